@@ -0,0 +1,8 @@
+import roaring from ".";
+
+/**
+ * Read only index over a bundle of bitmaps created with RoaringBitmap32.serializeBundle
+ *
+ * @type {roaring.RoaringBitmap32Bundle}
+ */
+export = roaring.RoaringBitmap32Bundle;
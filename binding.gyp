@@ -6,9 +6,9 @@
         {
             "target_name": "roaring",
             "default_configuration": "Release",
-            "cflags_cc": ["-O3", "-std=c++14", "-fno-rtti", "-fno-exceptions", "-fvisibility=hidden", "-flto", "-Wno-unused-variable", "-Wno-cast-function-type"],
+            "cflags_cc": ["-O3", "-std=c++17", "-fno-rtti", "-fno-exceptions", "-fvisibility=hidden", "-flto", "-Wno-unused-variable", "-Wno-cast-function-type"],
             'xcode_settings': {
-                'OTHER_CFLAGS': ["-O3", "-std=c++14", "-mcpu=native", "-fno-rtti", "-fno-exceptions", "-fvisibility=hidden", "-flto"],
+                'OTHER_CFLAGS': ["-O3", "-std=c++17", "-mcpu=native", "-fno-rtti", "-fno-exceptions", "-fvisibility=hidden", "-flto"],
             },
             "sources": [
                 "src/cpp/RoaringBitmap32.cpp"
@@ -89,6 +89,15 @@ export class RoaringBitmap32 implements Set<number> {
    */
   public readonly isEmpty: boolean;
 
+  /**
+   * Property. True if the bitmap is frozen and cannot be modified, methods that modify the bitmap throw.
+   * Bitmaps created with RoaringBitmap32.frozenView or frozen with freeze() are frozen.
+   *
+   * @type {boolean}
+   * @memberof RoaringBitmap32
+   */
+  public readonly isFrozen: boolean;
+
   /**
    * Creates an instance of RoaringBitmap32.
    *
@@ -128,6 +137,99 @@ export class RoaringBitmap32 implements Set<number> {
    */
   public static fromRange(rangeStart: number, rangeEnd: number, step?: number): RoaringBitmap32;
 
+  /**
+   * Creates a new bitmap that contains all the values in many intervals.
+   *
+   * The intervals are a flat list of [rangeStart, rangeEnd) pairs, trimmed like in RoaringBitmap32.fromRange.
+   * Use a Float64Array to pass rangeEnd 4294967296. Intervals can overlap.
+   * Sorted intervals are faster, run containers are built directly.
+   *
+   * @static
+   * @param {Uint32Array | Float64Array} ranges The [rangeStart, rangeEnd) pairs.
+   * @returns {RoaringBitmap32} A new RoaringBitmap32 instance.
+   * @memberof RoaringBitmap32
+   */
+  public static fromRanges(ranges: Uint32Array | Float64Array): RoaringBitmap32;
+
+  /**
+   * Creates a new bitmap that contains all the values in many intervals, asynchronously in a parallel thread.
+   * See RoaringBitmap32.fromRanges. The array must not be modified while the operation is running.
+   *
+   * @static
+   * @param {Uint32Array | Float64Array} ranges The [rangeStart, rangeEnd) pairs.
+   * @param {RoaringBitmap32AsyncOptions} [options] Options, options.signal aborts the operation.
+   * @returns {Promise<RoaringBitmap32>} A promise that resolves to a new RoaringBitmap32 instance.
+   * @memberof RoaringBitmap32
+   */
+  public static fromRangesAsync(
+    ranges: Uint32Array | Float64Array,
+    options?: RoaringBitmap32AsyncOptions,
+  ): Promise<RoaringBitmap32>;
+
+  /**
+   * Creates a new bitmap that contains all the values in many intervals, asynchronously in a parallel thread.
+   * See RoaringBitmap32.fromRanges. The array must not be modified while the operation is running.
+   *
+   * @static
+   * @param {Uint32Array | Float64Array} ranges The [rangeStart, rangeEnd) pairs.
+   * @param {RoaringBitmap32Callback} callback The callback to execute when the operation completes.
+   * @returns {void}
+   * @memberof RoaringBitmap32
+   */
+  public static fromRangesAsync(ranges: Uint32Array | Float64Array, callback: RoaringBitmap32Callback): void;
+
+  /**
+   * Creates a new bitmap from a text of decimal values.
+   *
+   * - "json" (default) is an array of numbers, like "[1,2,3]".
+   * - "csv" has values separated by commas or new lines, like "1,2,3".
+   * - "ndjson" has one value per line.
+   *
+   * csv and ndjson also accept inclusive ranges, like "10-20". Empty items and whitespace are ignored.
+   * Throws an error if the text is not valid or a value is not a 32 bit unsigned integer.
+   *
+   * @static
+   * @param {string | Uint8Array} text The text to parse, a string or an UTF-8 Buffer.
+   * @param {RoaringBitmap32TextFormat} [format="json"] The text format.
+   * @returns {RoaringBitmap32} A new RoaringBitmap32 instance.
+   * @memberof RoaringBitmap32
+   */
+  public static fromText(text: string | Uint8Array, format?: RoaringBitmap32TextFormat): RoaringBitmap32;
+
+  /**
+   * Creates a new bitmap from a text of decimal values asynchronously, in a parallel thread.
+   * See RoaringBitmap32.fromText. A Buffer must not be modified while the operation is running.
+   *
+   * @static
+   * @param {string | Uint8Array} text The text to parse, a string or an UTF-8 Buffer.
+   * @param {RoaringBitmap32TextFormat} [format="json"] The text format.
+   * @param {RoaringBitmap32AsyncOptions} [options] Options, options.signal aborts the operation.
+   * @returns {Promise<RoaringBitmap32>} A promise that resolves to a new RoaringBitmap32 instance.
+   * @memberof RoaringBitmap32
+   */
+  public static fromTextAsync(
+    text: string | Uint8Array,
+    format?: RoaringBitmap32TextFormat,
+    options?: RoaringBitmap32AsyncOptions,
+  ): Promise<RoaringBitmap32>;
+
+  /**
+   * Creates a new bitmap from a text of decimal values asynchronously, in a parallel thread.
+   * See RoaringBitmap32.fromText. A Buffer must not be modified while the operation is running.
+   *
+   * @static
+   * @param {string | Uint8Array} text The text to parse, a string or an UTF-8 Buffer.
+   * @param {RoaringBitmap32TextFormat | undefined} format The text format.
+   * @param {RoaringBitmap32Callback} callback The callback to execute when the operation completes.
+   * @returns {void}
+   * @memberof RoaringBitmap32
+   */
+  public static fromTextAsync(
+    text: string | Uint8Array,
+    format: RoaringBitmap32TextFormat | undefined,
+    callback: RoaringBitmap32Callback,
+  ): void;
+
   /**
    *
    * Creates an instance of RoaringBitmap32 from the given Iterable asynchronously in a parallel thread.
@@ -136,14 +238,21 @@ export class RoaringBitmap32 implements Set<number> {
    *
    * NOTE: This method will throw a TypeError if a RoaringBitmap32 is passed as argument.
    *
+   * Arrays with more than 1048576 values are built in multiple parallel threads:
+   * unsorted values are first partitioned by their highest bits, then each partition is built concurrently.
+   *
    * Returns a Promise that resolves to a new RoaringBitmap32 instance.
    *
    * @static
    * @param {Iterable<number>} values The values to set. Cannot be a RoaringBitmap32.
+   * @param {RoaringBitmap32ParallelAsyncOptions} [options] Options, options.signal aborts the operation.
    * @returns {Promise<RoaringBitmap32>} A promise that resolves to a new RoaringBitmap32 instance filled with all the given values.
    * @memberof RoaringBitmap32
    */
-  public static fromArrayAsync(values: Iterable<number> | null | undefined): Promise<RoaringBitmap32>;
+  public static fromArrayAsync(
+    values: Iterable<number> | null | undefined,
+    options?: RoaringBitmap32ParallelAsyncOptions,
+  ): Promise<RoaringBitmap32>;
 
   /**
    *
@@ -195,10 +304,15 @@ export class RoaringBitmap32 implements Set<number> {
    * @static
    * @param {Uint8Array} serialized An Uint8Array or a node Buffer that contains the serialized data.
    * @param {boolean} portable If false, optimized C/C++ format is used.  If true, Java and Go portable format is used.
+   * @param {RoaringBitmap32AsyncOptions} [options] Options, options.signal aborts the operation.
    * @returns {Promise<RoaringBitmap32>} A promise that resolves to a new RoaringBitmap32 instance.
    * @memberof RoaringBitmap32
    */
-  public static deserializeAsync(serialized: Uint8Array, portable: boolean): Promise<RoaringBitmap32>;
+  public static deserializeAsync(
+    serialized: Uint8Array,
+    portable: boolean,
+    options?: RoaringBitmap32AsyncOptions,
+  ): Promise<RoaringBitmap32>;
 
   /**
    *
@@ -234,12 +348,14 @@ export class RoaringBitmap32 implements Set<number> {
    * @static
    * @param {Uint8Array[]} serialized An Uint8Array or a node Buffer that contains the serialized data.
    * @param {boolean} portable If false, optimized C/C++ format is used.  If true, Java and Go portable format is used.
+   * @param {RoaringBitmap32ParallelAsyncOptions} [options] Scheduling options, options.signal aborts the operation.
    * @returns {Promise<RoaringBitmap32[]>} A promise that resolves to a new RoaringBitmap32 instance.
    * @memberof RoaringBitmap32
    */
   public static deserializeParallelAsync(
     serialized: (Uint8Array | null | undefined)[],
     portable: boolean,
+    options?: RoaringBitmap32ParallelAsyncOptions,
   ): Promise<RoaringBitmap32[]>;
 
   /**
@@ -267,6 +383,189 @@ export class RoaringBitmap32 implements Set<number> {
     callback: RoaringBitmap32ArrayCallback,
   ): void;
 
+  /**
+   * Creates a frozen, read only bitmap that is a view of a buffer written by RoaringBitmap32.prototype.serializeFrozen.
+   *
+   * The containers are not copied, the bitmap reads directly the memory of the buffer, that is kept alive
+   * while the bitmap is alive. A SharedArrayBuffer can be shared this way between worker threads.
+   * The buffer must not be modified while the bitmap is alive.
+   * If the buffer was copied and the data is not aligned anymore, the bitmap is copied.
+   *
+   * @static
+   * @param {SharedArrayBuffer | ArrayBuffer | Uint8Array} buffer The buffer that contains the frozen bitmap.
+   * @param {number} [byteOffset=0] The byteOffset passed to serializeFrozen.
+   * @returns {RoaringBitmap32} A new frozen RoaringBitmap32 instance.
+   * @memberof RoaringBitmap32
+   */
+  public static frozenView(buffer: SharedArrayBuffer | ArrayBuffer | Uint8Array, byteOffset?: number): RoaringBitmap32;
+
+  /**
+   * Serializes the difference between two versions of a bitmap.
+   *
+   * The diff contains only the containers that changed between base and current, xor encoded and compressed,
+   * so it is much smaller than the full serialization when only a small fraction of values changed.
+   * Use RoaringBitmap32.applyDiff on a copy of base to obtain current.
+   *
+   * The diff is protected by a CRC32C checksum. It stores the cardinality of base and current, and a fingerprint
+   * of base: a CRC32C of the keys of all the containers of base and of the values of the containers the diff changes.
+   * applyDiff checks them and throws if they do not match, so applying the diff to another base is detected
+   * unless the two bases differ only in the values of containers that the diff does not change.
+   *
+   * @static
+   * @param {RoaringBitmap32} base The previous version of the bitmap.
+   * @param {RoaringBitmap32} current The current version of the bitmap.
+   * @returns {Buffer} A new node Buffer that contains the diff.
+   * @memberof RoaringBitmap32
+   */
+  public static serializeDiff(base: RoaringBitmap32, current: RoaringBitmap32): Buffer;
+
+  /**
+   * Serializes the difference between two versions of a bitmap asynchronously in a parallel thread.
+   * See RoaringBitmap32.serializeDiff.
+   *
+   * The diff is computed on a copy of the two bitmaps, so they can be changed while the operation runs.
+   *
+   * @static
+   * @param {RoaringBitmap32} base The previous version of the bitmap.
+   * @param {RoaringBitmap32} current The current version of the bitmap.
+   * @param {RoaringBitmap32AsyncOptions} [options] Options, options.signal aborts the operation.
+   * @returns {Promise<Buffer>} A promise that resolves to a new node Buffer that contains the diff.
+   * @memberof RoaringBitmap32
+   */
+  public static serializeDiffAsync(
+    base: RoaringBitmap32,
+    current: RoaringBitmap32,
+    options?: RoaringBitmap32AsyncOptions,
+  ): Promise<Buffer>;
+
+  /**
+   * Serializes the difference between two versions of a bitmap asynchronously in a parallel thread.
+   * See RoaringBitmap32.serializeDiff.
+   *
+   * When the operation is completed or failed, the given callback will be executed.
+   *
+   * @static
+   * @param {RoaringBitmap32} base The previous version of the bitmap.
+   * @param {RoaringBitmap32} current The current version of the bitmap.
+   * @param {RoaringBitmap32BufferCallback} callback The callback to execute when the operation completes.
+   * @returns {void}
+   * @memberof RoaringBitmap32
+   */
+  public static serializeDiffAsync(
+    base: RoaringBitmap32,
+    current: RoaringBitmap32,
+    callback: RoaringBitmap32BufferCallback,
+  ): void;
+
+  /**
+   * Applies a diff created with RoaringBitmap32.serializeDiff to the base bitmap.
+   *
+   * Returns a new bitmap, base is not modified.
+   * Throws if the diff is corrupted or if it was not created from the given base.
+   *
+   * @static
+   * @param {RoaringBitmap32} base The same base bitmap passed to RoaringBitmap32.serializeDiff.
+   * @param {Uint8Array} diff The diff created with RoaringBitmap32.serializeDiff.
+   * @returns {RoaringBitmap32} A new RoaringBitmap32 instance equal to the current bitmap passed to serializeDiff.
+   * @memberof RoaringBitmap32
+   */
+  public static applyDiff(base: RoaringBitmap32, diff: Uint8Array): RoaringBitmap32;
+
+  /**
+   * Applies a diff created with RoaringBitmap32.serializeDiff to the base bitmap asynchronously in a parallel thread.
+   * See RoaringBitmap32.applyDiff.
+   *
+   * @static
+   * @param {RoaringBitmap32} base The same base bitmap passed to RoaringBitmap32.serializeDiff.
+   * @param {Uint8Array} diff The diff created with RoaringBitmap32.serializeDiff.
+   * @param {RoaringBitmap32AsyncOptions} [options] Options, options.signal aborts the operation.
+   * @returns {Promise<RoaringBitmap32>} A promise that resolves to a new RoaringBitmap32 instance.
+   * @memberof RoaringBitmap32
+   */
+  public static applyDiffAsync(
+    base: RoaringBitmap32,
+    diff: Uint8Array,
+    options?: RoaringBitmap32AsyncOptions,
+  ): Promise<RoaringBitmap32>;
+
+  /**
+   * Applies a diff created with RoaringBitmap32.serializeDiff to the base bitmap asynchronously in a parallel thread.
+   * See RoaringBitmap32.applyDiff.
+   *
+   * When the operation is completed or failed, the given callback will be executed.
+   *
+   * @static
+   * @param {RoaringBitmap32} base The same base bitmap passed to RoaringBitmap32.serializeDiff.
+   * @param {Uint8Array} diff The diff created with RoaringBitmap32.serializeDiff.
+   * @param {RoaringBitmap32Callback} callback The callback to execute when the operation completes.
+   * @returns {void}
+   * @memberof RoaringBitmap32
+   */
+  public static applyDiffAsync(base: RoaringBitmap32, diff: Uint8Array, callback: RoaringBitmap32Callback): void;
+
+  /**
+   * Serializes many bitmaps, each one identified by a string key, into a single bundle Buffer.
+   *
+   * The bundle contains a directory that maps each key to the position of its bitmap,
+   * so single bitmaps can be loaded on demand with RoaringBitmap32Bundle without deserializing the whole bundle.
+   *
+   * Bitmaps are stored in the portable format (compatible with Java and Go) or in the frozen format,
+   * that is bigger but faster to load. A CRC32C checksum of each bitmap can be stored and is verified on load.
+   *
+   * @static
+   * @param {ReadonlyMap<string, RoaringBitmap32> | ReadonlyArray<[string, RoaringBitmap32]> | { [key: string]: RoaringBitmap32 }} entries The bitmaps to serialize.
+   * @param {RoaringBitmap32BundleOptions} [options] Serialization options.
+   * @returns {Buffer} A new node Buffer that contains the bundle.
+   * @memberof RoaringBitmap32
+   */
+  public static serializeBundle(
+    entries:
+      | ReadonlyMap<string, RoaringBitmap32>
+      | ReadonlyArray<[string, RoaringBitmap32]>
+      | { readonly [key: string]: RoaringBitmap32 },
+    options?: RoaringBitmap32BundleOptions,
+  ): Buffer;
+
+  /**
+   * Deserializes the bitmaps with the given keys from a bundle asynchronously, in parallel threads.
+   *
+   * The resulting array has the same length of the keys array, missing keys are undefined.
+   * If a checksum does not match or a bitmap is corrupted the operation fails.
+   *
+   * @static
+   * @param {RoaringBitmap32Bundle | Uint8Array} bundle A bundle or a buffer created with RoaringBitmap32.serializeBundle
+   * @param {string[]} keys The keys of the bitmaps to load.
+   * @param {RoaringBitmap32ParallelAsyncOptions} [options] Scheduling options, options.signal aborts the operation.
+   * @returns {Promise<(RoaringBitmap32 | undefined)[]>} A promise that resolves to the loaded bitmaps.
+   * @memberof RoaringBitmap32
+   */
+  public static deserializeBundleParallelAsync(
+    bundle: RoaringBitmap32Bundle | Uint8Array,
+    keys: ReadonlyArray<string>,
+    options?: RoaringBitmap32ParallelAsyncOptions,
+  ): Promise<(RoaringBitmap32 | undefined)[]>;
+
+  /**
+   * Deserializes the bitmaps with the given keys from a bundle asynchronously, in parallel threads.
+   *
+   * The resulting array has the same length of the keys array, missing keys are undefined.
+   * If a checksum does not match or a bitmap is corrupted the operation fails.
+   *
+   * When deserialization is completed or failed, the given callback will be executed.
+   *
+   * @static
+   * @param {RoaringBitmap32Bundle | Uint8Array} bundle A bundle or a buffer created with RoaringBitmap32.serializeBundle
+   * @param {string[]} keys The keys of the bitmaps to load.
+   * @param {RoaringBitmap32BundleCallback} callback The callback to execute when the operation completes.
+   * @returns {void}
+   * @memberof RoaringBitmap32
+   */
+  public static deserializeBundleParallelAsync(
+    bundle: RoaringBitmap32Bundle | Uint8Array,
+    keys: ReadonlyArray<string>,
+    callback: RoaringBitmap32BundleCallback,
+  ): void;
+
   /**
    * Swaps the content of two RoaringBitmap32 instances.
    *
@@ -277,6 +576,30 @@ export class RoaringBitmap32 implements Set<number> {
    */
   public static swap(a: RoaringBitmap32, b: RoaringBitmap32): void;
 
+  /**
+   * Gets the number of threads used by the asynchronous operations.
+   *
+   * Asynchronous operations run in a thread pool separate from the libuv thread pool,
+   * so they do not delay fs, dns and zlib operations. Serialization runs with a lower priority than deserialization.
+   * The pool is shared by all the worker threads of the process.
+   *
+   * @static
+   * @returns {number} The number of threads. Defaults to the number of CPUs.
+   * @memberof RoaringBitmap32
+   */
+  public static getThreadPoolSize(): number;
+
+  /**
+   * Sets the number of threads used by the asynchronous operations.
+   * Threads are started when needed and stopped when the pool shrinks.
+   *
+   * @static
+   * @param {number} size The number of threads, from 1 to 1024. Zero resets to the number of CPUs.
+   * @returns {void}
+   * @memberof RoaringBitmap32
+   */
+  public static setThreadPoolSize(size: number): void;
+
   /**
    * Returns a new RoaringBitmap32 with the intersection (and) between the given two bitmaps.
    *
@@ -396,10 +719,14 @@ export class RoaringBitmap32 implements Set<number> {
    *
    * Same as [Symbol.iterator]()
    *
+   * With options.snapshot the iterator reads a copy on write snapshot taken when the iterator is created,
+   * the bitmap can then be changed while iterating.
+   *
+   * @param {RoaringBitmap32IteratorOptions} [options] The iterator options.
    * @returns {RoaringBitmap32Iterator} A new iterator
    * @memberof RoaringBitmap32
    */
-  public iterator(): RoaringBitmap32Iterator;
+  public iterator(options?: RoaringBitmap32IteratorOptions): RoaringBitmap32Iterator;
 
   /**
    * Gets a new iterator able to iterate all values in the set in ascending order.
@@ -624,6 +951,63 @@ export class RoaringBitmap32 implements Set<number> {
    */
   public removeRange(rangeStart: number, rangeEnd: number): this;
 
+  /**
+   * Adds all the values in many intervals, a flat list of [rangeStart, rangeEnd) pairs.
+   * Same as calling addRange for each interval, but faster.
+   *
+   * @param {Uint32Array | Float64Array} ranges The [rangeStart, rangeEnd) pairs.
+   * @returns {this} This RoaringBitmap32 instance.
+   * @memberof RoaringBitmap32
+   */
+  public addRanges(ranges: Uint32Array | Float64Array): this;
+
+  /**
+   * Removes all the values in many intervals, a flat list of [rangeStart, rangeEnd) pairs.
+   * Same as calling removeRange for each interval, but faster.
+   *
+   * @param {Uint32Array | Float64Array} ranges The [rangeStart, rangeEnd) pairs.
+   * @returns {this} This RoaringBitmap32 instance.
+   * @memberof RoaringBitmap32
+   */
+  public removeRanges(ranges: Uint32Array | Float64Array): this;
+
+  /**
+   * Negates the values in many intervals, a flat list of [rangeStart, rangeEnd) pairs.
+   * Same as calling flipRange for each interval in order, so values in overlapping intervals are negated more than once.
+   * Faster if the intervals are sorted and do not overlap.
+   *
+   * @param {Uint32Array | Float64Array} ranges The [rangeStart, rangeEnd) pairs.
+   * @returns {this} This RoaringBitmap32 instance.
+   * @memberof RoaringBitmap32
+   */
+  public flipRanges(ranges: Uint32Array | Float64Array): this;
+
+  /**
+   * Gets the runs of consecutive values as a flat list of sorted, disjoint [rangeStart, rangeEnd) pairs.
+   * The result can be passed to RoaringBitmap32.fromRanges.
+   *
+   * In an Uint32Array, a rangeEnd of 4294967296 (when the bitmap contains 4294967295) is stored as 0.
+   * fromRanges and addRanges read it back correctly. Use a Float64Array output to get the exact value.
+   *
+   * @param {number} [maxRanges] The maximum number of ranges to return.
+   * @returns {Uint32Array} A new Uint32Array with the [rangeStart, rangeEnd) pairs.
+   * @memberof RoaringBitmap32
+   */
+  public toRanges(maxRanges?: number): Uint32Array;
+
+  /**
+   * Writes the runs of consecutive values as a flat list of sorted, disjoint [rangeStart, rangeEnd) pairs
+   * in the given array, up to the length of the array or maxRanges.
+   *
+   * In an Uint32Array, a rangeEnd of 4294967296 (when the bitmap contains 4294967295) is stored as 0.
+   *
+   * @param {Uint32Array | Float64Array} output The array to write to.
+   * @param {number} [maxRanges] The maximum number of ranges to write.
+   * @returns {Uint32Array | Float64Array} A view of the written part of the output array.
+   * @memberof RoaringBitmap32
+   */
+  public toRanges<TOutput extends Uint32Array | Float64Array>(output: TOutput, maxRanges?: number): TOutput;
+
   /**
    * Removes all values from the set.
    *
@@ -825,6 +1209,7 @@ export class RoaringBitmap32 implements Set<number> {
 
   /**
    * If needed, reallocate memory to shrink the memory usage.
+   * Releases also the memory kept by the incremental serialization.
    *
    * Returns the number of bytes saved.
    *
@@ -833,6 +1218,30 @@ export class RoaringBitmap32 implements Set<number> {
    */
   public shrinkToFit(): number;
 
+  /**
+   * Sets a policy that automatically runs runOptimize() and shrinkToFit() on the containers
+   * changed since the last optimization, so long lived bitmaps modified with add and remove stay compact.
+   *
+   * add, tryAdd, remove and delete mark only the container of the value, other mutations mark all the containers.
+   * The total of the bytes released is reported by statistics() as autoOptimizeSavedBytes.
+   * The policy is not copied by clone(). Pass false to remove the policy.
+   *
+   * @param {RoaringBitmap32AutoOptimizeOptions | false} options The policy, or false to disable it.
+   * @returns {this} This RoaringBitmap32 instance.
+   * @memberof RoaringBitmap32
+   */
+  public setAutoOptimize(options: RoaringBitmap32AutoOptimizeOptions | false | null | undefined): this;
+
+  /**
+   * Makes this bitmap immutable: after this call isFrozen is true and the methods that modify the bitmap throw.
+   * A bitmap cannot be unfrozen, clone() returns a mutable copy.
+   * The containers still pending for the setAutoOptimize policy are optimized, then the policy is removed.
+   *
+   * @returns {this} This RoaringBitmap32 instance.
+   * @memberof RoaringBitmap32
+   */
+  public freeze(): this;
+
   /**
    *  Returns the number of values in the set that are smaller or equal to the given value.
    *
@@ -868,6 +1277,40 @@ export class RoaringBitmap32 implements Set<number> {
    */
   public toUint32Array(): Uint32Array;
 
+  /**
+   * Creates a new Uint32Array and fills it with all the values in the bitmap asynchronously, in a parallel thread.
+   *
+   * A copy on write snapshot of the bitmap is read, so the bitmap can be changed while the operation is running.
+   * Useful to export very big bitmaps without blocking the main thread.
+   *
+   * @param {RoaringBitmap32AsyncOptions} [options] The options, options.signal aborts the operation.
+   * @returns {Promise<Uint32Array>} A promise that resolves to a new Uint32Array containing all the items in the set in order.
+   * @memberof RoaringBitmap32
+   */
+  public toUint32ArrayAsync(options?: RoaringBitmap32AsyncOptions): Promise<Uint32Array>;
+
+  /**
+   * Creates a new Uint32Array and fills it with all the values in the bitmap asynchronously, in a parallel thread.
+   *
+   * @param {RoaringBitmap32AsyncOptions | undefined} options The options, options.signal aborts the operation.
+   * @param {RoaringBitmap32Uint32ArrayCallback} callback The callback to execute when the operation completes.
+   * @returns {void}
+   * @memberof RoaringBitmap32
+   */
+  public toUint32ArrayAsync(
+    options: RoaringBitmap32AsyncOptions | undefined,
+    callback: RoaringBitmap32Uint32ArrayCallback,
+  ): void;
+
+  /**
+   * Creates a new Uint32Array and fills it with all the values in the bitmap asynchronously, in a parallel thread.
+   *
+   * @param {RoaringBitmap32Uint32ArrayCallback} callback The callback to execute when the operation completes.
+   * @returns {void}
+   * @memberof RoaringBitmap32
+   */
+  public toUint32ArrayAsync(callback: RoaringBitmap32Uint32ArrayCallback): void;
+
   /**
    * to array with pagination
    * @returns A new Uint32Array instance containing paginated items in the set in order.
@@ -905,6 +1348,49 @@ export class RoaringBitmap32 implements Set<number> {
    */
   public toJSON(): number[];
 
+  /**
+   * Returns the content of the bitmap as a compact JSON array string, like "[1,2,3]".
+   *
+   * Same result as JSON.stringify(bitmap), but the string is written natively without creating an array.
+   *
+   * @returns {string} A JSON array string with all the values in the set in order.
+   * @memberof RoaringBitmap32
+   */
+  public toJSONString(): string;
+
+  /**
+   * Returns the content of the bitmap as text, in the given format.
+   *
+   * "json" (default) writes "[1,2,3]", "csv" writes "1,2,3" and "ndjson" writes one value per line.
+   * The result can be parsed back with RoaringBitmap32.fromText.
+   *
+   * @param {RoaringBitmap32TextFormat} [format="json"] The text format.
+   * @returns {string} The values in the set in order, as text.
+   * @memberof RoaringBitmap32
+   */
+  public toText(format?: RoaringBitmap32TextFormat): string;
+
+  /**
+   * Returns the content of the bitmap as text asynchronously, in a parallel thread.
+   * A copy on write snapshot of the bitmap is read, so the bitmap can be changed while the operation is running.
+   *
+   * @param {RoaringBitmap32TextFormat} [format="json"] The text format.
+   * @param {RoaringBitmap32AsyncOptions} [options] The options, options.signal aborts the operation.
+   * @returns {Promise<string>} A promise that resolves to the values in the set in order, as text.
+   * @memberof RoaringBitmap32
+   */
+  public toTextAsync(format?: RoaringBitmap32TextFormat, options?: RoaringBitmap32AsyncOptions): Promise<string>;
+
+  /**
+   * Returns the content of the bitmap as text asynchronously, in a parallel thread.
+   *
+   * @param {RoaringBitmap32TextFormat | undefined} format The text format.
+   * @param {RoaringBitmap32TextCallback} callback The callback to execute when the operation completes.
+   * @returns {void}
+   * @memberof RoaringBitmap32
+   */
+  public toTextAsync(format: RoaringBitmap32TextFormat | undefined, callback: RoaringBitmap32TextCallback): void;
+
   /**
    * How many bytes are required to serialize this bitmap.
    *
@@ -914,10 +1400,11 @@ export class RoaringBitmap32 implements Set<number> {
    * NOTE: portable argument was optional before, now is required and an Error is thrown if the portable flag is not passed.
    *
    * @param {boolean} portable If false, optimized C/C++ format is used. If true, Java and Go portable format is used.
+   * @param {RoaringBitmap32SerializeOptions} [options] Serialization options.
    * @returns {number} How many bytes are required to serialize this bitmap.
    * @memberof RoaringBitmap32
    */
-  public getSerializationSizeInBytes(portable: boolean): number;
+  public getSerializationSizeInBytes(portable: boolean, options?: RoaringBitmap32SerializeOptions): number;
 
   /**
    * Serializes the bitmap into a new Buffer.
@@ -927,11 +1414,107 @@ export class RoaringBitmap32 implements Set<number> {
    *
    * NOTE: portable argument was optional before, now is required and an Error is thrown if the portable flag is not passed.
    *
+   * If options.checksum is true (non portable format only), the data is wrapped in an envelope that contains its CRC32C checksum,
+   * computed while serializing. Deserialization of a checksummed buffer fails if the data was corrupted.
+   *
    * @param {boolean} portable If false, optimized C/C++ format is used. If true, Java and Go portable format is used.
+   * @param {RoaringBitmap32SerializeOptions} [options] Serialization options.
    * @returns {Buffer} A new node Buffer that contains the serialized bitmap.
    * @memberof RoaringBitmap32
    */
-  public serialize(portable: boolean): Buffer;
+  public serialize(portable: boolean, options?: RoaringBitmap32SerializeOptions): Buffer;
+
+  /**
+   * Serializes the bitmap into a new Buffer asynchronously, in a parallel thread.
+   *
+   * A copy on write snapshot of the bitmap is serialized, so the bitmap can be changed while the operation is running.
+   * This is useful with the compressed format, that requires more CPU time.
+   *
+   * @param {boolean} portable If false, optimized C/C++ format is used. If true, Java and Go portable format is used.
+   * @param {RoaringBitmap32SerializeOptions & RoaringBitmap32AsyncOptions} [options] Serialization options, options.signal aborts the operation.
+   * @returns {Promise<Buffer>} A promise that resolves to a new node Buffer that contains the serialized bitmap.
+   * @memberof RoaringBitmap32
+   */
+  public serializeAsync(
+    portable: boolean,
+    options?: RoaringBitmap32SerializeOptions & RoaringBitmap32AsyncOptions,
+  ): Promise<Buffer>;
+
+  /**
+   * Serializes the bitmap into a new Buffer asynchronously, in a parallel thread.
+   *
+   * A copy on write snapshot of the bitmap is serialized, so the bitmap can be changed while the operation is running.
+   * This is useful with the compressed format, that requires more CPU time.
+   *
+   * @param {boolean} portable If false, optimized C/C++ format is used. If true, Java and Go portable format is used.
+   * @param {RoaringBitmap32SerializeOptions} options Serialization options.
+   * @param {RoaringBitmap32BufferCallback} callback The callback to execute when the operation completes.
+   * @returns {void}
+   * @memberof RoaringBitmap32
+   */
+  public serializeAsync(
+    portable: boolean,
+    options: (RoaringBitmap32SerializeOptions & RoaringBitmap32AsyncOptions) | undefined,
+    callback: RoaringBitmap32BufferCallback,
+  ): void;
+
+  /**
+   * Serializes the bitmap into a new Buffer asynchronously, in a parallel thread.
+   *
+   * @param {boolean} portable If false, optimized C/C++ format is used. If true, Java and Go portable format is used.
+   * @param {RoaringBitmap32BufferCallback} callback The callback to execute when the operation completes.
+   * @returns {void}
+   * @memberof RoaringBitmap32
+   */
+  public serializeAsync(portable: boolean, callback: RoaringBitmap32BufferCallback): void;
+
+  /**
+   * Gets the maximum number of bytes written by serializeFrozen, including the header and the alignment padding.
+   *
+   * @returns {number} The size in bytes.
+   * @memberof RoaringBitmap32
+   */
+  public getFrozenSizeInBytes(): number;
+
+  /**
+   * Serializes the bitmap in the frozen format into a new SharedArrayBuffer.
+   *
+   * The SharedArrayBuffer can be sent to other worker threads,
+   * that can use RoaringBitmap32.frozenView to read the bitmap without copying it.
+   *
+   * @returns {SharedArrayBuffer} A new SharedArrayBuffer that contains the frozen bitmap.
+   * @memberof RoaringBitmap32
+   */
+  public serializeFrozen(): SharedArrayBuffer;
+
+  /**
+   * Serializes the bitmap in the frozen format into the given buffer, starting at byteOffset.
+   *
+   * The data is aligned in memory so RoaringBitmap32.frozenView can use it without copying.
+   * The buffer must have at least getFrozenSizeInBytes() bytes available after byteOffset.
+   *
+   * @param {SharedArrayBuffer | ArrayBuffer | Uint8Array} target The buffer to write to.
+   * @param {number} [byteOffset=0] The position in the buffer where to start writing.
+   * @returns {number} The number of bytes written.
+   * @memberof RoaringBitmap32
+   */
+  public serializeFrozen(target: SharedArrayBuffer | ArrayBuffer | Uint8Array, byteOffset?: number): number;
+
+  /**
+   * Serializes the bitmap in the portable format, emitting it in chunks of at most chunkSize bytes.
+   *
+   * The concatenation of all the chunks is identical to the output of serialize(true),
+   * but the whole serialized bitmap is never allocated in memory at once, so memory usage is bounded by chunkSize.
+   *
+   * The returned iterable can be used as a source for a Readable stream: stream.Readable.from(bitmap.serializeToChunks())
+   *
+   * NOTE: An Error is thrown if the bitmap is changed while serializing.
+   *
+   * @param {number} [chunkSize] The maximum size of each chunk in bytes. Default is 65536.
+   * @returns {IterableIterator<Buffer>} An iterable of node Buffers, each one containing the next chunk of the serialized bitmap.
+   * @memberof RoaringBitmap32
+   */
+  public serializeToChunks(chunkSize?: number): IterableIterator<Buffer>;
 
   /**
    * Deserializes the bitmap from an Uint8Array or a Buffer.
@@ -949,6 +1532,10 @@ export class RoaringBitmap32 implements Set<number> {
   /**
    * Returns a new RoaringBitmap32 that is a copy of this bitmap, same as new RoaringBitmap32(copy)
    *
+   * The copy is copy on write: the two bitmaps share their containers,
+   * a container is copied only when one of the two bitmaps modifies it.
+   * The clone of a frozen bitmap is not frozen.
+   *
    * @returns {RoaringBitmap32} A cloned RoaringBitmap32 instance
    * @memberof RoaringBitmap32
    */
@@ -992,6 +1579,19 @@ export class RoaringBitmap32 implements Set<number> {
    * @memberof RoaringBitmap32
    */
   public statistics(): RoaringBitmap32Statistics;
+
+  /**
+   * Returns the details of each container in this RoaringBitmap32 instance, as parallel typed arrays.
+   *
+   * A container holds all the values with the same high 16 bits (the key).
+   * Useful to find containers that use more memory than expected, for example bitsets with few values.
+   *
+   * @param {number} [minKey=0] The first key to include, between 0 and 65535.
+   * @param {number} [maxKey=65535] The last key to include, between 0 and 65535.
+   * @returns {RoaringBitmap32Containers} The keys, types, cardinalities and sizes of the containers, in key order.
+   * @memberof RoaringBitmap32
+   */
+  public containers(minKey?: number, maxKey?: number): RoaringBitmap32Containers;
 }
 
 /**
@@ -1036,6 +1636,23 @@ export class RoaringBitmap32Iterator implements IterableIterator<number> {
    */
   public constructor(roaringBitmap32: RoaringBitmap32, buffer: Uint32Array);
 
+  /**
+   * Creates a new iterator able to iterate a RoaringBitmap32 with the given options.
+   *
+   * With options.snapshot the iterator reads a copy on write snapshot taken in the constructor,
+   * the bitmap can then be changed while iterating. Without it, the iterator throws if the bitmap is changed.
+   *
+   * @param {RoaringBitmap32} roaringBitmap32 The roaring bitmap to iterate
+   * @param {number | Uint32Array | undefined} buffer The buffer size or the reusable temporary buffer.
+   * @param {RoaringBitmap32IteratorOptions} options The iterator options.
+   * @memberof RoaringBitmap32Iterator
+   */
+  public constructor(
+    roaringBitmap32: RoaringBitmap32,
+    buffer: number | Uint32Array | undefined,
+    options: RoaringBitmap32IteratorOptions,
+  );
+
   /**
    * Returns this.
    *
@@ -1055,6 +1672,170 @@ export class RoaringBitmap32Iterator implements IterableIterator<number> {
   public next(): IteratorResult<number>;
 }
 
+/**
+ * Read only index over a bundle of bitmaps created with RoaringBitmap32.serializeBundle.
+ *
+ * The bundle keeps a reference to the given buffer and deserializes single bitmaps on demand.
+ * The buffer must not be modified while the bundle is in use.
+ *
+ * @export
+ * @class RoaringBitmap32Bundle
+ */
+export class RoaringBitmap32Bundle {
+  // Allows: import RoaringBitmap32Bundle from 'roaring/RoaringBitmap32Bundle'
+  private static readonly default: typeof RoaringBitmap32Bundle;
+
+  /**
+   * The number of bitmaps in the bundle.
+   *
+   * @type {number}
+   * @memberof RoaringBitmap32Bundle
+   */
+  public readonly size: number;
+
+  /**
+   * Opens a bundle. The header and the directory are validated, bitmaps are not deserialized.
+   *
+   * @param {Uint8Array} buffer A Buffer or Uint8Array created with RoaringBitmap32.serializeBundle
+   * @memberof RoaringBitmap32Bundle
+   */
+  public constructor(buffer: Uint8Array);
+
+  /**
+   * Gets all the keys in the bundle, in the order they were written.
+   *
+   * @returns {string[]} A new array of keys.
+   * @memberof RoaringBitmap32Bundle
+   */
+  public keys(): string[];
+
+  /**
+   * Checks if the bundle contains a bitmap with the given key.
+   *
+   * @param {string} key The key to look for.
+   * @returns {boolean} True if the key exists.
+   * @memberof RoaringBitmap32Bundle
+   */
+  public has(key: string): boolean;
+
+  /**
+   * Deserializes the bitmap with the given key.
+   *
+   * An Error is thrown if the checksum does not match or the bitmap is corrupted.
+   *
+   * @param {string} key The key of the bitmap to load.
+   * @returns {(RoaringBitmap32 | undefined)} A new RoaringBitmap32 instance or undefined if the key does not exist.
+   * @memberof RoaringBitmap32Bundle
+   */
+  public get(key: string): RoaringBitmap32 | undefined;
+}
+
+/**
+ * Options for RoaringBitmap32 serialize() and getSerializationSizeInBytes() methods
+ *
+ * @export
+ * @interface RoaringBitmap32SerializeOptions
+ */
+export interface RoaringBitmap32SerializeOptions {
+  /**
+   * If true, a CRC32C checksum is stored with the data and verified on deserialization. Default is false.
+   * Supported only by the non portable format.
+   * @type {boolean}
+   */
+  checksum?: boolean;
+
+  /**
+   * If true, the compressed format is used, meant for cold storage: values are delta encoded with varints or bit packing,
+   * consecutive values as runs, choosing the smallest encoding for each container. Default is false.
+   * Slower than the other formats, is detected automatically by the non portable deserialization.
+   * Supported only by the non portable format.
+   * @type {boolean}
+   */
+  compressed?: boolean;
+
+  /**
+   * If true, the encoded containers are kept in memory, and the next incremental serialization
+   * encodes again only the containers changed since then. Default is false.
+   * Useful to serialize often a big bitmap that changes slowly. Supported only by the compressed format,
+   * ignored by serializeAsync. The memory is released by shrinkToFit().
+   * @type {boolean}
+   */
+  incremental?: boolean;
+}
+
+/**
+ * Options for the asynchronous RoaringBitmap32 methods.
+ *
+ * @export
+ * @interface RoaringBitmap32AsyncOptions
+ */
+export interface RoaringBitmap32AsyncOptions {
+  /**
+   * When the signal is aborted the work stops as soon as possible, partial results are released
+   * and the operation fails with an Error with name "AbortError" and code "ABORT_ERR".
+   * @type {AbortSignal}
+   */
+  signal?: AbortSignal;
+
+  /**
+   * Queue order of the operation in the thread pool: jobs with an higher priority start first,
+   * jobs with the same priority start in order. It does not stop jobs that are already running.
+   * Default is "background" for serializeAsync and serializeDiffAsync, "normal" for the other methods.
+   * @type {"background" | "normal" | "high"}
+   */
+  priority?: "background" | "normal" | "high";
+}
+
+/**
+ * Options for the asynchronous RoaringBitmap32 methods that run in multiple parallel threads.
+ *
+ * @export
+ * @interface RoaringBitmap32ParallelAsyncOptions
+ */
+export interface RoaringBitmap32ParallelAsyncOptions extends RoaringBitmap32AsyncOptions {
+  /**
+   * The maximum number of threads to use, from 1 to 1024. Default is the size of the thread pool.
+   * @type {number}
+   */
+  concurrency?: number;
+
+  /**
+   * How many consecutive items a thread takes at once, from 1 to 65536.
+   * Bigger chunks are faster with many small bitmaps, smaller chunks balance better a few big bitmaps.
+   * Default is automatic, based on the number of items and threads.
+   * @type {number}
+   */
+  chunkSize?: number;
+
+  /**
+   * If true, the biggest bitmaps are processed first, so a big bitmap does not end up running alone at the end.
+   * Sorting is done synchronously before starting. Default is false.
+   * @type {boolean}
+   */
+  largestFirst?: boolean;
+}
+
+/**
+ * Options for RoaringBitmap32.serializeBundle
+ *
+ * @export
+ * @interface RoaringBitmap32BundleOptions
+ */
+export interface RoaringBitmap32BundleOptions {
+  /**
+   * The format used to store each bitmap. Default is "portable".
+   * "portable" is compatible with Java and Go, "frozen" is bigger but faster to load.
+   * @type {"portable" | "frozen"}
+   */
+  format?: "portable" | "frozen";
+
+  /**
+   * If true, a CRC32C checksum of the directory and of each bitmap is stored and verified on load. Default is false.
+   * @type {boolean}
+   */
+  checksum?: boolean;
+}
+
 /**
  * Object returned by RoaringBitmap32 statistics() method
  *
@@ -1145,6 +1926,80 @@ export interface RoaringBitmap32Statistics {
    * @type {number}
    */
   size: number;
+
+  /**
+   * Total number of bytes released by the automatic optimization, see RoaringBitmap32.setAutoOptimize
+   * @type {number}
+   */
+  autoOptimizeSavedBytes: number;
+}
+
+/**
+ * Options for RoaringBitmap32 setAutoOptimize() method
+ *
+ * @export
+ * @interface RoaringBitmap32AutoOptimizeOptions
+ */
+export interface RoaringBitmap32AutoOptimizeOptions {
+  /**
+   * Optimizes the changed containers after this number of mutations. Default is 0, disabled.
+   * @type {number}
+   */
+  everyNMutations?: number;
+
+  /**
+   * If true, the changed containers are optimized before the bitmap is serialized. Default is false.
+   * @type {boolean}
+   */
+  onSerialize?: boolean;
+}
+
+/**
+ * Options for RoaringBitmap32Iterator and RoaringBitmap32 iterator() method
+ *
+ * @export
+ * @interface RoaringBitmap32IteratorOptions
+ */
+export interface RoaringBitmap32IteratorOptions {
+  /**
+   * If true, the iterator reads a copy on write snapshot of the bitmap, so the bitmap can be changed while iterating.
+   * Only the containers changed after the snapshot are copied. Default is false.
+   * @type {boolean}
+   */
+  snapshot?: boolean;
+}
+
+/**
+ * Object returned by RoaringBitmap32 containers() method.
+ * All the arrays have one element per container, in key order.
+ *
+ * @export
+ * @interface RoaringBitmap32Containers
+ */
+export interface RoaringBitmap32Containers {
+  /**
+   * The high 16 bits of the values in each container.
+   * @type {Uint16Array}
+   */
+  keys: Uint16Array;
+
+  /**
+   * The type of each container: 1 is bitset, 2 is array, 3 is run.
+   * @type {Uint8Array}
+   */
+  types: Uint8Array;
+
+  /**
+   * The number of values in each container.
+   * @type {Uint32Array}
+   */
+  cardinalities: Uint32Array;
+
+  /**
+   * The number of bytes allocated for the values of each container.
+   * @type {Uint32Array}
+   */
+  sizesInBytes: Uint32Array;
 }
 
 /**
@@ -1175,5 +2030,18 @@ export type RoaringBitmap32Callback = (error: Error | null, bitmap: RoaringBitma
 
 export type RoaringBitmap32ArrayCallback = (error: Error | null, bitmap: RoaringBitmap32[] | undefined) => void;
 
+export type RoaringBitmap32BufferCallback = (error: Error | null, buffer: Buffer | undefined) => void;
+
+export type RoaringBitmap32Uint32ArrayCallback = (error: Error | null, array: Uint32Array | undefined) => void;
+
+export type RoaringBitmap32TextCallback = (error: Error | null, text: string | undefined) => void;
+
+export type RoaringBitmap32TextFormat = "json" | "csv" | "ndjson";
+
+export type RoaringBitmap32BundleCallback = (
+  error: Error | null,
+  bitmaps: (RoaringBitmap32 | undefined)[] | undefined,
+) => void;
+
 // tslint:disable-next-line:no-empty-interface
 declare interface Buffer extends Uint8Array {}
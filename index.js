@@ -9,7 +9,7 @@ const { defineProperty } = Reflect;
 
 defineProperty(roaring, "__esModule", { value: true });
 
-const { RoaringBitmap32, RoaringBitmap32BufferedIterator } = roaring;
+const { RoaringBitmap32, RoaringBitmap32BufferedIterator, RoaringBitmap32ChunkedSerializer } = roaring;
 
 class RoaringBitmap32IteratorResult {
   constructor() {
@@ -23,8 +23,9 @@ const _iteratorBufferPoolDefaultLen = 512;
 const _iteratorBufferPool = [];
 
 class RoaringBitmap32Iterator {
-  constructor(bitmap, buffer = _iteratorBufferPoolDefaultLen) {
+  constructor(bitmap, buffer = _iteratorBufferPoolDefaultLen, options) {
     const r = new RoaringBitmap32IteratorResult();
+    const snapshot = !!(options && options.snapshot);
     let t;
     let i = 0;
     let n = 0;
@@ -41,11 +42,16 @@ class RoaringBitmap32Iterator {
       if (typeof buffer === "number") {
         buffer = (buffer === _iteratorBufferPoolDefaultLen && _iteratorBufferPool.pop()) || new Uint32Array(buffer);
       }
-      t = new RoaringBitmap32BufferedIterator(bitmap, buffer);
+      t = new RoaringBitmap32BufferedIterator(bitmap, buffer, snapshot);
       n = t.n;
       r.done = false;
     };
 
+    if (snapshot && t === undefined) {
+      // The snapshot is taken now, changes made before the first call to next() are not seen.
+      init();
+    }
+
     const m = () => {
       if (t !== null) {
         if (t === undefined) {
@@ -99,8 +105,25 @@ const roaringBitmap32IteratorProp = {
 defineProperty(RoaringBitmap32Iterator, "default", roaringBitmap32IteratorProp);
 defineProperty(RoaringBitmap32Iterator, "RoaringBitmap32Iterator", roaringBitmap32IteratorProp);
 
-function iterator() {
-  return new RoaringBitmap32Iterator(this);
+function iterator(options) {
+  return new RoaringBitmap32Iterator(this, undefined, options);
+}
+
+const _serializeToChunksDefaultChunkSize = 65536;
+
+function* serializeToChunks(chunkSize = _serializeToChunksDefaultChunkSize) {
+  if (!Number.isInteger(chunkSize) || chunkSize < 1) {
+    throw new TypeError("RoaringBitmap32 serializeToChunks - chunkSize must be a positive integer");
+  }
+  const serializer = new RoaringBitmap32ChunkedSerializer(this);
+  for (;;) {
+    const chunk = Buffer.allocUnsafe(chunkSize);
+    const n = serializer.fill(chunk);
+    if (n === 0) {
+      break;
+    }
+    yield n === chunkSize ? chunk : chunk.subarray(0, n);
+  }
 }
 
 if (!roaring.PackageVersion) {
@@ -125,6 +148,7 @@ if (!roaring.PackageVersion) {
       }
     }
   };
+  roaringBitmap32Proto.serializeToChunks = serializeToChunks;
   roaringBitmap32Proto.PackageVersion = packageVersion;
 
   RoaringBitmap32.PackageVersion = packageVersion;
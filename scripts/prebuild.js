@@ -11,6 +11,8 @@ args.push("-t", "14.0.0");
 args.push("-t", "15.0.0");
 args.push("-t", "16.0.0");
 args.push("-t", "18.0.0");
+args.push("-t", "20.0.0");
+args.push("-t", "22.0.0");
 
 const token = process.argv[2] || process.env.PREBUILD_GITHUB_TOKEN;
 
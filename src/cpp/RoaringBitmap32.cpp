@@ -4,10 +4,14 @@
 #include <math.h>
 #include <cmath>
 #include <string>
+#include <unordered_set>
+#include <algorithm>
+#include <vector>
 
 /////////////////// unity build ///////////////////
 
 #include "v8utils/v8utils.cpp"
+#include "crc32c/crc32c.cpp"
 
 #define printf(...) ((void)0)
 #define fprintf(...) ((void)0)
@@ -16,6 +20,21 @@
 
 #define CROARING_SERIALIZATION_ARRAY_UINT32 1
 #define CROARING_SERIALIZATION_CONTAINER 2
+#define CROARING_SERIALIZATION_CRC32C 3
+#define CROARING_SERIALIZATION_CRC32C_HEADER_SIZE 5
+#define CROARING_SERIALIZATION_COMPRESSED 4
+
+// Diff format: "RBDF" magic, uint64 base cardinality, uint64 result cardinality, uint32 base fingerprint,
+// then the xor of the two bitmaps in the compressed non portable format with checksum.
+#define ROARING_DIFF_HEADER_SIZE 24
+static const char roaringDiffMagic[4] = {'R', 'B', 'D', 'F'};
+
+// Shared frozen format: uint32 length of the frozen data, uint32 offset of the frozen data,
+// then padding up to the first 32 bytes aligned address, then the frozen data.
+#define ROARING_SHARED_FROZEN_HEADER_SIZE 8
+#define ROARING_FROZEN_ALIGNMENT 32
+
+static const char frozenErrorMessage[] = "RoaringBitmap32 - the bitmap is frozen and cannot be modified";
 
 #if defined(__clang__)
 #  pragma clang diagnostic push
@@ -39,110 +58,214 @@
 
 #define MAX_SERIALIZATION_ARRAY_SIZE_IN_BYTES 0x00FFFFFF
 
+//////////// AddonData ////////////
+
+AddonData::AddonData(v8::Isolate * isolate) : isolate(isolate), _refs(1) {
+  v8::HandleScope scope(isolate);
+  this->external.Reset(isolate, v8::External::New(isolate, this));
+}
+
+AddonData::~AddonData() { this->_resetHandles(); }
+
+void AddonData::_resetHandles() {
+  this->RoaringBitmap32Bundle_constructor.Reset();
+  this->RoaringBitmap32Bundle_constructorTemplate.Reset();
+  this->RoaringBitmap32ChunkedSerializer_constructor.Reset();
+  this->RoaringBitmap32ChunkedSerializer_constructorTemplate.Reset();
+  this->RoaringBitmap32BufferedIterator_nPropertyName.Reset();
+  this->RoaringBitmap32BufferedIterator_constructor.Reset();
+  this->RoaringBitmap32BufferedIterator_constructorTemplate.Reset();
+  this->RoaringBitmap32_constructor.Reset();
+  this->RoaringBitmap32_constructorTemplate.Reset();
+  this->Uint32Array_from.Reset();
+  this->Set_constructor.Reset();
+  this->Uint32Array.Reset();
+  this->external.Reset();
+}
+
+void AddonData::acquire() { atomicIncrement32(&this->_refs); }
+
+void AddonData::release() {
+  if (atomicDecrement32(&this->_refs) == 0) {
+    delete this;
+  }
+}
+
+// The handles are reset while the isolate is still alive, the memory is released with the last async job.
+void AddonData::cleanup(void * param) {
+  auto * addonData = static_cast<AddonData *>(param);
+  addonData->_resetHandles();
+  addonData->release();
+}
+
+void AddonData::initJSTypes(const v8::Local<v8::Object> & global) {
+  v8::HandleScope scope(isolate);
+  auto context = isolate->GetCurrentContext();
+
+  auto uint32Array = global->Get(context, NEW_LITERAL_V8_STRING(isolate, "Uint32Array", v8::NewStringType::kInternalized))
+                       .ToLocalChecked()
+                       ->ToObject(context)
+                       .ToLocalChecked();
+
+  this->Uint32Array.Reset(isolate, uint32Array);
+
+  v8::Local<v8::Value> setConstructor;
+  if (
+    global->Get(context, NEW_LITERAL_V8_STRING(isolate, "Set", v8::NewStringType::kInternalized)).ToLocal(&setConstructor) &&
+    setConstructor->IsFunction()) {
+    this->Set_constructor.Reset(isolate, setConstructor.As<v8::Function>());
+  }
+  this->Uint32Array_from.Reset(
+    isolate,
+    v8::Local<v8::Function>::Cast(
+      uint32Array->Get(context, NEW_LITERAL_V8_STRING(isolate, "from", v8::NewStringType::kInternalized)).ToLocalChecked()));
+}
+
+void AddonData::setMethod(v8::Local<v8::Object> target, const char * name, v8::FunctionCallback callback) {
+  v8::HandleScope scope(isolate);
+  auto context = isolate->GetCurrentContext();
+  v8::Local<v8::Function> fn;
+  if (!v8::FunctionTemplate::New(isolate, callback, this->external.Get(isolate))->GetFunction(context).ToLocal(&fn)) {
+    return;
+  }
+  v8::Local<v8::String> fnName =
+    v8::String::NewFromUtf8(isolate, name, v8::NewStringType::kInternalized).ToLocalChecked();
+  fn->SetName(fnName);
+  v8utils::ignoreMaybeResult(target->Set(context, fnName, fn));
+}
+
+void AddonData::setPrototypeMethod(
+  v8::Local<v8::FunctionTemplate> target, const char * name, v8::FunctionCallback callback) {
+  v8::HandleScope scope(isolate);
+  v8::Local<v8::FunctionTemplate> t = v8::FunctionTemplate::New(
+    isolate, callback, this->external.Get(isolate), v8::Signature::New(isolate, target));
+  v8::Local<v8::String> fnName =
+    v8::String::NewFromUtf8(isolate, name, v8::NewStringType::kInternalized).ToLocalChecked();
+  t->SetClassName(fnName);
+  target->PrototypeTemplate()->Set(fnName, t);
+}
+
+//////////// Module ////////////
+
 void initTypes(const v8::FunctionCallbackInfo<v8::Value> & info) {
   v8::Isolate * isolate = info.GetIsolate();
   v8::HandleScope scope(isolate);
-  JSTypes::initJSTypes(isolate, info[0]->ToObject(isolate->GetCurrentContext()).ToLocalChecked());
+  AddonData::get(info)->initJSTypes(info[0]->ToObject(isolate->GetCurrentContext()).ToLocalChecked());
 }
 
 void InitModule(v8::Local<v8::Object> exports) {
   v8::Isolate * isolate = v8::Isolate::GetCurrent();
   v8::HandleScope scope(isolate);
 
-  JSTypes::initJSTypes(isolate, isolate->GetCurrentContext()->Global());
+  auto * addonData = new AddonData(isolate);
+#if NODE_MAJOR_VERSION >= 10
+  node::AddEnvironmentCleanupHook(isolate, AddonData::cleanup, addonData);
+#endif
+
+  addonData->initJSTypes(isolate->GetCurrentContext()->Global());
 
-  v8utils::defineHiddenFunction(isolate, exports, "_initTypes", initTypes);
+  v8utils::defineHiddenFunction(isolate, exports, "_initTypes", initTypes, addonData->external.Get(isolate));
   v8utils::defineHiddenField(isolate, exports, "default", exports);
 
-  RoaringBitmap32::Init(exports);
-  RoaringBitmap32BufferedIterator::Init(exports);
+  RoaringBitmap32::Init(exports, addonData);
+  RoaringBitmap32BufferedIterator::Init(exports, addonData);
+  RoaringBitmap32ChunkedSerializer::Init(exports, addonData);
+  RoaringBitmap32Bundle::Init(exports, addonData);
 }
 
+#if NODE_MAJOR_VERSION >= 10
+// Context aware, the addon can be loaded in multiple worker threads.
+NODE_MODULE_INIT(/* exports, module, context */) { InitModule(exports); }
+#else
 NODE_MODULE(roaring, InitModule);
+#endif
 
 //////////// RoaringBitmap32 ////////////
 
-v8::Eternal<v8::FunctionTemplate> RoaringBitmap32::constructorTemplate;
-v8::Eternal<v8::Function> RoaringBitmap32::constructor;
-
-void RoaringBitmap32::Init(v8::Local<v8::Object> exports) {
-  v8::Isolate * isolate = v8::Isolate::GetCurrent();
+void RoaringBitmap32::Init(v8::Local<v8::Object> exports, AddonData * addonData) {
+  v8::Isolate * isolate = addonData->isolate;
   v8::HandleScope scope(isolate);
 
   auto className = NEW_LITERAL_V8_STRING(isolate, "RoaringBitmap32", v8::NewStringType::kInternalized);
   auto versionString = NEW_LITERAL_V8_STRING(isolate, ROARING_VERSION_STRING, v8::NewStringType::kInternalized);
 
-  v8::Local<v8::FunctionTemplate> ctor = v8::FunctionTemplate::New(isolate, RoaringBitmap32::New);
-  RoaringBitmap32::constructorTemplate.Set(isolate, ctor);
+  v8::Local<v8::FunctionTemplate> ctor =
+    v8::FunctionTemplate::New(isolate, RoaringBitmap32::New, addonData->external.Get(isolate));
+  addonData->RoaringBitmap32_constructorTemplate.Reset(isolate, ctor);
   ctor->InstanceTemplate()->SetInternalFieldCount(1);
   ctor->SetClassName(className);
 
   v8::Local<v8::ObjectTemplate> ctorInstanceTemplate = ctor->InstanceTemplate();
 
-  ctorInstanceTemplate->SetAccessor(
-    NEW_LITERAL_V8_STRING(isolate, "isEmpty", v8::NewStringType::kInternalized),
-    isEmpty_getter,
-    nullptr,
-    v8::Local<v8::Value>(),
-    (v8::AccessControl)(v8::ALL_CAN_READ | v8::PROHIBITS_OVERWRITING),
-    (v8::PropertyAttribute)(v8::ReadOnly));
-
-  ctorInstanceTemplate->SetAccessor(
-    NEW_LITERAL_V8_STRING(isolate, "size", v8::NewStringType::kInternalized),
-    size_getter,
-    nullptr,
-    v8::Local<v8::Value>(),
-    (v8::AccessControl)(v8::ALL_CAN_READ | v8::PROHIBITS_OVERWRITING),
-    (v8::PropertyAttribute)(v8::ReadOnly));
-
-  NODE_SET_PROTOTYPE_METHOD(ctor, "minimum", minimum);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "maximum", maximum);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "contains", has);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "has", has);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "copyFrom", copyFrom);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "add", add);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "tryAdd", tryAdd);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "addMany", addMany);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "remove", remove);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "removeMany", removeMany);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "delete", removeChecked);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "clear", clear);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "orInPlace", addMany);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "andNotInPlace", removeMany);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "andInPlace", andInPlace);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "xorInPlace", xorInPlace);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "isSubset", isSubset);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "isStrictSubset", isStrictSubset);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "isEqual", isEqual);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "intersects", intersects);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "andCardinality", andCardinality);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "orCardinality", orCardinality);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "andNotCardinality", andNotCardinality);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "xorCardinality", xorCardinality);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "jaccardIndex", jaccardIndex);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "removeRunCompression", removeRunCompression);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "runOptimize", runOptimize);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "shrinkToFit", shrinkToFit);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "rank", rank);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "select", select);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "toUint32Array", toUint32Array);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "rangeUint32Array", rangeUint32Array);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "toArray", toArray);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "toSet", toSet);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "toJSON", toArray);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "getSerializationSizeInBytes", getSerializationSizeInBytes);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "serialize", serialize);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "deserialize", deserialize);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "clone", clone);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "toString", toString);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "contentToString", contentToString);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "statistics", statistics);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "containsRange", hasRange);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "hasRange", hasRange);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "rangeCardinality", rangeCardinality);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "flipRange", flipRange);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "addRange", addRange);
-  NODE_SET_PROTOTYPE_METHOD(ctor, "removeRange", removeRange);
+  v8utils::setReadOnlyAccessor(
+    ctorInstanceTemplate, NEW_LITERAL_V8_STRING(isolate, "isEmpty", v8::NewStringType::kInternalized), isEmpty_getter);
+  v8utils::setReadOnlyAccessor(
+    ctorInstanceTemplate, NEW_LITERAL_V8_STRING(isolate, "size", v8::NewStringType::kInternalized), size_getter);
+  v8utils::setReadOnlyAccessor(
+    ctorInstanceTemplate, NEW_LITERAL_V8_STRING(isolate, "isFrozen", v8::NewStringType::kInternalized), isFrozen_getter);
+
+  addonData->setPrototypeMethod(ctor, "minimum", minimum);
+  addonData->setPrototypeMethod(ctor, "maximum", maximum);
+  addonData->setPrototypeMethod(ctor, "contains", has);
+  addonData->setPrototypeMethod(ctor, "has", has);
+  addonData->setPrototypeMethod(ctor, "copyFrom", copyFrom);
+  addonData->setPrototypeMethod(ctor, "add", add);
+  addonData->setPrototypeMethod(ctor, "tryAdd", tryAdd);
+  addonData->setPrototypeMethod(ctor, "addMany", addMany);
+  addonData->setPrototypeMethod(ctor, "remove", remove);
+  addonData->setPrototypeMethod(ctor, "removeMany", removeMany);
+  addonData->setPrototypeMethod(ctor, "delete", removeChecked);
+  addonData->setPrototypeMethod(ctor, "clear", clear);
+  addonData->setPrototypeMethod(ctor, "orInPlace", addMany);
+  addonData->setPrototypeMethod(ctor, "andNotInPlace", removeMany);
+  addonData->setPrototypeMethod(ctor, "andInPlace", andInPlace);
+  addonData->setPrototypeMethod(ctor, "xorInPlace", xorInPlace);
+  addonData->setPrototypeMethod(ctor, "isSubset", isSubset);
+  addonData->setPrototypeMethod(ctor, "isStrictSubset", isStrictSubset);
+  addonData->setPrototypeMethod(ctor, "isEqual", isEqual);
+  addonData->setPrototypeMethod(ctor, "intersects", intersects);
+  addonData->setPrototypeMethod(ctor, "andCardinality", andCardinality);
+  addonData->setPrototypeMethod(ctor, "orCardinality", orCardinality);
+  addonData->setPrototypeMethod(ctor, "andNotCardinality", andNotCardinality);
+  addonData->setPrototypeMethod(ctor, "xorCardinality", xorCardinality);
+  addonData->setPrototypeMethod(ctor, "jaccardIndex", jaccardIndex);
+  addonData->setPrototypeMethod(ctor, "removeRunCompression", removeRunCompression);
+  addonData->setPrototypeMethod(ctor, "runOptimize", runOptimize);
+  addonData->setPrototypeMethod(ctor, "shrinkToFit", shrinkToFit);
+  addonData->setPrototypeMethod(ctor, "setAutoOptimize", setAutoOptimize);
+  addonData->setPrototypeMethod(ctor, "freeze", freeze);
+  addonData->setPrototypeMethod(ctor, "rank", rank);
+  addonData->setPrototypeMethod(ctor, "select", select);
+  addonData->setPrototypeMethod(ctor, "toUint32Array", toUint32Array);
+  addonData->setPrototypeMethod(ctor, "toUint32ArrayAsync", toUint32ArrayAsync);
+  addonData->setPrototypeMethod(ctor, "rangeUint32Array", rangeUint32Array);
+  addonData->setPrototypeMethod(ctor, "toArray", toArray);
+  addonData->setPrototypeMethod(ctor, "toSet", toSet);
+  addonData->setPrototypeMethod(ctor, "toJSON", toArray);
+  addonData->setPrototypeMethod(ctor, "toJSONString", toJSONString);
+  addonData->setPrototypeMethod(ctor, "getSerializationSizeInBytes", getSerializationSizeInBytes);
+  addonData->setPrototypeMethod(ctor, "serialize", serialize);
+  addonData->setPrototypeMethod(ctor, "serializeAsync", serializeAsync);
+  addonData->setPrototypeMethod(ctor, "getFrozenSizeInBytes", getFrozenSizeInBytes);
+  addonData->setPrototypeMethod(ctor, "serializeFrozen", serializeFrozen);
+  addonData->setPrototypeMethod(ctor, "deserialize", deserialize);
+  addonData->setPrototypeMethod(ctor, "clone", clone);
+  addonData->setPrototypeMethod(ctor, "toString", toString);
+  addonData->setPrototypeMethod(ctor, "contentToString", contentToString);
+  addonData->setPrototypeMethod(ctor, "statistics", statistics);
+  addonData->setPrototypeMethod(ctor, "containers", containers);
+  addonData->setPrototypeMethod(ctor, "containsRange", hasRange);
+  addonData->setPrototypeMethod(ctor, "hasRange", hasRange);
+  addonData->setPrototypeMethod(ctor, "rangeCardinality", rangeCardinality);
+  addonData->setPrototypeMethod(ctor, "flipRange", flipRange);
+  addonData->setPrototypeMethod(ctor, "addRange", addRange);
+  addonData->setPrototypeMethod(ctor, "removeRange", removeRange);
+  addonData->setPrototypeMethod(ctor, "addRanges", addRanges);
+  addonData->setPrototypeMethod(ctor, "removeRanges", removeRanges);
+  addonData->setPrototypeMethod(ctor, "flipRanges", flipRanges);
+  addonData->setPrototypeMethod(ctor, "toRanges", toRanges);
+  addonData->setPrototypeMethod(ctor, "toText", toText);
+  addonData->setPrototypeMethod(ctor, "toTextAsync", toTextAsync);
 
   ctor->PrototypeTemplate()->Set(
     v8::Symbol::GetToStringTag(isolate), NEW_LITERAL_V8_STRING(isolate, "Set", v8::NewStringType::kInternalized));
@@ -152,18 +275,31 @@ void RoaringBitmap32::Init(v8::Local<v8::Object> exports) {
   auto ctorFunction = ctor->GetFunction(context).ToLocalChecked();
   auto ctorObject = ctorFunction->ToObject(context).ToLocalChecked();
 
-  NODE_SET_METHOD(ctorObject, "fromRange", fromRangeStatic);
-  NODE_SET_METHOD(ctorObject, "fromArrayAsync", fromArrayStaticAsync);
-  NODE_SET_METHOD(ctorObject, "deserialize", deserializeStatic);
-  NODE_SET_METHOD(ctorObject, "deserializeAsync", deserializeStaticAsync);
-  NODE_SET_METHOD(ctorObject, "deserializeParallelAsync", deserializeParallelStaticAsync);
-  NODE_SET_METHOD(ctorObject, "and", andStatic);
-  NODE_SET_METHOD(ctorObject, "or", orStatic);
-  NODE_SET_METHOD(ctorObject, "xor", xorStatic);
-  NODE_SET_METHOD(ctorObject, "andNot", andNotStatic);
-  NODE_SET_METHOD(ctorObject, "orMany", orManyStatic);
-  NODE_SET_METHOD(ctorObject, "xorMany", xorManyStatic);
-  NODE_SET_METHOD(ctorObject, "swap", swapStatic);
+  addonData->setMethod(ctorObject, "fromRange", fromRangeStatic);
+  addonData->setMethod(ctorObject, "fromRanges", fromRangesStatic);
+  addonData->setMethod(ctorObject, "fromRangesAsync", fromRangesStaticAsync);
+  addonData->setMethod(ctorObject, "fromText", fromTextStatic);
+  addonData->setMethod(ctorObject, "fromTextAsync", fromTextStaticAsync);
+  addonData->setMethod(ctorObject, "fromArrayAsync", fromArrayStaticAsync);
+  addonData->setMethod(ctorObject, "deserialize", deserializeStatic);
+  addonData->setMethod(ctorObject, "deserializeAsync", deserializeStaticAsync);
+  addonData->setMethod(ctorObject, "deserializeParallelAsync", deserializeParallelStaticAsync);
+  addonData->setMethod(ctorObject, "frozenView", frozenViewStatic);
+  addonData->setMethod(ctorObject, "serializeDiff", serializeDiffStatic);
+  addonData->setMethod(ctorObject, "serializeDiffAsync", serializeDiffStaticAsync);
+  addonData->setMethod(ctorObject, "applyDiff", applyDiffStatic);
+  addonData->setMethod(ctorObject, "applyDiffAsync", applyDiffStaticAsync);
+  addonData->setMethod(ctorObject, "serializeBundle", serializeBundleStatic);
+  addonData->setMethod(ctorObject, "deserializeBundleParallelAsync", deserializeBundleParallelStaticAsync);
+  addonData->setMethod(ctorObject, "and", andStatic);
+  addonData->setMethod(ctorObject, "or", orStatic);
+  addonData->setMethod(ctorObject, "xor", xorStatic);
+  addonData->setMethod(ctorObject, "andNot", andNotStatic);
+  addonData->setMethod(ctorObject, "orMany", orManyStatic);
+  addonData->setMethod(ctorObject, "xorMany", xorManyStatic);
+  addonData->setMethod(ctorObject, "swap", swapStatic);
+  addonData->setMethod(ctorObject, "getThreadPoolSize", getThreadPoolSizeStatic);
+  addonData->setMethod(ctorObject, "setThreadPoolSize", setThreadPoolSizeStatic);
 
   v8utils::ignoreMaybeResult(
     ctorObject->Set(context, NEW_LITERAL_V8_STRING(isolate, "from", v8::NewStringType::kInternalized), ctorFunction));
@@ -176,14 +312,123 @@ void RoaringBitmap32::Init(v8::Local<v8::Object> exports) {
 
   v8utils::defineReadonlyField(isolate, exports, "CRoaringVersion", versionString);
 
-  constructor.Set(isolate, ctorFunction);
+  addonData->RoaringBitmap32_constructor.Reset(isolate, ctorFunction);
 }
 
 RoaringBitmap32::RoaringBitmap32(uint32_t capacity) :
-  roaring(nullptr), version(0), amountOfExternalAllocatedMemoryTracker(0) {
+  roaring(nullptr), version(0), amountOfExternalAllocatedMemoryTracker(0), frozen(false),
+  autoOptimizeSavedBytes(0),
+  cardinalityCacheVersion(UINT64_MAX),
+  cachedCardinality(0),
+  minMaxCacheVersion(UINT64_MAX),
+  cachedMinimum(0),
+  cachedMaximum(0) {
   this->roaring = roaring_bitmap_create_with_capacity(capacity);
 }
 
+RoaringBitmap32 * RoaringBitmap32::unwrapMutable(v8::Isolate * isolate, v8::Local<v8::Object> holder) {
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(holder);
+  if (self != nullptr && self->frozen) {
+    v8utils::throwError(isolate, frozenErrorMessage);
+    return nullptr;
+  }
+  return self;
+}
+
+// A bitmap becomes copy on write when it is cloned, frozen or snapshotted: a copy then shares the containers,
+// a shared container is copied only when one of the bitmaps that share it is modified.
+// Other bitmaps own their containers and skip the reference counting.
+// Views of a frozen buffer are never copy on write, their containers are not owned.
+static inline void roaringEnableCopyOnWrite(roaring_bitmap_t * r) {
+  if (r != nullptr && (r->high_low_container.flags & ROARING_FLAG_FROZEN) == 0) {
+    roaring_bitmap_set_copy_on_write(r, true);
+  }
+}
+
+// Copies a bitmap without sharing any container with it. The reference counters of shared
+// containers are not thread safe, the copy can instead be modified and freed on any thread.
+static roaring_bitmap_t * roaringBitmapDeepCopy(const roaring_bitmap_t * r) {
+  const roaring_array_t * ra = &r->high_low_container;
+  roaring_bitmap_t * result = roaring_bitmap_create_with_capacity((uint32_t)ra->size);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  for (int32_t i = 0; i < ra->size; ++i) {
+    uint8_t type = ra->typecodes[i];
+    const container_t * c = container_unwrap_shared(ra->containers[i], &type);
+    container_t * copied = container_clone(c, type);
+    if (copied == nullptr) {
+      roaring_bitmap_free(result);
+      return nullptr;
+    }
+    ra_append(&result->high_low_container, ra->keys[i], copied, type);
+  }
+  return result;
+}
+
+// Takes a copy on write snapshot of a bitmap, only the container references are copied.
+// The snapshot is a stable view that can be read by another thread while the bitmap is modified,
+// a modified container is copied by the bitmap and the snapshot keeps the old one.
+// The reference counters of shared containers are not thread safe: the snapshot must be created and
+// freed in the main thread, and must not be modified. Views of a frozen buffer are copied.
+static inline roaring_bitmap_t * roaringBitmapSnapshot(roaring_bitmap_t * r) {
+  roaringEnableCopyOnWrite(r);
+  return roaring_bitmap_copy(r);
+}
+
+// Takes back the ownership of a shared container that is not referenced anymore by other bitmaps
+// or snapshots, no copy is made. Returns false if the container is still shared.
+static inline bool roaringOwnContainerAt(roaring_array_t * ra, int32_t i) {
+  if (ra->typecodes[i] != SHARED_CONTAINER_TYPE) {
+    return true;
+  }
+  if (const_CAST_shared(ra->containers[i])->counter != 1) {
+    return false;
+  }
+  ra_unshare_container_at_index(ra, (uint16_t)i);
+  return true;
+}
+
+// A read only bitmap with the shared containers of a bitmap unwrapped, the frozen format cannot be written from
+// shared containers. The containers are borrowed and the bitmap is not modified, it must not change while the view
+// is used. bitmap is nullptr if the allocation failed.
+class RoaringUnsharedView {
+ public:
+  const roaring_bitmap_t * bitmap;
+
+  explicit RoaringUnsharedView(const roaring_bitmap_t * r) : bitmap(r), unwrapped(nullptr) {
+    const roaring_array_t * ra = &r->high_low_container;
+    int32_t i = 0;
+    while (i < ra->size && ra->typecodes[i] != SHARED_CONTAINER_TYPE) {
+      ++i;
+    }
+    if (i == ra->size) {
+      return;
+    }
+    this->unwrapped = roaring_bitmap_create_with_capacity((uint32_t)ra->size);
+    this->bitmap = this->unwrapped;
+    if (this->unwrapped == nullptr) {
+      return;
+    }
+    for (i = 0; i < ra->size; ++i) {
+      uint8_t type = ra->typecodes[i];
+      const container_t * c = container_unwrap_shared(ra->containers[i], &type);
+      ra_append(&this->unwrapped->high_low_container, ra->keys[i], (container_t *)c, type);
+    }
+  }
+
+  ~RoaringUnsharedView() {
+    if (this->unwrapped != nullptr) {
+      // Frees only the arrays, the containers belong to the source bitmap.
+      this->unwrapped->high_low_container.size = 0;
+      roaring_bitmap_free(this->unwrapped);
+    }
+  }
+
+ private:
+  roaring_bitmap_t * unwrapped;
+};
+
 bool RoaringBitmap32::replaceBitmapInstance(v8::Isolate * isolate, roaring_bitmap_t * newInstance) {
   if (this->roaring != newInstance) {
     if (this->roaring != nullptr) {
@@ -217,6 +462,9 @@ RoaringBitmap32::~RoaringBitmap32() {
   if (this->roaring != nullptr) {
     roaring_bitmap_free(this->roaring);
   }
+#if NODE_MAJOR_VERSION <= 13
+  this->frozenBuffer.Reset();
+#endif
   this->persistent.Reset();
 }
 
@@ -233,9 +481,10 @@ void RoaringBitmap32::WeakCallback(v8::WeakCallbackInfo<RoaringBitmap32> const &
 void RoaringBitmap32::New(const v8::FunctionCallbackInfo<v8::Value> & info) {
   v8::Isolate * isolate = info.GetIsolate();
   v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
 
   if (!info.IsConstructCall()) {
-    v8::Local<v8::Function> cons = constructor.Get(isolate);
+    v8::Local<v8::Function> cons = addonData->RoaringBitmap32_constructor.Get(isolate);
     v8::MaybeLocal<v8::Object> v;
     if (info.Length() < 1) {
       v = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
@@ -266,7 +515,7 @@ void RoaringBitmap32::New(const v8::FunctionCallbackInfo<v8::Value> & info) {
 
   bool hasParameter = info.Length() != 0 && !info[0]->IsUndefined() && !info[0]->IsNull();
   if (hasParameter) {
-    if (RoaringBitmap32::constructorTemplate.Get(isolate)->HasInstance(info[0])) {
+    if (addonData->RoaringBitmap32_constructorTemplate.Get(isolate)->HasInstance(info[0])) {
       RoaringBitmap32::copyFrom(info);
     } else {
       RoaringBitmap32::addMany(info);
@@ -277,12 +526,12 @@ void RoaringBitmap32::New(const v8::FunctionCallbackInfo<v8::Value> & info) {
 }
 
 void RoaringBitmap32::size_getter(v8::Local<v8::String> property, const v8::PropertyCallbackInfo<v8::Value> & info) {
-  const RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<const RoaringBitmap32>(info.Holder());
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
   if (self == nullptr) {
     return info.GetReturnValue().Set(0U);
   }
 
-  size_t size = roaring_bitmap_get_cardinality(self->roaring);
+  uint64_t size = self->getCardinality();
   if (size <= 0xFFFFFFFF) {
     return info.GetReturnValue().Set((uint32_t)size);
   }
@@ -290,6 +539,26 @@ void RoaringBitmap32::size_getter(v8::Local<v8::String> property, const v8::Prop
   info.GetReturnValue().Set((double)size);
 }
 
+void RoaringBitmap32::isFrozen_getter(v8::Local<v8::String> property, const v8::PropertyCallbackInfo<v8::Value> & info) {
+  const RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<const RoaringBitmap32>(info.Holder());
+  info.GetReturnValue().Set(self && self->frozen);
+}
+
+void RoaringBitmap32::freeze(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (self != nullptr && !self->frozen) {
+    // A frozen bitmap is never modified again, the pending containers are optimized now.
+    if (self->autoOptimizePolicy && self->autoOptimizePolicy->dirty.isDirty()) {
+      self->autoOptimize();
+    }
+    self->autoOptimizePolicy.reset();
+    self->frozen = true;
+    // Copies of a frozen bitmap share its containers, they are never modified again by this bitmap.
+    roaringEnableCopyOnWrite(self->roaring);
+  }
+  info.GetReturnValue().Set(info.Holder());
+}
+
 void RoaringBitmap32::isEmpty_getter(v8::Local<v8::String> property, const v8::PropertyCallbackInfo<v8::Value> & info) {
   const RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<const RoaringBitmap32>(info.Holder());
   info.GetReturnValue().Set(self && roaring_bitmap_is_empty(self->roaring));
@@ -342,12 +611,12 @@ void RoaringBitmap32::hasRange(const v8::FunctionCallbackInfo<v8::Value> & info)
 
 void RoaringBitmap32::minimum(const v8::FunctionCallbackInfo<v8::Value> & info) {
   RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  return info.GetReturnValue().Set(roaring_bitmap_minimum(self->roaring));
+  return info.GetReturnValue().Set(self->getMinimum());
 }
 
 void RoaringBitmap32::maximum(const v8::FunctionCallbackInfo<v8::Value> & info) {
   RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  return info.GetReturnValue().Set(roaring_bitmap_maximum(self->roaring));
+  return info.GetReturnValue().Set(self->getMaximum());
 }
 
 void RoaringBitmap32::rank(const v8::FunctionCallbackInfo<v8::Value> & info) {
@@ -374,7 +643,8 @@ void RoaringBitmap32::select(const v8::FunctionCallbackInfo<v8::Value> & info) {
 }
 
 void RoaringBitmap32::removeRunCompression(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+  if (self == nullptr) return;
   bool removed = roaring_bitmap_remove_run_compression(self->roaring);
   if (removed) {
     self->invalidate();
@@ -383,24 +653,185 @@ void RoaringBitmap32::removeRunCompression(const v8::FunctionCallbackInfo<v8::Va
 }
 
 void RoaringBitmap32::runOptimize(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+  if (self == nullptr) return;
   info.GetReturnValue().Set(roaring_bitmap_run_optimize(self->roaring));
+  self->invalidateContainers();
   self->updateAmountOfExternalAllocatedMemory(info.GetIsolate());
 }
 
 void RoaringBitmap32::shrinkToFit(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  info.GetReturnValue().Set((double)roaring_bitmap_shrink_to_fit(self->roaring));
+  RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+  if (self == nullptr) return;
+  // roaring_bitmap_shrink_to_fit reallocates also the shared containers, that may be read by a snapshot in another thread.
+  roaring_array_t * ra = &self->roaring->high_low_container;
+  size_t saved = 0;
+  for (int32_t i = 0; i < ra->size; ++i) {
+    if (roaringOwnContainerAt(ra, i)) {
+      saved += (size_t)container_shrink_to_fit(ra->containers[i], ra->typecodes[i]);
+    }
+  }
+  saved += (size_t)ra_shrink_to_fit(ra);
+  if (self->compressedCache) {
+    saved += self->compressedCache->blocks.capacity();
+    self->compressedCache.reset();
+  }
+  info.GetReturnValue().Set((double)saved);
+  self->invalidateContainers();
   self->updateAmountOfExternalAllocatedMemory(info.GetIsolate());
 }
 
+// Number of bytes allocated for the values of a container.
+static inline size_t containerAllocatedBytes(const container_t * c, uint8_t type) {
+  switch (type) {
+    case BITSET_CONTAINER_TYPE: return BITSET_CONTAINER_SIZE_IN_WORDS * sizeof(uint64_t);
+    case ARRAY_CONTAINER_TYPE: return (size_t)const_CAST_array(c)->capacity * sizeof(uint16_t);
+    default: return (size_t)const_CAST_run(c)->capacity * sizeof(rle16_t);
+  }
+}
+
+// Converts a container to the smallest type and releases its unused capacity.
+// Shared containers are skipped, they are owned also by other bitmaps. Returns the number of bytes released.
+static size_t optimizeContainerAt(roaring_array_t * ra, int32_t i) {
+  if (!roaringOwnContainerAt(ra, i)) {
+    return 0;
+  }
+  const uint8_t type = ra->typecodes[i];
+  container_t * c = ra->containers[i];
+  const size_t before = containerAllocatedBytes(c, type);
+  uint8_t newType;
+  container_t * optimized = convert_run_optimize(c, type, &newType);
+  if (optimized != c) {
+    ra_set_container_at_index(ra, i, optimized, newType);
+  }
+  container_shrink_to_fit(optimized, newType);
+  const size_t after = containerAllocatedBytes(optimized, newType);
+  return before > after ? before - after : 0;
+}
+
+void RoaringBitmap32DirtyKeys::normalize() {
+  std::sort(this->keys.begin(), this->keys.end());
+  this->keys.erase(std::unique(this->keys.begin(), this->keys.end()), this->keys.end());
+}
+
+size_t RoaringBitmap32::autoOptimize() {
+  RoaringBitmap32AutoOptimize * policy = this->autoOptimizePolicy.get();
+  if (policy == nullptr || this->frozen || this->roaring == nullptr) {
+    return 0;
+  }
+  roaring_array_t * ra = &this->roaring->high_low_container;
+  size_t saved = 0;
+  if (policy->dirty.all) {
+    for (int32_t i = 0; i < ra->size; ++i) {
+      saved += optimizeContainerAt(ra, i);
+    }
+    saved += (size_t)ra_shrink_to_fit(ra);
+  } else {
+    policy->dirty.normalize();
+    const std::vector<uint16_t> & keys = policy->dirty.keys;
+    int32_t i = -1;
+    for (size_t k = 0; k < keys.size(); ++k) {
+      // Keys are sorted, the search restarts from the last position.
+      i = ra_advance_until(ra, keys[k], i);
+      if (i >= ra->size) {
+        break;
+      }
+      if (ra->keys[i] == keys[k]) {
+        saved += optimizeContainerAt(ra, i);
+      }
+    }
+  }
+  policy->dirty.clear();
+  policy->mutations = 0;
+  // Containers may have been converted even if no memory was released.
+  this->invalidateContainers();
+  this->autoOptimizeSavedBytes += saved;
+  return saved;
+}
+
+void RoaringBitmap32::setAutoOptimize(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+
+  RoaringBitmap32 * self = unwrapMutable(isolate, info.Holder());
+  if (self == nullptr) return;
+
+  uint32_t everyNMutations = 0;
+  bool onSerialize = false;
+  v8::Local<v8::Value> arg = info.Length() > 0 ? info[0] : v8::Local<v8::Value>();
+  if (!arg.IsEmpty() && !arg->IsNullOrUndefined() && !arg->IsFalse()) {
+    if (!arg->IsObject()) {
+      return v8utils::throwTypeError(isolate, "RoaringBitmap32::setAutoOptimize - options must be an object or false");
+    }
+    auto context = isolate->GetCurrentContext();
+    v8::Local<v8::Object> options = arg.As<v8::Object>();
+    v8::Local<v8::Value> everyNMutationsValue, onSerializeValue;
+    if (
+      !options->Get(context, NEW_LITERAL_V8_STRING(isolate, "everyNMutations", v8::NewStringType::kInternalized))
+         .ToLocal(&everyNMutationsValue) ||
+      !options->Get(context, NEW_LITERAL_V8_STRING(isolate, "onSerialize", v8::NewStringType::kInternalized))
+         .ToLocal(&onSerializeValue)) {
+      return;
+    }
+    if (!everyNMutationsValue->IsUndefined()) {
+      if (!everyNMutationsValue->IsUint32()) {
+        return v8utils::throwTypeError(
+          isolate, "RoaringBitmap32::setAutoOptimize - everyNMutations must be a 32 bit unsigned integer");
+      }
+      everyNMutations = everyNMutationsValue.As<v8::Uint32>()->Value();
+    }
+    onSerialize = onSerializeValue->IsTrue();
+  }
+
+  if (everyNMutations == 0 && !onSerialize) {
+    self->autoOptimizePolicy.reset();
+  } else {
+    if (!self->autoOptimizePolicy) {
+      self->autoOptimizePolicy.reset(new RoaringBitmap32AutoOptimize());
+      // Containers changed before the policy was set are optimized by the first pass.
+      self->autoOptimizePolicy->dirty.markAll();
+    }
+    self->autoOptimizePolicy->everyNMutations = everyNMutations;
+    self->autoOptimizePolicy->onSerialize = onSerialize;
+  }
+  info.GetReturnValue().Set(info.Holder());
+}
+
+// Below this size the array is allocated by V8, above the values are written to an uninitialized buffer.
+#define TO_UINT32_ARRAY_EXTERNAL_MIN_LENGTH 0x4000
+
+// Creates an Uint32Array that takes the ownership of memory allocated with malloc, without copying or zero filling.
+// On failure the memory is not freed.
+static v8::MaybeLocal<v8::Uint32Array> uint32ArrayFromMallocated(v8::Isolate * isolate, uint32_t * data, size_t length) {
+  v8::Local<v8::Object> buffer;
+  if (!node::Buffer::New(isolate, (char *)data, length * sizeof(uint32_t)).ToLocal(&buffer)) {
+    return v8::MaybeLocal<v8::Uint32Array>();
+  }
+  return v8::Uint32Array::New(buffer.As<v8::Uint8Array>()->Buffer(), 0, length);
+}
+
 void RoaringBitmap32::toUint32Array(const v8::FunctionCallbackInfo<v8::Value> & info) {
   v8::Isolate * isolate = info.GetIsolate();
   v8::HandleScope scope(isolate);
 
   RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
 
-  auto size = static_cast<size_t>(roaring_bitmap_get_cardinality(self->roaring));
+  auto size = static_cast<size_t>(self->getCardinality());
+
+  if (size >= TO_UINT32_ARRAY_EXTERNAL_MIN_LENGTH) {
+    // V8 zero fills new ArrayBuffers, this avoids writing the memory twice.
+    uint32_t * data = (uint32_t *)malloc(size * sizeof(uint32_t));
+    if (data == nullptr) {
+      return v8utils::throwError(isolate, "RoaringBitmap32::toUint32Array - failed to allocate memory");
+    }
+    roaring_bitmap_to_uint32_array(self->roaring, data);
+    v8::Local<v8::Uint32Array> result;
+    if (!uint32ArrayFromMallocated(isolate, data, size).ToLocal(&result)) {
+      free(data);
+      return;
+    }
+    return info.GetReturnValue().Set(result);
+  }
 
   auto arrayBuffer = v8::ArrayBuffer::New(isolate, size * sizeof(uint32_t));
   auto typedArray = v8::Uint32Array::New(arrayBuffer, 0, size);
@@ -434,7 +865,7 @@ void RoaringBitmap32::rangeUint32Array(const v8::FunctionCallbackInfo<v8::Value>
     return info.GetReturnValue().Set(false);
   }
 
-  auto cardinality = roaring_bitmap_get_cardinality(self->roaring);
+  auto cardinality = self->getCardinality();
   auto size = limit < cardinality - offset ? limit : cardinality - offset;
 
   if (offset > cardinality) {
@@ -459,63 +890,175 @@ void RoaringBitmap32::rangeUint32Array(const v8::FunctionCallbackInfo<v8::Value>
   info.GetReturnValue().Set(typedArray);
 }
 
+// Values are read from the bitmap in blocks of this size.
+#define TO_ARRAY_BLOCK_SIZE 4096
+
+// Above this size, the array is filled one element at a time, to not keep too many handles alive.
+#define TO_ARRAY_BULK_MAX_LENGTH 0x4000000
+
+// Creates a JS array with all the values of a bitmap.
+static v8::MaybeLocal<v8::Array> roaringToArray(v8::Isolate * isolate, const roaring_bitmap_t * roaring) {
+  const uint64_t cardinality = roaring != nullptr ? roaring_bitmap_get_cardinality(roaring) : 0;
+  if (cardinality == 0) {
+    return v8::Array::New(isolate, 0);
+  }
+
+  roaring_uint32_iterator_t iterator;
+  roaring_init_iterator(roaring, &iterator);
+  uint32_t block[TO_ARRAY_BLOCK_SIZE];
+
+#if NODE_MAJOR_VERSION >= 12
+  if (cardinality <= TO_ARRAY_BULK_MAX_LENGTH) {
+    // Creates all the elements and then the array in one go, a lot faster than setting the elements one by one.
+    std::vector<v8::Local<v8::Value>> elements((size_t)cardinality);
+    size_t index = 0;
+    uint32_t count;
+    while ((count = roaring_read_uint32_iterator(&iterator, block, TO_ARRAY_BLOCK_SIZE)) != 0) {
+      for (uint32_t i = 0; i != count; ++i) {
+        const uint32_t value = block[i];
+        // Values up to 2^30 are small integers on all platforms, no heap number is allocated.
+        if (value < 0x40000000) {
+          elements[index++] = v8::Integer::New(isolate, (int32_t)value);
+        } else {
+          elements[index++] = v8::Number::New(isolate, (double)value);
+        }
+      }
+    }
+    return v8::Array::New(isolate, elements.data(), elements.size());
+  }
+#endif
+
+  v8::Local<v8::Context> context = isolate->GetCurrentContext();
+  v8::Local<v8::Array> result = v8::Array::New(isolate, (int)cardinality);
+  uint32_t index = 0;
+  uint32_t count;
+  while ((count = roaring_read_uint32_iterator(&iterator, block, TO_ARRAY_BLOCK_SIZE)) != 0) {
+    v8::HandleScope scope(isolate);
+    for (uint32_t i = 0; i != count; ++i) {
+      if (result->Set(context, index++, v8::Uint32::NewFromUnsigned(isolate, block[i])).IsNothing()) {
+        return v8::MaybeLocal<v8::Array>();
+      }
+    }
+  }
+  return result;
+}
+
 void RoaringBitmap32::toArray(const v8::FunctionCallbackInfo<v8::Value> & info) {
   v8::Isolate * isolate = info.GetIsolate();
   v8::HandleScope scope(isolate);
 
   RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  size_t cardinality = self ? roaring_bitmap_get_cardinality(self->roaring) : 0;
 
-  struct iter_data {
-    uint32_t index;
-    v8::Isolate * isolate;
-    v8::Local<v8::Context> context;
-    v8::Local<v8::Array> jsArray;
-  } iterData;
-
-  iterData.index = 0;
-  iterData.isolate = isolate;
-  iterData.context = isolate->GetCurrentContext();
-  iterData.jsArray = v8::Array::New(isolate, cardinality);
-  info.GetReturnValue().Set(iterData.jsArray);
-
-  if (cardinality != 0) {
-    roaring_iterate(
-      self->roaring,
-      [](uint32_t value, void * vp) -> bool {
-        auto * p = reinterpret_cast<iter_data *>(vp);
-        bool r = false;
-        return p->jsArray->Set(p->context, p->index++, v8::Uint32::NewFromUnsigned(p->isolate, value)).To(&r) && r;
-      },
-      (void *)&iterData);
+  v8::Local<v8::Array> result;
+  if (roaringToArray(isolate, self ? self->roaring : nullptr).ToLocal(&result)) {
+    info.GetReturnValue().Set(result);
   }
 }
 
 void RoaringBitmap32::toSet(const v8::FunctionCallbackInfo<v8::Value> & info) {
   v8::Isolate * isolate = info.GetIsolate();
   v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
   RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
 
-  struct iter_data {
-    v8::Isolate * isolate;
-    v8::Local<v8::Context> context;
-    v8::Local<v8::Set> jsSet;
-  } iterData;
+  if (self == nullptr || roaring_bitmap_is_empty(self->roaring)) {
+    return info.GetReturnValue().Set(v8::Set::New(isolate));
+  }
+
+  // new Set(array) fills the set natively, faster than calling Set::Add for each value.
+  v8::Local<v8::Value> argv[1];
+  v8::Local<v8::Object> result;
+  v8::Local<v8::Array> array;
+  if (!roaringToArray(isolate, self->roaring).ToLocal(&array)) {
+    return;
+  }
+  argv[0] = array;
+  if (addonData->Set_constructor.Get(isolate)->NewInstance(isolate->GetCurrentContext(), 1, argv).ToLocal(&result)) {
+    info.GetReturnValue().Set(result);
+  }
+}
 
-  iterData.isolate = isolate;
-  iterData.context = isolate->GetCurrentContext();
-  iterData.jsSet = v8::Set::New(isolate);
-  info.GetReturnValue().Set(iterData.jsSet);
+// Writes the decimal representation of a value, returns the end of the written characters.
+inline char * writeUint32Decimal(char * output, uint32_t value) {
+  char digits[10];
+  int n = 0;
+  do {
+    digits[n++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  do {
+    *output++ = digits[--n];
+  } while (n != 0);
+  return output;
+}
 
-  if (self != nullptr && !roaring_bitmap_is_empty(self->roaring)) {
-    roaring_iterate(
-      self->roaring,
-      [](uint32_t value, void * vp) -> bool {
-        auto * p = reinterpret_cast<iter_data *>(vp);
-        return !p->jsSet->Add(p->context, v8::Uint32::NewFromUnsigned(p->isolate, value)).IsEmpty();
-      },
-      (void *)&iterData);
+enum class TextFormat { json, csv, ndjson };
+
+// Writes all the values of a bitmap as text: a JSON array, comma separated values, or one value per line.
+static void roaringWriteText(const roaring_bitmap_t * roaring, TextFormat format, std::vector<char> & str) {
+  const uint64_t cardinality = roaring_bitmap_get_cardinality(roaring);
+  const char separator = format == TextFormat::ndjson ? '\n' : ',';
+  str.reserve((size_t)cardinality * 8 + 2);
+  if (format == TextFormat::json) {
+    str.push_back('[');
+  }
+
+  roaring_uint32_iterator_t iterator;
+  roaring_init_iterator(roaring, &iterator);
+  uint32_t block[TO_ARRAY_BLOCK_SIZE];
+  uint32_t count;
+  while ((count = roaring_read_uint32_iterator(&iterator, block, TO_ARRAY_BLOCK_SIZE)) != 0) {
+    const size_t position = str.size();
+    str.resize(position + (size_t)count * 11);
+    char * p = str.data() + position;
+    for (uint32_t i = 0; i != count; ++i) {
+      p = writeUint32Decimal(p, block[i]);
+      *p++ = separator;
+    }
+    str.resize((size_t)(p - str.data()));
+  }
+
+  if (format == TextFormat::json) {
+    if (cardinality != 0) {
+      str.back() = ']';
+    } else {
+      str.push_back(']');
+    }
+  } else if (format == TextFormat::csv && cardinality != 0) {
+    str.pop_back();
+  }
+}
+
+// Each value takes at least two characters, bitmaps bigger than this cannot be converted to a string.
+#define TEXT_MAX_CARDINALITY ((uint64_t)v8::String::kMaxLength / 2)
+
+// Converts the text written by roaringWriteText to a string.
+static v8::MaybeLocal<v8::String> textToString(v8::Isolate * isolate, const std::vector<char> & str) {
+  if (str.size() > (size_t)v8::String::kMaxLength) {
+    return v8::MaybeLocal<v8::String>();
+  }
+  return v8::String::NewFromOneByte(isolate, (const uint8_t *)str.data(), v8::NewStringType::kNormal, (int)str.size());
+}
+
+void RoaringBitmap32::toJSONString(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (self == nullptr || roaring_bitmap_is_empty(self->roaring)) {
+    return info.GetReturnValue().Set(NEW_LITERAL_V8_STRING(isolate, "[]", v8::NewStringType::kInternalized));
   }
+
+  std::vector<char> str;
+  if (self->getCardinality() > TEXT_MAX_CARDINALITY) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::toJSONString - the bitmap is too big to be converted to a string");
+  }
+  roaringWriteText(self->roaring, TextFormat::json, str);
+  v8::Local<v8::String> result;
+  if (!textToString(isolate, str).ToLocal(&result)) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::toJSONString - the bitmap is too big to be converted to a string");
+  }
+  info.GetReturnValue().Set(result);
 }
 
 void RoaringBitmap32::toString(const v8::FunctionCallbackInfo<v8::Value> & info) {
@@ -573,8 +1116,15 @@ void RoaringBitmap32::contentToString(const v8::FunctionCallbackInfo<v8::Value>
 void RoaringBitmap32::clone(const v8::FunctionCallbackInfo<v8::Value> & info) {
   v8::Isolate * isolate = info.GetIsolate();
   v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
 
-  v8::Local<v8::Function> cons = constructor.Get(isolate);
+  v8::Local<v8::Function> cons = addonData->RoaringBitmap32_constructor.Get(isolate);
+
+  // The clone shares the containers with this bitmap until one of the two is modified.
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (self != nullptr) {
+    roaringEnableCopyOnWrite(self->roaring);
+  }
 
   v8::Local<v8::Value> argv[1] = {info.Holder()};
   auto v = cons->NewInstance(isolate->GetCurrentContext(), 1, argv);
@@ -649,19 +1199,101 @@ void RoaringBitmap32::statistics(const v8::FunctionCallbackInfo<v8::Value> & inf
     context,
     NEW_LITERAL_V8_STRING(isolate, "size", v8::NewStringType::kInternalized),
     v8::Number::New(isolate, (double)stats.cardinality)));
+  v8utils::ignoreMaybeResult(result->Set(
+    context,
+    NEW_LITERAL_V8_STRING(isolate, "autoOptimizeSavedBytes", v8::NewStringType::kInternalized),
+    v8::Number::New(isolate, (double)self->autoOptimizeSavedBytes)));
+  info.GetReturnValue().Set(result);
+}
+
+// Reads an optional container key argument, a 16 bit unsigned integer.
+static bool getContainerKey(v8::Local<v8::Value> value, uint32_t defaultValue, uint32_t & result) {
+  result = defaultValue;
+  if (value.IsEmpty() || value->IsUndefined()) {
+    return true;
+  }
+  if (!value->IsNumber()) {
+    return false;
+  }
+  const double n = value.As<v8::Number>()->Value();
+  if (!(n >= 0 && n <= 0xFFFF) || n != std::floor(n)) {
+    return false;
+  }
+  result = (uint32_t)n;
+  return true;
+}
+
+void RoaringBitmap32::containers(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (self == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::containers on invalid object");
+  }
+
+  uint32_t minKey, maxKey;
+  if (
+    !getContainerKey(info.Length() > 0 ? info[0] : v8::Local<v8::Value>(), 0, minKey) ||
+    !getContainerKey(info.Length() > 1 ? info[1] : v8::Local<v8::Value>(), 0xFFFF, maxKey)) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::containers - keys must be integers between 0 and 65535");
+  }
+
+  const roaring_array_t * ra = &self->roaring->high_low_container;
+  int32_t begin = ra_advance_until(ra, (uint16_t)minKey, -1);
+  int32_t end = begin;
+  while (end < ra->size && ra->keys[end] <= maxKey) {
+    ++end;
+  }
+  const size_t count = (size_t)(end - begin);
+
+  auto keysArray = v8::Uint16Array::New(v8::ArrayBuffer::New(isolate, count * sizeof(uint16_t)), 0, count);
+  auto typesArray = v8::Uint8Array::New(v8::ArrayBuffer::New(isolate, count), 0, count);
+  auto cardinalitiesArray = v8::Uint32Array::New(v8::ArrayBuffer::New(isolate, count * sizeof(uint32_t)), 0, count);
+  auto sizesArray = v8::Uint32Array::New(v8::ArrayBuffer::New(isolate, count * sizeof(uint32_t)), 0, count);
+
+  if (count != 0) {
+    v8utils::TypedArrayContent<uint16_t> keys(keysArray);
+    v8utils::TypedArrayContent<uint8_t> types(typesArray);
+    v8utils::TypedArrayContent<uint32_t> cardinalities(cardinalitiesArray);
+    v8utils::TypedArrayContent<uint32_t> sizes(sizesArray);
+    for (int32_t i = begin; i < end; ++i) {
+      uint8_t type = ra->typecodes[i];
+      const container_t * c = container_unwrap_shared(ra->containers[i], &type);
+      const size_t j = (size_t)(i - begin);
+      keys.data[j] = ra->keys[i];
+      types.data[j] = type;
+      cardinalities.data[j] = (uint32_t)container_get_cardinality(c, type);
+      sizes.data[j] = (uint32_t)containerAllocatedBytes(c, type);
+    }
+  }
+
+  auto context = isolate->GetCurrentContext();
+  auto result = v8::Object::New(isolate);
+  v8utils::ignoreMaybeResult(
+    result->Set(context, NEW_LITERAL_V8_STRING(isolate, "keys", v8::NewStringType::kInternalized), keysArray));
+  v8utils::ignoreMaybeResult(
+    result->Set(context, NEW_LITERAL_V8_STRING(isolate, "types", v8::NewStringType::kInternalized), typesArray));
+  v8utils::ignoreMaybeResult(result->Set(
+    context, NEW_LITERAL_V8_STRING(isolate, "cardinalities", v8::NewStringType::kInternalized), cardinalitiesArray));
+  v8utils::ignoreMaybeResult(
+    result->Set(context, NEW_LITERAL_V8_STRING(isolate, "sizesInBytes", v8::NewStringType::kInternalized), sizesArray));
   info.GetReturnValue().Set(result);
 }
 
 //////////// RoaringBitmap32FactoryAsyncWorker ////////////
 
-RoaringBitmap32FactoryAsyncWorker::RoaringBitmap32FactoryAsyncWorker(v8::Isolate * isolate) :
-  v8utils::AsyncWorker(isolate), bitmap(nullptr) {}
+RoaringBitmap32FactoryAsyncWorker::RoaringBitmap32FactoryAsyncWorker(AddonData * addonData) :
+  v8utils::AsyncWorker(addonData->isolate), addonData(addonData), bitmap(nullptr) {
+  addonData->acquire();
+}
 
 RoaringBitmap32FactoryAsyncWorker::~RoaringBitmap32FactoryAsyncWorker() {
   if (this->bitmap != nullptr) {
     roaring_bitmap_free(this->bitmap);
     this->bitmap = nullptr;
   }
+  this->addonData->release();
 }
 
 v8::Local<v8::Value> RoaringBitmap32FactoryAsyncWorker::done() {
@@ -670,7 +1302,7 @@ v8::Local<v8::Value> RoaringBitmap32FactoryAsyncWorker::done() {
     return v8::Local<v8::Value>();
   }
 
-  v8::Local<v8::Function> cons = RoaringBitmap32::constructor.Get(this->isolate);
+  v8::Local<v8::Function> cons = this->addonData->RoaringBitmap32_constructor.Get(this->isolate);
 
   v8::MaybeLocal<v8::Object> resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
   v8::Local<v8::Object> result;
@@ -693,1339 +1325,5228 @@ v8::Local<v8::Value> RoaringBitmap32FactoryAsyncWorker::done() {
 
 ///// Serialization /////
 
-void RoaringBitmap32::getSerializationSizeInBytes(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  if (info.Length() <= 0) {
-    return v8utils::throwError(info.GetIsolate(), "portable argument must be a boolean value");
+RoaringBitmap32Serializer::RoaringBitmap32Serializer() :
+  roaring(nullptr),
+  portable(false),
+  checksum(false),
+  compressed(false),
+  compressedCache(nullptr),
+  serializeArray(false),
+  cardinality(0),
+  portableSize(0),
+  payloadSize(0),
+  compressedContainers(0),
+  values(nullptr) {}
+
+RoaringBitmap32Serializer::~RoaringBitmap32Serializer() { free(this->values); }
+
+size_t RoaringBitmap32Serializer::computeSize() {
+  this->portableSize = roaring_bitmap_portable_size_in_bytes(this->roaring);
+  if (this->portable) {
+    return this->portableSize;
   }
-  if (self == nullptr) {
-    return info.GetReturnValue().Set(0U);
+
+  this->cardinality = roaring_bitmap_get_cardinality(this->roaring);
+  auto sizeasarray = this->cardinality * sizeof(uint32_t) + sizeof(uint32_t);
+  if (this->portableSize < sizeasarray || sizeasarray >= MAX_SERIALIZATION_ARRAY_SIZE_IN_BYTES - 1) {
+    this->serializeArray = false;
+    this->payloadSize = this->portableSize + 1;
+  } else {
+    this->serializeArray = true;
+    this->payloadSize = (size_t)sizeasarray + 1;
+  }
+
+  if (this->compressed) {
+    // Very sparse bitmaps may not be compressible, the uncompressed format is used if smaller.
+    const size_t uncompressedSize = this->payloadSize;
+    if (!this->computeCompressedSize()) {
+      return 0;
+    }
+    if (uncompressedSize <= this->payloadSize) {
+      this->compressed = false;
+      this->payloadSize = uncompressedSize;
+    }
   }
-  bool portable = info[0]->IsTrue();
 
-  auto portablesize = roaring_bitmap_portable_size_in_bytes(self->roaring);
-  self->updateAmountOfExternalAllocatedMemory(info.GetIsolate(), portablesize);
+  return this->checksum ? this->payloadSize + CROARING_SERIALIZATION_CRC32C_HEADER_SIZE : this->payloadSize;
+}
 
-  if (portable) {
-    return info.GetReturnValue().Set((double)portablesize);
+const char * RoaringBitmap32Serializer::serialize(uint8_t * data) {
+  if (this->portable) {
+    roaring_bitmap_portable_serialize(this->roaring, (char *)data);
+    return nullptr;
   }
 
-  auto cardinality = roaring_bitmap_get_cardinality(self->roaring);
-  auto sizeasarray = cardinality * sizeof(uint32_t) + sizeof(uint32_t);
+  if (this->compressed && this->values == nullptr) {
+    return "RoaringBitmap32::serialize - failed to allocate";
+  }
 
-  if (portablesize < sizeasarray || sizeasarray >= MAX_SERIALIZATION_ARRAY_SIZE_IN_BYTES - 1) {
-    return info.GetReturnValue().Set((double)(portablesize + 1));
+  if (!this->checksum) {
+    this->writePayload(data, nullptr);
+    return nullptr;
   }
 
-  return info.GetReturnValue().Set((double)(sizeasarray + 1));
+  // The checksum is computed while writing, one cache friendly block at a time.
+  uint32_t crc = 0;
+  this->writePayload(data + CROARING_SERIALIZATION_CRC32C_HEADER_SIZE, &crc);
+  data[0] = CROARING_SERIALIZATION_CRC32C;
+  memcpy(data + 1, &crc, sizeof(uint32_t));
+  return nullptr;
 }
 
-void RoaringBitmap32::serialize(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = info.GetIsolate();
-  v8::HandleScope scope(isolate);
-
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  if (self == nullptr) {
-    return v8utils::throwError(info.GetIsolate(), "RoaringBitmap32::serialize on invalid object");
+void RoaringBitmap32Serializer::writePayload(uint8_t * data, uint32_t * crc) {
+  if (this->compressed) {
+    this->writeCompressed(data, crc);
+    return;
   }
 
-  if (info.Length() <= 0) {
-    return v8utils::throwError(info.GetIsolate(), "RoaringBitmap32::serialize portable argument must be a boolean value");
+  if (this->serializeArray) {
+    data[0] = CROARING_SERIALIZATION_ARRAY_UINT32;
+    memcpy(data + 1, &this->cardinality, sizeof(uint32_t));
+    if (crc == nullptr) {
+      roaring_bitmap_to_uint32_array(this->roaring, (uint32_t *)(data + 1 + sizeof(uint32_t)));
+      return;
+    }
+    *crc = crc32c::value(data, 1 + sizeof(uint32_t));
+    uint32_t * output = (uint32_t *)(data + 1 + sizeof(uint32_t));
+    roaring_uint32_iterator_t it;
+    roaring_init_iterator(this->roaring, &it);
+    for (;;) {
+      uint32_t n = roaring_read_uint32_iterator(&it, output, 8192);
+      if (n == 0) {
+        break;
+      }
+      *crc = crc32c::extend(*crc, output, n * sizeof(uint32_t));
+      output += n;
+    }
+    return;
   }
 
-  bool portable = info.Length() > 0 && info[0]->IsTrue();
-  bool serializeArray = false;
-  auto portablesize = roaring_bitmap_portable_size_in_bytes(self->roaring);
-  self->updateAmountOfExternalAllocatedMemory(info.GetIsolate(), portablesize);
-  uint64_t cardinality;
-  size_t buffersize;
-
-  if (portable) {
-    buffersize = portablesize;
-  } else {
-    cardinality = roaring_bitmap_get_cardinality(self->roaring);
-    auto sizeasarray = cardinality * sizeof(uint32_t) + sizeof(uint32_t);
-    if (portablesize < sizeasarray || sizeasarray >= MAX_SERIALIZATION_ARRAY_SIZE_IN_BYTES - 1) {
-      buffersize = portablesize + 1;
-    } else {
-      serializeArray = true;
-      buffersize = (size_t)sizeasarray + 1;
+  data[0] = CROARING_SERIALIZATION_CONTAINER;
+  if (crc == nullptr) {
+    roaring_bitmap_portable_serialize(this->roaring, (char *)data + 1);
+    return;
+  }
+  *crc = crc32c::value(data, 1);
+  const roaring_array_t * ra = &this->roaring->high_low_container;
+  RoaringBitmap32ChunkedSerializer chunked;
+  chunked.start(ra);
+  char * output = (char *)data + 1;
+  size_t remaining = this->portableSize;
+  while (remaining != 0) {
+    size_t n = chunked.write(ra, output, remaining < 32768 ? remaining : 32768);
+    if (n == 0) {
+      break;
     }
+    *crc = crc32c::extend(*crc, output, n);
+    output += n;
+    remaining -= n;
   }
+}
 
-  auto maybeBufferObject = node::Buffer::New(isolate, buffersize);
-  v8::Local<v8::Object> bufferObject;
-  if (!maybeBufferObject.ToLocal(&bufferObject))
-    return v8utils::throwError(isolate, "RoaringBitmap32::serialize - failed to allocate");
-  const v8utils::TypedArrayContent<uint8_t> buf(bufferObject);
-  if (!buf.length || !buf.data) return v8utils::throwError(isolate, "RoaringBitmap32::serialize - failed to allocate");
+///// Compressed serialization /////
+
+// Compressed format, after the CROARING_SERIALIZATION_COMPRESSED header byte:
+//   varint number of containers
+//   for each container: varint (key - previous key - 1), uint8 encoding, encoded values
+// Encodings:
+//   compressedArrayVarint  varint (cardinality - 1), varint first value, varint (value - previous - 1) for the others
+//   compressedArrayPacked  as above, but the deltas are bit packed with a fixed width stored in one byte
+//   compressedRuns         varint number of runs, for each run varint gap from the previous run and varint (length - 1)
+//   compressedBitset       8192 bytes, the raw bitset
+// The smallest encoding is chosen for each container, independently from its in-memory type.
+
+enum {
+  compressedArrayVarint = 0,
+  compressedArrayPacked = 1,
+  compressedRuns = 2,
+  compressedBitset = 3,
+  compressedSkip = 0xFF,
+};
 
-  info.GetReturnValue().Set(bufferObject);
+static const uint32_t compressedBitsetSize = 8192;
 
-  if (portable) {
-    roaring_bitmap_portable_serialize(self->roaring, (char *)buf.data);
-  } else if (serializeArray) {
-    buf.data[0] = CROARING_SERIALIZATION_ARRAY_UINT32;
-    memcpy(buf.data + 1, &cardinality, sizeof(uint32_t));
-    roaring_bitmap_to_uint32_array(self->roaring, (uint32_t *)(buf.data + 1 + sizeof(uint32_t)));
-  } else {
-    buf.data[0] = CROARING_SERIALIZATION_CONTAINER;
-    roaring_bitmap_portable_serialize(self->roaring, (char *)buf.data + 1);
+static inline uint32_t varintSize(uint32_t value) {
+  uint32_t result = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++result;
   }
+  return result;
 }
 
-DeserializeResult RoaringBitmap32::doDeserialize(const v8utils::TypedArrayContent<uint8_t> & typedArray, bool portable) {
-  auto bufLen = typedArray.length;
-  const char * bufaschar = (const char *)typedArray.data;
+static inline uint8_t * writeVarint(uint8_t * p, uint32_t value) {
+  while (value >= 0x80) {
+    *p++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  *p++ = (uint8_t)value;
+  return p;
+}
 
-  if (bufLen == 0 || !bufaschar) {
-    return DeserializeResult(roaring_bitmap_create(), "RoaringBitmap32::deserialize - failed to create an empty bitmap");
+// Reads a varint written by writeVarint. Fails for values that do not fit in 32 bits
+// and for non canonical encodings, such as a trailing zero byte, that writeVarint never produces.
+static inline bool readVarint(const uint8_t *& p, const uint8_t * end, uint32_t & value) {
+  value = 0;
+  for (uint32_t shift = 0; shift < 35; shift += 7) {
+    if (p == end) {
+      return false;
+    }
+    uint8_t b = *p++;
+    if (shift == 28 && (b & 0x70) != 0) {
+      return false;
+    }
+    value |= (uint32_t)(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) {
+      return b != 0 || shift == 0;
+    }
   }
+  return false;
+}
 
-  if (portable) {
-    return DeserializeResult(
-      roaring_bitmap_portable_deserialize_safe(bufaschar, bufLen),
-      "RoaringBitmap32::deserialize - portable deserialization failed");
+static inline uint32_t bitWidth(uint32_t value) {
+  uint32_t result = 0;
+  while (value != 0) {
+    value >>= 1;
+    ++result;
   }
+  return result;
+}
 
-  switch ((unsigned char)bufaschar[0]) {
-    case CROARING_SERIALIZATION_ARRAY_UINT32: {
-      uint32_t card;
-      memcpy(&card, bufaschar + 1, sizeof(uint32_t));
+// Gap between the start of a run and the end of the previous one, runs are never adjacent.
+static inline uint32_t compressedRunGap(uint32_t start, int32_t previousEnd) {
+  return previousEnd < 0 ? start : start - (uint32_t)previousEnd - 2;
+}
 
-      if (card * sizeof(uint32_t) + sizeof(uint32_t) + 1 != bufLen) {
-        return DeserializeResult(nullptr, "RoaringBitmap32::deserialize - corrupted data, wrong cardinality header");
+// Expands a container into its sorted 16 bit values. Returns the cardinality.
+static uint32_t containerToUint16Array(const container_t * c, uint8_t type, uint16_t * output) {
+  c = container_unwrap_shared(c, &type);
+  switch (type) {
+    case ARRAY_CONTAINER_TYPE: {
+      const array_container_t * ac = const_CAST_array(c);
+      memcpy(output, ac->array, ac->cardinality * sizeof(uint16_t));
+      return (uint32_t)ac->cardinality;
+    }
+    case BITSET_CONTAINER_TYPE: {
+      const bitset_container_t * bc = const_CAST_bitset(c);
+      uint32_t n = 0;
+      for (uint32_t i = 0; i != BITSET_CONTAINER_SIZE_IN_WORDS; ++i) {
+        uint64_t w = bc->words[i];
+        while (w != 0) {
+          output[n++] = (uint16_t)(i * 64 + __builtin_ctzll(w));
+          w &= w - 1;
+        }
       }
-
-      const uint32_t * elems = (const uint32_t *)(bufaschar + 1 + sizeof(uint32_t));
-      return DeserializeResult(
-        roaring_bitmap_of_ptr(card, elems), "RoaringBitmap32::deserialize - uint32 array deserialization failed");
+      return n;
     }
-
-    case CROARING_SERIALIZATION_CONTAINER: {
-      return DeserializeResult(
-        roaring_bitmap_portable_deserialize_safe(bufaschar + 1, bufLen - 1),
-        "RoaringBitmap32::deserialize - container deserialization failed");
+    case RUN_CONTAINER_TYPE: {
+      const run_container_t * rc = const_CAST_run(c);
+      uint32_t n = 0;
+      for (int32_t i = 0; i != rc->n_runs; ++i) {
+        const uint32_t start = rc->runs[i].value;
+        const uint32_t end = start + rc->runs[i].length;
+        for (uint32_t v = start; v <= end; ++v) {
+          output[n++] = (uint16_t)v;
+        }
+      }
+      return n;
     }
   }
-
-  return DeserializeResult(nullptr, "RoaringBitmap32::deserialize - invalid portable header byte");
+  return 0;
 }
 
-void RoaringBitmap32::deserializeStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = info.GetIsolate();
-
-  v8::HandleScope scope(isolate);
-
-  if (info.Length() == 0 || (!info[0]->IsUint8Array() && !info[0]->IsInt8Array() && !info[0]->IsUint8ClampedArray()))
-    return v8utils::throwTypeError(
-      isolate, "RoaringBitmap32::deserialize requires an argument of type Uint8Array or Buffer");
-
-  v8::Local<v8::Function> cons = constructor.Get(isolate);
-
-  v8::MaybeLocal<v8::Object> resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
-  v8::Local<v8::Object> result;
-  if (!resultMaybe.ToLocal(&result)) {
-    return;
+// Chooses the smallest encoding for the given values, n must be greater than zero.
+static uint8_t chooseCompressedEncoding(const uint16_t * values, uint32_t n, uint32_t & size) {
+  const uint32_t header = varintSize(n - 1) + varintSize(values[0]);
+  uint32_t varintBytes = header;
+  uint32_t maxDelta = 0;
+  uint32_t runs = 0;
+  uint32_t runBytes = 0;
+  uint32_t runStart = values[0];
+  int32_t previousEnd = -1;
+
+  for (uint32_t i = 1; i < n; ++i) {
+    const uint32_t delta = (uint32_t)values[i] - values[i - 1] - 1;
+    varintBytes += varintSize(delta);
+    if (delta != 0) {
+      if (delta > maxDelta) {
+        maxDelta = delta;
+      }
+      runBytes += varintSize(compressedRunGap(runStart, previousEnd)) + varintSize(values[i - 1] - runStart);
+      previousEnd = values[i - 1];
+      runStart = values[i];
+      ++runs;
+    }
   }
+  runBytes += varintSize(compressedRunGap(runStart, previousEnd)) + varintSize(values[n - 1] - runStart);
+  ++runs;
+  runBytes += varintSize(runs);
 
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
-  self->replaceBitmapInstance(isolate, nullptr);
-
-  const v8utils::TypedArrayContent<uint8_t> typedArray(info[0]);
+  const uint32_t packedBytes = header + 1 + (uint32_t)(((uint64_t)(n - 1) * bitWidth(maxDelta) + 7) / 8);
 
-  if (info.Length() < 2) {
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::deserialize portable argument must be specified");
+  uint8_t encoding = compressedBitset;
+  size = compressedBitsetSize;
+  if (packedBytes < size) {
+    encoding = compressedArrayPacked;
+    size = packedBytes;
   }
-
-  auto deserialization = doDeserialize(typedArray, info[1]->IsTrue());
-  if (deserialization.error) {
-    return v8utils::throwError(isolate, deserialization.error);
+  if (varintBytes < size) {
+    encoding = compressedArrayVarint;
+    size = varintBytes;
   }
-
-  self->replaceBitmapInstance(isolate, deserialization.bitmap);
-  self->updateAmountOfExternalAllocatedMemory(isolate);
-
-  info.GetReturnValue().Set(result);
+  if (runBytes < size) {
+    encoding = compressedRuns;
+    size = runBytes;
+  }
+  return encoding;
 }
 
-void RoaringBitmap32::deserialize(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  auto isolate = info.GetIsolate();
-  v8::HandleScope scope(isolate);
-
-  if (info.Length() == 0 || (!info[0]->IsUint8Array() && !info[0]->IsInt8Array() && !info[0]->IsUint8ClampedArray()))
-    return v8utils::throwTypeError(
-      isolate, "RoaringBitmap32::deserialize requires an argument of type Uint8Array or Buffer");
+// Writes the values of a container with the given encoding. Returns the end of the written data.
+static uint8_t * writeCompressedValues(uint8_t * p, uint8_t encoding, const uint16_t * values, uint32_t n) {
+  switch (encoding) {
+    case compressedArrayVarint: {
+      p = writeVarint(p, n - 1);
+      p = writeVarint(p, values[0]);
+      for (uint32_t j = 1; j < n; ++j) {
+        p = writeVarint(p, (uint32_t)values[j] - values[j - 1] - 1);
+      }
+      break;
+    }
 
-  auto holder = info.Holder();
+    case compressedArrayPacked: {
+      uint32_t maxDelta = 0;
+      for (uint32_t j = 1; j < n; ++j) {
+        const uint32_t delta = (uint32_t)values[j] - values[j - 1] - 1;
+        if (delta > maxDelta) {
+          maxDelta = delta;
+        }
+      }
+      const uint32_t width = bitWidth(maxDelta);
+      p = writeVarint(p, n - 1);
+      p = writeVarint(p, values[0]);
+      *p++ = (uint8_t)width;
+      uint64_t accumulator = 0;
+      uint32_t bits = 0;
+      for (uint32_t j = 1; j < n; ++j) {
+        accumulator |= (uint64_t)((uint32_t)values[j] - values[j - 1] - 1) << bits;
+        bits += width;
+        while (bits >= 8) {
+          *p++ = (uint8_t)accumulator;
+          accumulator >>= 8;
+          bits -= 8;
+        }
+      }
+      if (bits != 0) {
+        *p++ = (uint8_t)accumulator;
+      }
+      break;
+    }
 
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(holder);
+    case compressedRuns: {
+      uint32_t runs = 1;
+      for (uint32_t j = 1; j < n; ++j) {
+        if (values[j] != values[j - 1] + 1) {
+          ++runs;
+        }
+      }
+      p = writeVarint(p, runs);
+      uint32_t runStart = values[0];
+      int32_t previousEnd = -1;
+      for (uint32_t j = 1; j <= n; ++j) {
+        if (j == n || values[j] != values[j - 1] + 1) {
+          p = writeVarint(p, compressedRunGap(runStart, previousEnd));
+          p = writeVarint(p, values[j - 1] - runStart);
+          previousEnd = values[j - 1];
+          if (j != n) {
+            runStart = values[j];
+          }
+        }
+      }
+      break;
+    }
 
-  if (info.Length() < 2) {
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::deserialize portable argument must be specified");
+    default: {
+      memset(p, 0, compressedBitsetSize);
+      for (uint32_t j = 0; j < n; ++j) {
+        p[values[j] >> 3] |= (uint8_t)(1 << (values[j] & 7));
+      }
+      p += compressedBitsetSize;
+      break;
+    }
   }
+  return p;
+}
 
-  const v8utils::TypedArrayContent<uint8_t> typedArray(info[0]);
-  auto deserialized = doDeserialize(typedArray, info[1]->IsTrue());
-  if (deserialized.error) {
-    return v8utils::throwError(isolate, deserialized.error);
+bool RoaringBitmap32Serializer::computeCompressedSize() {
+  const roaring_array_t * ra = &this->roaring->high_low_container;
+  if (this->values == nullptr) {
+    this->values = (uint16_t *)malloc(65536 * sizeof(uint16_t));
+    if (this->values == nullptr) {
+      return false;
+    }
+  }
+  if (this->compressedCache != nullptr) {
+    return this->computeCompressedSizeCached();
   }
 
-  self->replaceBitmapInstance(isolate, deserialized.bitmap);
-  self->updateAmountOfExternalAllocatedMemory(isolate);
+  this->encodings.resize((size_t)ra->size);
 
-  info.GetReturnValue().Set(holder);
+  uint32_t containers = 0;
+  int32_t previousKey = -1;
+  size_t size = 1;
+  for (int32_t i = 0; i < ra->size; ++i) {
+    const uint32_t n = containerToUint16Array(ra->containers[i], ra->typecodes[i], this->values);
+    if (n == 0) {
+      this->encodings[i] = compressedSkip;
+      continue;
+    }
+    uint32_t containerSize;
+    this->encodings[i] = chooseCompressedEncoding(this->values, n, containerSize);
+    size += varintSize((uint32_t)(ra->keys[i] - previousKey - 1)) + 1 + containerSize;
+    previousKey = ra->keys[i];
+    ++containers;
+  }
+
+  this->compressedContainers = containers;
+  this->payloadSize = size + varintSize(containers);
+  return true;
 }
 
-class DeserializeWorker final : public RoaringBitmap32FactoryAsyncWorker {
- public:
-  v8::Persistent<v8::Value> bufferPersistent;
-  v8utils::TypedArrayContent<uint8_t> buffer;
-  bool portable;
+// Encodes again only the containers changed since the last incremental serialization,
+// the other containers are copied from the cache. The cache is replaced by the new encoded containers.
+bool RoaringBitmap32Serializer::computeCompressedSizeCached() {
+  const roaring_array_t * ra = &this->roaring->high_low_container;
+  RoaringBitmap32CompressedCache * cache = this->compressedCache;
+  cache->dirty.normalize();
+
+  std::vector<uint16_t> keys;
+  std::vector<size_t> offsets;
+  std::vector<uint8_t> blocks;
+  keys.reserve((size_t)ra->size);
+  offsets.reserve((size_t)ra->size + 1);
+  blocks.reserve(cache->blocks.size());
+
+  uint32_t containers = 0;
+  int32_t previousKey = -1;
+  size_t size = 1;
+  size_t cached = 0;
+  for (int32_t i = 0; i < ra->size; ++i) {
+    const uint16_t key = ra->keys[i];
+    while (cached < cache->keys.size() && cache->keys[cached] < key) {
+      ++cached;
+    }
+    const size_t blockStart = blocks.size();
+    if (cached < cache->keys.size() && cache->keys[cached] == key && !cache->dirty.contains(key)) {
+      blocks.insert(
+        blocks.end(), cache->blocks.begin() + cache->offsets[cached], cache->blocks.begin() + cache->offsets[cached + 1]);
+    } else {
+      const uint32_t n = containerToUint16Array(ra->containers[i], ra->typecodes[i], this->values);
+      if (n == 0) {
+        continue;
+      }
+      uint32_t containerSize;
+      const uint8_t encoding = chooseCompressedEncoding(this->values, n, containerSize);
+      blocks.resize(blockStart + 1 + containerSize);
+      uint8_t * p = blocks.data() + blockStart;
+      *p++ = encoding;
+      writeCompressedValues(p, encoding, this->values, n);
+    }
+    keys.push_back(key);
+    offsets.push_back(blockStart);
+    size += varintSize((uint32_t)(key - previousKey - 1)) + (blocks.size() - blockStart);
+    previousKey = key;
+    ++containers;
+  }
+  offsets.push_back(blocks.size());
 
-  explicit DeserializeWorker(v8::Isolate * isolate) : RoaringBitmap32FactoryAsyncWorker(isolate), portable(false) {}
+  cache->keys.swap(keys);
+  cache->offsets.swap(offsets);
+  cache->blocks.swap(blocks);
+  cache->dirty.clear();
 
-  virtual ~DeserializeWorker() { bufferPersistent.Reset(); }
+  this->compressedContainers = containers;
+  this->payloadSize = size + varintSize(containers);
+  return true;
+}
 
-  bool setBuffer(v8::Local<v8::Value> buf) {
-    if (buf.IsEmpty() || (!buf->IsUint8Array() && !buf->IsInt8Array() && !buf->IsUint8ClampedArray())) {
-      return false;
+void RoaringBitmap32Serializer::writeCompressed(uint8_t * data, uint32_t * crc) {
+  if (this->compressedCache != nullptr) {
+    const RoaringBitmap32CompressedCache * cache = this->compressedCache;
+    uint8_t * p = data;
+    *p++ = CROARING_SERIALIZATION_COMPRESSED;
+    p = writeVarint(p, this->compressedContainers);
+    int32_t previousKey = -1;
+    for (size_t i = 0; i < cache->keys.size(); ++i) {
+      p = writeVarint(p, (uint32_t)(cache->keys[i] - previousKey - 1));
+      previousKey = cache->keys[i];
+      const size_t length = cache->offsets[i + 1] - cache->offsets[i];
+      memcpy(p, cache->blocks.data() + cache->offsets[i], length);
+      p += length;
     }
-    if (!this->buffer.set(buf)) {
-      return false;
+    if (crc != nullptr) {
+      *crc = crc32c::value(data, (size_t)(p - data));
     }
-    bufferPersistent.Reset(isolate, buf);
-    return true;
+    return;
   }
 
- protected:
-  void work() final {
-    auto deserialized = RoaringBitmap32::doDeserialize(buffer, portable);
-    if (deserialized.error != nullptr) {
-      this->setError(deserialized.error);
-      return;
-    }
-    this->bitmap = deserialized.bitmap;
+  const roaring_array_t * ra = &this->roaring->high_low_container;
+  uint16_t * values = this->values;
+
+  uint8_t * p = data;
+  *p++ = CROARING_SERIALIZATION_COMPRESSED;
+  p = writeVarint(p, this->compressedContainers);
+  if (crc != nullptr) {
+    *crc = crc32c::value(data, (size_t)(p - data));
   }
-};
 
-void RoaringBitmap32::deserializeStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = v8::Isolate::GetCurrent();
-  v8::HandleScope scope(isolate);
+  int32_t previousKey = -1;
+  for (int32_t i = 0; i < ra->size; ++i) {
+    const uint8_t encoding = this->encodings[i];
+    if (encoding == compressedSkip) {
+      continue;
+    }
 
-  auto * worker = new DeserializeWorker(isolate);
-  if (worker == nullptr) {
-    return v8utils::throwError(isolate, "RoaringBitmap32::deserializeAsync - Failed to allocate async worker");
+    uint8_t * containerStart = p;
+    const uint32_t n = containerToUint16Array(ra->containers[i], ra->typecodes[i], values);
+    p = writeVarint(p, (uint32_t)(ra->keys[i] - previousKey - 1));
+    previousKey = ra->keys[i];
+    *p++ = encoding;
+    p = writeCompressedValues(p, encoding, values, n);
+
+    if (crc != nullptr) {
+      *crc = crc32c::extend(*crc, containerStart, (size_t)(p - containerStart));
+    }
   }
+}
 
-  if (info.Length() <= 0 || !worker->setBuffer(info[0])) {
-    delete worker;
-    return v8utils::throwTypeError(
-      isolate, "RoaringBitmap32::deserializeAsync - first argument must be Uint8Array or Buffer");
+// Creates an array or a bitset container from sorted 16 bit values.
+static container_t * containerFromUint16Array(const uint16_t * values, uint32_t n, uint8_t & type) {
+  if (n <= DEFAULT_MAX_SIZE) {
+    array_container_t * ac = array_container_create_given_capacity((int32_t)n);
+    if (ac == nullptr) {
+      return nullptr;
+    }
+    memcpy(ac->array, values, n * sizeof(uint16_t));
+    ac->cardinality = (int32_t)n;
+    type = ARRAY_CONTAINER_TYPE;
+    return ac;
+  }
+  bitset_container_t * bc = bitset_container_create();
+  if (bc == nullptr) {
+    return nullptr;
   }
+  for (uint32_t i = 0; i != n; ++i) {
+    bc->words[values[i] >> 6] |= UINT64_C(1) << (values[i] & 63);
+  }
+  bc->cardinality = (int32_t)n;
+  type = BITSET_CONTAINER_TYPE;
+  return bc;
+}
 
-  if (info.Length() >= 2) {
-    if (info[1]->IsFunction()) {
-      worker->setCallback(info[1]);
-      if (info.Length() >= 3 && info[2]->IsTrue()) {
-        worker->portable = true;
+static container_t * readCompressedContainer(
+  const uint8_t *& p, const uint8_t * end, uint8_t encoding, uint16_t * values, uint8_t & type) {
+  switch (encoding) {
+    case compressedArrayVarint:
+    case compressedArrayPacked: {
+      uint32_t nMinus1;
+      uint32_t value;
+      if (!readVarint(p, end, nMinus1) || nMinus1 > 0xFFFF || !readVarint(p, end, value) || value > 0xFFFF) {
+        return nullptr;
       }
-    } else {
-      if (info[1]->IsTrue()) {
-        worker->portable = true;
+      const uint32_t n = nMinus1 + 1;
+      values[0] = (uint16_t)value;
+      if (encoding == compressedArrayVarint) {
+        for (uint32_t i = 1; i != n; ++i) {
+          uint32_t delta;
+          if (!readVarint(p, end, delta) || delta > 0xFFFF) {
+            return nullptr;
+          }
+          value += delta + 1;
+          if (value > 0xFFFF) {
+            return nullptr;
+          }
+          values[i] = (uint16_t)value;
+        }
+      } else {
+        if (p == end) {
+          return nullptr;
+        }
+        const uint32_t width = *p++;
+        if (width > 16 || (uint64_t)(end - p) < ((uint64_t)nMinus1 * width + 7) / 8) {
+          return nullptr;
+        }
+        const uint32_t mask = (1U << width) - 1;
+        uint64_t accumulator = 0;
+        uint32_t bits = 0;
+        for (uint32_t i = 1; i != n; ++i) {
+          while (bits < width) {
+            accumulator |= (uint64_t)(*p++) << bits;
+            bits += 8;
+          }
+          value += ((uint32_t)accumulator & mask) + 1;
+          accumulator >>= width;
+          bits -= width;
+          if (value > 0xFFFF) {
+            return nullptr;
+          }
+          values[i] = (uint16_t)value;
+        }
+      }
+      return containerFromUint16Array(values, n, type);
+    }
+
+    case compressedRuns: {
+      uint32_t runs;
+      if (!readVarint(p, end, runs) || runs == 0 || runs > 32768) {
+        return nullptr;
       }
-      if (info.Length() >= 3 && info[2]->IsFunction()) {
-        worker->setCallback(info[2]);
+      run_container_t * rc = run_container_create_given_capacity((int32_t)runs);
+      if (rc == nullptr) {
+        return nullptr;
       }
+      int32_t previousEnd = -1;
+      for (uint32_t i = 0; i != runs; ++i) {
+        uint32_t gap;
+        uint32_t lengthMinus1;
+        if (!readVarint(p, end, gap) || !readVarint(p, end, lengthMinus1)) {
+          run_container_free(rc);
+          return nullptr;
+        }
+        const uint64_t start = previousEnd < 0 ? (uint64_t)gap : (uint64_t)previousEnd + 2 + gap;
+        if (start + lengthMinus1 > 0xFFFF) {
+          run_container_free(rc);
+          return nullptr;
+        }
+        rc->runs[i].value = (uint16_t)start;
+        rc->runs[i].length = (uint16_t)lengthMinus1;
+        previousEnd = (int32_t)(start + lengthMinus1);
+      }
+      rc->n_runs = (int32_t)runs;
+      type = RUN_CONTAINER_TYPE;
+      return rc;
+    }
+
+    case compressedBitset: {
+      if ((size_t)(end - p) < compressedBitsetSize) {
+        return nullptr;
+      }
+      bitset_container_t * bc = bitset_container_create();
+      if (bc == nullptr) {
+        return nullptr;
+      }
+      memcpy(bc->words, p, compressedBitsetSize);
+      p += compressedBitsetSize;
+      bc->cardinality = bitset_container_compute_cardinality(bc);
+      if (bc->cardinality == 0) {
+        bitset_container_free(bc);
+        return nullptr;
+      }
+      if (bc->cardinality <= DEFAULT_MAX_SIZE) {
+        array_container_t * ac = array_container_from_bitset(bc);
+        bitset_container_free(bc);
+        type = ARRAY_CONTAINER_TYPE;
+        return ac;
+      }
+      type = BITSET_CONTAINER_TYPE;
+      return bc;
     }
   }
 
-  v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
-  info.GetReturnValue().Set(returnValue);
+  return nullptr;
 }
 
-class DeserializeParallelWorkerItem {
- public:
-  volatile roaring_bitmap_t_ptr bitmap;
-  v8::Persistent<v8::Value> bufferPersistent;
-  v8utils::TypedArrayContent<uint8_t> buffer;
+roaring_bitmap_t * RoaringBitmap32Serializer::deserializeCompressed(const uint8_t * data, size_t length) {
+  const uint8_t * p = data;
+  const uint8_t * end = data + length;
 
-  DeserializeParallelWorkerItem() : bitmap(nullptr) {}
+  uint32_t count;
+  if (!readVarint(p, end, count) || count > 65536 || count > length) {
+    return nullptr;
+  }
 
-  ~DeserializeParallelWorkerItem() {
-    bufferPersistent.Reset();
-    if (this->bitmap != nullptr) {
-      roaring_bitmap_free(this->bitmap);
-      this->bitmap = nullptr;
-    }
+  roaring_bitmap_t * result = roaring_bitmap_create_with_capacity(count);
+  if (result == nullptr) {
+    return nullptr;
   }
 
-  bool setBuffer(v8::Isolate * isolate, v8::Local<v8::Value> buf) {
-    if (buf.IsEmpty() || (!buf->IsUint8Array() && !buf->IsInt8Array() && !buf->IsUint8ClampedArray())) {
-      return false;
+  uint16_t * values = count != 0 ? (uint16_t *)malloc(65536 * sizeof(uint16_t)) : nullptr;
+  bool ok = count == 0 || values != nullptr;
+
+  int32_t key = -1;
+  for (uint32_t i = 0; ok && i != count; ++i) {
+    uint32_t keyDelta;
+    if (!readVarint(p, end, keyDelta) || keyDelta > 0xFFFF || key + 1 + (int32_t)keyDelta > 0xFFFF || p == end) {
+      ok = false;
+      break;
     }
-    return this->buffer.set(buf);
+    key += 1 + (int32_t)keyDelta;
+    const uint8_t encoding = *p++;
+    uint8_t type = 0;
+    container_t * container = readCompressedContainer(p, end, encoding, values, type);
+    if (container == nullptr) {
+      ok = false;
+      break;
+    }
+    ra_append(&result->high_low_container, (uint16_t)key, container, type);
   }
-};
 
-class DeserializeParallelWorker : public v8utils::ParallelAsyncWorker {
- public:
-  v8::Persistent<v8::Value> bufferPersistent;
+  free(values);
 
-  bool portable;
-  DeserializeParallelWorkerItem * items;
+  if (!ok || p != end) {
+    roaring_bitmap_free(result);
+    return nullptr;
+  }
+  return result;
+}
 
-  explicit DeserializeParallelWorker(v8::Isolate * isolate) :
-    v8utils::ParallelAsyncWorker(isolate), portable(false), items(nullptr) {}
+///// Serialization API /////
+
+// Reads the serialization options object, returns false if the options are invalid.
+static bool getSerializationOptions(
+  v8::Isolate * isolate,
+  v8::Local<v8::Value> optionsValue,
+  RoaringBitmap32Serializer & serializer,
+  bool * incremental = nullptr) {
+  serializer.checksum = false;
+  serializer.compressed = false;
+  if (incremental != nullptr) {
+    *incremental = false;
+  }
+  if (optionsValue.IsEmpty() || optionsValue->IsNullOrUndefined()) {
+    return true;
+  }
+  if (!optionsValue->IsObject()) {
+    v8utils::throwTypeError(isolate, "RoaringBitmap32::serialize - options must be an object");
+    return false;
+  }
+  auto context = isolate->GetCurrentContext();
+  auto options = v8::Local<v8::Object>::Cast(optionsValue);
+  v8::Local<v8::Value> checksumValue;
+  v8::Local<v8::Value> compressedValue;
+  if (
+    !options->Get(context, NEW_LITERAL_V8_STRING(isolate, "checksum", v8::NewStringType::kInternalized))
+       .ToLocal(&checksumValue) ||
+    !options->Get(context, NEW_LITERAL_V8_STRING(isolate, "compressed", v8::NewStringType::kInternalized))
+       .ToLocal(&compressedValue)) {
+    return false;
+  }
+  serializer.checksum = checksumValue->IsTrue();
+  serializer.compressed = compressedValue->IsTrue();
+  if (serializer.portable && serializer.checksum) {
+    v8utils::throwTypeError(isolate, "RoaringBitmap32::serialize - checksum is supported only by the non portable format");
+    return false;
+  }
+  if (serializer.portable && serializer.compressed) {
+    v8utils::throwTypeError(
+      isolate, "RoaringBitmap32::serialize - compression is supported only by the non portable format");
+    return false;
+  }
+  if (incremental != nullptr) {
+    v8::Local<v8::Value> incrementalValue;
+    if (!options->Get(context, NEW_LITERAL_V8_STRING(isolate, "incremental", v8::NewStringType::kInternalized))
+           .ToLocal(&incrementalValue)) {
+      return false;
+    }
+    *incremental = incrementalValue->IsTrue();
+    if (*incremental && !serializer.compressed) {
+      v8utils::throwTypeError(isolate, "RoaringBitmap32::serialize - incremental is supported only by the compressed format");
+      return false;
+    }
+  }
+  return true;
+}
 
-  virtual ~DeserializeParallelWorker() { delete[] items; }
+void RoaringBitmap32::getSerializationSizeInBytes(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (info.Length() <= 0) {
+    return v8utils::throwError(info.GetIsolate(), "portable argument must be a boolean value");
+  }
+  if (self == nullptr) {
+    return info.GetReturnValue().Set(0U);
+  }
+  self->autoOptimizeBeforeSerialize();
+
+  RoaringBitmap32Serializer serializer;
+  serializer.roaring = self->roaring;
+  serializer.portable = info[0]->IsTrue();
+  bool incremental;
+  if (!getSerializationOptions(
+        info.GetIsolate(), info.Length() >= 2 ? info[1] : v8::Local<v8::Value>(), serializer, &incremental)) {
+    return;
+  }
+  if (incremental) {
+    serializer.compressedCache = self->getCompressedCache();
+  }
 
- protected:
-  virtual void parallelWork(uint32_t index) {
-    DeserializeParallelWorkerItem & item = items[index];
-    auto deserialized = RoaringBitmap32::doDeserialize(item.buffer, portable);
-    if (deserialized.error != nullptr) {
-      this->setError(deserialized.error);
-      return;
-    }
-    item.bitmap = deserialized.bitmap;
+  size_t size = serializer.computeSize();
+  if (size == 0) {
+    return v8utils::throwError(info.GetIsolate(), "RoaringBitmap32::getSerializationSizeInBytes - failed to allocate");
   }
+  self->updateAmountOfExternalAllocatedMemory(info.GetIsolate(), serializer.getPortableSize());
 
-  v8::Local<v8::Value> done() final {
-    v8::Local<v8::Function> cons = RoaringBitmap32::constructor.Get(isolate);
+  return info.GetReturnValue().Set((double)size);
+}
 
-    const uint32_t itemsCount = this->loopCount;
-    DeserializeParallelWorkerItem * items = this->items;
+void RoaringBitmap32::serialize(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
 
-    v8::MaybeLocal<v8::Array> resultArrayMaybe = v8::Array::New(isolate, itemsCount);
-    v8::Local<v8::Array> resultArray;
-    if (!resultArrayMaybe.ToLocal(&resultArray)) return v8::Local<v8::Value>();
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (self == nullptr) {
+    return v8utils::throwError(info.GetIsolate(), "RoaringBitmap32::serialize on invalid object");
+  }
 
-    v8::Local<v8::Context> currentContext = isolate->GetCurrentContext();
+  if (info.Length() <= 0) {
+    return v8utils::throwError(info.GetIsolate(), "RoaringBitmap32::serialize portable argument must be a boolean value");
+  }
+  self->autoOptimizeBeforeSerialize();
 
-    for (uint32_t i = 0; i != itemsCount; ++i) {
-      v8::MaybeLocal<v8::Object> instanceMaybe = cons->NewInstance(currentContext, 0, nullptr);
+  RoaringBitmap32Serializer serializer;
+  serializer.roaring = self->roaring;
+  serializer.portable = info[0]->IsTrue();
+  bool incremental;
+  if (!getSerializationOptions(isolate, info.Length() >= 2 ? info[1] : v8::Local<v8::Value>(), serializer, &incremental)) {
+    return;
+  }
+  if (incremental) {
+    serializer.compressedCache = self->getCompressedCache();
+  }
 
-      v8::Local<v8::Object> instance;
-      if (!instanceMaybe.ToLocal(&instance)) return v8::Local<v8::Value>();
+  size_t buffersize = serializer.computeSize();
+  if (buffersize == 0) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serialize - failed to allocate");
+  }
+  self->updateAmountOfExternalAllocatedMemory(info.GetIsolate(), serializer.getPortableSize());
 
-      RoaringBitmap32 * unwrapped = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(instance);
+  auto maybeBufferObject = node::Buffer::New(isolate, buffersize);
+  v8::Local<v8::Object> bufferObject;
+  if (!maybeBufferObject.ToLocal(&bufferObject))
+    return v8utils::throwError(isolate, "RoaringBitmap32::serialize - failed to allocate");
+  const v8utils::TypedArrayContent<uint8_t> buf(bufferObject);
+  if (!buf.length || !buf.data) return v8utils::throwError(isolate, "RoaringBitmap32::serialize - failed to allocate");
 
-      DeserializeParallelWorkerItem & item = items[i];
+  const char * error = serializer.serialize(buf.data);
+  if (error != nullptr) {
+    return v8utils::throwError(isolate, error);
+  }
 
-      unwrapped->replaceBitmapInstance(isolate, item.bitmap);
-      item.bitmap = nullptr;
+  info.GetReturnValue().Set(bufferObject);
+}
 
-      unwrapped->updateAmountOfExternalAllocatedMemory(isolate);
+// Reads an optional integer option, undefined is zero.
+static bool getUint32Option(
+  v8::Isolate * isolate,
+  const char * name,
+  v8::Local<v8::Object> options,
+  v8::Local<v8::String> key,
+  const char * message,
+  uint32_t maxValue,
+  uint32_t & result) {
+  v8::Local<v8::Value> value;
+  if (!options->Get(isolate->GetCurrentContext(), key).ToLocal(&value)) {
+    return false;
+  }
+  if (value->IsUndefined()) {
+    return true;
+  }
+  double n = value->IsNumber() ? value.As<v8::Number>()->Value() : -1;
+  if (!(n >= 0 && n <= maxValue && n == std::floor(n))) {
+    v8utils::throwTypeError(isolate, name, message);
+    return false;
+  }
+  result = (uint32_t)n;
+  return true;
+}
 
-      v8utils::ignoreMaybeResult(resultArray->Set(currentContext, i, instance));
+// Parses the "background", "normal" or "high" priority of an async operation. Undefined keeps the given priority.
+static bool getAsyncPriority(v8::Isolate * isolate, v8::Local<v8::Value> value, v8utils::AsyncPriority & priority) {
+  if (value.IsEmpty() || value->IsUndefined()) {
+    return true;
+  }
+  if (!value->IsString()) {
+    return false;
+  }
+  v8::String::Utf8Value str(isolate, value);
+  if (*str == nullptr) {
+    return false;
+  }
+  if (strcmp(*str, "background") == 0) {
+    priority = v8utils::AsyncPriority::Background;
+    return true;
+  }
+  if (strcmp(*str, "normal") == 0) {
+    priority = v8utils::AsyncPriority::Normal;
+    return true;
+  }
+  if (strcmp(*str, "high") == 0) {
+    priority = v8utils::AsyncPriority::High;
+    return true;
+  }
+  return false;
+}
+
+// Reads the optional { signal, priority } options of an async operation,
+// and the { concurrency, chunkSize, largestFirst } options of a parallel async operation.
+static bool setAsyncOptions(
+  v8::Isolate * isolate,
+  const char * name,
+  v8::Local<v8::Value> optionsValue,
+  v8utils::AsyncWorker * worker,
+  v8utils::ParallelAsyncWorker * parallelWorker = nullptr) {
+  if (optionsValue.IsEmpty() || optionsValue->IsNullOrUndefined()) {
+    return true;
+  }
+  if (!optionsValue->IsObject()) {
+    v8utils::throwTypeError(isolate, name, " - options must be an object");
+    return false;
+  }
+  auto context = isolate->GetCurrentContext();
+  auto options = v8::Local<v8::Object>::Cast(optionsValue);
+  v8::Local<v8::Value> signal;
+  if (!options->Get(context, NEW_LITERAL_V8_STRING(isolate, "signal", v8::NewStringType::kInternalized)).ToLocal(&signal)) {
+    return false;
+  }
+  if (!signal->IsUndefined() && !worker->setAbortSignal(signal)) {
+    v8utils::throwTypeError(isolate, name, " - options.signal must be an AbortSignal");
+    return false;
+  }
+  v8::Local<v8::Value> priority;
+  if (!options->Get(context, NEW_LITERAL_V8_STRING(isolate, "priority", v8::NewStringType::kInternalized))
+         .ToLocal(&priority)) {
+    return false;
+  }
+  if (!getAsyncPriority(isolate, priority, worker->priority)) {
+    v8utils::throwTypeError(isolate, name, " - options.priority must be \"background\", \"normal\" or \"high\"");
+    return false;
+  }
+  if (parallelWorker != nullptr) {
+    v8::Local<v8::Value> largestFirst;
+    if (
+      !getUint32Option(
+        isolate,
+        name,
+        options,
+        NEW_LITERAL_V8_STRING(isolate, "concurrency", v8::NewStringType::kInternalized),
+        " - options.concurrency must be an integer between 0 and 1024",
+        1024,
+        parallelWorker->concurrency) ||
+      !getUint32Option(
+        isolate,
+        name,
+        options,
+        NEW_LITERAL_V8_STRING(isolate, "chunkSize", v8::NewStringType::kInternalized),
+        " - options.chunkSize must be an integer between 0 and 65536",
+        65536,
+        parallelWorker->chunkSize) ||
+      !options->Get(context, NEW_LITERAL_V8_STRING(isolate, "largestFirst", v8::NewStringType::kInternalized))
+         .ToLocal(&largestFirst)) {
+      return false;
+    }
+    parallelWorker->largestFirst = largestFirst->IsTrue();
+  }
+  return true;
+}
+
+// Reads the optional options argument at the given index, followed by the optional callback.
+static bool setAsyncOptionsAndCallback(
+  const v8::FunctionCallbackInfo<v8::Value> & info,
+  int index,
+  const char * name,
+  v8utils::AsyncWorker * worker,
+  v8utils::ParallelAsyncWorker * parallelWorker = nullptr) {
+  if (info.Length() > index && !info[index]->IsFunction()) {
+    if (!setAsyncOptions(info.GetIsolate(), name, info[index], worker, parallelWorker)) {
+      return false;
     }
+    ++index;
+  }
+  if (info.Length() > index && info[index]->IsFunction()) {
+    worker->setCallback(info[index]);
+  }
+  return true;
+}
 
-    return resultArray;
+class SerializeWorker final : public v8utils::AsyncWorker {
+ public:
+  RoaringBitmap32Serializer serializer;
+  roaring_bitmap_t * snapshot;
+  char * data;
+  size_t size;
+
+  explicit SerializeWorker(v8::Isolate * isolate) : v8utils::AsyncWorker(isolate), snapshot(nullptr), data(nullptr), size(0) {
+    this->priority = v8utils::AsyncPriority::Background;
   }
-};
 
-void RoaringBitmap32::deserializeParallelStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = v8::Isolate::GetCurrent();
-  v8::HandleScope scope(isolate);
+  virtual ~SerializeWorker() {
+    free(this->data);
+    if (this->snapshot != nullptr) {
+      roaring_bitmap_free(this->snapshot);
+    }
+  }
 
-  if (info.Length() < 1 || !info[0]->IsArray()) {
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::deserializeParallelAsync requires an array as first argument");
+ protected:
+  void work() final {
+    this->serializer.roaring = this->snapshot;
+    this->size = this->serializer.computeSize();
+    this->data = this->size != 0 ? (char *)malloc(this->size) : nullptr;
+    if (this->data == nullptr) {
+      this->setError("RoaringBitmap32::serializeAsync - failed to allocate");
+      return;
+    }
+    this->setError(this->serializer.serialize((uint8_t *)this->data));
   }
 
-  auto array = v8::Local<v8::Array>::Cast(info[0]);
+  v8::Local<v8::Value> done() final {
+    // The buffer takes the ownership of the memory, no copy is needed.
+    v8::Local<v8::Object> result;
+    if (!node::Buffer::New(isolate, this->data, this->size).ToLocal(&result)) {
+      return v8::Local<v8::Value>();
+    }
+    this->data = nullptr;
+    return result;
+  }
+};
 
-  uint32_t length = array->Length();
+void RoaringBitmap32::serializeAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
 
-  if (length > 0x01FFFFFF) {
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::deserializeParallelAsync - array too big");
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (self == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeAsync on invalid object");
   }
 
-  auto * worker = new DeserializeParallelWorker(isolate);
-  if (worker == nullptr) {
-    return v8utils::throwError(isolate, "Failed to allocate async worker");
+  if (info.Length() <= 0 || info[0]->IsFunction()) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeAsync portable argument must be a boolean value");
   }
 
-  DeserializeParallelWorkerItem * items = length ? new DeserializeParallelWorkerItem[length]() : nullptr;
-  if (items == nullptr && length != 0) {
-    delete worker;
-    return v8utils::throwError(isolate, "Failed to allocate async worker memory");
+  auto * worker = new SerializeWorker(isolate);
+  if (worker == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeAsync - Failed to allocate async worker");
   }
-  worker->items = items;
-  worker->loopCount = length;
 
-  auto context = isolate->GetCurrentContext();
-  for (uint32_t i = 0; i != length; ++i) {
-    auto vMaybe = array->Get(context, i);
-    v8::Local<v8::Value> v;
-    if (!vMaybe.ToLocal(&v) || (!v->IsNullOrUndefined() && !items[i].setBuffer(isolate, v))) {
+  worker->serializer.portable = info[0]->IsTrue();
+
+  int callbackIndex = 1;
+  if (info.Length() >= 2 && !info[1]->IsFunction()) {
+    if (
+      !getSerializationOptions(isolate, info[1], worker->serializer) ||
+      !setAsyncOptions(isolate, "RoaringBitmap32::serializeAsync", info[1], worker)) {
       delete worker;
-      return v8utils::throwTypeError(
-        isolate, "RoaringBitmap32::deserializeParallelAsync - Array must contains only Uint8Array or Buffer elements");
+      return;
     }
+    callbackIndex = 2;
+  }
+  if (info.Length() > callbackIndex && info[callbackIndex]->IsFunction()) {
+    worker->setCallback(info[callbackIndex]);
   }
 
-  if (info.Length() >= 2) {
-    if (info[1]->IsFunction()) {
-      worker->setCallback(info[1]);
-      if (info.Length() >= 3 && info[2]->IsTrue()) {
-        worker->portable = true;
-      }
-    } else {
-      if (info[1]->IsTrue()) {
-        worker->portable = true;
-      }
-      if (info.Length() >= 3 && info[2]->IsFunction()) {
-        worker->setCallback(info[2]);
-      }
-    }
+  // The worker serializes a snapshot, so the bitmap can be safely changed while serializing.
+  self->autoOptimizeBeforeSerialize();
+  worker->snapshot = roaringBitmapSnapshot(self->roaring);
+  if (worker->snapshot == nullptr) {
+    delete worker;
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeAsync - failed to allocate");
   }
 
   v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
   info.GetReturnValue().Set(returnValue);
 }
 
-void RoaringBitmap32::isSubset(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, RoaringBitmap32::constructorTemplate);
-  info.GetReturnValue().Set(self == other || (self && other && roaring_bitmap_is_subset(self->roaring, other->roaring)));
-}
+class ToUint32ArrayWorker final : public v8utils::AsyncWorker {
+ public:
+  roaring_bitmap_t * snapshot;
+  uint32_t * data;
+  size_t size;
 
-void RoaringBitmap32::isStrictSubset(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, RoaringBitmap32::constructorTemplate);
-  info.GetReturnValue().Set(self && other && roaring_bitmap_is_strict_subset(self->roaring, other->roaring));
-}
+  explicit ToUint32ArrayWorker(v8::Isolate * isolate) :
+    v8utils::AsyncWorker(isolate), snapshot(nullptr), data(nullptr), size(0) {}
 
-void RoaringBitmap32::isEqual(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, RoaringBitmap32::constructorTemplate);
-  info.GetReturnValue().Set(self == other || (self && other && roaring_bitmap_equals(self->roaring, other->roaring)));
-}
+  virtual ~ToUint32ArrayWorker() {
+    free(this->data);
+    if (this->snapshot != nullptr) {
+      roaring_bitmap_free(this->snapshot);
+    }
+  }
+
+ protected:
+  void work() final {
+    this->size = (size_t)roaring_bitmap_get_cardinality(this->snapshot);
+    if (this->size == 0) {
+      return;
+    }
+    this->data = (uint32_t *)malloc(this->size * sizeof(uint32_t));
+    if (this->data == nullptr) {
+      this->setError("RoaringBitmap32::toUint32ArrayAsync - failed to allocate memory");
+      return;
+    }
+    roaring_bitmap_to_uint32_array(this->snapshot, this->data);
+  }
+
+  v8::Local<v8::Value> done() final {
+    if (this->data == nullptr) {
+      return v8::Uint32Array::New(v8::ArrayBuffer::New(isolate, 0), 0, 0);
+    }
+    // The array takes the ownership of the memory, no copy is needed.
+    v8::Local<v8::Uint32Array> result;
+    if (!uint32ArrayFromMallocated(isolate, this->data, this->size).ToLocal(&result)) {
+      return v8::Local<v8::Value>();
+    }
+    this->data = nullptr;
+    return result;
+  }
+};
+
+void RoaringBitmap32::toUint32ArrayAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
 
-void RoaringBitmap32::intersects(const v8::FunctionCallbackInfo<v8::Value> & info) {
   RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, RoaringBitmap32::constructorTemplate);
-  info.GetReturnValue().Set(self && other && roaring_bitmap_intersect(self->roaring, other->roaring));
+  if (self == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::toUint32ArrayAsync on invalid object");
+  }
+
+  auto * worker = new ToUint32ArrayWorker(isolate);
+  if (worker == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::toUint32ArrayAsync - Failed to allocate async worker");
+  }
+
+  if (!setAsyncOptionsAndCallback(info, 0, "RoaringBitmap32::toUint32ArrayAsync", worker)) {
+    delete worker;
+    return;
+  }
+
+  // The worker reads a snapshot, so the bitmap can be safely changed while the operation is running.
+  worker->snapshot = roaringBitmapSnapshot(self->roaring);
+  if (worker->snapshot == nullptr) {
+    delete worker;
+    return v8utils::throwError(isolate, "RoaringBitmap32::toUint32ArrayAsync - failed to allocate");
+  }
+
+  v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
+  info.GetReturnValue().Set(returnValue);
 }
 
-void RoaringBitmap32::andCardinality(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, RoaringBitmap32::constructorTemplate);
-  info.GetReturnValue().Set(self && other ? (double)roaring_bitmap_and_cardinality(self->roaring, other->roaring) : -1);
+DeserializeResult RoaringBitmap32::doDeserialize(const v8utils::TypedArrayContent<uint8_t> & typedArray, bool portable) {
+  return doDeserialize((const char *)typedArray.data, typedArray.length, portable);
 }
 
-void RoaringBitmap32::orCardinality(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, RoaringBitmap32::constructorTemplate);
-  info.GetReturnValue().Set(self && other ? (double)roaring_bitmap_or_cardinality(self->roaring, other->roaring) : -1);
+DeserializeResult RoaringBitmap32::doDeserialize(const char * bufaschar, size_t bufLen, bool portable) {
+  if (bufLen == 0 || !bufaschar) {
+    return DeserializeResult(roaring_bitmap_create(), "RoaringBitmap32::deserialize - failed to create an empty bitmap");
+  }
+
+  if (portable) {
+    return DeserializeResult(
+      roaring_bitmap_portable_deserialize_safe(bufaschar, bufLen),
+      "RoaringBitmap32::deserialize - portable deserialization failed");
+  }
+
+  if ((unsigned char)bufaschar[0] == CROARING_SERIALIZATION_CRC32C) {
+    if (bufLen <= CROARING_SERIALIZATION_CRC32C_HEADER_SIZE) {
+      return DeserializeResult(nullptr, "RoaringBitmap32::deserialize - corrupted data, checksum envelope too short");
+    }
+    uint32_t expected;
+    memcpy(&expected, bufaschar + 1, sizeof(uint32_t));
+    bufaschar += CROARING_SERIALIZATION_CRC32C_HEADER_SIZE;
+    bufLen -= CROARING_SERIALIZATION_CRC32C_HEADER_SIZE;
+    if (crc32c::value(bufaschar, bufLen) != expected) {
+      return DeserializeResult(nullptr, "RoaringBitmap32::deserialize - corrupted data, checksum mismatch");
+    }
+  }
+
+  switch ((unsigned char)bufaschar[0]) {
+    case CROARING_SERIALIZATION_ARRAY_UINT32: {
+      uint32_t card;
+      memcpy(&card, bufaschar + 1, sizeof(uint32_t));
+
+      if (card * sizeof(uint32_t) + sizeof(uint32_t) + 1 != bufLen) {
+        return DeserializeResult(nullptr, "RoaringBitmap32::deserialize - corrupted data, wrong cardinality header");
+      }
+
+      const uint32_t * elems = (const uint32_t *)(bufaschar + 1 + sizeof(uint32_t));
+      return DeserializeResult(
+        roaring_bitmap_of_ptr(card, elems), "RoaringBitmap32::deserialize - uint32 array deserialization failed");
+    }
+
+    case CROARING_SERIALIZATION_CONTAINER: {
+      return DeserializeResult(
+        roaring_bitmap_portable_deserialize_safe(bufaschar + 1, bufLen - 1),
+        "RoaringBitmap32::deserialize - container deserialization failed");
+    }
+
+    case CROARING_SERIALIZATION_COMPRESSED: {
+      return DeserializeResult(
+        RoaringBitmap32Serializer::deserializeCompressed((const uint8_t *)bufaschar + 1, bufLen - 1),
+        "RoaringBitmap32::deserialize - compressed deserialization failed");
+    }
+  }
+
+  return DeserializeResult(nullptr, "RoaringBitmap32::deserialize - invalid portable header byte");
+}
+
+void RoaringBitmap32::deserializeStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  if (info.Length() == 0 || (!info[0]->IsUint8Array() && !info[0]->IsInt8Array() && !info[0]->IsUint8ClampedArray()))
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32::deserialize requires an argument of type Uint8Array or Buffer");
+
+  v8::Local<v8::Function> cons = addonData->RoaringBitmap32_constructor.Get(isolate);
+
+  v8::MaybeLocal<v8::Object> resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
+  v8::Local<v8::Object> result;
+  if (!resultMaybe.ToLocal(&result)) {
+    return;
+  }
+
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+  self->replaceBitmapInstance(isolate, nullptr);
+
+  const v8utils::TypedArrayContent<uint8_t> typedArray(info[0]);
+
+  if (info.Length() < 2) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::deserialize portable argument must be specified");
+  }
+
+  auto deserialization = doDeserialize(typedArray, info[1]->IsTrue());
+  if (deserialization.error) {
+    return v8utils::throwError(isolate, deserialization.error);
+  }
+
+  self->replaceBitmapInstance(isolate, deserialization.bitmap);
+  self->updateAmountOfExternalAllocatedMemory(isolate);
+
+  info.GetReturnValue().Set(result);
+}
+
+void RoaringBitmap32::deserialize(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  auto isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+
+  if (info.Length() == 0 || (!info[0]->IsUint8Array() && !info[0]->IsInt8Array() && !info[0]->IsUint8ClampedArray()))
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32::deserialize requires an argument of type Uint8Array or Buffer");
+
+  auto holder = info.Holder();
+
+  RoaringBitmap32 * self = unwrapMutable(isolate, holder);
+  if (self == nullptr) return;
+
+  if (info.Length() < 2) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::deserialize portable argument must be specified");
+  }
+
+  const v8utils::TypedArrayContent<uint8_t> typedArray(info[0]);
+  auto deserialized = doDeserialize(typedArray, info[1]->IsTrue());
+  if (deserialized.error) {
+    return v8utils::throwError(isolate, deserialized.error);
+  }
+
+  self->replaceBitmapInstance(isolate, deserialized.bitmap);
+  self->updateAmountOfExternalAllocatedMemory(isolate);
+
+  info.GetReturnValue().Set(holder);
+}
+
+class DeserializeWorker final : public RoaringBitmap32FactoryAsyncWorker {
+ public:
+  v8::Persistent<v8::Value> bufferPersistent;
+  v8utils::TypedArrayContent<uint8_t> buffer;
+  bool portable;
+
+  explicit DeserializeWorker(AddonData * addonData) : RoaringBitmap32FactoryAsyncWorker(addonData), portable(false) {}
+
+  virtual ~DeserializeWorker() { bufferPersistent.Reset(); }
+
+  bool setBuffer(v8::Local<v8::Value> buf) {
+    if (buf.IsEmpty() || (!buf->IsUint8Array() && !buf->IsInt8Array() && !buf->IsUint8ClampedArray())) {
+      return false;
+    }
+    if (!this->buffer.set(buf)) {
+      return false;
+    }
+    bufferPersistent.Reset(isolate, buf);
+    return true;
+  }
+
+ protected:
+  void work() final {
+    auto deserialized = RoaringBitmap32::doDeserialize(buffer, portable);
+    if (deserialized.error != nullptr) {
+      this->setError(deserialized.error);
+      return;
+    }
+    this->bitmap = deserialized.bitmap;
+  }
+};
+
+void RoaringBitmap32::deserializeStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = v8::Isolate::GetCurrent();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  auto * worker = new DeserializeWorker(addonData);
+  if (worker == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::deserializeAsync - Failed to allocate async worker");
+  }
+
+  if (info.Length() <= 0 || !worker->setBuffer(info[0])) {
+    delete worker;
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32::deserializeAsync - first argument must be Uint8Array or Buffer");
+  }
+
+  if (info.Length() >= 2) {
+    if (info[1]->IsFunction()) {
+      worker->setCallback(info[1]);
+      if (info.Length() >= 3 && info[2]->IsTrue()) {
+        worker->portable = true;
+      }
+    } else {
+      if (info[1]->IsTrue()) {
+        worker->portable = true;
+      }
+      if (!setAsyncOptionsAndCallback(info, 2, "RoaringBitmap32::deserializeAsync", worker)) {
+        delete worker;
+        return;
+      }
+    }
+  }
+
+  v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
+  info.GetReturnValue().Set(returnValue);
+}
+
+class DeserializeParallelWorkerItem {
+ public:
+  volatile roaring_bitmap_t_ptr bitmap;
+  v8::Persistent<v8::Value> bufferPersistent;
+  v8utils::TypedArrayContent<uint8_t> buffer;
+
+  DeserializeParallelWorkerItem() : bitmap(nullptr) {}
+
+  ~DeserializeParallelWorkerItem() {
+    bufferPersistent.Reset();
+    if (this->bitmap != nullptr) {
+      roaring_bitmap_free(this->bitmap);
+      this->bitmap = nullptr;
+    }
+  }
+
+  bool setBuffer(v8::Isolate * isolate, v8::Local<v8::Value> buf) {
+    if (buf.IsEmpty() || (!buf->IsUint8Array() && !buf->IsInt8Array() && !buf->IsUint8ClampedArray())) {
+      return false;
+    }
+    return this->buffer.set(buf);
+  }
+};
+
+class DeserializeParallelWorker : public v8utils::ParallelAsyncWorker {
+ public:
+  v8::Persistent<v8::Value> bufferPersistent;
+
+  bool portable;
+  DeserializeParallelWorkerItem * items;
+
+  AddonData * const addonData;
+
+  explicit DeserializeParallelWorker(AddonData * addonData) :
+    v8utils::ParallelAsyncWorker(addonData->isolate), portable(false), items(nullptr), addonData(addonData) {
+    addonData->acquire();
+  }
+
+  virtual ~DeserializeParallelWorker() {
+    delete[] items;
+    this->addonData->release();
+  }
+
+ protected:
+  virtual void parallelWork(uint32_t index) {
+    DeserializeParallelWorkerItem & item = items[index];
+    auto deserialized = RoaringBitmap32::doDeserialize(item.buffer, portable);
+    if (deserialized.error != nullptr) {
+      this->setError(deserialized.error);
+      return;
+    }
+    item.bitmap = deserialized.bitmap;
+  }
+
+  uint64_t parallelWorkSize(uint32_t index) final { return items[index].buffer.length; }
+
+  v8::Local<v8::Value> done() final {
+    v8::Local<v8::Function> cons = this->addonData->RoaringBitmap32_constructor.Get(isolate);
+
+    const uint32_t itemsCount = this->loopCount;
+    DeserializeParallelWorkerItem * items = this->items;
+
+    v8::MaybeLocal<v8::Array> resultArrayMaybe = v8::Array::New(isolate, itemsCount);
+    v8::Local<v8::Array> resultArray;
+    if (!resultArrayMaybe.ToLocal(&resultArray)) return v8::Local<v8::Value>();
+
+    v8::Local<v8::Context> currentContext = isolate->GetCurrentContext();
+
+    for (uint32_t i = 0; i != itemsCount; ++i) {
+      v8::MaybeLocal<v8::Object> instanceMaybe = cons->NewInstance(currentContext, 0, nullptr);
+
+      v8::Local<v8::Object> instance;
+      if (!instanceMaybe.ToLocal(&instance)) return v8::Local<v8::Value>();
+
+      RoaringBitmap32 * unwrapped = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(instance);
+
+      DeserializeParallelWorkerItem & item = items[i];
+
+      unwrapped->replaceBitmapInstance(isolate, item.bitmap);
+      item.bitmap = nullptr;
+
+      unwrapped->updateAmountOfExternalAllocatedMemory(isolate);
+
+      v8utils::ignoreMaybeResult(resultArray->Set(currentContext, i, instance));
+    }
+
+    return resultArray;
+  }
+};
+
+void RoaringBitmap32::deserializeParallelStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = v8::Isolate::GetCurrent();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  if (info.Length() < 1 || !info[0]->IsArray()) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::deserializeParallelAsync requires an array as first argument");
+  }
+
+  auto array = v8::Local<v8::Array>::Cast(info[0]);
+
+  uint32_t length = array->Length();
+
+  if (length > 0x01FFFFFF) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::deserializeParallelAsync - array too big");
+  }
+
+  auto * worker = new DeserializeParallelWorker(addonData);
+  if (worker == nullptr) {
+    return v8utils::throwError(isolate, "Failed to allocate async worker");
+  }
+
+  DeserializeParallelWorkerItem * items = length ? new DeserializeParallelWorkerItem[length]() : nullptr;
+  if (items == nullptr && length != 0) {
+    delete worker;
+    return v8utils::throwError(isolate, "Failed to allocate async worker memory");
+  }
+  worker->items = items;
+  worker->loopCount = length;
+
+  auto context = isolate->GetCurrentContext();
+  for (uint32_t i = 0; i != length; ++i) {
+    auto vMaybe = array->Get(context, i);
+    v8::Local<v8::Value> v;
+    if (!vMaybe.ToLocal(&v) || (!v->IsNullOrUndefined() && !items[i].setBuffer(isolate, v))) {
+      delete worker;
+      return v8utils::throwTypeError(
+        isolate, "RoaringBitmap32::deserializeParallelAsync - Array must contains only Uint8Array or Buffer elements");
+    }
+  }
+
+  if (info.Length() >= 2) {
+    if (info[1]->IsFunction()) {
+      worker->setCallback(info[1]);
+      if (info.Length() >= 3 && info[2]->IsTrue()) {
+        worker->portable = true;
+      }
+    } else {
+      if (info[1]->IsTrue()) {
+        worker->portable = true;
+      }
+      if (!setAsyncOptionsAndCallback(info, 2, "RoaringBitmap32::deserializeParallelAsync", worker, worker)) {
+        delete worker;
+        return;
+      }
+    }
+  }
+
+  v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
+  info.GetReturnValue().Set(returnValue);
+}
+
+/////////////// Frozen ///////////////
+
+inline static roaring_bitmap_t * roaringBitmapFromFrozen(const char * data, size_t length) {
+  // roaring_bitmap_frozen_view requires the data to be 32 bytes aligned,
+  // the buffer may be not aligned in memory, in that case a temporary aligned copy is needed.
+  char * aligned = nullptr;
+  if (((uintptr_t)data % ROARING_FROZEN_ALIGNMENT) != 0) {
+    aligned = (char *)roaring_aligned_malloc(ROARING_FROZEN_ALIGNMENT, length != 0 ? length : 1);
+    if (aligned == nullptr) {
+      return nullptr;
+    }
+    memcpy(aligned, data, length);
+    data = aligned;
+  }
+
+  roaring_bitmap_t * result = nullptr;
+  const roaring_bitmap_t * view = roaring_bitmap_frozen_view(data, length);
+  if (view != nullptr) {
+    result = roaring_bitmap_copy(view);
+    roaring_bitmap_free(view);
+  }
+
+  if (aligned != nullptr) {
+    roaring_aligned_free(aligned);
+  }
+  return result;
+}
+
+void RoaringBitmap32::getFrozenSizeInBytes(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (self == nullptr) {
+    return info.GetReturnValue().Set(0U);
+  }
+  self->autoOptimizeBeforeSerialize();
+  const RoaringUnsharedView view(self->roaring);
+  if (view.bitmap == nullptr) {
+    return v8utils::throwError(info.GetIsolate(), "RoaringBitmap32::getFrozenSizeInBytes - failed to allocate");
+  }
+  size_t size = roaring_bitmap_frozen_size_in_bytes(view.bitmap);
+  info.GetReturnValue().Set((double)(ROARING_SHARED_FROZEN_HEADER_SIZE + ROARING_FROZEN_ALIGNMENT - 1 + size));
+}
+
+void RoaringBitmap32::serializeFrozen(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (self == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeFrozen on invalid object");
+  }
+  self->autoOptimizeBeforeSerialize();
+  const RoaringUnsharedView view(self->roaring);
+  if (view.bitmap == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeFrozen - failed to allocate");
+  }
+
+  const size_t frozenSize = roaring_bitmap_frozen_size_in_bytes(view.bitmap);
+  if (frozenSize > 0xFFFFFFFF) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeFrozen - bitmap too big");
+  }
+
+  v8::Local<v8::Value> target;
+  if (info.Length() == 0 || info[0]->IsUndefined()) {
+    target = v8::SharedArrayBuffer::New(isolate, ROARING_SHARED_FROZEN_HEADER_SIZE + ROARING_FROZEN_ALIGNMENT - 1 + frozenSize);
+  } else {
+    target = info[0];
+  }
+
+  v8utils::TypedArrayContent<uint8_t> content;
+  if (!content.setBufferOrView(target)) {
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32::serializeFrozen - target must be a SharedArrayBuffer, an ArrayBuffer or an Uint8Array");
+  }
+
+  double byteOffset = 0;
+  if (
+    info.Length() >= 2 && !info[1]->IsUndefined() &&
+    (!info[1]->NumberValue(isolate->GetCurrentContext()).To(&byteOffset) || !(byteOffset >= 0) ||
+     byteOffset > (double)content.length || byteOffset != floor(byteOffset))) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::serializeFrozen - invalid byteOffset");
+  }
+
+  uint8_t * start = content.data + (size_t)byteOffset;
+  uintptr_t frozenAddress = (uintptr_t)start + ROARING_SHARED_FROZEN_HEADER_SIZE;
+  frozenAddress = (frozenAddress + ROARING_FROZEN_ALIGNMENT - 1) & ~(uintptr_t)(ROARING_FROZEN_ALIGNMENT - 1);
+  const uint32_t frozenOffset = (uint32_t)(frozenAddress - (uintptr_t)start);
+  const size_t totalSize = frozenOffset + frozenSize;
+  if (totalSize > content.length - (size_t)byteOffset) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeFrozen - target buffer is too small");
+  }
+
+  const uint32_t frozenLength = (uint32_t)frozenSize;
+  memcpy(start, &frozenLength, sizeof(uint32_t));
+  memcpy(start + 4, &frozenOffset, sizeof(uint32_t));
+  memset(start + ROARING_SHARED_FROZEN_HEADER_SIZE, 0, frozenOffset - ROARING_SHARED_FROZEN_HEADER_SIZE);
+  roaring_bitmap_frozen_serialize(view.bitmap, (char *)frozenAddress);
+
+  if (info.Length() == 0 || info[0]->IsUndefined()) {
+    return info.GetReturnValue().Set(target);
+  }
+  info.GetReturnValue().Set((double)totalSize);
+}
+
+void RoaringBitmap32::frozenViewStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  v8utils::TypedArrayContent<uint8_t> content;
+  if (info.Length() == 0 || !content.setBufferOrView(info[0])) {
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32::frozenView - buffer must be a SharedArrayBuffer, an ArrayBuffer or an Uint8Array");
+  }
+
+  double byteOffset = 0;
+  if (
+    info.Length() >= 2 && !info[1]->IsUndefined() &&
+    (!info[1]->NumberValue(isolate->GetCurrentContext()).To(&byteOffset) || !(byteOffset >= 0) ||
+     byteOffset > (double)content.length || byteOffset != floor(byteOffset))) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::frozenView - invalid byteOffset");
+  }
+
+  const uint8_t * start = content.data + (size_t)byteOffset;
+  const size_t available = content.length - (size_t)byteOffset;
+  uint32_t frozenLength;
+  uint32_t frozenOffset;
+  if (available < ROARING_SHARED_FROZEN_HEADER_SIZE) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::frozenView - invalid frozen data");
+  }
+  memcpy(&frozenLength, start, sizeof(uint32_t));
+  memcpy(&frozenOffset, start + 4, sizeof(uint32_t));
+  if (
+    frozenOffset < ROARING_SHARED_FROZEN_HEADER_SIZE || frozenOffset > available ||
+    frozenLength > available - frozenOffset) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::frozenView - invalid frozen data");
+  }
+
+  const char * frozenData = (const char *)start + frozenOffset;
+  roaring_bitmap_t * bitmap;
+  bool isView = ((uintptr_t)frozenData % ROARING_FROZEN_ALIGNMENT) == 0;
+  if (isView) {
+    // The bitmap is a view of the buffer, the containers are not copied.
+    bitmap = const_cast<roaring_bitmap_t *>(roaring_bitmap_frozen_view(frozenData, frozenLength));
+  } else {
+    // The buffer was copied to a different alignment, the bitmap must be copied.
+    bitmap = roaringBitmapFromFrozen(frozenData, frozenLength);
+  }
+  if (bitmap == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::frozenView - invalid frozen data");
+  }
+
+  v8::Local<v8::Function> cons = addonData->RoaringBitmap32_constructor.Get(isolate);
+  v8::Local<v8::Object> result;
+  if (!cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr).ToLocal(&result)) {
+    roaring_bitmap_free(bitmap);
+    return;
+  }
+
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+  if (isView) {
+#if NODE_MAJOR_VERSION > 13
+    self->frozenBackingStore = content.backingStore;
+#else
+    self->frozenBuffer.Reset(isolate, info[0]);
+#endif
+    roaring_bitmap_free(self->roaring);
+    self->roaring = bitmap;
+    self->invalidate();
+  } else {
+    self->replaceBitmapInstance(isolate, bitmap);
+  }
+  self->frozen = true;
+
+  info.GetReturnValue().Set(result);
+}
+
+/////////////// Diff ///////////////
+
+// CRC32C of the part of base a diff depends on: the keys of all the containers of base,
+// and the values of the containers of base that the diff changes.
+// The values are hashed as sorted 16 bit arrays, so the fingerprint does not depend on the container types.
+static bool roaringDiffBaseFingerprint(const roaring_bitmap_t * base, const roaring_bitmap_t * delta, uint32_t & crc) {
+  const roaring_array_t * ra = &base->high_low_container;
+  const roaring_array_t * da = &delta->high_low_container;
+  crc = crc32c::value(ra->keys, (size_t)ra->size * sizeof(uint16_t));
+  if (ra->size == 0 || da->size == 0) {
+    return true;
+  }
+  uint16_t * values = (uint16_t *)malloc(65536 * sizeof(uint16_t));
+  if (values == nullptr) {
+    return false;
+  }
+  int32_t i = -1;
+  for (int32_t k = 0; k < da->size; ++k) {
+    i = ra_advance_until(ra, da->keys[k], i);
+    if (i >= ra->size) {
+      break;
+    }
+    if (ra->keys[i] == da->keys[k]) {
+      const uint32_t n = containerToUint16Array(ra->containers[i], ra->typecodes[i], values);
+      crc = crc32c::extend(crc, &ra->keys[i], sizeof(uint16_t));
+      crc = crc32c::extend(crc, values, (size_t)n * sizeof(uint16_t));
+    }
+  }
+  free(values);
+  return true;
+}
+
+const char * RoaringBitmap32::doSerializeDiff(
+  const roaring_bitmap_t * base, const roaring_bitmap_t * current, char *& data, size_t & size) {
+  data = nullptr;
+  size = 0;
+
+  // The xor is computed container by container, unchanged containers cancel out and are not emitted.
+  roaring_bitmap_t * delta = roaring_bitmap_xor(base, current);
+  if (delta == nullptr) {
+    return "RoaringBitmap32::serializeDiff - failed to allocate";
+  }
+
+  RoaringBitmap32Serializer serializer;
+  serializer.roaring = delta;
+  serializer.compressed = true;
+  serializer.checksum = true;
+
+  const char * error = nullptr;
+  uint32_t baseFingerprint = 0;
+  size_t payloadSize = serializer.computeSize();
+  if (
+    payloadSize == 0 || !roaringDiffBaseFingerprint(base, delta, baseFingerprint) ||
+    (data = (char *)malloc(ROARING_DIFF_HEADER_SIZE + payloadSize)) == nullptr) {
+    error = "RoaringBitmap32::serializeDiff - failed to allocate";
+  } else {
+    uint64_t baseCardinality = roaring_bitmap_get_cardinality(base);
+    uint64_t resultCardinality = roaring_bitmap_get_cardinality(current);
+    memcpy(data, roaringDiffMagic, sizeof(roaringDiffMagic));
+    memcpy(data + 4, &baseCardinality, sizeof(uint64_t));
+    memcpy(data + 12, &resultCardinality, sizeof(uint64_t));
+    memcpy(data + 20, &baseFingerprint, sizeof(uint32_t));
+    error = serializer.serialize((uint8_t *)data + ROARING_DIFF_HEADER_SIZE);
+    size = ROARING_DIFF_HEADER_SIZE + payloadSize;
+  }
+
+  roaring_bitmap_free(delta);
+
+  if (error != nullptr) {
+    free(data);
+    data = nullptr;
+    size = 0;
+  }
+  return error;
+}
+
+DeserializeResult RoaringBitmap32::doApplyDiff(const roaring_bitmap_t * base, const uint8_t * diff, size_t length) {
+  if (length < ROARING_DIFF_HEADER_SIZE || memcmp(diff, roaringDiffMagic, sizeof(roaringDiffMagic)) != 0) {
+    return DeserializeResult(nullptr, "RoaringBitmap32::applyDiff - invalid diff");
+  }
+
+  uint64_t baseCardinality;
+  uint64_t resultCardinality;
+  uint32_t baseFingerprint;
+  memcpy(&baseCardinality, diff + 4, sizeof(uint64_t));
+  memcpy(&resultCardinality, diff + 12, sizeof(uint64_t));
+  memcpy(&baseFingerprint, diff + 20, sizeof(uint32_t));
+
+  if (roaring_bitmap_get_cardinality(base) != baseCardinality) {
+    return DeserializeResult(nullptr, "RoaringBitmap32::applyDiff - the diff was not created from the given base bitmap");
+  }
+
+  DeserializeResult delta =
+    doDeserialize((const char *)diff + ROARING_DIFF_HEADER_SIZE, length - ROARING_DIFF_HEADER_SIZE, false);
+  if (delta.error != nullptr) {
+    return delta;
+  }
+
+  uint32_t fingerprint;
+  if (!roaringDiffBaseFingerprint(base, delta.bitmap, fingerprint)) {
+    roaring_bitmap_free(delta.bitmap);
+    return DeserializeResult(nullptr, "RoaringBitmap32::applyDiff - failed to allocate");
+  }
+  if (fingerprint != baseFingerprint) {
+    roaring_bitmap_free(delta.bitmap);
+    return DeserializeResult(nullptr, "RoaringBitmap32::applyDiff - the diff was not created from the given base bitmap");
+  }
+
+  roaring_bitmap_t * result = roaring_bitmap_xor(base, delta.bitmap);
+  roaring_bitmap_free(delta.bitmap);
+  if (result == nullptr) {
+    return DeserializeResult(nullptr, "RoaringBitmap32::applyDiff - failed to allocate");
+  }
+
+  if (roaring_bitmap_get_cardinality(result) != resultCardinality) {
+    roaring_bitmap_free(result);
+    return DeserializeResult(nullptr, "RoaringBitmap32::applyDiff - the diff was not created from the given base bitmap");
+  }
+
+  return DeserializeResult(result);
+}
+
+void RoaringBitmap32::serializeDiffStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  RoaringBitmap32 * base = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  RoaringBitmap32 * current = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 1, addonData->RoaringBitmap32_constructorTemplate);
+  if (base == nullptr || current == nullptr) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::serializeDiff - arguments must be two RoaringBitmap32 instances");
+  }
+
+  char * data;
+  size_t size;
+  const char * error = doSerializeDiff(base->roaring, current->roaring, data, size);
+  if (error != nullptr) {
+    return v8utils::throwError(isolate, error);
+  }
+
+  // The buffer takes the ownership of the memory, no copy is needed.
+  v8::Local<v8::Object> result;
+  if (!node::Buffer::New(isolate, data, size).ToLocal(&result)) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeDiff - failed to allocate");
+  }
+  info.GetReturnValue().Set(result);
+}
+
+void RoaringBitmap32::applyDiffStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  RoaringBitmap32 * base = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  if (base == nullptr) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::applyDiff - first argument must be a RoaringBitmap32");
+  }
+
+  if (info.Length() < 2 || (!info[1]->IsUint8Array() && !info[1]->IsInt8Array() && !info[1]->IsUint8ClampedArray())) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::applyDiff - second argument must be Uint8Array or Buffer");
+  }
+  const v8utils::TypedArrayContent<uint8_t> diff(info[1]);
+
+  DeserializeResult applied = doApplyDiff(base->roaring, diff.data, diff.length);
+  if (applied.error != nullptr) {
+    return v8utils::throwError(isolate, applied.error);
+  }
+
+  v8::Local<v8::Function> cons = addonData->RoaringBitmap32_constructor.Get(isolate);
+  v8::MaybeLocal<v8::Object> resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
+  v8::Local<v8::Object> result;
+  if (!resultMaybe.ToLocal(&result)) {
+    roaring_bitmap_free(applied.bitmap);
+    return;
+  }
+
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+  self->replaceBitmapInstance(isolate, applied.bitmap);
+  self->updateAmountOfExternalAllocatedMemory(isolate);
+
+  info.GetReturnValue().Set(result);
+}
+
+class SerializeDiffWorker final : public v8utils::AsyncWorker {
+ public:
+  roaring_bitmap_t * base;
+  roaring_bitmap_t * current;
+  char * data;
+  size_t size;
+
+  explicit SerializeDiffWorker(v8::Isolate * isolate) :
+    v8utils::AsyncWorker(isolate), base(nullptr), current(nullptr), data(nullptr), size(0) {
+    this->priority = v8utils::AsyncPriority::Background;
+  }
+
+  virtual ~SerializeDiffWorker() {
+    free(this->data);
+    if (this->base != nullptr) {
+      roaring_bitmap_free(this->base);
+    }
+    if (this->current != nullptr) {
+      roaring_bitmap_free(this->current);
+    }
+  }
+
+ protected:
+  void work() final { this->setError(RoaringBitmap32::doSerializeDiff(this->base, this->current, this->data, this->size)); }
+
+  v8::Local<v8::Value> done() final {
+    v8::Local<v8::Object> result;
+    if (!node::Buffer::New(isolate, this->data, this->size).ToLocal(&result)) {
+      return v8::Local<v8::Value>();
+    }
+    this->data = nullptr;
+    return result;
+  }
+};
+
+void RoaringBitmap32::serializeDiffStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  RoaringBitmap32 * base = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  RoaringBitmap32 * current = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 1, addonData->RoaringBitmap32_constructorTemplate);
+  if (base == nullptr || current == nullptr) {
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32::serializeDiffAsync - arguments must be two RoaringBitmap32 instances");
+  }
+
+  auto * worker = new SerializeDiffWorker(isolate);
+  if (worker == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeDiffAsync - Failed to allocate async worker");
+  }
+
+  if (!setAsyncOptionsAndCallback(info, 2, "RoaringBitmap32::serializeDiffAsync", worker)) {
+    delete worker;
+    return;
+  }
+
+  // The worker compares copies, so both bitmaps can be safely changed while the diff is computed.
+  worker->base = roaringBitmapDeepCopy(base->roaring);
+  worker->current = worker->base != nullptr ? roaringBitmapDeepCopy(current->roaring) : nullptr;
+  if (worker->current == nullptr) {
+    delete worker;
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeDiffAsync - failed to allocate");
+  }
+
+  v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
+  info.GetReturnValue().Set(returnValue);
+}
+
+class ApplyDiffWorker final : public RoaringBitmap32FactoryAsyncWorker {
+ public:
+  roaring_bitmap_t * base;
+  v8::Persistent<v8::Value> diffPersistent;
+  v8utils::TypedArrayContent<uint8_t> diff;
+
+  explicit ApplyDiffWorker(AddonData * addonData) : RoaringBitmap32FactoryAsyncWorker(addonData), base(nullptr) {}
+
+  virtual ~ApplyDiffWorker() {
+    diffPersistent.Reset();
+    if (this->base != nullptr) {
+      roaring_bitmap_free(this->base);
+    }
+  }
+
+  bool setDiff(v8::Local<v8::Value> buf) {
+    if (buf.IsEmpty() || (!buf->IsUint8Array() && !buf->IsInt8Array() && !buf->IsUint8ClampedArray())) {
+      return false;
+    }
+    if (!this->diff.set(buf)) {
+      return false;
+    }
+    diffPersistent.Reset(isolate, buf);
+    return true;
+  }
+
+ protected:
+  void work() final {
+    auto applied = RoaringBitmap32::doApplyDiff(this->base, this->diff.data, this->diff.length);
+    if (applied.error != nullptr) {
+      this->setError(applied.error);
+      return;
+    }
+    this->bitmap = applied.bitmap;
+  }
+};
+
+void RoaringBitmap32::applyDiffStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  RoaringBitmap32 * base = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  if (base == nullptr) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::applyDiffAsync - first argument must be a RoaringBitmap32");
+  }
+
+  auto * worker = new ApplyDiffWorker(addonData);
+  if (worker == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::applyDiffAsync - Failed to allocate async worker");
+  }
+
+  if (info.Length() < 2 || !worker->setDiff(info[1])) {
+    delete worker;
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32::applyDiffAsync - second argument must be Uint8Array or Buffer");
+  }
+
+  if (!setAsyncOptionsAndCallback(info, 2, "RoaringBitmap32::applyDiffAsync", worker)) {
+    delete worker;
+    return;
+  }
+
+  worker->base = roaringBitmapDeepCopy(base->roaring);
+  if (worker->base == nullptr) {
+    delete worker;
+    return v8utils::throwError(isolate, "RoaringBitmap32::applyDiffAsync - failed to allocate");
+  }
+
+  v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
+  info.GetReturnValue().Set(returnValue);
+}
+
+void RoaringBitmap32::isSubset(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  AddonData * addonData = AddonData::get(info);
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  info.GetReturnValue().Set(self == other || (self && other && roaring_bitmap_is_subset(self->roaring, other->roaring)));
+}
+
+void RoaringBitmap32::isStrictSubset(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  AddonData * addonData = AddonData::get(info);
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  info.GetReturnValue().Set(self && other && roaring_bitmap_is_strict_subset(self->roaring, other->roaring));
+}
+
+void RoaringBitmap32::isEqual(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  AddonData * addonData = AddonData::get(info);
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  info.GetReturnValue().Set(self == other || (self && other && roaring_bitmap_equals(self->roaring, other->roaring)));
+}
+
+void RoaringBitmap32::intersects(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  AddonData * addonData = AddonData::get(info);
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  info.GetReturnValue().Set(self && other && roaring_bitmap_intersect(self->roaring, other->roaring));
+}
+
+void RoaringBitmap32::andCardinality(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  AddonData * addonData = AddonData::get(info);
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  info.GetReturnValue().Set(self && other ? (double)roaring_bitmap_and_cardinality(self->roaring, other->roaring) : -1);
+}
+
+void RoaringBitmap32::orCardinality(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  AddonData * addonData = AddonData::get(info);
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  info.GetReturnValue().Set(self && other ? (double)roaring_bitmap_or_cardinality(self->roaring, other->roaring) : -1);
+}
+
+void RoaringBitmap32::andNotCardinality(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  AddonData * addonData = AddonData::get(info);
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  info.GetReturnValue().Set(other ? (double)roaring_bitmap_andnot_cardinality(self->roaring, other->roaring) : -1);
+}
+
+void RoaringBitmap32::xorCardinality(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  AddonData * addonData = AddonData::get(info);
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  info.GetReturnValue().Set(self && other ? (double)roaring_bitmap_xor_cardinality(self->roaring, other->roaring) : -1);
+}
+
+void RoaringBitmap32::jaccardIndex(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  AddonData * addonData = AddonData::get(info);
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, addonData->RoaringBitmap32_constructorTemplate);
+  info.GetReturnValue().Set(self && other ? roaring_bitmap_jaccard_index(self->roaring, other->roaring) : -1);
+}
+
+// Returns true if the values are sorted and without duplicates.
+static bool isStrictlyIncreasing(const uint32_t * values, size_t length) {
+  for (size_t i = 1; i < length; ++i) {
+    if (values[i] <= values[i - 1]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Builds a bitmap from strictly increasing values, creating directly for each chunk
+// the smallest container among array, bitset and run.
+static roaring_bitmap_t * roaringBitmapFromSortedValues(const uint32_t * values, size_t length) {
+  roaring_bitmap_t * result = roaring_bitmap_create();
+  if (result == nullptr) {
+    return nullptr;
+  }
+
+  size_t i = 0;
+  while (i != length) {
+    const uint32_t key = values[i] >> 16;
+    size_t end = i + 1;
+    int32_t nruns = 1;
+    while (end != length && (values[end] >> 16) == key) {
+      if (values[end] != values[end - 1] + 1) {
+        ++nruns;
+      }
+      ++end;
+    }
+
+    const int32_t cardinality = (int32_t)(end - i);
+    const int32_t otherSize =
+      cardinality <= DEFAULT_MAX_SIZE ? (int32_t)array_container_serialized_size_in_bytes(cardinality) : 8192;
+    container_t * c;
+    uint8_t type;
+    if (run_container_serialized_size_in_bytes(nruns) < otherSize) {
+      run_container_t * run = run_container_create_given_capacity(nruns);
+      if (run != nullptr) {
+        uint16_t start = (uint16_t)values[i];
+        for (size_t j = i + 1; j <= end; ++j) {
+          if (j == end || values[j] != values[j - 1] + 1) {
+            run->runs[run->n_runs++] = MAKE_RLE16(start, (uint16_t)values[j - 1] - start);
+            if (j != end) {
+              start = (uint16_t)values[j];
+            }
+          }
+        }
+      }
+      c = run;
+      type = RUN_CONTAINER_TYPE;
+    } else if (cardinality <= DEFAULT_MAX_SIZE) {
+      array_container_t * array = array_container_create_given_capacity(cardinality);
+      if (array != nullptr) {
+        for (size_t j = i; j != end; ++j) {
+          array->array[array->cardinality++] = (uint16_t)values[j];
+        }
+      }
+      c = array;
+      type = ARRAY_CONTAINER_TYPE;
+    } else {
+      bitset_container_t * bitset = bitset_container_create();
+      if (bitset != nullptr) {
+        for (size_t j = i; j != end; ++j) {
+          const uint16_t low = (uint16_t)values[j];
+          bitset->words[low >> 6] |= UINT64_C(1) << (low & 63);
+        }
+        bitset->cardinality = cardinality;
+      }
+      c = bitset;
+      type = BITSET_CONTAINER_TYPE;
+    }
+
+    if (c == nullptr) {
+      roaring_bitmap_free(result);
+      return nullptr;
+    }
+    ra_append(&result->high_low_container, (uint16_t)key, c, type);
+    i = end;
+  }
+  return result;
+}
+
+// Adds many values. If the bitmap is empty and the values are sorted, builds the containers directly.
+// The caller invalidates the bitmap, once for each public call.
+static void roaringAddValues(RoaringBitmap32 * self, const uint32_t * values, size_t length, bool replace) {
+  if (replace || self->roaring->high_low_container.size == 0) {
+    if (isStrictlyIncreasing(values, length)) {
+      roaring_bitmap_t * built = roaringBitmapFromSortedValues(values, length);
+      if (built != nullptr) {
+        roaring_bitmap_free(self->roaring);
+        self->roaring = built;
+        return;
+      }
+    }
+    if (replace && self->roaring->high_low_container.containers != nullptr) {
+      roaring_bitmap_clear(self->roaring);
+    }
+  }
+  roaring_bitmap_add_many(self->roaring, length, values);
+}
+
+// Converts a number to uint32 as Uint32Array.from does.
+inline uint32_t numberToUint32(v8::Local<v8::Value> value) {
+  if (value->IsInt32()) {
+    return (uint32_t)value.As<v8::Int32>()->Value();
+  }
+  const double d = value.As<v8::Number>()->Value();
+  if (!std::isfinite(d)) {
+    return 0;
+  }
+  const double m = std::fmod(std::trunc(d), 4294967296.0);
+  return (uint32_t)(int64_t)(m < 0 ? m + 4294967296.0 : m);
+}
+
+#if NODE_MAJOR_VERSION >= 22
+static v8::Array::CallbackResult readArrayOfNumbersCallback(uint32_t index, v8::Local<v8::Value> element, void * data) {
+  if (!element->IsNumber()) {
+    return v8::Array::CallbackResult::kBreak;
+  }
+  static_cast<std::vector<uint32_t> *>(data)->push_back(numberToUint32(element));
+  return v8::Array::CallbackResult::kContinue;
+}
+
+// Array::Iterate is faster than Uint32Array.from up to about a hundred elements, then two to four times slower.
+#define READ_ARRAY_MAX_LENGTH 64
+#else
+#define READ_ARRAY_MAX_LENGTH 32
+#endif
+
+// Reads the numbers of a plain array natively, without creating an intermediate Uint32Array.
+// Returns false if the array contains something else than numbers, the caller should then use Uint32Array.from.
+static bool readArrayOfNumbers(v8::Isolate * isolate, v8::Local<v8::Array> array, std::vector<uint32_t> & result) {
+  const uint32_t length = array->Length();
+  // Reading each element through the API is slower than Uint32Array.from for big arrays.
+  if (length > READ_ARRAY_MAX_LENGTH) {
+    return false;
+  }
+  result.reserve(length);
+  v8::Local<v8::Context> context = isolate->GetCurrentContext();
+#if NODE_MAJOR_VERSION >= 22
+  if (array->Iterate(context, readArrayOfNumbersCallback, &result).IsNothing()) {
+    return false;
+  }
+#else
+  v8::HandleScope scope(isolate);
+  for (uint32_t i = 0; i != length; ++i) {
+    v8::Local<v8::Value> element;
+    if (!array->Get(context, i).ToLocal(&element) || !element->IsNumber()) {
+      return false;
+    }
+    result.push_back(numberToUint32(element));
+  }
+#endif
+  return result.size() == length;
+}
+
+// Adds the values of a bitmap, an Uint32Array or an iterable. The caller invalidates the bitmap, once for each public call.
+inline bool roaringAddMany(AddonData * addonData, RoaringBitmap32 * self, v8::Local<v8::Value> arg, bool replace = false) {
+  v8::Isolate * isolate = addonData->isolate;
+  if (arg.IsEmpty()) {
+    return false;
+  }
+
+  if (arg->IsNullOrUndefined()) {
+    if (replace && self->roaring->high_low_container.containers != nullptr) {
+      roaring_bitmap_clear(self->roaring);
+    }
+    return true;
+  }
+
+  if (!arg->IsObject()) {
+    return false;
+  }
+
+  if (arg->IsUint32Array() || arg->IsInt32Array()) {
+    const v8utils::TypedArrayContent<uint32_t> typedArray(arg);
+    roaringAddValues(self, typedArray.data, typedArray.length, replace);
+    return true;
+  }
+
+  if (arg->IsArray()) {
+    std::vector<uint32_t> values;
+    if (readArrayOfNumbers(isolate, arg.As<v8::Array>(), values)) {
+      roaringAddValues(self, values.data(), values.size(), replace);
+      return true;
+    }
+  }
+
+  RoaringBitmap32 * other =
+    v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(arg, addonData->RoaringBitmap32_constructorTemplate, isolate);
+  if (other != nullptr) {
+    if (self != other) {
+      if (replace || self->roaring->high_low_container.containers == nullptr) {
+        if (self->roaring->high_low_container.containers != nullptr) {
+          roaring_bitmap_clear(self->roaring);
+        }
+        roaring_bitmap_t * copied = roaring_bitmap_copy(other->roaring);
+        if (copied == nullptr) {
+          v8utils::throwError(isolate, "RoaringBitmap32 - Failed to copy bitmap");
+          return true;
+        }
+        roaring_bitmap_free(self->roaring);
+        self->roaring = copied;
+        self->updateAmountOfExternalAllocatedMemory(isolate);
+      } else {
+        roaring_bitmap_or_inplace(self->roaring, other->roaring);
+      }
+    }
+    return true;
+  }
+
+  v8::Local<v8::Value> argv[] = {arg};
+  auto tMaybe =
+    addonData->Uint32Array_from.Get(isolate)->Call(isolate->GetCurrentContext(), addonData->Uint32Array.Get(isolate), 1, argv);
+  v8::Local<v8::Value> t;
+  if (!tMaybe.ToLocal(&t)) return false;
+
+  const v8utils::TypedArrayContent<uint32_t> typedArray(t);
+  roaringAddValues(self, typedArray.data, typedArray.length, replace);
+  return true;
+}
+
+void RoaringBitmap32::copyFrom(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  AddonData * addonData = AddonData::get(info);
+  RoaringBitmap32 * self = unwrapMutable(isolate, info.Holder());
+  if (self == nullptr) return;
+  if (info.Length() == 0 || !roaringAddMany(addonData, self, info[0], true)) {
+    return v8utils::throwError(
+      isolate, "RoaringBitmap32::copyFrom expects a RoaringBitmap32, an Uint32Array or an Iterable");
+  }
+  self->invalidate();
+  info.GetReturnValue().Set(info.Holder());
+}
+
+void RoaringBitmap32::addMany(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  auto isolate = info.GetIsolate();
+  AddonData * addonData = AddonData::get(info);
+  if (info.Length() > 0) {
+    RoaringBitmap32 * self = unwrapMutable(isolate, info.Holder());
+    if (self == nullptr) return;
+    if (roaringAddMany(addonData, self, info[0])) {
+      self->invalidate();
+      return info.GetReturnValue().Set(info.Holder());
+    }
+  }
+  v8utils::throwTypeError(isolate, "Uint32Array, RoaringBitmap32 or Iterable<number> expected");
+}
+
+void RoaringBitmap32::add(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  uint32_t v;
+  auto isolate = info.GetIsolate();
+  if (info.Length() < 1 || !info[0]->IsUint32() || !info[0]->Uint32Value(isolate->GetCurrentContext()).To(&v)) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::add - 32 bit unsigned integer expected");
+  }
+
+  RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+  if (self == nullptr) return;
+  if (roaring_bitmap_add_checked(self->roaring, v)) {
+    self->invalidateAdded(v);
+  }
+  info.GetReturnValue().Set(info.Holder());
+}
+
+void RoaringBitmap32::tryAdd(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  uint32_t v;
+  if (info.Length() < 1 || !info[0]->IsUint32() || !info[0]->Uint32Value(info.GetIsolate()->GetCurrentContext()).To(&v)) {
+    return info.GetReturnValue().Set(false);
+  }
+
+  RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+  if (self == nullptr) return;
+  bool result = roaring_bitmap_add_checked(self->roaring, v);
+  if (result) self->invalidateAdded(v);
+  info.GetReturnValue().Set(result);
+}
+
+void RoaringBitmap32::removeMany(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  bool done = false;
+  v8::Isolate * isolate = info.GetIsolate();
+  AddonData * addonData = AddonData::get(info);
+
+  if (info.Length() > 0) {
+    auto const & arg = info[0];
+    RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+    if (self == nullptr) return;
+
+    if (arg->IsUint32Array() || arg->IsInt32Array()) {
+      const v8utils::TypedArrayContent<uint32_t> typedArray(arg);
+      roaring_bitmap_remove_many(self->roaring, typedArray.length, typedArray.data);
+      self->invalidate();
+      done = true;
+    } else {
+      RoaringBitmap32 * other =
+        v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(arg, addonData->RoaringBitmap32_constructorTemplate, isolate);
+      std::vector<uint32_t> values;
+      if (other != nullptr) {
+        roaring_bitmap_andnot_inplace(self->roaring, other->roaring);
+        self->invalidate();
+        done = true;
+      } else if (arg->IsArray() && readArrayOfNumbers(isolate, arg.As<v8::Array>(), values)) {
+        roaring_bitmap_remove_many(self->roaring, values.size(), values.data());
+        self->invalidate();
+        done = true;
+      } else {
+        v8::Local<v8::Value> argv[] = {arg};
+        auto tMaybe = addonData->Uint32Array_from.Get(isolate)->Call(
+          isolate->GetCurrentContext(), addonData->Uint32Array.Get(isolate), 1, argv);
+        v8::Local<v8::Value> t;
+        if (tMaybe.ToLocal(&t)) {
+          const v8utils::TypedArrayContent<uint32_t> typedArray(t);
+          roaring_bitmap_remove_many(self->roaring, typedArray.length, typedArray.data);
+          self->invalidate();
+          done = true;
+        } else {
+          RoaringBitmap32 tmp(0);
+          if (roaringAddMany(addonData, &tmp, arg)) {
+            roaring_bitmap_andnot_inplace(self->roaring, tmp.roaring);
+            self->invalidate();
+            done = true;
+          }
+        }
+      }
+    }
+  }
+
+  if (done) {
+    info.GetReturnValue().Set(info.Holder());
+  } else {
+    v8utils::throwTypeError(isolate, "Uint32Array, RoaringBitmap32 or Iterable<number> expected");
+  }
+}
+
+void RoaringBitmap32::andInPlace(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  AddonData * addonData = AddonData::get(info);
+  if (info.Length() > 0) {
+    auto const & arg = info[0];
+    RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+    if (self == nullptr) return;
+    RoaringBitmap32 * other =
+      v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(arg, addonData->RoaringBitmap32_constructorTemplate, isolate);
+    if (other != nullptr) {
+      roaring_bitmap_and_inplace(self->roaring, other->roaring);
+      self->invalidate();
+      return info.GetReturnValue().Set(info.Holder());
+    } else {
+      RoaringBitmap32 tmp(0);
+      if (roaringAddMany(addonData, &tmp, arg)) {
+        roaring_bitmap_and_inplace(self->roaring, tmp.roaring);
+        self->invalidate();
+        return info.GetReturnValue().Set(info.Holder());
+      }
+    }
+  }
+
+  return v8utils::throwTypeError(isolate, "Uint32Array, RoaringBitmap32 or Iterable<number> expected");
+}
+
+void RoaringBitmap32::xorInPlace(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  AddonData * addonData = AddonData::get(info);
+  if (info.Length() > 0) {
+    auto const & arg = info[0];
+    RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+    if (self == nullptr) return;
+    RoaringBitmap32 * other =
+      v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(arg, addonData->RoaringBitmap32_constructorTemplate, isolate);
+    if (other != nullptr) {
+      roaring_bitmap_xor_inplace(self->roaring, other->roaring);
+      self->invalidate();
+      return info.GetReturnValue().Set(info.Holder());
+    } else {
+      RoaringBitmap32 tmp(0);
+      roaringAddMany(addonData, &tmp, arg);
+      roaring_bitmap_xor_inplace(self->roaring, tmp.roaring);
+      self->invalidate();
+      return info.GetReturnValue().Set(info.Holder());
+    }
+  }
+
+  return v8utils::throwTypeError(isolate, "Uint32Array, RoaringBitmap32 or Iterable<number> expected");
+}
+
+void RoaringBitmap32::remove(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  uint32_t v;
+  if (info.Length() >= 1 && info[0]->IsUint32() && info[0]->Uint32Value(info.GetIsolate()->GetCurrentContext()).To(&v)) {
+    RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+    if (self == nullptr) return;
+    if (roaring_bitmap_remove_checked(self->roaring, v)) {
+      self->invalidateRemoved(v);
+    }
+  }
+}
+
+void RoaringBitmap32::removeChecked(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  uint32_t v;
+  if (info.Length() < 1 || !info[0]->IsUint32() || !info[0]->Uint32Value(info.GetIsolate()->GetCurrentContext()).To(&v)) {
+    return info.GetReturnValue().Set(false);
+  }
+  RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+  if (self == nullptr) return;
+  bool result = roaring_bitmap_remove_checked(self->roaring, v);
+  if (result) {
+    self->invalidateRemoved(v);
+  }
+  info.GetReturnValue().Set(result);
+}
+
+void RoaringBitmap32::clear(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+  if (self == nullptr) return;
+  if (self->roaring && self->roaring->high_low_container.size == 0) {
+    info.GetReturnValue().Set(false);
+  } else {
+    if (self->roaring != nullptr) {
+      roaring_bitmap_clear(self->roaring);
+      roaring_bitmap_shrink_to_fit(self->roaring);
+      self->updateAmountOfExternalAllocatedMemory(info.GetIsolate(), 0);
+      self->invalidate();
+    }
+    info.GetReturnValue().Set(true);
+  }
+}
+
+inline static bool getRangeOperationParameters(
+  const v8::FunctionCallbackInfo<v8::Value> & info, uint64_t & minInteger, uint64_t & maxInteger) {
+  if (info.Length() < 2 || !info[0]->IsNumber() || !info[1]->IsNumber()) {
+    return false;
+  }
+
+  v8::Isolate * isolate = info.GetIsolate();
+  double minimum, maximum;
+
+  if (!info[0]->NumberValue(isolate->GetCurrentContext()).To(&minimum) || std::isnan(minimum)) {
+    return false;
+  }
+
+  if (!info[1]->NumberValue(isolate->GetCurrentContext()).To(&maximum) || std::isnan(maximum)) {
+    return false;
+  }
+
+  if (minimum < 0) {
+    minimum = 0;
+  }
+
+  if (maximum < 0) {
+    maximum = 0;
+  } else if (maximum > 4294967296) {
+    maximum = 4294967296;
+  }
+
+  minInteger = (uint64_t)minimum;
+  maxInteger = (uint64_t)maximum;
+
+  return minInteger < maxInteger;
+}
+
+void RoaringBitmap32::rangeCardinality(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  uint64_t minInteger, maxInteger;
+  if (getRangeOperationParameters(info, minInteger, maxInteger)) {
+    RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+    auto card = roaring_bitmap_range_cardinality(self->roaring, minInteger, maxInteger);
+    if (card <= 0xFFFFFFFF) {
+      return info.GetReturnValue().Set((uint32_t)card);
+    }
+    return info.GetReturnValue().Set((double)card);
+  }
+  return info.GetReturnValue().Set(0u);
+}
+
+void RoaringBitmap32::flipRange(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  uint64_t minInteger, maxInteger;
+  if (getRangeOperationParameters(info, minInteger, maxInteger)) {
+    RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+    if (self == nullptr) return;
+    roaring_bitmap_flip_inplace(self->roaring, minInteger, maxInteger);
+    self->invalidate();
+  }
+  info.GetReturnValue().Set(info.Holder());
+}
+
+void RoaringBitmap32::addRange(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  uint64_t minInteger, maxInteger;
+  if (getRangeOperationParameters(info, minInteger, maxInteger)) {
+    RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+    if (self == nullptr) return;
+    roaring_bitmap_add_range_closed(self->roaring, (uint32_t)minInteger, (uint32_t)(maxInteger - 1));
+    self->invalidate();
+  }
+  info.GetReturnValue().Set(info.Holder());
+}
+
+void RoaringBitmap32::removeRange(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  uint64_t minInteger, maxInteger;
+  if (getRangeOperationParameters(info, minInteger, maxInteger)) {
+    RoaringBitmap32 * self = unwrapMutable(info.GetIsolate(), info.Holder());
+    if (self == nullptr) return;
+    roaring_bitmap_remove_range_closed(self->roaring, (uint32_t)minInteger, (uint32_t)(maxInteger - 1));
+    self->invalidate();
+  }
+  info.GetReturnValue().Set(info.Holder());
+}
+
+//////////// Ranges ////////////
+
+// A flat list of [start, end) pairs in an Uint32Array or in a Float64Array.
+class RangePairs {
+ public:
+  size_t count;
+
+  RangePairs() : count(0) {}
+
+  bool set(v8::Local<v8::Value> value) {
+    this->count = 0;
+    if (value.IsEmpty()) {
+      return false;
+    }
+    if (value->IsUint32Array()) {
+      this->u32.set(value);
+      this->f64.reset();
+      if (this->u32.length % 2 != 0) return false;
+      this->count = this->u32.length / 2;
+      return true;
+    }
+    if (value->IsFloat64Array()) {
+      this->f64.set(value);
+      this->u32.reset();
+      if (this->f64.length % 2 != 0) return false;
+      this->count = this->f64.length / 2;
+      return true;
+    }
+    return false;
+  }
+
+  // Gets a range, trimmed like addRange does. Returns false if the range is empty.
+  inline bool get(size_t index, uint64_t & minInteger, uint64_t & maxInteger) const {
+    if (this->u32.data != nullptr) {
+      minInteger = this->u32.data[index * 2];
+      maxInteger = this->u32.data[index * 2 + 1];
+      if (maxInteger == 0 && minInteger != 0) {
+        // An end of 4294967296 wraps to 0 in an Uint32Array, as written by toRanges.
+        maxInteger = 4294967296;
+      }
+      return minInteger < maxInteger;
+    }
+    double minimum = this->f64.data[index * 2];
+    double maximum = this->f64.data[index * 2 + 1];
+    if (std::isnan(minimum) || std::isnan(maximum)) {
+      return false;
+    }
+    minimum = minimum < 0 ? 0 : minimum > 4294967296 ? 4294967296 : minimum;
+    maximum = maximum < 0 ? 0 : maximum > 4294967296 ? 4294967296 : maximum;
+    minInteger = (uint64_t)minimum;
+    maxInteger = (uint64_t)maximum;
+    return minInteger < maxInteger;
+  }
+
+  // True if the non empty ranges are sorted by start. If disjoint is true, ranges must also not overlap.
+  bool isSorted(bool disjoint) const {
+    uint64_t prevMin = 0, prevMax = 0;
+    uint64_t minInteger, maxInteger;
+    for (size_t i = 0; i != this->count; ++i) {
+      if (this->get(i, minInteger, maxInteger)) {
+        if (minInteger < (disjoint ? prevMax : prevMin)) {
+          return false;
+        }
+        prevMin = minInteger;
+        prevMax = maxInteger;
+      }
+    }
+    return true;
+  }
+
+ private:
+  v8utils::TypedArrayContent<uint32_t> u32;
+  v8utils::TypedArrayContent<double> f64;
+};
+
+// Builds a bitmap of run containers from ranges sorted by start, ranges can overlap.
+// getRange(index, min, max) returns false for an empty range.
+template <typename GetRange>
+static roaring_bitmap_t * roaringBitmapFromSortedRanges(size_t count, const GetRange & getRange) {
+  roaring_bitmap_t * result = roaring_bitmap_create();
+  if (result == nullptr) {
+    return nullptr;
+  }
+
+  run_container_t * run = nullptr;
+  int64_t key = -1;
+  uint64_t covered = 0;
+  uint64_t minInteger, maxInteger;
+  for (size_t i = 0; i != count; ++i) {
+    if (!getRange(i, minInteger, maxInteger) || maxInteger <= covered) {
+      continue;
+    }
+    uint64_t start = minInteger < covered ? covered : minInteger;
+    covered = maxInteger;
+    while (start < maxInteger) {
+      const uint64_t k = start >> 16;
+      const uint64_t containerEnd = (k + 1) << 16;
+      const uint64_t end = maxInteger < containerEnd ? maxInteger : containerEnd;
+      if ((int64_t)k != key) {
+        if (run != nullptr) {
+          ra_append(&result->high_low_container, (uint16_t)key, run, RUN_CONTAINER_TYPE);
+        }
+        run = run_container_create();
+        if (run == nullptr) {
+          roaring_bitmap_free(result);
+          return nullptr;
+        }
+        key = (int64_t)k;
+      }
+      const uint32_t low = (uint32_t)(start & 0xFFFF);
+      const uint32_t length = (uint32_t)(end - start - 1);
+      rle16_t * last = run->n_runs > 0 ? &run->runs[run->n_runs - 1] : nullptr;
+      if (last != nullptr && (uint32_t)last->value + last->length + 1 == low) {
+        // Touches the previous range, extends the run.
+        last->length = (uint16_t)(last->length + length + 1);
+      } else {
+        if (run->n_runs == run->capacity) {
+          run_container_grow(run, run->n_runs + 1, true);
+        }
+        run->runs[run->n_runs++] = MAKE_RLE16(low, length);
+      }
+      start = end;
+    }
+  }
+  if (run != nullptr) {
+    ra_append(&result->high_low_container, (uint16_t)key, run, RUN_CONTAINER_TYPE);
+  }
+
+  // Converts the run containers with many short runs to arrays or bitsets.
+  roaring_bitmap_run_optimize(result);
+  roaring_bitmap_shrink_to_fit(result);
+  return result;
+}
+
+static roaring_bitmap_t * roaringBitmapFromRanges(const RangePairs & ranges) {
+  if (ranges.isSorted(false)) {
+    return roaringBitmapFromSortedRanges(
+      ranges.count, [&ranges](size_t i, uint64_t & minInteger, uint64_t & maxInteger) {
+        return ranges.get(i, minInteger, maxInteger);
+      });
+  }
+
+  std::vector<std::pair<uint64_t, uint64_t>> sorted;
+  sorted.reserve(ranges.count);
+  uint64_t minInteger, maxInteger;
+  for (size_t i = 0; i != ranges.count; ++i) {
+    if (ranges.get(i, minInteger, maxInteger)) {
+      sorted.emplace_back(minInteger, maxInteger);
+    }
+  }
+  std::sort(sorted.begin(), sorted.end());
+  return roaringBitmapFromSortedRanges(
+    sorted.size(), [&sorted](size_t i, uint64_t & minInteger, uint64_t & maxInteger) {
+      minInteger = sorted[i].first;
+      maxInteger = sorted[i].second;
+      return true;
+    });
+}
+
+static const char rangesTypeErrorMessage[] = " - ranges must be an Uint32Array or a Float64Array of [start, end) pairs";
+
+void RoaringBitmap32::fromRangesStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  RangePairs ranges;
+  if (info.Length() < 1 || !ranges.set(info[0])) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::fromRanges", rangesTypeErrorMessage);
+  }
+
+  v8::Local<v8::Object> result;
+  if (!addonData->RoaringBitmap32_constructor.Get(isolate)->NewInstance(isolate->GetCurrentContext(), 0, nullptr).ToLocal(&result)) {
+    return;
+  }
+
+  roaring_bitmap_t * r = roaringBitmapFromRanges(ranges);
+  if (r == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::fromRanges - failed to allocate");
+  }
+
+  v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result)->replaceBitmapInstance(isolate, r);
+  info.GetReturnValue().Set(result);
+}
+
+class FromRangesAsyncWorker final : public RoaringBitmap32FactoryAsyncWorker {
+ public:
+  v8::Persistent<v8::Value> argPersistent;
+  RangePairs ranges;
+
+  explicit FromRangesAsyncWorker(AddonData * addonData) : RoaringBitmap32FactoryAsyncWorker(addonData) {}
+
+  virtual ~FromRangesAsyncWorker() { argPersistent.Reset(); }
+
+ protected:
+  void work() final {
+    this->bitmap = roaringBitmapFromRanges(this->ranges);
+    if (this->bitmap == nullptr) {
+      this->setError("Failed to allocate roaring bitmap");
+    }
+  }
+};
+
+void RoaringBitmap32::fromRangesStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  auto * worker = new FromRangesAsyncWorker(addonData);
+  if (worker == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::fromRangesAsync - Failed to allocate async worker");
+  }
+
+  if (info.Length() < 1 || !worker->ranges.set(info[0])) {
+    delete worker;
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::fromRangesAsync", rangesTypeErrorMessage);
+  }
+  worker->argPersistent.Reset(isolate, info[0]);
+
+  if (!setAsyncOptionsAndCallback(info, 1, "RoaringBitmap32::fromRangesAsync", worker)) {
+    delete worker;
+    return;
+  }
+
+  v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
+  info.GetReturnValue().Set(returnValue);
+}
+
+void RoaringBitmap32::addRanges(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  RoaringBitmap32 * self = unwrapMutable(isolate, info.Holder());
+  if (self == nullptr) return;
+
+  RangePairs ranges;
+  if (info.Length() < 1 || !ranges.set(info[0])) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::addRanges", rangesTypeErrorMessage);
+  }
+
+  roaring_bitmap_t * r = roaringBitmapFromRanges(ranges);
+  if (r == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::addRanges - failed to allocate");
+  }
+  roaring_bitmap_or_inplace(self->roaring, r);
+  roaring_bitmap_free(r);
+  self->invalidate();
+  info.GetReturnValue().Set(info.Holder());
+}
+
+void RoaringBitmap32::removeRanges(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  RoaringBitmap32 * self = unwrapMutable(isolate, info.Holder());
+  if (self == nullptr) return;
+
+  RangePairs ranges;
+  if (info.Length() < 1 || !ranges.set(info[0])) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::removeRanges", rangesTypeErrorMessage);
+  }
+
+  roaring_bitmap_t * r = roaringBitmapFromRanges(ranges);
+  if (r == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::removeRanges - failed to allocate");
+  }
+  roaring_bitmap_andnot_inplace(self->roaring, r);
+  roaring_bitmap_free(r);
+  self->invalidate();
+  info.GetReturnValue().Set(info.Holder());
+}
+
+void RoaringBitmap32::flipRanges(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  RoaringBitmap32 * self = unwrapMutable(isolate, info.Holder());
+  if (self == nullptr) return;
+
+  RangePairs ranges;
+  if (info.Length() < 1 || !ranges.set(info[0])) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::flipRanges", rangesTypeErrorMessage);
+  }
+
+  if (ranges.isSorted(true)) {
+    // Disjoint ranges: flipping all of them is a xor with their union.
+    roaring_bitmap_t * r = roaringBitmapFromRanges(ranges);
+    if (r == nullptr) {
+      return v8utils::throwError(isolate, "RoaringBitmap32::flipRanges - failed to allocate");
+    }
+    roaring_bitmap_xor_inplace(self->roaring, r);
+    roaring_bitmap_free(r);
+  } else {
+    // Overlapping ranges are flipped more than once, in order.
+    uint64_t minInteger, maxInteger;
+    for (size_t i = 0; i != ranges.count; ++i) {
+      if (ranges.get(i, minInteger, maxInteger)) {
+        roaring_bitmap_flip_inplace(self->roaring, minInteger, maxInteger);
+      }
+    }
+  }
+  self->invalidate();
+  info.GetReturnValue().Set(info.Holder());
+}
+
+// Writes the runs of a bitmap as [start, end) pairs, merging the runs across containers.
+// If output is null the ranges are only counted. Stops after maxRanges ranges. Returns the number of ranges.
+template <typename T>
+class RangesWriter {
+ public:
+  RangesWriter(T * output, size_t maxRanges) :
+    output(output), maxRanges(maxRanges), count(0), pendingStart(0), pendingEnd(0), hasPending(false) {}
+
+  size_t write(const roaring_bitmap_t * bitmap) {
+    const roaring_array_t * ra = &bitmap->high_low_container;
+    for (int32_t i = 0; i != ra->size && this->count < this->maxRanges; ++i) {
+      uint8_t type = ra->typecodes[i];
+      const container_t * c = container_unwrap_shared(ra->containers[i], &type);
+      const uint64_t base = (uint64_t)ra->keys[i] << 16;
+      switch (type) {
+        case ARRAY_CONTAINER_TYPE: this->writeArray(const_CAST_array(c), base); break;
+        case BITSET_CONTAINER_TYPE: this->writeBitset(const_CAST_bitset(c), base); break;
+        case RUN_CONTAINER_TYPE: this->writeRun(const_CAST_run(c), base); break;
+      }
+    }
+    if (this->hasPending) {
+      this->flush();
+    }
+    return this->count;
+  }
+
+ private:
+  T * const output;
+  const size_t maxRanges;
+  size_t count;
+  uint64_t pendingStart;
+  uint64_t pendingEnd;
+  bool hasPending;
+
+  inline void flush() {
+    if (this->count < this->maxRanges) {
+      if (this->output != nullptr) {
+        // For an Uint32Array, an end of 4294967296 wraps to 0.
+        this->output[this->count * 2] = (T)this->pendingStart;
+        this->output[this->count * 2 + 1] = (T)this->pendingEnd;
+      }
+      ++this->count;
+    }
+  }
+
+  inline void emit(uint64_t start, uint64_t end) {
+    if (this->hasPending) {
+      if (this->pendingEnd == start) {
+        this->pendingEnd = end;
+        return;
+      }
+      this->flush();
+    }
+    this->pendingStart = start;
+    this->pendingEnd = end;
+    this->hasPending = true;
+  }
+
+  void writeRun(const run_container_t * rc, uint64_t base) {
+    for (int32_t i = 0; i != rc->n_runs && this->count < this->maxRanges; ++i) {
+      const uint64_t start = base + rc->runs[i].value;
+      this->emit(start, start + rc->runs[i].length + 1);
+    }
+  }
+
+  void writeArray(const array_container_t * ac, uint64_t base) {
+    const uint16_t * values = ac->array;
+    const int32_t n = ac->cardinality;
+    int32_t i = 0;
+    while (i != n && this->count < this->maxRanges) {
+      const uint32_t start = values[i];
+      uint32_t end = start + 1;
+      while (++i != n && values[i] == end) {
+        ++end;
+      }
+      this->emit(base + start, base + end);
+    }
+  }
+
+  // Finds the runs a word at a time: the trailing zeros of a word are the gap before a run,
+  // the trailing ones of the word with the gap filled are the run.
+  void writeBitset(const bitset_container_t * bc, uint64_t base) {
+    const uint64_t * words = bc->words;
+    uint32_t i = 0;
+    uint64_t w = words[0];
+    while (this->count < this->maxRanges) {
+      while (w == 0 && i != BITSET_CONTAINER_SIZE_IN_WORDS - 1) {
+        w = words[++i];
+      }
+      if (w == 0) {
+        return;
+      }
+      const uint32_t start = i * 64 + (uint32_t)__builtin_ctzll(w);
+      uint64_t filled = w | (w - 1);
+      while (filled == ~UINT64_C(0) && i != BITSET_CONTAINER_SIZE_IN_WORDS - 1) {
+        filled = words[++i];
+      }
+      if (filled == ~UINT64_C(0)) {
+        this->emit(base + start, base + 65536);
+        return;
+      }
+      const uint32_t end = i * 64 + (uint32_t)__builtin_ctzll(~filled);
+      this->emit(base + start, base + end);
+      w = filled & (filled + 1);
+    }
+  }
+};
+
+void RoaringBitmap32::toRanges(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (self == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::toRanges on invalid object");
+  }
+
+  int argIndex = 0;
+  v8::Local<v8::Value> output;
+  if (info.Length() > 0 && !info[0]->IsNumber() && !info[0]->IsUndefined()) {
+    output = info[0];
+    if (!output->IsUint32Array() && !output->IsFloat64Array()) {
+      return v8utils::throwTypeError(
+        isolate, "RoaringBitmap32::toRanges - output must be an Uint32Array or a Float64Array");
+    }
+    argIndex = 1;
+  }
+
+  size_t maxRanges = SIZE_MAX;
+  if (info.Length() > argIndex && !info[argIndex]->IsUndefined()) {
+    double n = info[argIndex]->IsNumber() ? info[argIndex].As<v8::Number>()->Value() : -1;
+    if (!(n >= 0) || n != std::floor(n)) {
+      return v8utils::throwTypeError(isolate, "RoaringBitmap32::toRanges - maxRanges must be a non negative integer");
+    }
+    if (n < (double)SIZE_MAX) {
+      maxRanges = (size_t)n;
+    }
+  }
+
+  if (output.IsEmpty()) {
+    const size_t count = RangesWriter<uint32_t>(nullptr, maxRanges).write(self->roaring);
+    if (count * 2 > 0xFFFFFFFFu) {
+      return v8utils::throwError(isolate, "RoaringBitmap32::toRanges - too many ranges");
+    }
+    auto arrayBuffer = v8::ArrayBuffer::New(isolate, count * 2 * sizeof(uint32_t));
+    auto result = v8::Uint32Array::New(arrayBuffer, 0, count * 2);
+    v8utils::TypedArrayContent<uint32_t> content(result);
+    RangesWriter<uint32_t>(content.data, count).write(self->roaring);
+    return info.GetReturnValue().Set(result);
+  }
+
+  // Writes into the given array, and returns a view of the written ranges.
+  auto outputArray = v8::Local<v8::TypedArray>::Cast(output);
+  const size_t capacity = outputArray->Length() / 2;
+  const size_t limit = capacity < maxRanges ? capacity : maxRanges;
+  if (output->IsUint32Array()) {
+    v8utils::TypedArrayContent<uint32_t> content(output);
+    const size_t count = RangesWriter<uint32_t>(content.data, limit).write(self->roaring);
+    info.GetReturnValue().Set(v8::Uint32Array::New(outputArray->Buffer(), outputArray->ByteOffset(), count * 2));
+  } else {
+    v8utils::TypedArrayContent<double> content(output);
+    const size_t count = RangesWriter<double>(content.data, limit).write(self->roaring);
+    info.GetReturnValue().Set(v8::Float64Array::New(outputArray->Buffer(), outputArray->ByteOffset(), count * 2));
+  }
+}
+
+//////////// Text ////////////
+
+static const char textFormatErrorMessage[] = " - format must be \"json\", \"csv\" or \"ndjson\"";
+
+// Reads a text format argument, undefined is json. Returns false if the value is not a valid format.
+static bool getTextFormat(v8::Isolate * isolate, v8::Local<v8::Value> value, TextFormat & format) {
+  format = TextFormat::json;
+  if (value.IsEmpty() || value->IsUndefined()) {
+    return true;
+  }
+  if (!value->IsString()) {
+    return false;
+  }
+  v8::String::Utf8Value str(isolate, value);
+  if (*str == nullptr) {
+    return false;
+  }
+  if (strcmp(*str, "json") == 0) {
+    return true;
+  }
+  if (strcmp(*str, "csv") == 0) {
+    format = TextFormat::csv;
+    return true;
+  }
+  if (strcmp(*str, "ndjson") == 0) {
+    format = TextFormat::ndjson;
+    return true;
+  }
+  return false;
+}
+
+// Parses decimal values and inclusive "start-end" ranges, adding them to a bitmap in batches.
+// json is an array of values separated by commas, csv has values separated by commas or new lines,
+// ndjson has one value per line. Ranges are accepted only in csv and ndjson. Empty items are ignored in csv and ndjson.
+class TextParser final {
+ public:
+  TextParser(roaring_bitmap_t * bitmap, TextFormat format, const v8utils::AsyncWorker * worker = nullptr) :
+    bitmap(bitmap), format(format), worker(worker), batchSize(0) {}
+
+  // Returns nullptr on success or an error message.
+  const char * parse(const char * text, size_t length) {
+    const char * p = text;
+    const char * end = text + length;
+    const char * error;
+    if (this->format == TextFormat::json) {
+      error = this->parseJson(p, end);
+    } else {
+      error = this->parseLines(p, end);
+    }
+    this->flush();
+    return error;
+  }
+
+ private:
+  roaring_bitmap_t * const bitmap;
+  const TextFormat format;
+  const v8utils::AsyncWorker * const worker;
+  uint32_t batchSize;
+  uint32_t batch[4096];
+
+  inline bool isAborted() const { return this->worker != nullptr && this->worker->hasError(); }
+
+  inline void flush() {
+    roaring_bitmap_add_many(this->bitmap, this->batchSize, this->batch);
+    this->batchSize = 0;
+  }
+
+  inline void add(uint32_t value) {
+    this->batch[this->batchSize++] = value;
+    if (this->batchSize == sizeof(this->batch) / sizeof(this->batch[0])) {
+      this->flush();
+    }
+  }
+
+  static inline bool isDigit(char c) { return (unsigned char)(c - '0') < 10; }
+
+  static inline void skipSpaces(const char *& p, const char * end, bool newLines) {
+    while (p != end && (*p == ' ' || *p == '\t' || *p == '\r' || (newLines && *p == '\n'))) {
+      ++p;
+    }
+  }
+
+  // Reads an unsigned decimal integer. Returns false if there is no number or it does not fit in 32 bits.
+  static inline bool readNumber(const char *& p, const char * end, uint32_t & result) {
+    if (p == end || !isDigit(*p)) {
+      return false;
+    }
+    uint64_t value = 0;
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    // Converts 8 digits at a time in a 64 bit register, for long numbers.
+    if (end - p >= 8) {
+      uint64_t chunk;
+      memcpy(&chunk, p, 8);
+      if (
+        (chunk & UINT64_C(0xF0F0F0F0F0F0F0F0)) == UINT64_C(0x3030303030303030) &&
+        ((chunk + UINT64_C(0x0606060606060606)) & UINT64_C(0xF0F0F0F0F0F0F0F0)) == UINT64_C(0x3030303030303030)) {
+        chunk -= UINT64_C(0x3030303030303030);
+        chunk = (chunk * 10) + (chunk >> 8);
+        value = (((chunk & UINT64_C(0x000000FF000000FF)) * (100 + (UINT64_C(1000000) << 32))) +
+                 (((chunk >> 16) & UINT64_C(0x000000FF000000FF)) * (1 + (UINT64_C(10000) << 32)))) >>
+                32;
+        p += 8;
+      }
+    }
+#endif
+    int digits = 0;
+    while (p != end && isDigit(*p)) {
+      value = value * 10 + (uint64_t)(*p - '0');
+      if (value > 0xFFFFFFFF || ++digits > 10) {
+        return false;
+      }
+      ++p;
+    }
+    result = (uint32_t)value;
+    return true;
+  }
+
+  const char * parseJson(const char *& p, const char * end) {
+    skipSpaces(p, end, true);
+    if (p == end || *p != '[') {
+      return "RoaringBitmap32::fromText - invalid JSON, array expected";
+    }
+    ++p;
+    skipSpaces(p, end, true);
+    if (p != end && *p == ']') {
+      ++p;
+    } else {
+      for (;;) {
+        uint32_t value;
+        if (!readNumber(p, end, value)) {
+          return "RoaringBitmap32::fromText - invalid JSON, 32 bit unsigned integer expected";
+        }
+        this->add(value);
+        skipSpaces(p, end, true);
+        if (p == end) {
+          return "RoaringBitmap32::fromText - invalid JSON, unterminated array";
+        }
+        const char c = *p++;
+        if (c == ']') {
+          break;
+        }
+        if (c != ',') {
+          return "RoaringBitmap32::fromText - invalid JSON, comma expected";
+        }
+        if (this->batchSize == 0 && this->isAborted()) {
+          return nullptr;
+        }
+        skipSpaces(p, end, true);
+      }
+    }
+    skipSpaces(p, end, true);
+    return p == end ? nullptr : "RoaringBitmap32::fromText - invalid JSON, unexpected content after the array";
+  }
+
+  const char * parseLines(const char *& p, const char * end) {
+    const bool commas = this->format == TextFormat::csv;
+    while (p != end) {
+      skipSpaces(p, end, false);
+      if (p == end) {
+        break;
+      }
+      if (*p == '\n' || (commas && *p == ',')) {
+        ++p;
+        continue;
+      }
+      uint32_t value;
+      if (!readNumber(p, end, value)) {
+        return "RoaringBitmap32::fromText - 32 bit unsigned integer expected";
+      }
+      skipSpaces(p, end, false);
+      if (p != end && *p == '-') {
+        ++p;
+        skipSpaces(p, end, false);
+        uint32_t last;
+        if (!readNumber(p, end, last) || last < value) {
+          return "RoaringBitmap32::fromText - invalid range";
+        }
+        roaring_bitmap_add_range_closed(this->bitmap, value, last);
+        skipSpaces(p, end, false);
+      } else {
+        this->add(value);
+      }
+      if (p != end) {
+        if (*p != '\n' && !(commas && *p == ',')) {
+          return commas ? "RoaringBitmap32::fromText - invalid CSV, comma or new line expected"
+                        : "RoaringBitmap32::fromText - invalid NDJSON, new line expected";
+        }
+        ++p;
+      }
+      if (this->batchSize == 0 && this->isAborted()) {
+        return nullptr;
+      }
+    }
+    return nullptr;
+  }
+};
+
+// The text to parse, from a string, a Buffer or an Uint8Array.
+struct TextInput final {
+  std::string copy;
+  v8utils::TypedArrayContent<uint8_t> content;
+  const char * data = nullptr;
+  size_t length = 0;
+
+  bool set(v8::Isolate * isolate, v8::Local<v8::Value> value) {
+    if (value->IsString()) {
+      v8::String::Utf8Value str(isolate, value);
+      if (*str == nullptr) {
+        return false;
+      }
+      this->copy.assign(*str, (size_t)str.length());
+      this->data = this->copy.data();
+      this->length = this->copy.length();
+      return true;
+    }
+    if (!value->IsUint8Array() && !value->IsInt8Array() && !value->IsUint8ClampedArray()) {
+      return false;
+    }
+    if (!this->content.set(value)) {
+      return false;
+    }
+    this->data = (const char *)this->content.data;
+    this->length = this->content.length;
+    return true;
+  }
+};
+
+static const char textInputErrorMessage[] = " - text must be a string, a Buffer or an Uint8Array";
+
+void RoaringBitmap32::fromTextStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+
+  TextInput input;
+  if (info.Length() < 1 || !input.set(isolate, info[0])) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::fromText", textInputErrorMessage);
+  }
+  TextFormat format;
+  if (!getTextFormat(isolate, info.Length() > 1 ? info[1] : v8::Local<v8::Value>(), format)) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::fromText", textFormatErrorMessage);
+  }
+
+  roaring_bitmap_t * bitmap = roaring_bitmap_create();
+  if (bitmap == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::fromText - failed to allocate");
+  }
+  const char * error = TextParser(bitmap, format).parse(input.data, input.length);
+  if (error != nullptr) {
+    roaring_bitmap_free(bitmap);
+    return v8utils::throwError(isolate, error);
+  }
+
+  AddonData * addonData = AddonData::get(info);
+  v8::Local<v8::Function> cons = addonData->RoaringBitmap32_constructor.Get(isolate);
+  v8::Local<v8::Object> result;
+  if (!cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr).ToLocal(&result)) {
+    roaring_bitmap_free(bitmap);
+    return;
+  }
+  RoaringBitmap32 * unwrapped = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+  unwrapped->replaceBitmapInstance(isolate, bitmap);
+  info.GetReturnValue().Set(result);
+}
+
+class FromTextAsyncWorker final : public RoaringBitmap32FactoryAsyncWorker {
+ public:
+  v8::Persistent<v8::Value> argPersistent;
+  TextInput input;
+  TextFormat format;
+
+  explicit FromTextAsyncWorker(AddonData * addonData) :
+    RoaringBitmap32FactoryAsyncWorker(addonData), format(TextFormat::json) {}
+
+  virtual ~FromTextAsyncWorker() { argPersistent.Reset(); }
+
+ protected:
+  void work() final {
+    roaring_bitmap_t * bitmap = roaring_bitmap_create();
+    if (bitmap == nullptr) {
+      this->setError("RoaringBitmap32::fromTextAsync - failed to allocate");
+      return;
+    }
+    const char * error = TextParser(bitmap, this->format, this).parse(this->input.data, this->input.length);
+    if (error != nullptr || this->hasError()) {
+      roaring_bitmap_free(bitmap);
+      this->setError(error);
+      return;
+    }
+    this->bitmap = bitmap;
+  }
+};
+
+void RoaringBitmap32::fromTextStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  auto * worker = new FromTextAsyncWorker(addonData);
+  if (worker == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::fromTextAsync - Failed to allocate async worker");
+  }
+
+  if (info.Length() < 1 || !worker->input.set(isolate, info[0])) {
+    delete worker;
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::fromTextAsync", textInputErrorMessage);
+  }
+  worker->argPersistent.Reset(isolate, info[0]);
+
+  int index = 1;
+  if (info.Length() > 1 && (info[1]->IsString() || info[1]->IsUndefined())) {
+    if (!getTextFormat(isolate, info[1], worker->format)) {
+      delete worker;
+      return v8utils::throwTypeError(isolate, "RoaringBitmap32::fromTextAsync", textFormatErrorMessage);
+    }
+    index = 2;
+  }
+
+  if (!setAsyncOptionsAndCallback(info, index, "RoaringBitmap32::fromTextAsync", worker)) {
+    delete worker;
+    return;
+  }
+
+  v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
+  info.GetReturnValue().Set(returnValue);
+}
+
+void RoaringBitmap32::toText(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (self == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::toText on invalid object");
+  }
+
+  TextFormat format;
+  if (!getTextFormat(isolate, info.Length() > 0 ? info[0] : v8::Local<v8::Value>(), format)) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::toText", textFormatErrorMessage);
+  }
+  if (self->getCardinality() > TEXT_MAX_CARDINALITY) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::toText - the bitmap is too big to be converted to a string");
+  }
+
+  std::vector<char> str;
+  roaringWriteText(self->roaring, format, str);
+  v8::Local<v8::String> result;
+  if (!textToString(isolate, str).ToLocal(&result)) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::toText - the bitmap is too big to be converted to a string");
+  }
+  info.GetReturnValue().Set(result);
+}
+
+class ToTextAsyncWorker final : public v8utils::AsyncWorker {
+ public:
+  roaring_bitmap_t * snapshot;
+  TextFormat format;
+  std::vector<char> str;
+
+  explicit ToTextAsyncWorker(v8::Isolate * isolate) :
+    v8utils::AsyncWorker(isolate), snapshot(nullptr), format(TextFormat::json) {}
+
+  virtual ~ToTextAsyncWorker() {
+    if (this->snapshot != nullptr) {
+      roaring_bitmap_free(this->snapshot);
+    }
+  }
+
+ protected:
+  void work() final {
+    if (roaring_bitmap_get_cardinality(this->snapshot) > TEXT_MAX_CARDINALITY) {
+      this->setError("RoaringBitmap32::toTextAsync - the bitmap is too big to be converted to a string");
+      return;
+    }
+    roaringWriteText(this->snapshot, this->format, this->str);
+  }
+
+  v8::Local<v8::Value> done() final {
+    v8::Local<v8::String> result;
+    if (!textToString(isolate, this->str).ToLocal(&result)) {
+      v8utils::throwError(isolate, "RoaringBitmap32::toTextAsync - the bitmap is too big to be converted to a string");
+      return v8::Local<v8::Value>();
+    }
+    return result;
+  }
+};
+
+void RoaringBitmap32::toTextAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+
+  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (self == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::toTextAsync on invalid object");
+  }
+
+  auto * worker = new ToTextAsyncWorker(isolate);
+  if (worker == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::toTextAsync - Failed to allocate async worker");
+  }
+
+  int index = 0;
+  if (info.Length() > 0 && (info[0]->IsString() || info[0]->IsUndefined())) {
+    if (!getTextFormat(isolate, info[0], worker->format)) {
+      delete worker;
+      return v8utils::throwTypeError(isolate, "RoaringBitmap32::toTextAsync", textFormatErrorMessage);
+    }
+    index = 1;
+  }
+
+  if (!setAsyncOptionsAndCallback(info, index, "RoaringBitmap32::toTextAsync", worker)) {
+    delete worker;
+    return;
+  }
+
+  // The worker reads a snapshot, so the bitmap can be safely changed while the operation is running.
+  worker->snapshot = roaringBitmapSnapshot(self->roaring);
+  if (worker->snapshot == nullptr) {
+    delete worker;
+    return v8utils::throwError(isolate, "RoaringBitmap32::toTextAsync - failed to allocate");
+  }
+
+  v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
+  info.GetReturnValue().Set(returnValue);
+}
+
+void RoaringBitmap32::swapStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  AddonData * addonData = AddonData::get(info);
+  if (info.Length() < 2) return v8utils::throwTypeError(isolate, "RoaringBitmap32::swap expects 2 arguments");
+
+  auto constructorTemplate = addonData->RoaringBitmap32_constructorTemplate.Get(isolate);
+
+  RoaringBitmap32 * a = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], constructorTemplate, isolate);
+  if (a == nullptr)
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::swap first argument must be a RoaringBitmap32");
+
+  RoaringBitmap32 * b = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[1], constructorTemplate, isolate);
+  if (b == nullptr)
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::swap second argument must be a RoaringBitmap32");
+
+  if (a->frozen || b->frozen) {
+    return v8utils::throwError(isolate, frozenErrorMessage);
+  }
+
+  if (a != b) {
+    auto * t = a->roaring;
+    a->roaring = b->roaring;
+    b->roaring = t;
+    a->invalidate();
+    b->invalidate();
+  }
+}
+
+void RoaringBitmap32::getThreadPoolSizeStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  info.GetReturnValue().Set(v8utils::ThreadPool::getSize());
+}
+
+void RoaringBitmap32::setThreadPoolSizeStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  double size = 0;
+  if (info.Length() > 0 && !info[0]->IsUndefined()) {
+    if (!info[0]->IsNumber() || !info[0]->NumberValue(isolate->GetCurrentContext()).To(&size) || std::isnan(size) ||
+        size < 0 || size > 1024 || size != std::floor(size)) {
+      return v8utils::throwTypeError(
+        isolate, "RoaringBitmap32::setThreadPoolSize - size must be an integer between 0 and 1024");
+    }
+  }
+  v8utils::ThreadPool::setSize((uint32_t)size);
+}
+
+void RoaringBitmap32::andStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  auto constructorTemplate = addonData->RoaringBitmap32_constructorTemplate.Get(isolate);
+
+  if (info.Length() < 2) return v8utils::throwTypeError(isolate, "RoaringBitmap32::and expects 2 arguments");
+
+  RoaringBitmap32 * a = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], constructorTemplate, isolate);
+  if (a == nullptr) return v8utils::throwTypeError(isolate, "RoaringBitmap32::and first argument must be a RoaringBitmap32");
+
+  RoaringBitmap32 * b = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[1], constructorTemplate, isolate);
+  if (b == nullptr)
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::and second argument must be a RoaringBitmap32");
+
+  v8::Local<v8::Function> cons = addonData->RoaringBitmap32_constructor.Get(isolate);
+
+  auto resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
+  v8::Local<v8::Object> result;
+  if (!resultMaybe.ToLocal(&result)) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::and failed to create new instance");
+  }
+
+  auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+
+  roaring_bitmap_t * r = roaring_bitmap_and(a->roaring, b->roaring);
+  if (r == nullptr) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::and failed materalization");
+  }
+
+  self->replaceBitmapInstance(isolate, r);
+
+  info.GetReturnValue().Set(result);
+}
+
+void RoaringBitmap32::orStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  if (info.Length() < 2) return v8utils::throwTypeError(isolate, "RoaringBitmap32::or expects 2 arguments");
+
+  auto constructorTemplate = addonData->RoaringBitmap32_constructorTemplate.Get(isolate);
+
+  RoaringBitmap32 * a = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], constructorTemplate, isolate);
+  if (a == nullptr) return v8utils::throwTypeError(isolate, "RoaringBitmap32::or first argument must be a RoaringBitmap32");
+
+  RoaringBitmap32 * b = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[1], constructorTemplate, isolate);
+  if (b == nullptr) return v8utils::throwTypeError(isolate, "RoaringBitmap32::or second argument must be a RoaringBitmap32");
+
+  v8::Local<v8::Function> cons = addonData->RoaringBitmap32_constructor.Get(isolate);
+
+  auto resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
+  v8::Local<v8::Object> result;
+  if (!resultMaybe.ToLocal(&result)) return;
+
+  auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+
+  roaring_bitmap_t * r = roaring_bitmap_or(a->roaring, b->roaring);
+  if (r == nullptr) return v8utils::throwTypeError(isolate, "RoaringBitmap32::or failed materalization");
+
+  self->replaceBitmapInstance(isolate, r);
+
+  info.GetReturnValue().Set(result);
+}
+
+void RoaringBitmap32::xorStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  if (info.Length() < 2) return v8utils::throwTypeError(isolate, "RoaringBitmap32::xor expects 2 arguments");
+
+  auto constructorTemplate = addonData->RoaringBitmap32_constructorTemplate.Get(isolate);
+
+  RoaringBitmap32 * a = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], constructorTemplate, isolate);
+  if (a == nullptr) return v8utils::throwTypeError(isolate, "RoaringBitmap32::xor first argument must be a RoaringBitmap32");
+
+  RoaringBitmap32 * b = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[1], constructorTemplate, isolate);
+  if (b == nullptr)
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::xor second argument must be a RoaringBitmap32");
+
+  v8::Local<v8::Function> cons = addonData->RoaringBitmap32_constructor.Get(isolate);
+
+  auto resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
+  v8::Local<v8::Object> result;
+  if (!resultMaybe.ToLocal(&result)) return;
+
+  auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+
+  roaring_bitmap_t * r = roaring_bitmap_xor(a->roaring, b->roaring);
+  if (r == nullptr) return v8utils::throwTypeError(isolate, "RoaringBitmap32::xor failed materalization");
+
+  self->replaceBitmapInstance(isolate, r);
+
+  info.GetReturnValue().Set(result);
+}
+
+void RoaringBitmap32::andNotStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  if (info.Length() < 2) return v8utils::throwTypeError(isolate, "RoaringBitmap32::andnot expects 2 arguments");
+
+  auto constructorTemplate = addonData->RoaringBitmap32_constructorTemplate.Get(isolate);
+
+  RoaringBitmap32 * a = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], constructorTemplate, isolate);
+  if (a == nullptr)
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::andnot first argument must be a RoaringBitmap32");
+
+  RoaringBitmap32 * b = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[1], constructorTemplate, isolate);
+  if (b == nullptr)
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::andnot second argument must be a RoaringBitmap32");
+
+  v8::Local<v8::Function> cons = addonData->RoaringBitmap32_constructor.Get(isolate);
+
+  auto resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
+  v8::Local<v8::Object> result;
+  if (!resultMaybe.ToLocal(&result)) return;
+
+  auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+
+  roaring_bitmap_t * r = roaring_bitmap_andnot(a->roaring, b->roaring);
+  if (r == nullptr) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::andnot failed materalization");
+  }
+
+  self->replaceBitmapInstance(isolate, r);
+
+  info.GetReturnValue().Set(result);
+}
+
+void RoaringBitmap32::fromRangeStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = v8::Isolate::GetCurrent();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  v8::Local<v8::Function> cons = addonData->RoaringBitmap32_constructor.Get(isolate);
+
+  auto resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
+  v8::Local<v8::Object> result;
+  if (!resultMaybe.ToLocal(&result)) return;
+
+  uint32_t v;
+  uint32_t step = 1;
+  if (info.Length() >= 3 && info[2]->IsUint32() && info[2]->Uint32Value(isolate->GetCurrentContext()).To(&v)) {
+    step = v;
+    if (step == 0) {
+      step = 1;
+    }
+  }
+
+  auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+
+  uint64_t minInteger, maxInteger;
+  if (getRangeOperationParameters(info, minInteger, maxInteger)) {
+    roaring_bitmap_t * r = roaring_bitmap_from_range(minInteger, maxInteger, step);
+    if (r != nullptr) {
+      self->replaceBitmapInstance(isolate, r);
+    }
+  }
+
+  info.GetReturnValue().Set(result);
+}
+
+template <typename TSize>
+void RoaringBitmap32_opManyStatic(
+  const char * opName,
+  roaring_bitmap_t * op(TSize number, const roaring_bitmap_t ** x),
+  const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+
+  int length = info.Length();
+
+  v8::Local<v8::FunctionTemplate> ctorType = addonData->RoaringBitmap32_constructorTemplate.Get(isolate);
+  v8::Local<v8::Function> cons = addonData->RoaringBitmap32_constructor.Get(isolate);
+
+  auto context = isolate->GetCurrentContext();
+
+  if (length == 0) {
+    auto vMaybe = cons->NewInstance(context, 0, nullptr);
+    v8::Local<v8::Object> v;
+    if (vMaybe.ToLocal(&v)) {
+      info.GetReturnValue().Set(v);
+    }
+    return;
+  }
+
+  if (length == 1) {
+    if (info[0]->IsArray()) {
+      auto array = v8::Local<v8::Array>::Cast(info[0]);
+
+      size_t arrayLength = array->Length();
+
+      if (arrayLength == 0) {
+        auto vMaybe = cons->NewInstance(context, 0, nullptr);
+        v8::Local<v8::Object> v;
+        if (vMaybe.ToLocal(&v)) {
+          info.GetReturnValue().Set(v);
+        }
+        return;
+      }
+
+      if (arrayLength == 1) {
+        auto itemMaybe = array->Get(context, 0);
+
+        v8::Local<v8::Value> item;
+        if (!itemMaybe.ToLocal(&item) || !ctorType->HasInstance(item)) {
+          return v8utils::throwTypeError(isolate, opName, " accepts only RoaringBitmap32 instances");
+        }
+
+        v8::Local<v8::Value> argv[] = {item};
+        auto vMaybe = cons->NewInstance(context, 1, argv);
+        v8::Local<v8::Object> v;
+        if (vMaybe.ToLocal(&v)) {
+          info.GetReturnValue().Set(v);
+        }
+        return;
+      }
+
+      const auto ** x = (const roaring_bitmap_t **)malloc(arrayLength * sizeof(roaring_bitmap_t *));
+      if (x == nullptr) {
+        return v8utils::throwTypeError(isolate, opName, " failed allocation");
+      }
+
+      for (size_t i = 0; i < arrayLength; ++i) {
+        v8::Local<v8::Value> item;
+        auto itemMaybe = array->Get(context, i);
+        if (!itemMaybe.ToLocal(&item) || !ctorType->HasInstance(item)) {
+          return v8utils::throwTypeError(isolate, opName, " accepts only RoaringBitmap32 instances");
+        }
+        RoaringBitmap32 * p = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(item, ctorType, isolate);
+        if (p == nullptr) {
+          free(x);
+          return v8utils::throwTypeError(isolate, opName, " accepts only RoaringBitmap32 instances");
+        }
+        x[i] = p->roaring;
+      }
+
+      auto resultMaybe = cons->NewInstance(context, 0, nullptr);
+      v8::Local<v8::Object> result;
+      if (!resultMaybe.ToLocal(&result)) {
+        free(x);
+        return;
+      }
+
+      auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+
+      roaring_bitmap_t * r = op((TSize)arrayLength, x);
+      if (r == nullptr) {
+        free(x);
+        return v8utils::throwTypeError(isolate, opName, " failed roaring allocation");
+      }
+
+      self->replaceBitmapInstance(isolate, r);
+
+      info.GetReturnValue().Set(result);
+
+    } else {
+      if (!ctorType->HasInstance(info[0])) {
+        return v8utils::throwTypeError(isolate, opName, " accepts only RoaringBitmap32 instances");
+      }
+
+      v8::Local<v8::Value> argv[] = {info[0]};
+      auto vMaybe = cons->NewInstance(isolate->GetCurrentContext(), 1, argv);
+      v8::Local<v8::Object> v;
+      if (vMaybe.ToLocal(&v)) {
+        info.GetReturnValue().Set(v);
+      }
+    }
+  } else {
+    const auto ** x = (const roaring_bitmap_t **)malloc(length * sizeof(roaring_bitmap_t *));
+    if (x == nullptr) {
+      return v8utils::throwTypeError(isolate, opName, " failed allocation");
+    }
+
+    for (int i = 0; i < length; ++i) {
+      RoaringBitmap32 * p = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, i, ctorType);
+      if (p == nullptr) {
+        free(x);
+        return v8utils::throwTypeError(isolate, opName, " accepts only RoaringBitmap32 instances");
+      }
+      x[i] = p->roaring;
+    }
+
+    v8::MaybeLocal<v8::Object> resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
+    v8::Local<v8::Object> result;
+    if (!resultMaybe.ToLocal(&result)) {
+      free(x);
+      return;
+    }
+
+    auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+    roaring_bitmap_t * r = op((TSize)length, x);
+    if (r == nullptr) {
+      free(x);
+      return v8utils::throwTypeError(isolate, opName, " failed roaring allocation");
+    }
+
+    self->replaceBitmapInstance(isolate, r);
+
+    info.GetReturnValue().Set(result);
+  }
 }
 
-void RoaringBitmap32::andNotCardinality(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, RoaringBitmap32::constructorTemplate);
-  info.GetReturnValue().Set(other ? (double)roaring_bitmap_andnot_cardinality(self->roaring, other->roaring) : -1);
+void RoaringBitmap32::orManyStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  RoaringBitmap32_opManyStatic("RoaringBitmap32::orMany", roaring_bitmap_or_many_heap, info);
 }
 
-void RoaringBitmap32::xorCardinality(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, RoaringBitmap32::constructorTemplate);
-  info.GetReturnValue().Set(self && other ? (double)roaring_bitmap_xor_cardinality(self->roaring, other->roaring) : -1);
+void RoaringBitmap32::xorManyStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  RoaringBitmap32_opManyStatic("RoaringBitmap32::xorMany", roaring_bitmap_xor_many, info);
 }
 
-void RoaringBitmap32::jaccardIndex(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  RoaringBitmap32 * other = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, 0, RoaringBitmap32::constructorTemplate);
-  info.GetReturnValue().Set(self && other ? roaring_bitmap_jaccard_index(self->roaring, other->roaring) : -1);
-}
+// Inputs with less values are added by a single thread.
+#define FROM_ARRAY_PARALLEL_MIN_LENGTH 0x100000
+// Values are partitioned by their 10 highest bits, a partition covers 64 containers.
+#define FROM_ARRAY_PARTITION_SHIFT 22
+#define FROM_ARRAY_PARTITIONS 1024
+#define FROM_ARRAY_MAX_SLICES 256
+
+// Builds a bitmap from an array.
+// Big arrays are split in slices, and the work runs in phases:
+// - scan: each slice checks if it is sorted and counts the values of each partition.
+// - scatter: only if the input is not sorted, each slice copies its values in a temporary array grouped by partition.
+// - build: each partition is added to its own bitmap. Partitions contain different containers,
+//   so the bitmaps are finally concatenated moving their containers.
+class FromArrayAsyncWorker final : public v8utils::ParallelAsyncWorker {
+ public:
+  AddonData * const addonData;
+  v8::Persistent<v8::Value> argPersistent;
+  v8utils::TypedArrayContent<uint32_t> buffer;
+  roaring_bitmap_t * bitmap;
+
+  explicit FromArrayAsyncWorker(AddonData * addonData) :
+    v8utils::ParallelAsyncWorker(addonData->isolate),
+    addonData(addonData),
+    bitmap(nullptr),
+    phase(phaseSingle),
+    slicesCount(0),
+    counts(nullptr),
+    slicesSorted(nullptr),
+    partitionOffsets(nullptr),
+    partitioned(nullptr),
+    source(nullptr),
+    partitions(nullptr),
+    partitionBitmaps(nullptr),
+    partitionsCount(0) {
+    addonData->acquire();
+  }
 
-inline bool roaringAddMany(v8::Isolate * isolate, RoaringBitmap32 * self, v8::Local<v8::Value> arg, bool replace = false) {
-  if (arg.IsEmpty()) {
-    return false;
+  virtual ~FromArrayAsyncWorker() {
+    argPersistent.Reset();
+    this->freePartitions();
+    if (this->bitmap != nullptr) {
+      roaring_bitmap_free(this->bitmap);
+    }
+    this->addonData->release();
   }
 
-  if (arg->IsNullOrUndefined()) {
-    if (replace && self->roaring->high_low_container.containers != nullptr) {
-      roaring_bitmap_clear(self->roaring);
+  // Chooses between the single thread and the parallel build, and allocates the memory. Called in the main thread.
+  bool prepare() {
+    const uint32_t threads = this->concurrency != 0 ? this->concurrency : v8utils::ThreadPool::getSize();
+    if (buffer.length < FROM_ARRAY_PARALLEL_MIN_LENGTH || threads <= 1) {
+      this->phase = phaseSingle;
+      this->loopCount = 1;
+      return true;
     }
-    return true;
+    const uint32_t slices = threads * 4;
+    this->slicesCount = slices > FROM_ARRAY_MAX_SLICES ? FROM_ARRAY_MAX_SLICES : slices;
+    this->phase = phaseScan;
+    this->loopCount = this->slicesCount;
+    this->counts = new uint32_t[(size_t)slicesCount * FROM_ARRAY_PARTITIONS]();
+    this->slicesSorted = new bool[slicesCount]();
+    this->partitionOffsets = new size_t[FROM_ARRAY_PARTITIONS + 1]();
+    this->partitions = new uint32_t[FROM_ARRAY_PARTITIONS]();
+    return this->counts != nullptr && this->slicesSorted != nullptr && this->partitionOffsets != nullptr &&
+           this->partitions != nullptr;
   }
 
-  if (!arg->IsObject()) {
-    return false;
+ protected:
+  void parallelWork(uint32_t index) final {
+    switch (this->phase) {
+      case phaseSingle: this->buildSingle(); break;
+      case phaseScan: this->scan(index); break;
+      case phaseScatter: this->scatter(index); break;
+      case phaseBuild: this->buildPartition(index); break;
+    }
   }
 
-  if (arg->IsUint32Array() || arg->IsInt32Array()) {
-    if (replace && self->roaring->high_low_container.containers != nullptr) {
-      roaring_bitmap_clear(self->roaring);
+  bool nextParallelPhase() final {
+    switch (this->phase) {
+      case phaseScan: return this->afterScan();
+      case phaseScatter: return this->startBuild();
+      case phaseBuild: this->concatenate(); return false;
+      default: return false;
     }
-    const v8utils::TypedArrayContent<uint32_t> typedArray(arg);
-    roaring_bitmap_add_many(self->roaring, typedArray.length, typedArray.data);
-    self->invalidate();
-    return true;
   }
 
-  RoaringBitmap32 * other =
-    v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(arg, RoaringBitmap32::constructorTemplate, isolate);
-  if (other != nullptr) {
-    if (self != other) {
-      if (replace || self->roaring->high_low_container.containers == nullptr) {
-        if (self->roaring->high_low_container.containers != nullptr) {
-          roaring_bitmap_clear(self->roaring);
-        }
-        roaring_bitmap_t * copied = roaring_bitmap_copy(other->roaring);
-        if (copied == nullptr) {
-          v8utils::throwError(isolate, "RoaringBitmap32 - Failed to copy bitmap");
-        }
-        self->replaceBitmapInstance(isolate, copied);
-      } else {
-        roaring_bitmap_or_inplace(self->roaring, other->roaring);
+  v8::Local<v8::Value> done() final {
+    v8::Local<v8::Function> cons = this->addonData->RoaringBitmap32_constructor.Get(this->isolate);
+
+    v8::Local<v8::Object> result;
+    if (!cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr).ToLocal(&result)) {
+      v8utils::throwError(isolate, "Error instantiating roaring bitmap");
+      return v8::Local<v8::Value>();
+    }
+
+    RoaringBitmap32 * unwrapped = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+    if (unwrapped == nullptr) {
+      return v8::Local<v8::Value>();
+    }
+
+    unwrapped->replaceBitmapInstance(this->isolate, this->bitmap);
+    this->bitmap = nullptr;
+    return result;
+  }
+
+ private:
+  enum Phase { phaseSingle, phaseScan, phaseScatter, phaseBuild };
+
+  Phase phase;
+  uint32_t slicesCount;
+  uint32_t * counts;
+  bool * slicesSorted;
+  size_t * partitionOffsets;
+  uint32_t * partitioned;
+  const uint32_t * source;
+  uint32_t * partitions;
+  roaring_bitmap_t ** partitionBitmaps;
+  uint32_t partitionsCount;
+
+  inline size_t sliceBegin(uint32_t slice) const { return (size_t)((uint64_t)buffer.length * slice / slicesCount); }
+
+  void buildSingle() {
+    roaring_bitmap_t * result = roaring_bitmap_create_with_capacity(buffer.length);
+    if (result == nullptr) {
+      this->setError("Failed to allocate roaring bitmap");
+      return;
+    }
+    // Values are added in blocks, so an aborted operation stops early.
+    const size_t blockSize = 0x10000;
+    for (size_t offset = 0; offset < buffer.length; offset += blockSize) {
+      if (this->hasError()) {
+        roaring_bitmap_free(result);
+        return;
       }
-      self->invalidate();
+      const size_t remaining = buffer.length - offset;
+      roaring_bitmap_add_many(result, remaining < blockSize ? remaining : blockSize, buffer.data + offset);
     }
-    return true;
+    roaring_bitmap_run_optimize(result);
+    roaring_bitmap_shrink_to_fit(result);
+    this->bitmap = result;
   }
 
-  v8::Local<v8::Value> argv[] = {arg};
-  auto tMaybe =
-    JSTypes::Uint32Array_from.Get(isolate)->Call(isolate->GetCurrentContext(), JSTypes::Uint32Array.Get(isolate), 1, argv);
-  v8::Local<v8::Value> t;
-  if (!tMaybe.ToLocal(&t)) return false;
+  void scan(uint32_t slice) {
+    const uint32_t * data = buffer.data;
+    const size_t begin = this->sliceBegin(slice);
+    const size_t end = this->sliceBegin(slice + 1);
+    uint32_t * sliceCounts = this->counts + (size_t)slice * FROM_ARRAY_PARTITIONS;
+    bool sorted = begin == 0 || end == begin || data[begin - 1] <= data[begin];
+    uint32_t prev = begin < end ? data[begin] : 0;
+    for (size_t i = begin; i != end; ++i) {
+      const uint32_t v = data[i];
+      sorted = sorted && prev <= v;
+      prev = v;
+      ++sliceCounts[v >> FROM_ARRAY_PARTITION_SHIFT];
+    }
+    this->slicesSorted[slice] = sorted;
+  }
 
-  const v8utils::TypedArrayContent<uint32_t> typedArray(t);
-  if (replace) {
-    roaring_bitmap_clear(self->roaring);
+  bool afterScan() {
+    bool sorted = true;
+    for (uint32_t s = 0; s != slicesCount; ++s) {
+      sorted = sorted && slicesSorted[s];
+    }
+
+    size_t offset = 0;
+    for (uint32_t p = 0; p != FROM_ARRAY_PARTITIONS; ++p) {
+      partitionOffsets[p] = offset;
+      for (uint32_t s = 0; s != slicesCount; ++s) {
+        uint32_t & count = counts[(size_t)s * FROM_ARRAY_PARTITIONS + p];
+        const uint32_t c = count;
+        // From now on, counts contains the position where each slice writes the values of each partition.
+        count = (uint32_t)offset;
+        offset += c;
+      }
+    }
+    partitionOffsets[FROM_ARRAY_PARTITIONS] = offset;
+
+    if (sorted) {
+      // A sorted array is already grouped by partition.
+      this->source = buffer.data;
+      return this->startBuild();
+    }
+
+    this->partitioned = (uint32_t *)malloc(buffer.length * sizeof(uint32_t));
+    if (this->partitioned == nullptr) {
+      this->setError("Failed to allocate memory");
+      return false;
+    }
+    this->source = this->partitioned;
+    this->phase = phaseScatter;
+    this->loopCount = slicesCount;
+    return true;
   }
-  roaring_bitmap_add_many(self->roaring, typedArray.length, typedArray.data);
-  self->invalidate();
-  return true;
-}
 
-void RoaringBitmap32::copyFrom(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = info.GetIsolate();
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  if (info.Length() == 0 || !roaringAddMany(isolate, self, info[0], true)) {
-    return v8utils::throwError(
-      isolate, "RoaringBitmap32::copyFrom expects a RoaringBitmap32, an Uint32Array or an Iterable");
+  void scatter(uint32_t slice) {
+    const uint32_t * data = buffer.data;
+    const size_t end = this->sliceBegin(slice + 1);
+    uint32_t * positions = this->counts + (size_t)slice * FROM_ARRAY_PARTITIONS;
+    uint32_t * output = this->partitioned;
+    for (size_t i = this->sliceBegin(slice); i != end; ++i) {
+      const uint32_t v = data[i];
+      output[positions[v >> FROM_ARRAY_PARTITION_SHIFT]++] = v;
+    }
   }
-  self->invalidate();
-  info.GetReturnValue().Set(info.Holder());
-}
 
-void RoaringBitmap32::addMany(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  auto isolate = info.GetIsolate();
-  if (info.Length() > 0) {
-    RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-    self->invalidate();
-    if (roaringAddMany(isolate, self, info[0])) {
-      return info.GetReturnValue().Set(info.Holder());
+  bool startBuild() {
+    uint32_t n = 0;
+    for (uint32_t p = 0; p != FROM_ARRAY_PARTITIONS; ++p) {
+      if (partitionOffsets[p + 1] != partitionOffsets[p]) {
+        partitions[n++] = p;
+      }
+    }
+    this->partitionBitmaps = new roaring_bitmap_t *[n == 0 ? 1 : n]();
+    if (this->partitionBitmaps == nullptr) {
+      this->setError("Failed to allocate memory");
+      return false;
     }
+    this->partitionsCount = n;
+    this->phase = phaseBuild;
+    this->loopCount = n;
+    return true;
   }
-  v8utils::throwTypeError(isolate, "Uint32Array, RoaringBitmap32 or Iterable<number> expected");
-}
 
-void RoaringBitmap32::add(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  uint32_t v;
-  auto isolate = info.GetIsolate();
-  if (info.Length() < 1 || !info[0]->IsUint32() || !info[0]->Uint32Value(isolate->GetCurrentContext()).To(&v)) {
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::add - 32 bit unsigned integer expected");
+  void buildPartition(uint32_t index) {
+    const uint32_t p = partitions[index];
+    const size_t begin = partitionOffsets[p];
+    roaring_bitmap_t * result = roaring_bitmap_create();
+    if (result == nullptr) {
+      this->setError("Failed to allocate roaring bitmap");
+      return;
+    }
+    roaring_bitmap_add_many(result, partitionOffsets[p + 1] - begin, source + begin);
+    roaring_bitmap_run_optimize(result);
+    roaring_bitmap_shrink_to_fit(result);
+    partitionBitmaps[index] = result;
   }
 
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  roaring_bitmap_add(self->roaring, v);
-  self->invalidate();
-  info.GetReturnValue().Set(info.Holder());
-}
+  void concatenate() {
+    int32_t containersCount = 0;
+    for (uint32_t i = 0; i != partitionsCount; ++i) {
+      containersCount += partitionBitmaps[i]->high_low_container.size;
+    }
+    roaring_bitmap_t * result = roaring_bitmap_create_with_capacity((uint32_t)containersCount);
+    if (result == nullptr) {
+      this->setError("Failed to allocate roaring bitmap");
+      return;
+    }
+    for (uint32_t i = 0; i != partitionsCount; ++i) {
+      roaring_bitmap_t * part = partitionBitmaps[i];
+      ra_append_move_range(&result->high_low_container, &part->high_low_container, 0, part->high_low_container.size);
+      ra_clear_without_containers(&part->high_low_container);
+      roaring_free(part);
+      partitionBitmaps[i] = nullptr;
+    }
+    this->bitmap = result;
+    this->freePartitions();
+  }
 
-void RoaringBitmap32::tryAdd(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  uint32_t v;
-  if (info.Length() < 1 || !info[0]->IsUint32() || !info[0]->Uint32Value(info.GetIsolate()->GetCurrentContext()).To(&v)) {
-    return info.GetReturnValue().Set(false);
+  void freePartitions() {
+    delete[] this->counts;
+    this->counts = nullptr;
+    delete[] this->slicesSorted;
+    this->slicesSorted = nullptr;
+    delete[] this->partitionOffsets;
+    this->partitionOffsets = nullptr;
+    delete[] this->partitions;
+    this->partitions = nullptr;
+    free(this->partitioned);
+    this->partitioned = nullptr;
+    if (this->partitionBitmaps != nullptr) {
+      for (uint32_t i = 0; i != this->partitionsCount; ++i) {
+        if (this->partitionBitmaps[i] != nullptr) {
+          roaring_bitmap_free(this->partitionBitmaps[i]);
+        }
+      }
+      delete[] this->partitionBitmaps;
+      this->partitionBitmaps = nullptr;
+    }
   }
+};
 
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  bool result = roaring_bitmap_add_checked(self->roaring, v);
-  if (result) self->invalidate();
-  info.GetReturnValue().Set(result);
-}
+void RoaringBitmap32::fromArrayStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = v8::Isolate::GetCurrent();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
 
-void RoaringBitmap32::removeMany(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  bool done = false;
-  v8::Isolate * isolate = info.GetIsolate();
+  v8::Local<v8::Value> arg;
 
-  if (info.Length() > 0) {
-    auto const & arg = info[0];
-    RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
+  if (info.Length() >= 1) {
+    arg = info[0];
+  }
+
+  auto * worker = new FromArrayAsyncWorker(addonData);
+  if (worker == nullptr) {
+    return v8utils::throwError(isolate, "Failed to allocate async worker");
+  }
 
+  if (!arg->IsNullOrUndefined() && !arg->IsFunction()) {
     if (arg->IsUint32Array() || arg->IsInt32Array()) {
+      worker->buffer.set(arg);
       const v8utils::TypedArrayContent<uint32_t> typedArray(arg);
-      roaring_bitmap_remove_many(self->roaring, typedArray.length, typedArray.data);
-      self->invalidate();
-      done = true;
-    } else {
-      RoaringBitmap32 * other =
-        v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(arg, RoaringBitmap32::constructorTemplate, isolate);
-      if (other != nullptr) {
-        roaring_bitmap_andnot_inplace(self->roaring, other->roaring);
-        self->invalidate();
-        done = true;
-      } else {
-        v8::Local<v8::Value> argv[] = {arg};
-        auto tMaybe = JSTypes::Uint32Array_from.Get(isolate)->Call(
-          isolate->GetCurrentContext(), JSTypes::Uint32Array.Get(isolate), 1, argv);
-        v8::Local<v8::Value> t;
-        if (tMaybe.ToLocal(&t)) {
-          const v8utils::TypedArrayContent<uint32_t> typedArray(t);
-          roaring_bitmap_remove_many(self->roaring, typedArray.length, typedArray.data);
-          self->invalidate();
-          done = true;
-        } else {
-          RoaringBitmap32 tmp(0);
-          if (roaringAddMany(isolate, &tmp, arg)) {
-            roaring_bitmap_andnot_inplace(self->roaring, tmp.roaring);
-            self->invalidate();
-            done = true;
-          }
-        }
+    } else if (arg->IsObject()) {
+      if (addonData->RoaringBitmap32_constructorTemplate.Get(isolate)->HasInstance(arg)) {
+        return v8utils::throwTypeError(
+          isolate, "RoaringBitmap32::fromArrayAsync cannot be called with a RoaringBitmap32 instance");
+      }
+      v8::Local<v8::Value> argv[] = {arg};
+      auto carg = addonData->Uint32Array_from.Get(isolate)->Call(
+        isolate->GetCurrentContext(), addonData->Uint32Array.Get(isolate), 1, argv);
+      v8::Local<v8::Value> local;
+      if (carg.ToLocal(&local)) {
+        worker->buffer.set(local);
       }
     }
+
+    worker->argPersistent.Reset(isolate, arg);
   }
 
-  if (done) {
-    info.GetReturnValue().Set(info.Holder());
-  } else {
-    v8utils::throwTypeError(isolate, "Uint32Array, RoaringBitmap32 or Iterable<number> expected");
+  if (info.Length() >= 1 && info[0]->IsFunction()) {
+    worker->setCallback(info[0]);
+  } else if (!setAsyncOptionsAndCallback(info, 1, "RoaringBitmap32::fromArrayAsync", worker, worker)) {
+    delete worker;
+    return;
   }
-}
 
-void RoaringBitmap32::andInPlace(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = info.GetIsolate();
-  if (info.Length() > 0) {
-    auto const & arg = info[0];
-    RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-    RoaringBitmap32 * other =
-      v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(arg, RoaringBitmap32::constructorTemplate, isolate);
-    if (other != nullptr) {
-      roaring_bitmap_and_inplace(self->roaring, other->roaring);
-      self->invalidate();
-      return info.GetReturnValue().Set(info.Holder());
-    } else {
-      RoaringBitmap32 tmp(0);
-      if (roaringAddMany(isolate, &tmp, arg)) {
-        roaring_bitmap_and_inplace(self->roaring, tmp.roaring);
-        self->invalidate();
-        return info.GetReturnValue().Set(info.Holder());
-      }
-    }
+  if (!worker->prepare()) {
+    delete worker;
+    return v8utils::throwError(isolate, "RoaringBitmap32::fromArrayAsync - failed to allocate");
   }
 
-  return v8utils::throwTypeError(isolate, "Uint32Array, RoaringBitmap32 or Iterable<number> expected");
+  v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
+  info.GetReturnValue().Set(returnValue);
 }
 
-void RoaringBitmap32::xorInPlace(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = info.GetIsolate();
-  if (info.Length() > 0) {
-    auto const & arg = info[0];
-    RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-    RoaringBitmap32 * other =
-      v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(arg, RoaringBitmap32::constructorTemplate, isolate);
-    if (other != nullptr) {
-      roaring_bitmap_xor_inplace(self->roaring, other->roaring);
-      self->invalidate();
-      return info.GetReturnValue().Set(info.Holder());
-    } else {
-      RoaringBitmap32 tmp(0);
-      roaringAddMany(info.GetIsolate(), &tmp, arg);
-      roaring_bitmap_xor_inplace(self->roaring, tmp.roaring);
-      self->invalidate();
-      return info.GetReturnValue().Set(info.Holder());
-    }
-  }
+////////////// RoaringBitmap32BufferedIterator //////////////
 
-  return v8utils::throwTypeError(isolate, "Uint32Array, RoaringBitmap32 or Iterable<number> expected");
-}
 
-void RoaringBitmap32::remove(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  uint32_t v;
-  if (info.Length() >= 1 && info[0]->IsUint32() && info[0]->Uint32Value(info.GetIsolate()->GetCurrentContext()).To(&v)) {
-    RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-    roaring_bitmap_remove(self->roaring, v);
-    self->invalidate();
-  }
+RoaringBitmap32BufferedIterator::RoaringBitmap32BufferedIterator() : bitmapInstance(nullptr), snapshot(nullptr) {
+  this->it.parent = nullptr;
+  this->it.has_value = false;
 }
 
-void RoaringBitmap32::removeChecked(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  uint32_t v;
-  if (info.Length() < 1 || !info[0]->IsUint32() || !info[0]->Uint32Value(info.GetIsolate()->GetCurrentContext()).To(&v)) {
-    return info.GetReturnValue().Set(false);
-  }
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  bool result = roaring_bitmap_remove_checked(self->roaring, v);
-  if (result) {
-    self->invalidate();
+void RoaringBitmap32BufferedIterator::releaseSnapshot() {
+  if (this->snapshot != nullptr) {
+    roaring_bitmap_free(this->snapshot);
+    this->snapshot = nullptr;
   }
-  info.GetReturnValue().Set(result);
 }
 
-void RoaringBitmap32::clear(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-  if (self->roaring && self->roaring->high_low_container.size == 0) {
-    info.GetReturnValue().Set(false);
-  } else {
-    if (self->roaring != nullptr) {
-      roaring_bitmap_clear(self->roaring);
-      roaring_bitmap_shrink_to_fit(self->roaring);
-      self->updateAmountOfExternalAllocatedMemory(info.GetIsolate(), 0);
-      self->invalidate();
-    }
-    info.GetReturnValue().Set(true);
+void RoaringBitmap32BufferedIterator::destroy() {
+  this->releaseSnapshot();
+  this->bitmap.Reset();
+  this->buffer.Reset();
+  if (!persistent.IsEmpty()) {
+    persistent.ClearWeak();
+    persistent.Reset();
   }
 }
 
-inline static bool getRangeOperationParameters(
-  const v8::FunctionCallbackInfo<v8::Value> & info, uint64_t & minInteger, uint64_t & maxInteger) {
-  if (info.Length() < 2 || !info[0]->IsNumber() || !info[1]->IsNumber()) {
-    return false;
+RoaringBitmap32BufferedIterator::~RoaringBitmap32BufferedIterator() { this->destroy(); }
+
+void RoaringBitmap32BufferedIterator::Init(v8::Local<v8::Object> exports, AddonData * addonData) {
+  v8::Isolate * isolate = addonData->isolate;
+  v8::HandleScope scope(isolate);
+
+  auto stringN = NEW_LITERAL_V8_STRING(isolate, "n", v8::NewStringType::kInternalized);
+  auto className = NEW_LITERAL_V8_STRING(isolate, "RoaringBitmap32BufferedIterator", v8::NewStringType::kInternalized);
+
+  addonData->RoaringBitmap32BufferedIterator_nPropertyName.Reset(isolate, stringN);
+
+  v8::Local<v8::FunctionTemplate> ctor = v8::FunctionTemplate::New(isolate, New, addonData->external.Get(isolate));
+
+  ctor->SetClassName(className);
+  ctor->InstanceTemplate()->SetInternalFieldCount(1);
+
+  addonData->RoaringBitmap32BufferedIterator_constructorTemplate.Reset(isolate, ctor);
+
+  addonData->setPrototypeMethod(ctor, "fill", fill);
+
+  auto ctorFunctionMaybe = ctor->GetFunction(isolate->GetCurrentContext());
+  v8::Local<v8::Function> ctorFunction;
+
+  if (!ctorFunctionMaybe.ToLocal(&ctorFunction)) {
+    return v8utils::throwError(isolate, "Failed to instantiate RoaringBitmap32BufferedIterator");
   }
 
+  addonData->RoaringBitmap32BufferedIterator_constructor.Reset(isolate, ctorFunction);
+  v8utils::defineHiddenField(isolate, exports, "RoaringBitmap32BufferedIterator", ctorFunction);
+}
+
+void RoaringBitmap32BufferedIterator::New(const v8::FunctionCallbackInfo<v8::Value> & info) {
   v8::Isolate * isolate = info.GetIsolate();
-  double minimum, maximum;
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
 
-  if (!info[0]->NumberValue(isolate->GetCurrentContext()).To(&minimum) || std::isnan(minimum)) {
-    return false;
+  if (!info.IsConstructCall()) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32BufferedIterator::ctor - needs to be called with new");
   }
 
-  if (!info[1]->NumberValue(isolate->GetCurrentContext()).To(&maximum) || std::isnan(maximum)) {
-    return false;
+  auto holder = info.Holder();
+
+  if (info.Length() < 2) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32BufferedIterator::ctor - needs two arguments");
   }
 
-  if (minimum < 0) {
-    minimum = 0;
+  RoaringBitmap32 * bitmapInstance =
+    v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], addonData->RoaringBitmap32_constructorTemplate, isolate);
+  if (bitmapInstance == nullptr) {
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32BufferedIterator::ctor - first argument must be of type RoaringBitmap32");
   }
 
-  if (maximum < 0) {
-    maximum = 0;
-  } else if (maximum > 4294967296) {
-    maximum = 4294967296;
+  auto bufferObject = info[1];
+
+  if (!bufferObject->IsUint32Array()) {
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32BufferedIterator::ctor - second argument must be of type Uint32Array");
   }
 
-  minInteger = (uint64_t)minimum;
-  maxInteger = (uint64_t)maximum;
+  const v8utils::TypedArrayContent<uint32_t> bufferContent(bufferObject);
+  if (!bufferContent.data || bufferContent.length < 1) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32BufferedIterator::ctor - invalid Uint32Array buffer");
+  }
 
-  return minInteger < maxInteger;
-}
+  auto * instance = new RoaringBitmap32BufferedIterator();
+  if (instance == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32BufferedIterator::ctor - allocation failed");
+  }
 
-void RoaringBitmap32::rangeCardinality(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  uint64_t minInteger, maxInteger;
-  if (getRangeOperationParameters(info, minInteger, maxInteger)) {
-    RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-    auto card = roaring_bitmap_range_cardinality(self->roaring, minInteger, maxInteger);
-    if (card <= 0xFFFFFFFF) {
-      return info.GetReturnValue().Set((uint32_t)card);
+  holder->SetAlignedPointerInInternalField(0, instance);
+  instance->persistent.Reset(isolate, holder);
+  instance->persistent.SetWeak(instance, WeakCallback, v8::WeakCallbackType::kParameter);
+
+  auto context = isolate->GetCurrentContext();
+
+  const roaring_bitmap_t * iterated = bitmapInstance->roaring;
+  if (info.Length() > 2 && info[2]->IsTrue()) {
+    instance->snapshot = roaringBitmapSnapshot(bitmapInstance->roaring);
+    if (instance->snapshot == nullptr) {
+      return v8utils::throwError(isolate, "RoaringBitmap32BufferedIterator::ctor - allocation failed");
     }
-    return info.GetReturnValue().Set((double)card);
+    iterated = instance->snapshot;
   }
-  return info.GetReturnValue().Set(0u);
-}
 
-void RoaringBitmap32::flipRange(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  uint64_t minInteger, maxInteger;
-  if (getRangeOperationParameters(info, minInteger, maxInteger)) {
-    RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-    if (self != nullptr) {
-      roaring_bitmap_flip_inplace(self->roaring, minInteger, maxInteger);
-      self->invalidate();
+  roaring_init_iterator(iterated, &instance->it);
+
+  uint32_t n = roaring_read_uint32_iterator(&instance->it, bufferContent.data, bufferContent.length);
+  if (n != 0) {
+    instance->bitmapInstance = bitmapInstance;
+    instance->bitmapVersion = bitmapInstance->version;
+
+    auto a0Maybe = info[0]->ToObject(context);
+    v8::Local<v8::Object> a0;
+    if (!a0Maybe.ToLocal(&a0)) {
+      return v8utils::throwError(isolate, "RoaringBitmap32BufferedIterator::ctor - allocation failed");
     }
-  }
-  info.GetReturnValue().Set(info.Holder());
-}
+    instance->bitmap.Reset(isolate, a0);
 
-void RoaringBitmap32::addRange(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  uint64_t minInteger, maxInteger;
-  if (getRangeOperationParameters(info, minInteger, maxInteger)) {
-    RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-    if (self != nullptr) {
-      roaring_bitmap_add_range_closed(self->roaring, (uint32_t)minInteger, (uint32_t)(maxInteger - 1));
-      self->invalidate();
+    auto a1Maybe = bufferObject->ToObject(context);
+    v8::Local<v8::Object> a1;
+    if (!a1Maybe.ToLocal(&a1)) {
+      return v8utils::throwError(isolate, "RoaringBitmap32BufferedIterator::ctor - allocation failed");
     }
+    instance->buffer.Reset(isolate, a1);
+
+    instance->bufferContent.set(bufferObject);
+  } else {
+    instance->bitmapInstance = nullptr;
+    instance->releaseSnapshot();
   }
-  info.GetReturnValue().Set(info.Holder());
-}
 
-void RoaringBitmap32::removeRange(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  uint64_t minInteger, maxInteger;
-  if (getRangeOperationParameters(info, minInteger, maxInteger)) {
-    RoaringBitmap32 * self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(info.Holder());
-    if (self != nullptr) {
-      roaring_bitmap_remove_range_closed(self->roaring, (uint32_t)minInteger, (uint32_t)(maxInteger - 1));
-      self->invalidate();
-    }
+  if (holder->Set(context, addonData->RoaringBitmap32BufferedIterator_nPropertyName.Get(isolate), v8::Uint32::NewFromUnsigned(isolate, n)).IsNothing()) {
+    return v8utils::throwError(isolate, "RoaringBitmap32BufferedIterator::ctor - instantiation failed");
   }
-  info.GetReturnValue().Set(info.Holder());
+
+  info.GetReturnValue().Set(holder);
+  isolate->AdjustAmountOfExternalAllocatedMemory(RoaringBitmap32BufferedIterator::allocatedMemoryDelta);
 }
 
-void RoaringBitmap32::swapStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+void RoaringBitmap32BufferedIterator::fill(const v8::FunctionCallbackInfo<v8::Value> & info) {
   v8::Isolate * isolate = info.GetIsolate();
-  if (info.Length() < 2) return v8utils::throwTypeError(isolate, "RoaringBitmap32::swap expects 2 arguments");
+  v8::HandleScope scope(isolate);
 
-  auto constructorTemplate = RoaringBitmap32::constructorTemplate.Get(isolate);
+  RoaringBitmap32BufferedIterator * instance = v8utils::ObjectWrap::Unwrap<RoaringBitmap32BufferedIterator>(info.Holder());
 
-  RoaringBitmap32 * a = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], constructorTemplate, isolate);
-  if (a == nullptr)
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::swap first argument must be a RoaringBitmap32");
+  RoaringBitmap32 * bitmapInstance = instance->bitmapInstance;
 
-  RoaringBitmap32 * b = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[1], constructorTemplate, isolate);
-  if (b == nullptr)
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::swap second argument must be a RoaringBitmap32");
+  if (bitmapInstance == nullptr) {
+    return info.GetReturnValue().Set(0U);
+  }
 
-  if (a != b) {
-    auto * t = a->roaring;
-    a->roaring = b->roaring;
-    b->roaring = t;
-    a->invalidate();
-    b->invalidate();
+  if (instance->snapshot == nullptr && bitmapInstance->version != instance->bitmapVersion) {
+    return v8utils::throwError(isolate, "RoaringBitmap32 iterator - bitmap changed while iterating");
+  }
+
+  uint32_t n = roaring_read_uint32_iterator(&instance->it, instance->bufferContent.data, instance->bufferContent.length);
+  if (n == 0) {
+    instance->bitmapInstance = nullptr;
+    instance->releaseSnapshot();
+    instance->bufferContent.reset();
+    instance->bitmap.Reset();
+    instance->buffer.Reset();
   }
+
+  info.GetReturnValue().Set(n);
 }
 
-void RoaringBitmap32::andStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = info.GetIsolate();
-  v8::HandleScope scope(isolate);
+void RoaringBitmap32BufferedIterator::WeakCallback(v8::WeakCallbackInfo<RoaringBitmap32BufferedIterator> const & info) {
+  RoaringBitmap32BufferedIterator * p = info.GetParameter();
+  if (p != nullptr) {
+    info.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(-RoaringBitmap32BufferedIterator::allocatedMemoryDelta);
+    delete p;
+  }
+}
+
+////////////// RoaringBitmap32ChunkedSerializer //////////////
+
+
+RoaringBitmap32ChunkedSerializer::RoaringBitmap32ChunkedSerializer() :
+  bitmapVersion(0),
+  bitmapInstance(nullptr),
+  allocationFailed(false),
+  phase(phaseDone),
+  index(0),
+  hasRun(false),
+  containerOffset(0),
+  pending(nullptr),
+  pendingLength(0),
+  pendingPosition(0),
+  scratch(nullptr),
+  scratchCapacity(0) {}
+
+void RoaringBitmap32ChunkedSerializer::destroy() {
+  this->bitmapInstance = nullptr;
+  this->bitmap.Reset();
+  this->pending = nullptr;
+  this->pendingLength = 0;
+  this->pendingPosition = 0;
+  if (this->scratch != nullptr) {
+    free(this->scratch);
+    this->scratch = nullptr;
+    this->scratchCapacity = 0;
+  }
+}
 
-  auto constructorTemplate = RoaringBitmap32::constructorTemplate.Get(isolate);
+RoaringBitmap32ChunkedSerializer::~RoaringBitmap32ChunkedSerializer() {
+  this->destroy();
+  if (!persistent.IsEmpty()) {
+    persistent.ClearWeak();
+    persistent.Reset();
+  }
+}
 
-  if (info.Length() < 2) return v8utils::throwTypeError(isolate, "RoaringBitmap32::and expects 2 arguments");
+void RoaringBitmap32ChunkedSerializer::Init(v8::Local<v8::Object> exports, AddonData * addonData) {
+  v8::Isolate * isolate = addonData->isolate;
+  v8::HandleScope scope(isolate);
 
-  RoaringBitmap32 * a = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], constructorTemplate, isolate);
-  if (a == nullptr) return v8utils::throwTypeError(isolate, "RoaringBitmap32::and first argument must be a RoaringBitmap32");
+  auto className = NEW_LITERAL_V8_STRING(isolate, "RoaringBitmap32ChunkedSerializer", v8::NewStringType::kInternalized);
 
-  RoaringBitmap32 * b = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[1], constructorTemplate, isolate);
-  if (b == nullptr)
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::and second argument must be a RoaringBitmap32");
+  v8::Local<v8::FunctionTemplate> ctor = v8::FunctionTemplate::New(isolate, New, addonData->external.Get(isolate));
+
+  ctor->SetClassName(className);
+  ctor->InstanceTemplate()->SetInternalFieldCount(1);
 
-  v8::Local<v8::Function> cons = constructor.Get(isolate);
+  addonData->RoaringBitmap32ChunkedSerializer_constructorTemplate.Reset(isolate, ctor);
 
-  auto resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
-  v8::Local<v8::Object> result;
-  if (!resultMaybe.ToLocal(&result)) {
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::and failed to create new instance");
-  }
+  addonData->setPrototypeMethod(ctor, "fill", fill);
 
-  auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+  auto ctorFunctionMaybe = ctor->GetFunction(isolate->GetCurrentContext());
+  v8::Local<v8::Function> ctorFunction;
 
-  roaring_bitmap_t * r = roaring_bitmap_and(a->roaring, b->roaring);
-  if (r == nullptr) {
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::and failed materalization");
+  if (!ctorFunctionMaybe.ToLocal(&ctorFunction)) {
+    return v8utils::throwError(isolate, "Failed to instantiate RoaringBitmap32ChunkedSerializer");
   }
 
-  self->replaceBitmapInstance(isolate, r);
-
-  info.GetReturnValue().Set(result);
+  addonData->RoaringBitmap32ChunkedSerializer_constructor.Reset(isolate, ctorFunction);
+  v8utils::defineHiddenField(isolate, exports, "RoaringBitmap32ChunkedSerializer", ctorFunction);
 }
 
-void RoaringBitmap32::orStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+void RoaringBitmap32ChunkedSerializer::New(const v8::FunctionCallbackInfo<v8::Value> & info) {
   v8::Isolate * isolate = info.GetIsolate();
   v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
 
-  if (info.Length() < 2) return v8utils::throwTypeError(isolate, "RoaringBitmap32::or expects 2 arguments");
-
-  auto constructorTemplate = RoaringBitmap32::constructorTemplate.Get(isolate);
-
-  RoaringBitmap32 * a = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], constructorTemplate, isolate);
-  if (a == nullptr) return v8utils::throwTypeError(isolate, "RoaringBitmap32::or first argument must be a RoaringBitmap32");
+  if (!info.IsConstructCall()) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32ChunkedSerializer::ctor - needs to be called with new");
+  }
 
-  RoaringBitmap32 * b = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[1], constructorTemplate, isolate);
-  if (b == nullptr) return v8utils::throwTypeError(isolate, "RoaringBitmap32::or second argument must be a RoaringBitmap32");
+  if (info.Length() < 1) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32ChunkedSerializer::ctor - needs one argument");
+  }
 
-  v8::Local<v8::Function> cons = constructor.Get(isolate);
+  RoaringBitmap32 * bitmapInstance =
+    v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], addonData->RoaringBitmap32_constructorTemplate, isolate);
+  if (bitmapInstance == nullptr) {
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32ChunkedSerializer::ctor - first argument must be of type RoaringBitmap32");
+  }
 
-  auto resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
-  v8::Local<v8::Object> result;
-  if (!resultMaybe.ToLocal(&result)) return;
+  v8::Local<v8::Object> bitmapObject;
+  if (!info[0]->ToObject(isolate->GetCurrentContext()).ToLocal(&bitmapObject)) {
+    return v8utils::throwError(isolate, "RoaringBitmap32ChunkedSerializer::ctor - allocation failed");
+  }
 
-  auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+  auto * instance = new RoaringBitmap32ChunkedSerializer();
+  if (instance == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32ChunkedSerializer::ctor - allocation failed");
+  }
 
-  roaring_bitmap_t * r = roaring_bitmap_or(a->roaring, b->roaring);
-  if (r == nullptr) return v8utils::throwTypeError(isolate, "RoaringBitmap32::or failed materalization");
+  auto holder = info.Holder();
+  holder->SetAlignedPointerInInternalField(0, instance);
+  instance->persistent.Reset(isolate, holder);
+  instance->persistent.SetWeak(instance, WeakCallback, v8::WeakCallbackType::kParameter);
 
-  self->replaceBitmapInstance(isolate, r);
+  instance->bitmapInstance = bitmapInstance;
+  instance->bitmapVersion = bitmapInstance->version;
+  instance->bitmap.Reset(isolate, bitmapObject);
+  instance->start(&bitmapInstance->roaring->high_low_container);
 
-  info.GetReturnValue().Set(result);
+  info.GetReturnValue().Set(holder);
+  isolate->AdjustAmountOfExternalAllocatedMemory(RoaringBitmap32ChunkedSerializer::allocatedMemoryDelta);
 }
 
-void RoaringBitmap32::xorStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+void RoaringBitmap32ChunkedSerializer::fill(const v8::FunctionCallbackInfo<v8::Value> & info) {
   v8::Isolate * isolate = info.GetIsolate();
   v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
 
-  if (info.Length() < 2) return v8utils::throwTypeError(isolate, "RoaringBitmap32::xor expects 2 arguments");
-
-  auto constructorTemplate = RoaringBitmap32::constructorTemplate.Get(isolate);
+  RoaringBitmap32ChunkedSerializer * instance =
+    v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32ChunkedSerializer>(info.Holder(), addonData->RoaringBitmap32ChunkedSerializer_constructorTemplate, isolate);
+  if (instance == nullptr) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32ChunkedSerializer::fill - invalid instance");
+  }
 
-  RoaringBitmap32 * a = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], constructorTemplate, isolate);
-  if (a == nullptr) return v8utils::throwTypeError(isolate, "RoaringBitmap32::xor first argument must be a RoaringBitmap32");
+  if (info.Length() < 1 || (!info[0]->IsUint8Array() && !info[0]->IsInt8Array() && !info[0]->IsUint8ClampedArray())) {
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32ChunkedSerializer::fill - argument must be of type Uint8Array or Buffer");
+  }
 
-  RoaringBitmap32 * b = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[1], constructorTemplate, isolate);
-  if (b == nullptr)
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::xor second argument must be a RoaringBitmap32");
+  RoaringBitmap32 * bitmapInstance = instance->bitmapInstance;
+  if (bitmapInstance == nullptr) {
+    return info.GetReturnValue().Set(0U);
+  }
 
-  v8::Local<v8::Function> cons = constructor.Get(isolate);
+  if (bitmapInstance->version != instance->bitmapVersion) {
+    instance->destroy();
+    return v8utils::throwError(isolate, "RoaringBitmap32 serializeToChunks - bitmap changed while serializing");
+  }
 
-  auto resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
-  v8::Local<v8::Object> result;
-  if (!resultMaybe.ToLocal(&result)) return;
+  const v8utils::TypedArrayContent<uint8_t> output(info[0]);
+  if (!output.data || output.length < 1) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32ChunkedSerializer::fill - buffer cannot be empty");
+  }
 
-  auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+  size_t n = instance->write(&bitmapInstance->roaring->high_low_container, (char *)output.data, output.length);
+  if (instance->allocationFailed) {
+    instance->destroy();
+    return v8utils::throwError(isolate, "RoaringBitmap32 serializeToChunks - failed to allocate memory");
+  }
+  if (instance->phase == phaseDone && instance->pendingPosition >= instance->pendingLength) {
+    instance->destroy();
+  }
 
-  roaring_bitmap_t * r = roaring_bitmap_xor(a->roaring, b->roaring);
-  if (r == nullptr) return v8utils::throwTypeError(isolate, "RoaringBitmap32::xor failed materalization");
+  info.GetReturnValue().Set((double)n);
+}
 
-  self->replaceBitmapInstance(isolate, r);
+void RoaringBitmap32ChunkedSerializer::start(const roaring_array_t * ra) {
+  this->phase = phaseCookie;
+  this->index = 0;
+  this->hasRun = ra_has_run_container(ra);
+  if (this->hasRun) {
+    const uint32_t s = (ra->size + 7) / 8;
+    this->containerOffset = ra->size < NO_OFFSET_THRESHOLD ? 4 + 4 * ra->size + s : 4 + 8 * ra->size + s;
+  } else {
+    this->containerOffset = 4 + 4 + 8 * ra->size;
+  }
+}
 
-  info.GetReturnValue().Set(result);
+size_t RoaringBitmap32ChunkedSerializer::write(const roaring_array_t * ra, char * output, size_t length) {
+  size_t written = 0;
+  while (written < length) {
+    if (this->pendingPosition < this->pendingLength) {
+      size_t n = this->pendingLength - this->pendingPosition;
+      if (n > length - written) {
+        n = length - written;
+      }
+      memcpy(output + written, this->pending + this->pendingPosition, n);
+      this->pendingPosition += (uint32_t)n;
+      written += n;
+    } else if (this->phase == phaseDone) {
+      break;
+    } else {
+      written += this->nextItem(ra, output + written, length - written);
+    }
+  }
+  return written;
 }
 
-void RoaringBitmap32::andNotStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = info.GetIsolate();
-  v8::HandleScope scope(isolate);
+uint32_t RoaringBitmap32ChunkedSerializer::nextItem(const roaring_array_t * ra, char * output, size_t length) {
+  // Produces the next header field or container.
+  // If it fits in the output is written directly, otherwise is kept pending and 0 is returned.
+  uint32_t size = 0;
+  for (;;) {
+    switch (this->phase) {
+      case phaseCookie:
+        if (this->hasRun) {
+          uint32_t cookie = SERIAL_COOKIE | ((uint32_t)(ra->size - 1) << 16);
+          memcpy(this->small, &cookie, sizeof(cookie));
+          size = sizeof(cookie);
+          this->phase = phaseRunBitmap;
+        } else {
+          uint32_t cookie = SERIAL_COOKIE_NO_RUNCONTAINER;
+          memcpy(this->small, &cookie, sizeof(cookie));
+          memcpy(this->small + sizeof(cookie), &ra->size, sizeof(ra->size));
+          size = sizeof(cookie) + sizeof(ra->size);
+          this->phase = phaseKeys;
+        }
+        this->index = 0;
+        break;
+
+      case phaseRunBitmap: {
+        if (this->index >= (ra->size + 7) / 8) {
+          this->phase = phaseKeys;
+          this->index = 0;
+          continue;
+        }
+        uint8_t runBits = 0;
+        const int32_t first = this->index * 8;
+        for (int32_t i = first; i < first + 8 && i < ra->size; ++i) {
+          if (get_container_type(ra->containers[i], ra->typecodes[i]) == RUN_CONTAINER_TYPE) {
+            runBits |= (uint8_t)(1 << (i - first));
+          }
+        }
+        this->small[0] = (char)runBits;
+        size = 1;
+        ++this->index;
+        break;
+      }
 
-  if (info.Length() < 2) return v8utils::throwTypeError(isolate, "RoaringBitmap32::andnot expects 2 arguments");
+      case phaseKeys: {
+        if (this->index >= ra->size) {
+          this->phase = (!this->hasRun || ra->size >= NO_OFFSET_THRESHOLD) ? phaseOffsets : phaseContainers;
+          this->index = 0;
+          continue;
+        }
+        const int32_t k = this->index++;
+        uint16_t card = (uint16_t)(container_get_cardinality(ra->containers[k], ra->typecodes[k]) - 1);
+        memcpy(this->small, &ra->keys[k], sizeof(ra->keys[k]));
+        memcpy(this->small + sizeof(ra->keys[k]), &card, sizeof(card));
+        size = sizeof(ra->keys[k]) + sizeof(card);
+        break;
+      }
 
-  auto constructorTemplate = RoaringBitmap32::constructorTemplate.Get(isolate);
+      case phaseOffsets: {
+        if (this->index >= ra->size) {
+          this->phase = phaseContainers;
+          this->index = 0;
+          continue;
+        }
+        const int32_t k = this->index++;
+        memcpy(this->small, &this->containerOffset, sizeof(this->containerOffset));
+        size = sizeof(this->containerOffset);
+        this->containerOffset += container_size_in_bytes(ra->containers[k], ra->typecodes[k]);
+        break;
+      }
 
-  RoaringBitmap32 * a = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], constructorTemplate, isolate);
-  if (a == nullptr)
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::andnot first argument must be a RoaringBitmap32");
+      case phaseContainers: {
+        if (this->index >= ra->size) {
+          this->phase = phaseDone;
+          continue;
+        }
+        const int32_t k = this->index++;
+        size = (uint32_t)container_size_in_bytes(ra->containers[k], ra->typecodes[k]);
+        if (size <= length) {
+          return (uint32_t)container_write(ra->containers[k], ra->typecodes[k], output);
+        }
+        if (size > this->scratchCapacity) {
+          char * newScratch = (char *)realloc(this->scratch, size);
+          if (newScratch == nullptr) {
+            this->allocationFailed = true;
+            this->phase = phaseDone;
+            return 0;
+          }
+          this->scratch = newScratch;
+          this->scratchCapacity = size;
+        }
+        this->pending = this->scratch;
+        this->pendingLength = (uint32_t)container_write(ra->containers[k], ra->typecodes[k], this->scratch);
+        this->pendingPosition = 0;
+        return 0;
+      }
 
-  RoaringBitmap32 * b = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[1], constructorTemplate, isolate);
-  if (b == nullptr)
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::andnot second argument must be a RoaringBitmap32");
+      case phaseDone: return 0;
+    }
+    break;
+  }
+
+  if (size <= length) {
+    memcpy(output, this->small, size);
+    return size;
+  }
+  this->pending = this->small;
+  this->pendingLength = size;
+  this->pendingPosition = 0;
+  return 0;
+}
 
-  v8::Local<v8::Function> cons = constructor.Get(isolate);
+void RoaringBitmap32ChunkedSerializer::WeakCallback(v8::WeakCallbackInfo<RoaringBitmap32ChunkedSerializer> const & info) {
+  RoaringBitmap32ChunkedSerializer * p = info.GetParameter();
+  if (p != nullptr) {
+    info.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(-RoaringBitmap32ChunkedSerializer::allocatedMemoryDelta);
+    delete p;
+  }
+}
 
-  auto resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
-  v8::Local<v8::Object> result;
-  if (!resultMaybe.ToLocal(&result)) return;
+////////////// RoaringBitmap32Bundle //////////////
 
-  auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+const char RoaringBitmap32Bundle::magic[4] = {'R', 'B', 'N', 'D'};
 
-  roaring_bitmap_t * r = roaring_bitmap_andnot(a->roaring, b->roaring);
-  if (r == nullptr) {
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32::andnot failed materalization");
-  }
 
-  self->replaceBitmapInstance(isolate, r);
+RoaringBitmap32Bundle::RoaringBitmap32Bundle() : hasChecksums(false) {}
 
-  info.GetReturnValue().Set(result);
+RoaringBitmap32Bundle::~RoaringBitmap32Bundle() {
+  this->buffer.Reset();
+  this->content.reset();
+  if (!persistent.IsEmpty()) {
+    persistent.ClearWeak();
+    persistent.Reset();
+  }
 }
 
-void RoaringBitmap32::fromRangeStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = v8::Isolate::GetCurrent();
+void RoaringBitmap32Bundle::Init(v8::Local<v8::Object> exports, AddonData * addonData) {
+  v8::Isolate * isolate = addonData->isolate;
   v8::HandleScope scope(isolate);
 
-  v8::Local<v8::Function> cons = RoaringBitmap32::constructor.Get(isolate);
+  auto className = NEW_LITERAL_V8_STRING(isolate, "RoaringBitmap32Bundle", v8::NewStringType::kInternalized);
 
-  auto resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
-  v8::Local<v8::Object> result;
-  if (!resultMaybe.ToLocal(&result)) return;
+  v8::Local<v8::FunctionTemplate> ctor = v8::FunctionTemplate::New(isolate, New, addonData->external.Get(isolate));
 
-  uint32_t v;
-  uint32_t step = 1;
-  if (info.Length() >= 3 && info[2]->IsUint32() && info[2]->Uint32Value(isolate->GetCurrentContext()).To(&v)) {
-    step = v;
-    if (step == 0) {
-      step = 1;
-    }
-  }
+  ctor->SetClassName(className);
+  ctor->InstanceTemplate()->SetInternalFieldCount(1);
 
-  auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+  addonData->RoaringBitmap32Bundle_constructorTemplate.Reset(isolate, ctor);
 
-  uint64_t minInteger, maxInteger;
-  if (getRangeOperationParameters(info, minInteger, maxInteger)) {
-    roaring_bitmap_t * r = roaring_bitmap_from_range(minInteger, maxInteger, step);
-    if (r != nullptr) {
-      self->replaceBitmapInstance(isolate, r);
-    }
+  addonData->setPrototypeMethod(ctor, "keys", keys);
+  addonData->setPrototypeMethod(ctor, "has", has);
+  addonData->setPrototypeMethod(ctor, "get", get);
+
+  auto context = isolate->GetCurrentContext();
+  auto ctorFunctionMaybe = ctor->GetFunction(context);
+  v8::Local<v8::Function> ctorFunction;
+
+  if (!ctorFunctionMaybe.ToLocal(&ctorFunction)) {
+    return v8utils::throwError(isolate, "Failed to instantiate RoaringBitmap32Bundle");
   }
 
-  info.GetReturnValue().Set(result);
+  addonData->RoaringBitmap32Bundle_constructor.Reset(isolate, ctorFunction);
+  v8utils::defineHiddenField(isolate, ctorFunction, "default", ctorFunction);
+  v8utils::ignoreMaybeResult(exports->Set(context, className, ctorFunction));
 }
 
-template <typename TSize>
-void RoaringBitmap32_opManyStatic(
-  const char * opName,
-  roaring_bitmap_t * op(TSize number, const roaring_bitmap_t ** x),
-  const v8::FunctionCallbackInfo<v8::Value> & info) {
+void RoaringBitmap32Bundle::New(const v8::FunctionCallbackInfo<v8::Value> & info) {
   v8::Isolate * isolate = info.GetIsolate();
   v8::HandleScope scope(isolate);
 
-  int length = info.Length();
-
-  v8::Local<v8::FunctionTemplate> ctorType = RoaringBitmap32::constructorTemplate.Get(isolate);
-  v8::Local<v8::Function> cons = RoaringBitmap32::constructor.Get(isolate);
+  if (!info.IsConstructCall()) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32Bundle::ctor - needs to be called with new");
+  }
 
-  auto context = isolate->GetCurrentContext();
+  if (info.Length() < 1 || (!info[0]->IsUint8Array() && !info[0]->IsInt8Array() && !info[0]->IsUint8ClampedArray())) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32Bundle::ctor - first argument must be of type Uint8Array or Buffer");
+  }
 
-  if (length == 0) {
-    auto vMaybe = cons->NewInstance(context, 0, nullptr);
-    v8::Local<v8::Object> v;
-    if (vMaybe.ToLocal(&v)) {
-      info.GetReturnValue().Set(v);
-    }
-    return;
+  auto * instance = new RoaringBitmap32Bundle();
+  if (instance == nullptr) {
+    return v8utils::throwError(isolate, "RoaringBitmap32Bundle::ctor - allocation failed");
   }
 
-  if (length == 1) {
-    if (info[0]->IsArray()) {
-      auto array = v8::Local<v8::Array>::Cast(info[0]);
+  instance->content.set(info[0]);
+  const char * error = instance->parse();
+  if (error != nullptr) {
+    delete instance;
+    return v8utils::throwError(isolate, error);
+  }
 
-      size_t arrayLength = array->Length();
+  auto holder = info.Holder();
+  holder->SetAlignedPointerInInternalField(0, instance);
+  instance->persistent.Reset(isolate, holder);
+  instance->persistent.SetWeak(instance, WeakCallback, v8::WeakCallbackType::kParameter);
+  instance->buffer.Reset(isolate, v8::Local<v8::Object>::Cast(info[0]));
 
-      if (arrayLength == 0) {
-        auto vMaybe = cons->NewInstance(context, 0, nullptr);
-        v8::Local<v8::Object> v;
-        if (vMaybe.ToLocal(&v)) {
-          info.GetReturnValue().Set(v);
-        }
-        return;
-      }
+  v8utils::defineReadonlyField(
+    isolate, holder, "size", v8::Uint32::NewFromUnsigned(isolate, (uint32_t)instance->entries.size()));
 
-      if (arrayLength == 1) {
-        auto itemMaybe = array->Get(context, 0);
+  info.GetReturnValue().Set(holder);
+  isolate->AdjustAmountOfExternalAllocatedMemory(RoaringBitmap32Bundle::allocatedMemoryDelta);
+}
 
-        v8::Local<v8::Value> item;
-        if (!itemMaybe.ToLocal(&item) || !ctorType->HasInstance(item)) {
-          return v8utils::throwTypeError(isolate, opName, " accepts only RoaringBitmap32 instances");
-        }
+const char * RoaringBitmap32Bundle::parse() {
+  const uint8_t * data = this->content.data;
+  const size_t length = this->content.length;
 
-        v8::Local<v8::Value> argv[] = {item};
-        auto vMaybe = cons->NewInstance(context, 1, argv);
-        v8::Local<v8::Object> v;
-        if (vMaybe.ToLocal(&v)) {
-          info.GetReturnValue().Set(v);
-        }
-        return;
-      }
+  if (data == nullptr || length < headerSize || memcmp(data, magic, sizeof(magic)) != 0) {
+    return "RoaringBitmap32Bundle - invalid bundle header";
+  }
+  if (data[4] != formatVersion) {
+    return "RoaringBitmap32Bundle - unsupported bundle version";
+  }
+  if ((data[5] & ~flagChecksum) != 0) {
+    return "RoaringBitmap32Bundle - unsupported bundle flags";
+  }
 
-      const auto ** x = (const roaring_bitmap_t **)malloc(arrayLength * sizeof(roaring_bitmap_t *));
-      if (x == nullptr) {
-        return v8utils::throwTypeError(isolate, opName, " failed allocation");
-      }
+  uint32_t count;
+  uint32_t directorySize;
+  uint32_t directoryChecksum;
+  memcpy(&count, data + 8, sizeof(uint32_t));
+  memcpy(&directorySize, data + 12, sizeof(uint32_t));
+  memcpy(&directoryChecksum, data + 16, sizeof(uint32_t));
 
-      for (size_t i = 0; i < arrayLength; ++i) {
-        v8::Local<v8::Value> item;
-        auto itemMaybe = array->Get(context, i);
-        if (!itemMaybe.ToLocal(&item) || !ctorType->HasInstance(item)) {
-          return v8utils::throwTypeError(isolate, opName, " accepts only RoaringBitmap32 instances");
-        }
-        RoaringBitmap32 * p = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(item, ctorType, isolate);
-        if (p == nullptr) {
-          free(x);
-          return v8utils::throwTypeError(isolate, opName, " accepts only RoaringBitmap32 instances");
-        }
-        x[i] = p->roaring;
-      }
+  if (directorySize > length - headerSize || count > directorySize / entryHeaderSize) {
+    return "RoaringBitmap32Bundle - corrupted bundle directory";
+  }
 
-      auto resultMaybe = cons->NewInstance(context, 0, nullptr);
-      v8::Local<v8::Object> result;
-      if (!resultMaybe.ToLocal(&result)) {
-        free(x);
-        return;
-      }
+  this->hasChecksums = (data[5] & flagChecksum) != 0;
 
-      auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+  const uint8_t * p = data + headerSize;
+  const uint8_t * end = p + directorySize;
 
-      roaring_bitmap_t * r = op((TSize)arrayLength, x);
-      if (r == nullptr) {
-        free(x);
-        return v8utils::throwTypeError(isolate, opName, " failed roaring allocation");
-      }
+  if (this->hasChecksums && crc32c::value(p, directorySize) != directoryChecksum) {
+    return "RoaringBitmap32Bundle - bundle directory checksum mismatch";
+  }
 
-      self->replaceBitmapInstance(isolate, r);
+  this->entries.resize(count);
+  this->index.reserve(count);
 
-      info.GetReturnValue().Set(result);
+  for (uint32_t i = 0; i != count; ++i) {
+    if ((size_t)(end - p) < entryHeaderSize) {
+      return "RoaringBitmap32Bundle - corrupted bundle directory";
+    }
 
-    } else {
-      if (!ctorType->HasInstance(info[0])) {
-        return v8utils::throwTypeError(isolate, opName, " accepts only RoaringBitmap32 instances");
-      }
+    RoaringBitmap32BundleEntry & entry = this->entries[i];
+    memcpy(&entry.offset, p, sizeof(uint64_t));
+    memcpy(&entry.length, p + 8, sizeof(uint64_t));
+    memcpy(&entry.checksum, p + 16, sizeof(uint32_t));
+    entry.format = p[20];
+    memcpy(&entry.keyLength, p + 22, sizeof(uint16_t));
+    p += entryHeaderSize;
 
-      v8::Local<v8::Value> argv[] = {info[0]};
-      auto vMaybe = cons->NewInstance(isolate->GetCurrentContext(), 1, argv);
-      v8::Local<v8::Object> v;
-      if (vMaybe.ToLocal(&v)) {
-        info.GetReturnValue().Set(v);
-      }
-    }
-  } else {
-    const auto ** x = (const roaring_bitmap_t **)malloc(length * sizeof(roaring_bitmap_t *));
-    if (x == nullptr) {
-      return v8utils::throwTypeError(isolate, opName, " failed allocation");
+    if ((size_t)(end - p) < entry.keyLength) {
+      return "RoaringBitmap32Bundle - corrupted bundle directory";
     }
+    entry.key = (const char *)p;
+    p += entry.keyLength;
 
-    for (int i = 0; i < length; ++i) {
-      RoaringBitmap32 * p = v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info, i, ctorType);
-      if (p == nullptr) {
-        free(x);
-        return v8utils::throwTypeError(isolate, opName, " accepts only RoaringBitmap32 instances");
-      }
-      x[i] = p->roaring;
+    if (entry.format > formatFrozen || entry.offset > length || entry.length > length - entry.offset) {
+      return "RoaringBitmap32Bundle - corrupted bundle directory entry";
     }
 
-    v8::MaybeLocal<v8::Object> resultMaybe = cons->NewInstance(isolate->GetCurrentContext(), 0, nullptr);
-    v8::Local<v8::Object> result;
-    if (!resultMaybe.ToLocal(&result)) {
-      free(x);
-      return;
+    if (!this->index.emplace(std::string(entry.key, entry.keyLength), i).second) {
+      return "RoaringBitmap32Bundle - duplicate key in bundle directory";
     }
+  }
 
-    auto self = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
-    roaring_bitmap_t * r = op((TSize)length, x);
-    if (r == nullptr) {
-      free(x);
-      return v8utils::throwTypeError(isolate, opName, " failed roaring allocation");
-    }
+  if (p != end) {
+    return "RoaringBitmap32Bundle - corrupted bundle directory";
+  }
 
-    self->replaceBitmapInstance(isolate, r);
+  return nullptr;
+}
 
-    info.GetReturnValue().Set(result);
+int64_t RoaringBitmap32Bundle::find(v8::Isolate * isolate, v8::Local<v8::Value> key) const {
+  if (key.IsEmpty() || !key->IsString()) {
+    return -1;
+  }
+  v8::String::Utf8Value utf8(isolate, key);
+  if (*utf8 == nullptr) {
+    return -1;
   }
+  auto found = this->index.find(std::string(*utf8, (size_t)utf8.length()));
+  return found != this->index.end() ? (int64_t)found->second : -1;
 }
 
-void RoaringBitmap32::orManyStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32_opManyStatic("RoaringBitmap32::orMany", roaring_bitmap_or_many_heap, info);
-}
+DeserializeResult RoaringBitmap32Bundle::deserializeEntry(uint32_t entryIndex) const {
+  const RoaringBitmap32BundleEntry & entry = this->entries[entryIndex];
+  const char * data = (const char *)this->content.data + entry.offset;
 
-void RoaringBitmap32::xorManyStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  RoaringBitmap32_opManyStatic("RoaringBitmap32::xorMany", roaring_bitmap_xor_many, info);
-}
+  if (this->hasChecksums && crc32c::value(data, (size_t)entry.length) != entry.checksum) {
+    return DeserializeResult(nullptr, "RoaringBitmap32Bundle - checksum mismatch, bundle entry is corrupted");
+  }
 
-struct FromArrayAsyncWorker : public RoaringBitmap32FactoryAsyncWorker {
- public:
-  v8::Persistent<v8::Value> argPersistent;
-  v8utils::TypedArrayContent<uint32_t> buffer;
+  if (entry.format == formatFrozen) {
+    return DeserializeResult(
+      roaringBitmapFromFrozen(data, (size_t)entry.length), "RoaringBitmap32Bundle - frozen deserialization failed");
+  }
+
+  return DeserializeResult(
+    roaring_bitmap_portable_deserialize_safe(data, (size_t)entry.length),
+    "RoaringBitmap32Bundle - portable deserialization failed");
+}
 
-  explicit FromArrayAsyncWorker(v8::Isolate * isolate) : RoaringBitmap32FactoryAsyncWorker(isolate) {}
+void RoaringBitmap32Bundle::keys(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
 
-  virtual ~FromArrayAsyncWorker() { argPersistent.Reset(); }
+  RoaringBitmap32Bundle * instance =
+    v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32Bundle>(info.Holder(), addonData->RoaringBitmap32Bundle_constructorTemplate, isolate);
+  if (instance == nullptr) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32Bundle::keys - invalid instance");
+  }
 
- protected:
-  void work() final {
-    bitmap = roaring_bitmap_create_with_capacity(buffer.length);
-    if (bitmap == nullptr) {
-      this->setError("Failed to allocate roaring bitmap");
+  const uint32_t count = (uint32_t)instance->entries.size();
+  v8::Local<v8::Array> result = v8::Array::New(isolate, (int)count);
+  auto context = isolate->GetCurrentContext();
+
+  for (uint32_t i = 0; i != count; ++i) {
+    const RoaringBitmap32BundleEntry & entry = instance->entries[i];
+    v8::Local<v8::String> key;
+    if (!v8::String::NewFromUtf8(isolate, entry.key, v8::NewStringType::kNormal, entry.keyLength).ToLocal(&key)) {
       return;
     }
-    roaring_bitmap_add_many(bitmap, buffer.length, buffer.data);
-    roaring_bitmap_run_optimize(bitmap);
-    roaring_bitmap_shrink_to_fit(bitmap);
+    v8utils::ignoreMaybeResult(result->Set(context, i, key));
   }
-};
 
-void RoaringBitmap32::fromArrayStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = v8::Isolate::GetCurrent();
-  v8::HandleScope scope(isolate);
+  info.GetReturnValue().Set(result);
+}
 
-  v8::Local<v8::Value> arg;
+void RoaringBitmap32Bundle::has(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  AddonData * addonData = AddonData::get(info);
 
-  if (info.Length() >= 1) {
-    arg = info[0];
+  RoaringBitmap32Bundle * instance =
+    v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32Bundle>(info.Holder(), addonData->RoaringBitmap32Bundle_constructorTemplate, isolate);
+  if (instance == nullptr) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32Bundle::has - invalid instance");
   }
 
-  auto * worker = new FromArrayAsyncWorker(isolate);
-  if (worker == nullptr) {
-    return v8utils::throwError(isolate, "Failed to allocate async worker");
-  }
+  info.GetReturnValue().Set(info.Length() > 0 && instance->find(isolate, info[0]) >= 0);
+}
 
-  if (!arg->IsNullOrUndefined() && !arg->IsFunction()) {
-    if (arg->IsUint32Array() || arg->IsInt32Array()) {
-      worker->buffer.set(arg);
-      const v8utils::TypedArrayContent<uint32_t> typedArray(arg);
-    } else if (arg->IsObject()) {
-      if (RoaringBitmap32::constructorTemplate.Get(isolate)->HasInstance(arg)) {
-        return v8utils::throwTypeError(
-          isolate, "RoaringBitmap32::fromArrayAsync cannot be called with a RoaringBitmap32 instance");
-      }
-      v8::Local<v8::Value> argv[] = {arg};
-      auto carg = JSTypes::Uint32Array_from.Get(isolate)->Call(
-        isolate->GetCurrentContext(), JSTypes::Uint32Array.Get(isolate), 1, argv);
-      v8::Local<v8::Value> local;
-      if (carg.ToLocal(&local)) {
-        worker->buffer.set(local);
-      }
-    }
+void RoaringBitmap32Bundle::get(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
 
-    worker->argPersistent.Reset(isolate, arg);
+  RoaringBitmap32Bundle * instance =
+    v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32Bundle>(info.Holder(), addonData->RoaringBitmap32Bundle_constructorTemplate, isolate);
+  if (instance == nullptr) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32Bundle::get - invalid instance");
   }
 
-  if (info.Length() >= 2 && info[1]->IsFunction()) {
-    worker->setCallback(info[1]);
-  } else if (info.Length() >= 1 && info[0]->IsFunction()) {
-    worker->setCallback(info[0]);
+  int64_t entryIndex = info.Length() > 0 ? instance->find(isolate, info[0]) : -1;
+  if (entryIndex < 0) {
+    return;
   }
 
-  v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
-  info.GetReturnValue().Set(returnValue);
-}
+  auto deserialized = instance->deserializeEntry((uint32_t)entryIndex);
+  if (deserialized.error) {
+    return v8utils::throwError(isolate, deserialized.error);
+  }
 
-////////////// RoaringBitmap32BufferedIterator //////////////
+  v8::Local<v8::Object> result;
+  if (!addonData->RoaringBitmap32_constructor.Get(isolate)->NewInstance(isolate->GetCurrentContext(), 0, nullptr).ToLocal(&result)) {
+    roaring_bitmap_free(deserialized.bitmap);
+    return;
+  }
 
-v8::Eternal<v8::FunctionTemplate> RoaringBitmap32BufferedIterator::constructorTemplate;
-v8::Eternal<v8::Function> RoaringBitmap32BufferedIterator::constructor;
-v8::Eternal<v8::String> RoaringBitmap32BufferedIterator::nPropertyName;
+  RoaringBitmap32 * bitmap = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(result);
+  bitmap->replaceBitmapInstance(isolate, deserialized.bitmap);
+  bitmap->updateAmountOfExternalAllocatedMemory(isolate);
 
-RoaringBitmap32BufferedIterator::RoaringBitmap32BufferedIterator() {
-  this->it.parent = nullptr;
-  this->it.has_value = false;
+  info.GetReturnValue().Set(result);
 }
 
-void RoaringBitmap32BufferedIterator::destroy() {
-  this->bitmap.Reset();
-  this->buffer.Reset();
-  if (!persistent.IsEmpty()) {
-    persistent.ClearWeak();
-    persistent.Reset();
+void RoaringBitmap32Bundle::WeakCallback(v8::WeakCallbackInfo<RoaringBitmap32Bundle> const & info) {
+  RoaringBitmap32Bundle * p = info.GetParameter();
+  if (p != nullptr) {
+    info.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(-RoaringBitmap32Bundle::allocatedMemoryDelta);
+    delete p;
   }
 }
 
-RoaringBitmap32BufferedIterator::~RoaringBitmap32BufferedIterator() { this->destroy(); }
-
-void RoaringBitmap32BufferedIterator::Init(v8::Local<v8::Object> exports) {
-  v8::Isolate * isolate = v8::Isolate::GetCurrent();
-  v8::HandleScope scope(isolate);
+struct SerializeBundleItem {
+  std::string key;
+  roaring_bitmap_t * roaring;
+  uint64_t offset;
+  uint64_t length;
+};
 
-  auto stringN = NEW_LITERAL_V8_STRING(isolate, "n", v8::NewStringType::kInternalized);
-  auto className = NEW_LITERAL_V8_STRING(isolate, "RoaringBitmap32BufferedIterator", v8::NewStringType::kInternalized);
+inline static const char * serializeBundleAddItem(
+  AddonData * addonData,
+  std::vector<SerializeBundleItem> & items,
+  std::unordered_set<std::string> & keys,
+  v8::Local<v8::Value> key,
+  v8::Local<v8::Value> value) {
+  if (!key->IsString()) {
+    return "RoaringBitmap32::serializeBundle - keys must be strings";
+  }
+  v8::Isolate * isolate = addonData->isolate;
+  RoaringBitmap32 * bitmap =
+    v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(value, addonData->RoaringBitmap32_constructorTemplate, isolate);
+  if (bitmap == nullptr) {
+    return "RoaringBitmap32::serializeBundle - values must be RoaringBitmap32 instances";
+  }
+  v8::String::Utf8Value utf8(isolate, key);
+  if (*utf8 == nullptr || utf8.length() > 0xFFFF) {
+    return "RoaringBitmap32::serializeBundle - keys cannot be longer than 65535 bytes";
+  }
+  std::string keyString(*utf8, (size_t)utf8.length());
+  if (!keys.insert(keyString).second) {
+    return "RoaringBitmap32::serializeBundle - duplicate key";
+  }
+  items.push_back(SerializeBundleItem{keyString, bitmap->roaring, 0, 0});
+  return nullptr;
+}
 
-  nPropertyName.Set(isolate, stringN);
+void RoaringBitmap32::serializeBundleStatic(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = info.GetIsolate();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+  auto context = isolate->GetCurrentContext();
 
-  v8::Local<v8::FunctionTemplate> ctor = v8::FunctionTemplate::New(isolate, New);
+  if (info.Length() < 1 || !info[0]->IsObject()) {
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32::serializeBundle - first argument must be a Map, an array of [key, bitmap] or an object");
+  }
 
-  ctor->SetClassName(className);
-  ctor->InstanceTemplate()->SetInternalFieldCount(1);
+  bool frozen = false;
+  bool checksum = false;
+  if (info.Length() >= 2 && !info[1]->IsNullOrUndefined()) {
+    if (!info[1]->IsObject()) {
+      return v8utils::throwTypeError(isolate, "RoaringBitmap32::serializeBundle - options must be an object");
+    }
+    auto options = v8::Local<v8::Object>::Cast(info[1]);
 
-  constructorTemplate.Set(isolate, ctor);
+    v8::Local<v8::Value> formatValue;
+    if (!options->Get(context, NEW_LITERAL_V8_STRING(isolate, "format", v8::NewStringType::kInternalized))
+           .ToLocal(&formatValue)) {
+      return;
+    }
+    if (!formatValue->IsUndefined()) {
+      v8::String::Utf8Value format(isolate, formatValue);
+      if (formatValue->IsString() && strcmp(*format, "frozen") == 0) {
+        frozen = true;
+      } else if (!formatValue->IsString() || strcmp(*format, "portable") != 0) {
+        return v8utils::throwTypeError(
+          isolate, "RoaringBitmap32::serializeBundle - format must be \"portable\" or \"frozen\"");
+      }
+    }
 
-  NODE_SET_PROTOTYPE_METHOD(ctor, "fill", fill);
+    v8::Local<v8::Value> checksumValue;
+    if (!options->Get(context, NEW_LITERAL_V8_STRING(isolate, "checksum", v8::NewStringType::kInternalized))
+           .ToLocal(&checksumValue)) {
+      return;
+    }
+    checksum = checksumValue->IsTrue();
+  }
 
-  auto ctorFunctionMaybe = ctor->GetFunction(isolate->GetCurrentContext());
-  v8::Local<v8::Function> ctorFunction;
+  std::vector<SerializeBundleItem> items;
+  std::unordered_set<std::string> keys;
+  const char * error = nullptr;
+
+  if (info[0]->IsMap()) {
+    v8::Local<v8::Array> flat = v8::Local<v8::Map>::Cast(info[0])->AsArray();
+    const uint32_t length = flat->Length();
+    items.reserve(length / 2);
+    for (uint32_t i = 0; i + 1 < length && error == nullptr; i += 2) {
+      v8::Local<v8::Value> key;
+      v8::Local<v8::Value> value;
+      if (!flat->Get(context, i).ToLocal(&key) || !flat->Get(context, i + 1).ToLocal(&value)) {
+        return;
+      }
+      error = serializeBundleAddItem(addonData, items, keys, key, value);
+    }
+  } else if (info[0]->IsArray()) {
+    v8::Local<v8::Array> array = v8::Local<v8::Array>::Cast(info[0]);
+    const uint32_t length = array->Length();
+    items.reserve(length);
+    for (uint32_t i = 0; i != length && error == nullptr; ++i) {
+      v8::Local<v8::Value> pairValue;
+      if (!array->Get(context, i).ToLocal(&pairValue)) {
+        return;
+      }
+      if (!pairValue->IsArray()) {
+        error = "RoaringBitmap32::serializeBundle - array elements must be [key, bitmap] pairs";
+        break;
+      }
+      v8::Local<v8::Array> pair = v8::Local<v8::Array>::Cast(pairValue);
+      v8::Local<v8::Value> key;
+      v8::Local<v8::Value> value;
+      if (!pair->Get(context, 0).ToLocal(&key) || !pair->Get(context, 1).ToLocal(&value)) {
+        return;
+      }
+      error = serializeBundleAddItem(addonData, items, keys, key, value);
+    }
+  } else {
+    v8::Local<v8::Object> object = v8::Local<v8::Object>::Cast(info[0]);
+    v8::Local<v8::Array> names;
+    if (!object->GetOwnPropertyNames(context).ToLocal(&names)) {
+      return;
+    }
+    const uint32_t length = names->Length();
+    items.reserve(length);
+    for (uint32_t i = 0; i != length && error == nullptr; ++i) {
+      v8::Local<v8::Value> name;
+      v8::Local<v8::String> key;
+      v8::Local<v8::Value> value;
+      if (
+        !names->Get(context, i).ToLocal(&name) || !name->ToString(context).ToLocal(&key) ||
+        !object->Get(context, name).ToLocal(&value)) {
+        return;
+      }
+      error = serializeBundleAddItem(addonData, items, keys, key, value);
+    }
+  }
 
-  if (!ctorFunctionMaybe.ToLocal(&ctorFunction)) {
-    return v8utils::throwError(isolate, "Failed to instantiate RoaringBitmap32BufferedIterator");
+  if (error != nullptr) {
+    return v8utils::throwTypeError(isolate, error);
   }
 
-  constructor.Set(isolate, ctorFunction);
-  v8utils::defineHiddenField(isolate, exports, "RoaringBitmap32BufferedIterator", ctorFunction);
-}
+  uint64_t directorySize = 0;
+  for (const SerializeBundleItem & item : items) {
+    directorySize += RoaringBitmap32Bundle::entryHeaderSize + item.key.size();
+  }
 
-void RoaringBitmap32BufferedIterator::New(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = info.GetIsolate();
-  v8::HandleScope scope(isolate);
+  uint64_t position = RoaringBitmap32Bundle::headerSize + directorySize;
+  for (SerializeBundleItem & item : items) {
+    if (frozen) {
+      const uint64_t alignment = RoaringBitmap32Bundle::frozenAlignment;
+      position = (position + alignment - 1) & ~(alignment - 1);
+      const RoaringUnsharedView view(item.roaring);
+      if (view.bitmap == nullptr) {
+        return v8utils::throwError(isolate, "RoaringBitmap32::serializeBundle - failed to allocate");
+      }
+      item.length = roaring_bitmap_frozen_size_in_bytes(view.bitmap);
+    } else {
+      item.length = roaring_bitmap_portable_size_in_bytes(item.roaring);
+    }
+    item.offset = position;
+    position += item.length;
+  }
 
-  if (!info.IsConstructCall()) {
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32BufferedIterator::ctor - needs to be called with new");
+  if (directorySize > 0xFFFFFFFF || items.size() > 0xFFFFFFFF || position > node::Buffer::kMaxLength) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeBundle - bundle is too big");
   }
 
-  auto holder = info.Holder();
+  auto maybeBufferObject = node::Buffer::New(isolate, (size_t)position);
+  v8::Local<v8::Object> bufferObject;
+  if (!maybeBufferObject.ToLocal(&bufferObject)) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeBundle - failed to allocate");
+  }
+  const v8utils::TypedArrayContent<uint8_t> buf(bufferObject);
+  if (!buf.data) {
+    return v8utils::throwError(isolate, "RoaringBitmap32::serializeBundle - failed to allocate");
+  }
+  uint8_t * data = buf.data;
 
-  if (info.Length() != 2) {
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32BufferedIterator::ctor - needs two arguments");
+  position = RoaringBitmap32Bundle::headerSize + directorySize;
+  for (const SerializeBundleItem & item : items) {
+    if (item.offset > position) {
+      memset(data + position, 0, (size_t)(item.offset - position));
+    }
+    if (frozen) {
+      const RoaringUnsharedView view(item.roaring);
+      if (view.bitmap == nullptr) {
+        return v8utils::throwError(isolate, "RoaringBitmap32::serializeBundle - failed to allocate");
+      }
+      roaring_bitmap_frozen_serialize(view.bitmap, (char *)data + item.offset);
+    } else {
+      roaring_bitmap_portable_serialize(item.roaring, (char *)data + item.offset);
+    }
+    position = item.offset + item.length;
   }
 
-  RoaringBitmap32 * bitmapInstance =
-    v8utils::ObjectWrap::TryUnwrap<RoaringBitmap32>(info[0], RoaringBitmap32::constructorTemplate, isolate);
-  if (bitmapInstance == nullptr) {
-    return v8utils::throwTypeError(
-      isolate, "RoaringBitmap32BufferedIterator::ctor - first argument must be of type RoaringBitmap32");
+  const uint8_t format = frozen ? RoaringBitmap32Bundle::formatFrozen : RoaringBitmap32Bundle::formatPortable;
+  uint8_t * entry = data + RoaringBitmap32Bundle::headerSize;
+  for (const SerializeBundleItem & item : items) {
+    const uint32_t crc = checksum ? crc32c::value(data + item.offset, (size_t)item.length) : 0;
+    const uint16_t keyLength = (uint16_t)item.key.size();
+    memcpy(entry, &item.offset, sizeof(uint64_t));
+    memcpy(entry + 8, &item.length, sizeof(uint64_t));
+    memcpy(entry + 16, &crc, sizeof(uint32_t));
+    entry[20] = format;
+    entry[21] = 0;
+    memcpy(entry + 22, &keyLength, sizeof(uint16_t));
+    memcpy(entry + RoaringBitmap32Bundle::entryHeaderSize, item.key.data(), keyLength);
+    entry += RoaringBitmap32Bundle::entryHeaderSize + keyLength;
   }
 
-  auto bufferObject = info[1];
+  const uint32_t count = (uint32_t)items.size();
+  const uint32_t directorySize32 = (uint32_t)directorySize;
+  const uint32_t directoryChecksum =
+    checksum ? crc32c::value(data + RoaringBitmap32Bundle::headerSize, (size_t)directorySize) : 0;
+  memcpy(data, RoaringBitmap32Bundle::magic, sizeof(RoaringBitmap32Bundle::magic));
+  data[4] = RoaringBitmap32Bundle::formatVersion;
+  data[5] = checksum ? RoaringBitmap32Bundle::flagChecksum : 0;
+  data[6] = 0;
+  data[7] = 0;
+  memcpy(data + 8, &count, sizeof(uint32_t));
+  memcpy(data + 12, &directorySize32, sizeof(uint32_t));
+  memcpy(data + 16, &directoryChecksum, sizeof(uint32_t));
 
-  if (!bufferObject->IsUint32Array()) {
-    return v8utils::throwTypeError(
-      isolate, "RoaringBitmap32BufferedIterator::ctor - second argument must be of type Uint32Array");
+  info.GetReturnValue().Set(bufferObject);
+}
+
+class DeserializeBundleParallelWorker final : public v8utils::ParallelAsyncWorker {
+ public:
+  v8::Persistent<v8::Object> bundlePersistent;
+  const RoaringBitmap32Bundle * bundle;
+  int64_t * entryIndices;
+  roaring_bitmap_t_ptr * bitmaps;
+
+  AddonData * const addonData;
+
+  explicit DeserializeBundleParallelWorker(AddonData * addonData) :
+    v8utils::ParallelAsyncWorker(addonData->isolate),
+    bundle(nullptr),
+    entryIndices(nullptr),
+    bitmaps(nullptr),
+    addonData(addonData) {
+    addonData->acquire();
   }
 
-  const v8utils::TypedArrayContent<uint32_t> bufferContent(bufferObject);
-  if (!bufferContent.data || bufferContent.length < 1) {
-    return v8utils::throwTypeError(isolate, "RoaringBitmap32BufferedIterator::ctor - invalid Uint32Array buffer");
+  virtual ~DeserializeBundleParallelWorker() {
+    if (bitmaps != nullptr) {
+      for (uint32_t i = 0; i != this->loopCount; ++i) {
+        if (bitmaps[i] != nullptr) {
+          roaring_bitmap_free(bitmaps[i]);
+        }
+      }
+      delete[] bitmaps;
+    }
+    delete[] entryIndices;
+    bundlePersistent.Reset();
+    this->addonData->release();
   }
 
-  auto * instance = new RoaringBitmap32BufferedIterator();
-  if (instance == nullptr) {
-    return v8utils::throwError(isolate, "RoaringBitmap32BufferedIterator::ctor - allocation failed");
+ protected:
+  void parallelWork(uint32_t index) final {
+    const int64_t entryIndex = entryIndices[index];
+    if (entryIndex < 0) {
+      return;
+    }
+    auto deserialized = bundle->deserializeEntry((uint32_t)entryIndex);
+    if (deserialized.error != nullptr) {
+      this->setError(deserialized.error);
+      return;
+    }
+    bitmaps[index] = deserialized.bitmap;
   }
 
-  holder->SetAlignedPointerInInternalField(0, instance);
-  instance->persistent.Reset(isolate, holder);
-  instance->persistent.SetWeak(instance, WeakCallback, v8::WeakCallbackType::kParameter);
+  uint64_t parallelWorkSize(uint32_t index) final {
+    const int64_t entryIndex = entryIndices[index];
+    return entryIndex < 0 ? 0 : bundle->entries[(size_t)entryIndex].length;
+  }
 
-  auto context = isolate->GetCurrentContext();
+  v8::Local<v8::Value> done() final {
+    v8::Local<v8::Function> cons = this->addonData->RoaringBitmap32_constructor.Get(isolate);
 
-  roaring_init_iterator(bitmapInstance->roaring, &instance->it);
+    const uint32_t itemsCount = this->loopCount;
 
-  uint32_t n = roaring_read_uint32_iterator(&instance->it, bufferContent.data, bufferContent.length);
-  if (n != 0) {
-    instance->bitmapInstance = bitmapInstance;
-    instance->bitmapVersion = bitmapInstance->version;
+    v8::Local<v8::Array> resultArray = v8::Array::New(isolate, (int)itemsCount);
+    v8::Local<v8::Context> currentContext = isolate->GetCurrentContext();
 
-    auto a0Maybe = info[0]->ToObject(context);
-    v8::Local<v8::Object> a0;
-    if (!a0Maybe.ToLocal(&a0)) {
-      return v8utils::throwError(isolate, "RoaringBitmap32BufferedIterator::ctor - allocation failed");
-    }
-    instance->bitmap.Reset(isolate, a0);
+    for (uint32_t i = 0; i != itemsCount; ++i) {
+      if (bitmaps[i] == nullptr) {
+        v8utils::ignoreMaybeResult(resultArray->Set(currentContext, i, v8::Undefined(isolate)));
+        continue;
+      }
 
-    auto a1Maybe = bufferObject->ToObject(context);
-    v8::Local<v8::Object> a1;
-    if (!a1Maybe.ToLocal(&a1)) {
-      return v8utils::throwError(isolate, "RoaringBitmap32BufferedIterator::ctor - allocation failed");
+      v8::Local<v8::Object> instance;
+      if (!cons->NewInstance(currentContext, 0, nullptr).ToLocal(&instance)) return v8::Local<v8::Value>();
+
+      RoaringBitmap32 * unwrapped = v8utils::ObjectWrap::Unwrap<RoaringBitmap32>(instance);
+      unwrapped->replaceBitmapInstance(isolate, bitmaps[i]);
+      bitmaps[i] = nullptr;
+      unwrapped->updateAmountOfExternalAllocatedMemory(isolate);
+
+      v8utils::ignoreMaybeResult(resultArray->Set(currentContext, i, instance));
     }
-    instance->buffer.Reset(isolate, a1);
 
-    instance->bufferContent.set(bufferObject);
+    return resultArray;
+  }
+};
+
+void RoaringBitmap32::deserializeBundleParallelStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info) {
+  v8::Isolate * isolate = v8::Isolate::GetCurrent();
+  v8::HandleScope scope(isolate);
+  AddonData * addonData = AddonData::get(info);
+  auto context = isolate->GetCurrentContext();
+
+  v8::Local<v8::Object> bundleObject;
+  if (info.Length() >= 1 && addonData->RoaringBitmap32Bundle_constructorTemplate.Get(isolate)->HasInstance(info[0])) {
+    bundleObject = v8::Local<v8::Object>::Cast(info[0]);
+  } else if (
+    info.Length() >= 1 && (info[0]->IsUint8Array() || info[0]->IsInt8Array() || info[0]->IsUint8ClampedArray())) {
+    v8::Local<v8::Value> argv[] = {info[0]};
+    if (!addonData->RoaringBitmap32Bundle_constructor.Get(isolate)->NewInstance(context, 1, argv).ToLocal(&bundleObject)) {
+      return;
+    }
   } else {
-    instance->bitmapInstance = nullptr;
+    return v8utils::throwTypeError(
+      isolate,
+      "RoaringBitmap32::deserializeBundleParallelAsync - first argument must be a RoaringBitmap32Bundle, an Uint8Array or a Buffer");
   }
 
-  if (holder->Set(context, nPropertyName.Get(isolate), v8::Uint32::NewFromUnsigned(isolate, n)).IsNothing()) {
-    return v8utils::throwError(isolate, "RoaringBitmap32BufferedIterator::ctor - instantiation failed");
+  if (info.Length() < 2 || !info[1]->IsArray()) {
+    return v8utils::throwTypeError(
+      isolate, "RoaringBitmap32::deserializeBundleParallelAsync - second argument must be an array of keys");
   }
 
-  info.GetReturnValue().Set(holder);
-  isolate->AdjustAmountOfExternalAllocatedMemory(RoaringBitmap32BufferedIterator::allocatedMemoryDelta);
-}
+  auto keys = v8::Local<v8::Array>::Cast(info[1]);
+  const uint32_t length = keys->Length();
 
-void RoaringBitmap32BufferedIterator::fill(const v8::FunctionCallbackInfo<v8::Value> & info) {
-  v8::Isolate * isolate = info.GetIsolate();
-  v8::HandleScope scope(isolate);
+  if (length > 0x01FFFFFF) {
+    return v8utils::throwTypeError(isolate, "RoaringBitmap32::deserializeBundleParallelAsync - array too big");
+  }
 
-  RoaringBitmap32BufferedIterator * instance = v8utils::ObjectWrap::Unwrap<RoaringBitmap32BufferedIterator>(info.Holder());
+  auto * worker = new DeserializeBundleParallelWorker(addonData);
+  if (worker == nullptr) {
+    return v8utils::throwError(isolate, "Failed to allocate async worker");
+  }
 
-  RoaringBitmap32 * bitmapInstance = instance->bitmapInstance;
+  worker->bundle = v8utils::ObjectWrap::Unwrap<RoaringBitmap32Bundle>(bundleObject);
+  worker->bundlePersistent.Reset(isolate, bundleObject);
 
-  if (bitmapInstance == nullptr) {
-    return info.GetReturnValue().Set(0U);
+  if (length != 0) {
+    worker->entryIndices = new int64_t[length];
+    worker->bitmaps = new roaring_bitmap_t_ptr[length]();
+    if (worker->entryIndices == nullptr || worker->bitmaps == nullptr) {
+      delete worker;
+      return v8utils::throwError(isolate, "Failed to allocate async worker memory");
+    }
   }
+  worker->loopCount = length;
 
-  if (bitmapInstance->version != instance->bitmapVersion) {
-    return v8utils::throwError(isolate, "RoaringBitmap32 iterator - bitmap changed while iterating");
+  for (uint32_t i = 0; i != length; ++i) {
+    v8::Local<v8::Value> key;
+    if (!keys->Get(context, i).ToLocal(&key)) {
+      delete worker;
+      return;
+    }
+    if (!key->IsString()) {
+      delete worker;
+      return v8utils::throwTypeError(
+        isolate, "RoaringBitmap32::deserializeBundleParallelAsync - keys array must contain only strings");
+    }
+    worker->entryIndices[i] = worker->bundle->find(isolate, key);
   }
 
-  uint32_t n = roaring_read_uint32_iterator(&instance->it, instance->bufferContent.data, instance->bufferContent.length);
-  if (n == 0) {
-    instance->bitmapInstance = nullptr;
-    instance->bufferContent.reset();
-    instance->bitmap.Reset();
-    instance->buffer.Reset();
+  if (!setAsyncOptionsAndCallback(info, 2, "RoaringBitmap32::deserializeBundleParallelAsync", worker, worker)) {
+    delete worker;
+    return;
   }
 
-  info.GetReturnValue().Set(n);
-}
-
-void RoaringBitmap32BufferedIterator::WeakCallback(v8::WeakCallbackInfo<RoaringBitmap32BufferedIterator> const & info) {
-  RoaringBitmap32BufferedIterator * p = info.GetParameter();
-  if (p != nullptr) {
-    info.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(-RoaringBitmap32BufferedIterator::allocatedMemoryDelta);
-    delete p;
-  }
+  v8::Local<v8::Value> returnValue = v8utils::AsyncWorker::run(worker);
+  info.GetReturnValue().Set(returnValue);
 }
@@ -1,6 +1,12 @@
 #ifndef __ROARINGBITMAP32__H__
 #define __ROARINGBITMAP32__H__
 
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+
 #include "v8utils/v8utils.h"
 #include "CRoaringUnityBuild/roaring_version_string.h"
 #include "CRoaringUnityBuild/roaring.h"
@@ -10,6 +16,59 @@ using namespace roaring::api;
 
 class RoaringBitmap32;
 
+/**
+ * Per isolate state of the addon.
+ * Every isolate (the main thread and each worker thread) that loads the addon gets its own instance,
+ * passed as data to all the functions and deleted by an environment cleanup hook.
+ */
+class AddonData final {
+ public:
+  v8::Isolate * const isolate;
+
+  v8::Global<v8::External> external;
+
+  v8::Global<v8::Object> Uint32Array;
+  v8::Global<v8::Function> Uint32Array_from;
+  v8::Global<v8::Function> Set_constructor;
+
+  v8::Global<v8::FunctionTemplate> RoaringBitmap32_constructorTemplate;
+  v8::Global<v8::Function> RoaringBitmap32_constructor;
+
+  v8::Global<v8::FunctionTemplate> RoaringBitmap32BufferedIterator_constructorTemplate;
+  v8::Global<v8::Function> RoaringBitmap32BufferedIterator_constructor;
+  v8::Global<v8::String> RoaringBitmap32BufferedIterator_nPropertyName;
+
+  v8::Global<v8::FunctionTemplate> RoaringBitmap32ChunkedSerializer_constructorTemplate;
+  v8::Global<v8::Function> RoaringBitmap32ChunkedSerializer_constructor;
+
+  v8::Global<v8::FunctionTemplate> RoaringBitmap32Bundle_constructorTemplate;
+  v8::Global<v8::Function> RoaringBitmap32Bundle_constructor;
+
+  explicit AddonData(v8::Isolate * isolate);
+  ~AddonData();
+
+  // Async jobs that use the addon data keep it alive until they are deleted.
+  void acquire();
+  void release();
+
+  void initJSTypes(const v8::Local<v8::Object> & global);
+
+  void setMethod(v8::Local<v8::Object> target, const char * name, v8::FunctionCallback callback);
+  void setPrototypeMethod(v8::Local<v8::FunctionTemplate> target, const char * name, v8::FunctionCallback callback);
+
+  inline static AddonData * get(const v8::FunctionCallbackInfo<v8::Value> & info) {
+    return static_cast<AddonData *>(v8::Local<v8::External>::Cast(info.Data())->Value());
+  }
+
+  static void cleanup(void * param);
+
+ private:
+  // One reference for the environment plus one for each async job.
+  volatile int32_t _refs;
+
+  void _resetHandles();
+};
+
 typedef roaring_bitmap_t * roaring_bitmap_t_ptr;
 
 struct DeserializeResult final {
@@ -24,6 +83,121 @@ struct DeserializeResult final {
         : (error != nullptr ? error : "RoaringBitmap32::deserialize - failed to deserialize roaring bitmap")) {}
 };
 
+/**
+ * Keys of the containers changed since a point in time.
+ * Above maxKeys keys, all the containers are considered changed.
+ */
+struct RoaringBitmap32DirtyKeys final {
+  enum { maxKeys = 4096 };
+
+  bool all;
+  std::vector<uint16_t> keys;
+
+  RoaringBitmap32DirtyKeys() : all(false) {}
+
+  inline bool isDirty() const { return this->all || !this->keys.empty(); }
+
+  inline void markAll() {
+    this->all = true;
+    this->keys.clear();
+  }
+
+  inline void mark(uint16_t key) {
+    if (!this->all) {
+      if (this->keys.size() < maxKeys) {
+        this->keys.push_back(key);
+      } else {
+        this->markAll();
+      }
+    }
+  }
+
+  inline void clear() {
+    this->all = false;
+    this->keys.clear();
+  }
+
+  // Sorts the keys and removes the duplicates, must be called before contains.
+  void normalize();
+
+  inline bool contains(uint16_t key) const {
+    return this->all || std::binary_search(this->keys.begin(), this->keys.end(), key);
+  }
+};
+
+/**
+ * Containers encoded by the last incremental compressed serialization of a bitmap.
+ * The next incremental serialization encodes again only the containers changed since then.
+ */
+struct RoaringBitmap32CompressedCache final {
+  RoaringBitmap32DirtyKeys dirty;
+  // Keys of the encoded containers, in order.
+  std::vector<uint16_t> keys;
+  // Start of each container in blocks, followed by the end of the last one.
+  std::vector<size_t> offsets;
+  // For each container, the encoding byte followed by the encoded values.
+  std::vector<uint8_t> blocks;
+
+  RoaringBitmap32CompressedCache() { this->dirty.markAll(); }
+};
+
+/**
+ * Serializes a bitmap in the portable, non portable or compressed non portable format,
+ * optionally wrapped in a CRC32C envelope.
+ * computeSize() must be called before serialize(). Does not use V8, can be used in a worker thread.
+ */
+class RoaringBitmap32Serializer final {
+ public:
+  const roaring_bitmap_t * roaring;
+  bool portable;
+  bool checksum;
+  bool compressed;
+  // If not null, the compressed format reuses and updates the encoded containers. Used only on the main thread.
+  RoaringBitmap32CompressedCache * compressedCache;
+
+  RoaringBitmap32Serializer();
+  ~RoaringBitmap32Serializer();
+
+  size_t computeSize();
+  const char * serialize(uint8_t * data);
+
+  inline size_t getPortableSize() const { return this->portableSize; }
+
+  static roaring_bitmap_t * deserializeCompressed(const uint8_t * data, size_t length);
+
+ private:
+  bool serializeArray;
+  uint64_t cardinality;
+  size_t portableSize;
+  size_t payloadSize;
+  uint32_t compressedContainers;
+  std::vector<uint8_t> encodings;
+  uint16_t * values;
+
+  bool computeCompressedSize();
+  bool computeCompressedSizeCached();
+  void writeCompressed(uint8_t * data, uint32_t * crc);
+  void writePayload(uint8_t * data, uint32_t * crc);
+};
+
+/**
+ * Opt-in policy that runs run optimization and shrink to fit on the containers changed since the last pass.
+ * Single value mutations mark the container of the value, other mutations mark all the containers.
+ */
+struct RoaringBitmap32AutoOptimize final {
+  // Runs a pass after this number of mutations, 0 to disable.
+  uint32_t everyNMutations;
+  // Runs a pass before the bitmap is serialized.
+  bool onSerialize;
+
+  uint32_t mutations;
+  RoaringBitmap32DirtyKeys dirty;
+
+  RoaringBitmap32AutoOptimize() : everyNMutations(0), onSerialize(false), mutations(0) {}
+
+  inline bool isPassDue() const { return this->everyNMutations != 0 && this->mutations >= this->everyNMutations; }
+};
+
 class RoaringBitmap32 final {
  public:
   roaring_bitmap_t * roaring;
@@ -31,17 +205,149 @@ class RoaringBitmap32 final {
   int64_t amountOfExternalAllocatedMemoryTracker;
   v8::Persistent<v8::Object> persistent;
 
-  inline void invalidate() { ++version; }
+  // A frozen bitmap cannot be modified, mutating methods throw.
+  bool frozen;
+
+  // Keeps alive the memory of a bitmap that is a view of a frozen buffer.
+#if NODE_MAJOR_VERSION > 13
+  std::shared_ptr<v8::BackingStore> frozenBackingStore;
+#else
+  v8::Persistent<v8::Value> frozenBuffer;
+#endif
+
+  // Null if there is no automatic optimization policy.
+  std::unique_ptr<RoaringBitmap32AutoOptimize> autoOptimizePolicy;
+  // Total bytes released by the automatic optimization passes.
+  uint64_t autoOptimizeSavedBytes;
+
+  // Cardinality, minimum and maximum, valid while the cache version is equal to version.
+  uint64_t cardinalityCacheVersion;
+  uint64_t cachedCardinality;
+  uint64_t minMaxCacheVersion;
+  uint32_t cachedMinimum;
+  uint32_t cachedMaximum;
+
+  inline uint64_t getCardinality() {
+    if (cardinalityCacheVersion != version) {
+      cachedCardinality = roaring_bitmap_get_cardinality(roaring);
+      cardinalityCacheVersion = version;
+    }
+    return cachedCardinality;
+  }
+
+  inline void updateMinMaxCache() {
+    if (minMaxCacheVersion != version) {
+      cachedMinimum = roaring_bitmap_minimum(roaring);
+      cachedMaximum = roaring_bitmap_maximum(roaring);
+      minMaxCacheVersion = version;
+    }
+  }
+
+  inline uint32_t getMinimum() {
+    updateMinMaxCache();
+    return cachedMinimum;
+  }
+
+  inline uint32_t getMaximum() {
+    updateMinMaxCache();
+    return cachedMaximum;
+  }
+
+  // Null until the bitmap is serialized with the incremental option.
+  std::unique_ptr<RoaringBitmap32CompressedCache> compressedCache;
+
+  inline void invalidate() {
+    ++version;
+    if (compressedCache) {
+      compressedCache->dirty.markAll();
+    }
+    if (autoOptimizePolicy) {
+      autoOptimizePolicy->dirty.markAll();
+      ++autoOptimizePolicy->mutations;
+      if (autoOptimizePolicy->isPassDue()) autoOptimize();
+    }
+  }
+
+  // Called after a mutation that changed only the container of the given value.
+  inline void invalidate(uint32_t value) {
+    ++version;
+    if (compressedCache) {
+      compressedCache->dirty.mark((uint16_t)(value >> 16));
+    }
+    if (autoOptimizePolicy) {
+      autoOptimizePolicy->dirty.mark((uint16_t)(value >> 16));
+      ++autoOptimizePolicy->mutations;
+      if (autoOptimizePolicy->isPassDue()) autoOptimize();
+    }
+  }
+
+  // Called after a value that was not in the bitmap was added, updates the cached cardinality, minimum and maximum.
+  inline void invalidateAdded(uint32_t value) {
+    const bool cardinalityValid = cardinalityCacheVersion == version;
+    const bool minMaxValid = minMaxCacheVersion == version;
+    invalidate(value);
+    if (cardinalityValid) {
+      ++cachedCardinality;
+      cardinalityCacheVersion = version;
+    }
+    if (minMaxValid) {
+      if (value < cachedMinimum) cachedMinimum = value;
+      if (value > cachedMaximum) cachedMaximum = value;
+      minMaxCacheVersion = version;
+    }
+  }
+
+  // Called after a value that was in the bitmap was removed, updates the cached cardinality, minimum and maximum.
+  inline void invalidateRemoved(uint32_t value) {
+    const bool cardinalityValid = cardinalityCacheVersion == version;
+    const bool minMaxValid = minMaxCacheVersion == version && value != cachedMinimum && value != cachedMaximum;
+    invalidate(value);
+    if (cardinalityValid) {
+      --cachedCardinality;
+      cardinalityCacheVersion = version;
+    }
+    if (minMaxValid) {
+      minMaxCacheVersion = version;
+    }
+  }
+
+  // Called after containers were converted or reallocated without changing the values.
+  // Stops the iterators and the chunked serializers, the cached cardinality, minimum and maximum stay valid.
+  inline void invalidateContainers() {
+    const bool cardinalityValid = cardinalityCacheVersion == version;
+    const bool minMaxValid = minMaxCacheVersion == version;
+    ++version;
+    if (cardinalityValid) {
+      cardinalityCacheVersion = version;
+    }
+    if (minMaxValid) {
+      minMaxCacheVersion = version;
+    }
+  }
+
+  // Runs the automatic optimization pass if the policy requires it before serialization.
+  inline void autoOptimizeBeforeSerialize() {
+    if (autoOptimizePolicy && autoOptimizePolicy->onSerialize && autoOptimizePolicy->dirty.isDirty()) autoOptimize();
+  }
+
+  // Optimizes the dirty containers, returns the number of bytes released.
+  size_t autoOptimize();
+
+  inline RoaringBitmap32CompressedCache * getCompressedCache() {
+    if (!compressedCache) {
+      compressedCache.reset(new RoaringBitmap32CompressedCache());
+    }
+    return compressedCache.get();
+  }
+
+  static RoaringBitmap32 * unwrapMutable(v8::Isolate * isolate, v8::Local<v8::Object> holder);
 
   void updateAmountOfExternalAllocatedMemory(v8::Isolate * isolate);
   void updateAmountOfExternalAllocatedMemory(v8::Isolate * isolate, size_t newSize);
 
   bool replaceBitmapInstance(v8::Isolate * isolate, roaring_bitmap_t * newInstance);
 
-  static v8::Eternal<v8::FunctionTemplate> constructorTemplate;
-  static v8::Eternal<v8::Function> constructor;
-
-  static void Init(v8::Local<v8::Object> exports);
+  static void Init(v8::Local<v8::Object> exports, AddonData * addonData);
 
   static void New(const v8::FunctionCallbackInfo<v8::Value> & info);
 
@@ -51,6 +357,17 @@ class RoaringBitmap32 final {
   static void addRange(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void removeRange(const v8::FunctionCallbackInfo<v8::Value> & info);
 
+  static void fromRangesStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void fromRangesStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void addRanges(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void removeRanges(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void flipRanges(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void toRanges(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void fromTextStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void fromTextStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void toText(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void toTextAsync(const v8::FunctionCallbackInfo<v8::Value> & info);
+
   static void has(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void copyFrom(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void add(const v8::FunctionCallbackInfo<v8::Value> & info);
@@ -61,6 +378,7 @@ class RoaringBitmap32 final {
   static void remove(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void removeMany(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void removeChecked(const v8::FunctionCallbackInfo<v8::Value> & info);
+
   static void clear(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void minimum(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void maximum(const v8::FunctionCallbackInfo<v8::Value> & info);
@@ -80,13 +398,21 @@ class RoaringBitmap32 final {
   static void removeRunCompression(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void runOptimize(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void shrinkToFit(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void setAutoOptimize(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void freeze(const v8::FunctionCallbackInfo<v8::Value> & info);
 
   static void toUint32Array(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void toUint32ArrayAsync(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void rangeUint32Array(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void toArray(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void toSet(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void toJSONString(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void getSerializationSizeInBytes(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void serialize(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void serializeAsync(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void getFrozenSizeInBytes(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void serializeFrozen(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void frozenViewStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
 
   static void deserialize(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void deserializeStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
@@ -95,6 +421,14 @@ class RoaringBitmap32 final {
 
   static void fromArrayStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info);
 
+  static void serializeDiffStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void serializeDiffStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void applyDiffStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void applyDiffStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info);
+
+  static void serializeBundleStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void deserializeBundleParallelStaticAsync(const v8::FunctionCallbackInfo<v8::Value> & info);
+
   static void andStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void orStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void xorStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
@@ -104,13 +438,18 @@ class RoaringBitmap32 final {
 
   static void swapStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
 
+  static void getThreadPoolSizeStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void setThreadPoolSizeStatic(const v8::FunctionCallbackInfo<v8::Value> & info);
+
   static void clone(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void toString(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void contentToString(const v8::FunctionCallbackInfo<v8::Value> & info);
   static void statistics(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void containers(const v8::FunctionCallbackInfo<v8::Value> & info);
 
   static void isEmpty_getter(v8::Local<v8::String> property, const v8::PropertyCallbackInfo<v8::Value> & info);
   static void size_getter(v8::Local<v8::String> property, const v8::PropertyCallbackInfo<v8::Value> & info);
+  static void isFrozen_getter(v8::Local<v8::String> property, const v8::PropertyCallbackInfo<v8::Value> & info);
 
   explicit RoaringBitmap32(uint32_t capacity);
   ~RoaringBitmap32();
@@ -118,16 +457,24 @@ class RoaringBitmap32 final {
  private:
   static void WeakCallback(v8::WeakCallbackInfo<RoaringBitmap32> const & info);
   static DeserializeResult doDeserialize(const v8utils::TypedArrayContent<uint8_t> & typedArray, bool portable);
+  static DeserializeResult doDeserialize(const char * data, size_t length, bool portable);
+
+  static const char * doSerializeDiff(
+    const roaring_bitmap_t * base, const roaring_bitmap_t * current, char *& data, size_t & size);
+  static DeserializeResult doApplyDiff(const roaring_bitmap_t * base, const uint8_t * diff, size_t length);
 
   friend class DeserializeWorker;
   friend class DeserializeParallelWorker;
+  friend class SerializeDiffWorker;
+  friend class ApplyDiffWorker;
 };
 
 class RoaringBitmap32FactoryAsyncWorker : public v8utils::AsyncWorker {
  public:
+  AddonData * const addonData;
   volatile roaring_bitmap_t_ptr bitmap;
 
-  explicit RoaringBitmap32FactoryAsyncWorker(v8::Isolate * isolate);
+  explicit RoaringBitmap32FactoryAsyncWorker(AddonData * addonData);
   virtual ~RoaringBitmap32FactoryAsyncWorker();
 
  protected:
@@ -142,15 +489,14 @@ class RoaringBitmap32BufferedIterator {
   roaring_uint32_iterator_t it;
   uint64_t bitmapVersion;
   RoaringBitmap32 * bitmapInstance;
+  // Copy on write snapshot iterated instead of the bitmap, the bitmap can then be modified while iterating.
+  roaring_bitmap_t * snapshot;
   v8utils::TypedArrayContent<uint32_t> bufferContent;
 
   v8::Persistent<v8::Object> buffer;
   v8::Persistent<v8::Object> bitmap;
 
-  static v8::Eternal<v8::FunctionTemplate> constructorTemplate;
-  static v8::Eternal<v8::Function> constructor;
-
-  static void Init(v8::Local<v8::Object> exports);
+  static void Init(v8::Local<v8::Object> exports, AddonData * addonData);
   static void New(const v8::FunctionCallbackInfo<v8::Value> & info);
 
   static void fill(const v8::FunctionCallbackInfo<v8::Value> & info);
@@ -160,8 +506,116 @@ class RoaringBitmap32BufferedIterator {
 
  private:
   void destroy();
-  static v8::Eternal<v8::String> nPropertyName;
+  void releaseSnapshot();
   static void WeakCallback(v8::WeakCallbackInfo<RoaringBitmap32BufferedIterator> const & info);
 };
 
+/**
+ * Writes the portable serialization of a bitmap in bounded size chunks.
+ * The concatenation of all the chunks is byte by byte identical to roaring_bitmap_portable_serialize.
+ * Only one container at a time is materialized in a temporary buffer.
+ */
+class RoaringBitmap32ChunkedSerializer {
+ public:
+  enum { allocatedMemoryDelta = 1024 };
+
+  v8::Persistent<v8::Object> persistent;
+  uint64_t bitmapVersion;
+  RoaringBitmap32 * bitmapInstance;
+  v8::Persistent<v8::Object> bitmap;
+
+  static void Init(v8::Local<v8::Object> exports, AddonData * addonData);
+  static void New(const v8::FunctionCallbackInfo<v8::Value> & info);
+
+  static void fill(const v8::FunctionCallbackInfo<v8::Value> & info);
+
+  RoaringBitmap32ChunkedSerializer();
+  ~RoaringBitmap32ChunkedSerializer();
+
+  // Can be used also without a JS object, to serialize in chunks natively.
+  bool allocationFailed;
+  void start(const roaring_array_t * ra);
+  size_t write(const roaring_array_t * ra, char * output, size_t length);
+
+ private:
+  enum Phase { phaseCookie, phaseRunBitmap, phaseKeys, phaseOffsets, phaseContainers, phaseDone };
+
+  Phase phase;
+  int32_t index;
+  bool hasRun;
+  uint32_t containerOffset;
+
+  char * pending;
+  uint32_t pendingLength;
+  uint32_t pendingPosition;
+  char small[8];
+  char * scratch;
+  uint32_t scratchCapacity;
+
+  uint32_t nextItem(const roaring_array_t * ra, char * output, size_t length);
+  void destroy();
+
+  static void WeakCallback(v8::WeakCallbackInfo<RoaringBitmap32ChunkedSerializer> const & info);
+};
+
+/**
+ * A directory entry of a bitmap bundle.
+ * Offset and length are relative to the beginning of the bundle buffer.
+ */
+struct RoaringBitmap32BundleEntry {
+  uint64_t offset;
+  uint64_t length;
+  uint32_t checksum;
+  uint8_t format;
+  uint16_t keyLength;
+  const char * key;
+};
+
+/**
+ * Read only view over a bitmap bundle, a buffer that contains many serialized bitmaps indexed by a string key.
+ *
+ * Layout (little endian):
+ *   header     "RBND", uint8 version, uint8 flags, uint16 reserved, uint32 count, uint32 directory size, uint32 directory crc32c
+ *   directory  count entries of: uint64 offset, uint64 length, uint32 crc32c, uint8 format, uint8 reserved, uint16 key length, key
+ *   payloads   portable or frozen serialized bitmaps, frozen payloads are aligned to 32 bytes.
+ *
+ * The bundle keeps a reference to the buffer and deserializes single bitmaps on demand.
+ */
+class RoaringBitmap32Bundle final {
+ public:
+  enum { allocatedMemoryDelta = 1024 };
+
+  enum { formatVersion = 1, headerSize = 20, entryHeaderSize = 24, frozenAlignment = 32 };
+  enum { flagChecksum = 1 };
+  enum { formatPortable = 0, formatFrozen = 1 };
+
+  static const char magic[4];
+
+  v8::Persistent<v8::Object> persistent;
+  v8::Persistent<v8::Object> buffer;
+  v8utils::TypedArrayContent<uint8_t> content;
+  bool hasChecksums;
+  std::vector<RoaringBitmap32BundleEntry> entries;
+  std::unordered_map<std::string, uint32_t> index;
+
+  static void Init(v8::Local<v8::Object> exports, AddonData * addonData);
+  static void New(const v8::FunctionCallbackInfo<v8::Value> & info);
+
+  static void keys(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void has(const v8::FunctionCallbackInfo<v8::Value> & info);
+  static void get(const v8::FunctionCallbackInfo<v8::Value> & info);
+
+  int64_t find(v8::Isolate * isolate, v8::Local<v8::Value> key) const;
+
+  // Thread safe, can be called from a worker thread.
+  DeserializeResult deserializeEntry(uint32_t entryIndex) const;
+
+  RoaringBitmap32Bundle();
+  ~RoaringBitmap32Bundle();
+
+ private:
+  const char * parse();
+  static void WeakCallback(v8::WeakCallbackInfo<RoaringBitmap32Bundle> const & info);
+};
+
 #endif
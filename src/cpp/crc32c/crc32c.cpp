@@ -0,0 +1,184 @@
+#include "crc32c.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#  define CRC32C_HARDWARE_X64 1
+#  include <nmmintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  endif
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && defined(__ARM_FEATURE_CRC32)
+#  define CRC32C_HARDWARE_ARM64 1
+#  include <arm_acle.h>
+#endif
+
+/////////////// crc32c ///////////////
+
+namespace crc32c {
+
+  namespace {
+
+    // Reflected Castagnoli polynomial
+    const uint32_t POLYNOMIAL = 0x82F63B78;
+
+    // Slicing by 8 lookup tables
+    struct Tables {
+      uint32_t t[8][256];
+
+      Tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+          uint32_t c = i;
+          for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? (c >> 1) ^ POLYNOMIAL : c >> 1;
+          }
+          t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+          for (int k = 1; k < 8; ++k) {
+            t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+          }
+        }
+      }
+    };
+
+    const Tables & getTables() {
+      static const Tables tables;
+      return tables;
+    }
+
+    uint32_t extendSoftware(uint32_t crc, const uint8_t * p, size_t length) {
+      const uint32_t(*t)[256] = getTables().t;
+
+      crc = ~crc;
+
+      while (length != 0 && ((uintptr_t)p & 7) != 0) {
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        --length;
+      }
+
+      while (length >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^ t[3][hi & 0xFF] ^
+              t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        p += 8;
+        length -= 8;
+      }
+
+      while (length != 0) {
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        --length;
+      }
+
+      return ~crc;
+    }
+
+#if defined(CRC32C_HARDWARE_X64)
+
+    // SSE4.2 crc32 instruction, selected at runtime.
+
+#  if defined(__GNUC__) || defined(__clang__)
+    __attribute__((target("sse4.2")))
+#  endif
+    uint32_t
+    extendHardware(uint32_t crc, const uint8_t * p, size_t length) {
+      uint64_t c = ~crc;
+
+      while (length != 0 && ((uintptr_t)p & 7) != 0) {
+        c = _mm_crc32_u8((uint32_t)c, *p++);
+        --length;
+      }
+
+      while (length >= 32) {
+        uint64_t v0, v1, v2, v3;
+        memcpy(&v0, p, 8);
+        memcpy(&v1, p + 8, 8);
+        memcpy(&v2, p + 16, 8);
+        memcpy(&v3, p + 24, 8);
+        c = _mm_crc32_u64(c, v0);
+        c = _mm_crc32_u64(c, v1);
+        c = _mm_crc32_u64(c, v2);
+        c = _mm_crc32_u64(c, v3);
+        p += 32;
+        length -= 32;
+      }
+
+      while (length >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        length -= 8;
+      }
+
+      while (length != 0) {
+        c = _mm_crc32_u8((uint32_t)c, *p++);
+        --length;
+      }
+
+      return ~(uint32_t)c;
+    }
+
+    bool detectHardware() {
+#  if defined(_MSC_VER) && !defined(__clang__)
+      int info[4];
+      __cpuid(info, 1);
+      return (info[2] & (1 << 20)) != 0;
+#  else
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse4.2") != 0;
+#  endif
+    }
+
+    bool hasHardware() {
+      static const bool result = detectHardware();
+      return result;
+    }
+
+#elif defined(CRC32C_HARDWARE_ARM64)
+
+    // ARMv8 CRC32 extension, enabled at compile time.
+
+    uint32_t extendHardware(uint32_t crc, const uint8_t * p, size_t length) {
+      uint32_t c = ~crc;
+
+      while (length != 0 && ((uintptr_t)p & 7) != 0) {
+        c = __crc32cb(c, *p++);
+        --length;
+      }
+
+      while (length >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c = __crc32cd(c, v);
+        p += 8;
+        length -= 8;
+      }
+
+      while (length != 0) {
+        c = __crc32cb(c, *p++);
+        --length;
+      }
+
+      return ~c;
+    }
+
+    inline bool hasHardware() { return true; }
+
+#endif
+
+  }  // namespace
+
+  uint32_t extend(uint32_t crc, const void * data, size_t length) {
+#if defined(CRC32C_HARDWARE_X64) || defined(CRC32C_HARDWARE_ARM64)
+    if (hasHardware()) {
+      return extendHardware(crc, (const uint8_t *)data, length);
+    }
+#endif
+    return extendSoftware(crc, (const uint8_t *)data, length);
+  }
+
+}  // namespace crc32c
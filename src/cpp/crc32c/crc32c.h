@@ -0,0 +1,20 @@
+#ifndef __CRC32C__H__
+#define __CRC32C__H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace crc32c {
+
+  /**
+   * Extends a CRC-32C (Castagnoli) checksum with the given data.
+   * Start with crc = 0. extend(extend(0, a), b) is equal to the checksum of the concatenation of a and b.
+   * Thread safe, can be called from worker threads.
+   */
+  uint32_t extend(uint32_t crc, const void * data, size_t length);
+
+  inline uint32_t value(const void * data, size_t length) { return extend(0, data, length); }
+
+}  // namespace crc32c
+
+#endif
@@ -3,32 +3,13 @@
 #ifdef _MSC_VER
 #  define atomicIncrement32(ptr) InterlockedIncrement(ptr)
 #  define atomicDecrement32(ptr) InterlockedDecrement(ptr)
+#  define atomicFetchAdd32(ptr, value) InterlockedExchangeAdd(ptr, value)
 #else
 #  define atomicIncrement32(ptr) __sync_add_and_fetch(ptr, 1)
 #  define atomicDecrement32(ptr) __sync_sub_and_fetch(ptr, 1)
+#  define atomicFetchAdd32(ptr, value) __sync_fetch_and_add(ptr, value)
 #endif
 
-/////////////// JSTypes ///////////////
-
-v8::Eternal<v8::Object> JSTypes::Uint32Array;
-v8::Eternal<v8::Function> JSTypes::Uint32Array_from;
-
-void JSTypes::initJSTypes(v8::Isolate * isolate, const v8::Local<v8::Object> & global) {
-  v8::HandleScope scope(isolate);
-  auto context = isolate->GetCurrentContext();
-
-  auto uint32Array = global->Get(context, NEW_LITERAL_V8_STRING(isolate, "Uint32Array", v8::NewStringType::kInternalized))
-                       .ToLocalChecked()
-                       ->ToObject(context)
-                       .ToLocalChecked();
-
-  JSTypes::Uint32Array.Set(isolate, uint32Array);
-  JSTypes::Uint32Array_from.Set(
-    isolate,
-    v8::Local<v8::Function>::Cast(
-      uint32Array->Get(context, NEW_LITERAL_V8_STRING(isolate, "from", v8::NewStringType::kInternalized)).ToLocalChecked()));
-}
-
 /////////////// v8utils ///////////////
 
 namespace v8utils {
@@ -92,15 +73,458 @@ namespace v8utils {
     isolate->ThrowException(v8::Exception::TypeError(msg.IsEmpty() ? v8::String::Empty(isolate) : msg.ToLocalChecked()));
   }
 
+  /////////////// ThreadPool ///////////////
+
+  namespace ThreadPool {
+
+    struct _Task {
+      Callback callback;
+      void * data;
+      AsyncPriority priority;
+      uint64_t sequence;
+      const void * owner;
+
+      // std::priority_queue pops the largest element: higher priority first, then first in first out.
+      inline bool operator<(const _Task & other) const {
+        return priority != other.priority ? priority < other.priority : sequence > other.sequence;
+      }
+    };
+
+    struct _State {
+      std::mutex mutex;
+      std::condition_variable condition;
+      std::priority_queue<_Task> queue;
+      std::vector<std::thread> threads;
+      uint64_t sequence = 0;
+      uint32_t size = 0;
+      uint32_t running = 0;
+      bool stopping = false;
+    };
+
+    // Never deleted, the threads may still be waiting when the process exits.
+    static _State & _state() {
+      static _State * state = new _State();
+      return *state;
+    }
+
+    static void _threadMain() {
+      _State & state = _state();
+      std::unique_lock<std::mutex> lock(state.mutex);
+      for (;;) {
+        if (state.running > state.size || state.stopping) {
+          --state.running;
+          return;
+        }
+        if (state.queue.empty()) {
+          state.condition.wait(lock);
+          continue;
+        }
+        _Task task = state.queue.top();
+        state.queue.pop();
+        lock.unlock();
+        task.callback(task.data);
+        lock.lock();
+      }
+    }
+
+    // Must be called with the mutex locked.
+    static void _startThreads(_State & state) {
+      if (state.size == 0) {
+        state.size = getCpusCount();
+      }
+      while (state.running < state.size) {
+        state.threads.emplace_back(_threadMain);
+        ++state.running;
+      }
+    }
+
+    uint32_t getSize() {
+      _State & state = _state();
+      std::lock_guard<std::mutex> lock(state.mutex);
+      if (state.size == 0) {
+        state.size = getCpusCount();
+      }
+      return state.size;
+    }
+
+    void setSize(uint32_t size) {
+      _State & state = _state();
+      std::lock_guard<std::mutex> lock(state.mutex);
+      state.size = size != 0 ? size : getCpusCount();
+      if (state.running > state.size) {
+        state.condition.notify_all();
+      } else if (state.running != 0) {
+        _startThreads(state);
+      }
+    }
+
+    void post(Callback callback, void * data, AsyncPriority priority, const void * owner) {
+      _State & state = _state();
+      {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.queue.push(_Task{callback, data, priority, state.sequence++, owner});
+        _startThreads(state);
+      }
+      state.condition.notify_one();
+    }
+
+    void stop() {
+      _State & state = _state();
+      std::vector<std::thread> threads;
+      {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.stopping = true;
+        threads.swap(state.threads);
+      }
+      state.condition.notify_all();
+      for (std::thread & thread : threads) {
+        thread.join();
+      }
+      std::lock_guard<std::mutex> lock(state.mutex);
+      state.stopping = false;
+    }
+
+    uint32_t cancel(const void * owner) {
+      _State & state = _state();
+      std::lock_guard<std::mutex> lock(state.mutex);
+      std::priority_queue<_Task> kept;
+      uint32_t removed = 0;
+      for (; !state.queue.empty(); state.queue.pop()) {
+        if (state.queue.top().owner == owner) {
+          ++removed;
+        } else {
+          kept.push(state.queue.top());
+        }
+      }
+      state.queue.swap(kept);
+      return removed;
+    }
+
+  }  // namespace ThreadPool
+
+  /////////////// AsyncEnvironment ///////////////
+
+  struct _Environments {
+    std::mutex mutex;
+    AsyncEnvironment * first = nullptr;
+  };
+
+  // Never deleted, like the thread pool state.
+  static _Environments & _environments() {
+    static _Environments * environments = new _Environments();
+    return *environments;
+  }
+
+  AsyncEnvironment::AsyncEnvironment(v8::Isolate * isolate) :
+    _isolate(isolate),
+    _refs(1),
+    _alive(true),
+    _closingHandles(0),
+    _cleanedUp(false),
+#ifdef V8UTILS_ASYNC_CLEANUP_HOOK
+    _cleanupDone(nullptr),
+    _cleanupDoneArg(nullptr),
+#endif
+    _jobs(nullptr),
+    _next(nullptr) {}
+
+  AsyncEnvironment * AsyncEnvironment::get(v8::Isolate * isolate) {
+    _Environments & environments = _environments();
+    std::lock_guard<std::mutex> lock(environments.mutex);
+    for (AsyncEnvironment * environment = environments.first; environment != nullptr; environment = environment->_next) {
+      if (environment->_isolate == isolate) {
+        return environment;
+      }
+    }
+    auto * environment = new AsyncEnvironment(isolate);
+    environment->_next = environments.first;
+    environments.first = environment;
+#if defined(V8UTILS_ASYNC_CLEANUP_HOOK)
+    environment->_cleanupHook = node::AddEnvironmentCleanupHook(isolate, AsyncEnvironment::_cleanup, environment);
+#elif NODE_MAJOR_VERSION >= 10
+    node::AddEnvironmentCleanupHook(isolate, AsyncEnvironment::_cleanup, environment);
+#endif
+    return environment;
+  }
+
+  bool AsyncEnvironment::_post(ThreadPool::Callback callback, void * data, AsyncPriority priority) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!_alive) {
+        return false;
+      }
+      ++_refs;
+    }
+    ThreadPool::post(callback, data, priority, this);
+    return true;
+  }
+
+  void AsyncEnvironment::_release(uv_async_t * async) {
+    bool last;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (async != nullptr && _alive) {
+        uv_async_send(async);
+      }
+      last = --_refs == 0;
+      if (!_alive) {
+        _condition.notify_all();
+      }
+    }
+    if (last) {
+      delete this;
+    }
+  }
+
+  void AsyncEnvironment::_addJob(AsyncWorker * worker) {
+    worker->_environment = this;
+    worker->_prevJob = nullptr;
+    worker->_nextJob = _jobs;
+    if (_jobs != nullptr) {
+      _jobs->_prevJob = worker;
+    }
+    _jobs = worker;
+  }
+
+  void AsyncEnvironment::_removeJob(AsyncWorker * worker) {
+    if (worker->_prevJob != nullptr) {
+      worker->_prevJob->_nextJob = worker->_nextJob;
+    } else if (_jobs == worker) {
+      _jobs = worker->_nextJob;
+    }
+    if (worker->_nextJob != nullptr) {
+      worker->_nextJob->_prevJob = worker->_prevJob;
+    }
+    worker->_prevJob = nullptr;
+    worker->_nextJob = nullptr;
+  }
+
+  void AsyncEnvironment::_closeHandle(uv_async_t * handle) {
+    handle->data = this;
+    ++_closingHandles;
+    uv_close(reinterpret_cast<uv_handle_t *>(handle), AsyncEnvironment::_handleClosed);
+  }
+
+  void AsyncEnvironment::_handleClosed(uv_handle_t * handle) {
+    auto * environment = static_cast<AsyncEnvironment *>(handle->data);
+    delete reinterpret_cast<uv_async_t *>(handle);
+    if (--environment->_closingHandles == 0 && environment->_cleanedUp) {
+      environment->_cleanupCompleted();
+    }
+  }
+
+  void AsyncEnvironment::_cleanupCompleted() {
+#ifdef V8UTILS_ASYNC_CLEANUP_HOOK
+    void (*done)(void *) = _cleanupDone;
+    void * doneArg = _cleanupDoneArg;
+    _release(nullptr);
+    done(doneArg);
+#else
+    _release(nullptr);
+#endif
+  }
+
+#ifdef V8UTILS_ASYNC_CLEANUP_HOOK
+  void AsyncEnvironment::_cleanup(void * param, void (*done)(void * arg), void * doneArg) {
+    auto * environment = static_cast<AsyncEnvironment *>(param);
+    environment->_cleanupDone = done;
+    environment->_cleanupDoneArg = doneArg;
+#else
+  void AsyncEnvironment::_cleanup(void * param) {
+    auto * environment = static_cast<AsyncEnvironment *>(param);
+#endif
+
+    {
+      _Environments & environments = _environments();
+      std::lock_guard<std::mutex> lock(environments.mutex);
+      AsyncEnvironment ** link = &environments.first;
+      while (*link != environment) {
+        link = &(*link)->_next;
+      }
+      *link = environment->_next;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(environment->_mutex);
+      environment->_alive = false;
+    }
+
+    // The running callbacks stop as soon as they check hasError().
+    for (AsyncWorker * job = environment->_jobs; job != nullptr; job = job->_nextJob) {
+      job->abort();
+    }
+
+    uint32_t removed = ThreadPool::cancel(environment);
+    {
+      std::unique_lock<std::mutex> lock(environment->_mutex);
+      environment->_refs -= removed;
+      environment->_condition.wait(lock, [environment] { return environment->_refs == 1; });
+    }
+
+    // No thread references the workers anymore. JavaScript cannot run here, the abort listeners are just dropped.
+    while (environment->_jobs != nullptr) {
+      AsyncWorker * job = environment->_jobs;
+      job->_abortListener.Reset();
+      job->_abortSignal.Reset();
+      delete job;
+    }
+
+    // Node unloads the addon when the last environment that loaded it exits, the threads must not outlive it.
+    {
+      _Environments & environments = _environments();
+      std::lock_guard<std::mutex> lock(environments.mutex);
+      if (environments.first == nullptr) {
+        ThreadPool::stop();
+      }
+    }
+
+    environment->_cleanedUp = true;
+    if (environment->_closingHandles == 0) {
+      environment->_cleanupCompleted();
+    }
+  }
+
   /////////////// AsyncWorker ///////////////
 
-  AsyncWorker::AsyncWorker(v8::Isolate * isolate) : isolate(isolate), _error(nullptr), _completed(false) {
-    _task.data = this;
+  static uv_loop_t * _getEventLoop(v8::Isolate * isolate) {
+#if NODE_MAJOR_VERSION >= 10
+    uv_loop_t * loop = node::GetCurrentEventLoop(isolate);
+    if (loop != nullptr) {
+      return loop;
+    }
+#endif
+    return uv_default_loop();
   }
 
+  AsyncWorker::AsyncWorker(v8::Isolate * isolate) :
+    isolate(isolate),
+    priority(AsyncPriority::Normal),
+    _environment(nullptr),
+    _prevJob(nullptr),
+    _nextJob(nullptr),
+    _async(nullptr),
+    _error(nullptr),
+    _completed(false),
+    _aborted(false) {}
+
   AsyncWorker::~AsyncWorker() {
+    if (_environment != nullptr) {
+      _environment->_removeJob(this);
+    }
+    if (_async != nullptr) {
+      _environment->_closeHandle(_async);
+      _async = nullptr;
+    }
+    _removeAbortListener();
     _callback.Reset();
     _resolver.Reset();
+    _abortSignal.Reset();
+    _abortListener.Reset();
+  }
+
+  void AsyncWorker::abort() {
+    _aborted = true;
+    setError("The operation was aborted");
+  }
+
+  bool AsyncWorker::setAbortSignal(v8::Local<v8::Value> signal) {
+    if (signal.IsEmpty() || !signal->IsObject()) return false;
+
+    v8::HandleScope scope(isolate);
+    auto context = isolate->GetCurrentContext();
+    auto signalObject = v8::Local<v8::Object>::Cast(signal);
+
+    v8::Local<v8::Value> aborted;
+    v8::Local<v8::Value> addEventListener;
+    if (
+      !signalObject->Get(context, NEW_LITERAL_V8_STRING(isolate, "aborted", v8::NewStringType::kInternalized))
+         .ToLocal(&aborted) ||
+      !aborted->IsBoolean() ||
+      !signalObject->Get(context, NEW_LITERAL_V8_STRING(isolate, "addEventListener", v8::NewStringType::kInternalized))
+         .ToLocal(&addEventListener) ||
+      !addEventListener->IsFunction()) {
+      return false;
+    }
+
+    _abortSignal.Reset(isolate, signalObject);
+
+    if (aborted->IsTrue()) {
+      abort();
+      return true;
+    }
+
+    v8::Local<v8::Function> listener;
+    if (!v8::Function::New(context, AsyncWorker::_onAbort, v8::External::New(isolate, this)).ToLocal(&listener)) {
+      return false;
+    }
+
+    v8::Local<v8::Value> argv[] = {NEW_LITERAL_V8_STRING(isolate, "abort", v8::NewStringType::kInternalized), listener};
+    if (v8::Local<v8::Function>::Cast(addEventListener)->Call(context, signalObject, 2, argv).IsEmpty()) {
+      return false;
+    }
+
+    _abortListener.Reset(isolate, listener);
+    return true;
+  }
+
+  void AsyncWorker::_onAbort(const v8::FunctionCallbackInfo<v8::Value> & info) {
+    auto * worker = static_cast<AsyncWorker *>(v8::Local<v8::External>::Cast(info.Data())->Value());
+    worker->abort();
+  }
+
+  void AsyncWorker::_removeAbortListener() {
+    if (_abortListener.IsEmpty()) {
+      return;
+    }
+
+    v8::HandleScope scope(isolate);
+    auto context = isolate->GetCurrentContext();
+    auto signal = _abortSignal.Get(isolate);
+    v8::Local<v8::Value> removeEventListener;
+    if (
+      signal->Get(context, NEW_LITERAL_V8_STRING(isolate, "removeEventListener", v8::NewStringType::kInternalized))
+        .ToLocal(&removeEventListener) &&
+      removeEventListener->IsFunction()) {
+      v8::Local<v8::Value> argv[] = {
+        NEW_LITERAL_V8_STRING(isolate, "abort", v8::NewStringType::kInternalized), _abortListener.Get(isolate)};
+      ignoreMaybeResult(v8::Local<v8::Function>::Cast(removeEventListener)->Call(context, signal, 2, argv));
+    }
+    _abortListener.Reset();
+  }
+
+  v8::Local<v8::Value> AsyncWorker::_createAbortError() {
+    v8::EscapableHandleScope scope(isolate);
+    auto context = isolate->GetCurrentContext();
+
+    auto error = v8::Exception::Error(
+      NEW_LITERAL_V8_STRING(isolate, "The operation was aborted", v8::NewStringType::kInternalized));
+    v8::Local<v8::Object> errorObject;
+    if (!error->ToObject(context).ToLocal(&errorObject)) {
+      return scope.Escape(error);
+    }
+
+    ignoreMaybeResult(errorObject->Set(
+      context,
+      NEW_LITERAL_V8_STRING(isolate, "name", v8::NewStringType::kInternalized),
+      NEW_LITERAL_V8_STRING(isolate, "AbortError", v8::NewStringType::kInternalized)));
+    ignoreMaybeResult(errorObject->Set(
+      context,
+      NEW_LITERAL_V8_STRING(isolate, "code", v8::NewStringType::kInternalized),
+      NEW_LITERAL_V8_STRING(isolate, "ABORT_ERR", v8::NewStringType::kInternalized)));
+
+    if (!_abortSignal.IsEmpty()) {
+      v8::Local<v8::Value> reason;
+      if (
+        _abortSignal.Get(isolate)
+          ->Get(context, NEW_LITERAL_V8_STRING(isolate, "reason", v8::NewStringType::kInternalized))
+          .ToLocal(&reason) &&
+        !reason->IsUndefined()) {
+        ignoreMaybeResult(
+          errorObject->Set(context, NEW_LITERAL_V8_STRING(isolate, "cause", v8::NewStringType::kInternalized), reason));
+      }
+    }
+
+    return scope.Escape(errorObject);
   }
 
   bool AsyncWorker::setCallback(v8::Local<v8::Value> callback) {
@@ -109,12 +533,27 @@ namespace v8utils {
     return true;
   }
 
-  bool AsyncWorker::_start() {
-    if (uv_queue_work(uv_default_loop(), &_task, AsyncWorker::_work, AsyncWorker::_done) != 0) {
+  bool AsyncWorker::_initAsync() {
+    auto * handle = new uv_async_t();
+    handle->data = this;
+    if (uv_async_init(_getEventLoop(isolate), handle, AsyncWorker::_asyncDone) != 0) {
+      delete handle;
       setError("Error starting async thread");
       return false;
     }
+    _async = handle;
+    AsyncEnvironment::get(isolate)->_addJob(this);
+    return true;
+  }
 
+  bool AsyncWorker::_start() {
+    if (!_initAsync()) {
+      return false;
+    }
+    if (!_environment->_post(AsyncWorker::_work, this, priority)) {
+      setError("Error starting async thread");
+      return false;
+    }
     return true;
   }
 
@@ -146,18 +585,18 @@ namespace v8utils {
 
   v8::Local<v8::Value> AsyncWorker::done() { return {}; }
 
-  void AsyncWorker::_work(uv_work_t * request) {
-    auto * worker = static_cast<AsyncWorker *>(request->data);
+  void AsyncWorker::_work(void * data) {
+    auto * worker = static_cast<AsyncWorker *>(data);
     if (!worker->hasError()) {
       worker->work();
     }
+    worker->_environment->_release(worker->_async);
   }
 
-  void AsyncWorker::_done(uv_work_t * request, int status) {
-    auto * worker = static_cast<AsyncWorker *>(request->data);
-    if (status != 0) {
-      worker->setError("Error executing async thread");
-    }
+  void AsyncWorker::_asyncDone(uv_async_t * handle) {
+    auto * worker = static_cast<AsyncWorker *>(handle->data);
+    worker->_async = nullptr;
+    worker->_environment->_closeHandle(handle);
     _complete(worker);
   }
 
@@ -187,7 +626,10 @@ namespace v8utils {
       }
     }
 
-    if (_error != nullptr && result.IsEmpty()) {
+    if (_aborted) {
+      isError = true;
+      result = _createAbortError();
+    } else if (_error != nullptr && result.IsEmpty()) {
       isError = true;
       v8::MaybeLocal<v8::String> message = v8::String::NewFromUtf8(isolate, _error, v8::NewStringType::kNormal);
       result = v8::Exception::Error(message.IsEmpty() ? v8::String::Empty(isolate) : message.ToLocalChecked());
@@ -210,6 +652,8 @@ namespace v8utils {
     v8::Isolate * isolate = worker->isolate;
     v8::HandleScope scope(isolate);
 
+    worker->_removeAbortListener();
+
     v8::Local<v8::Value> result = worker->_invokeDone();
 
     bool hasError = worker->hasError();
@@ -248,20 +692,66 @@ namespace v8utils {
   /////////////// ParallelAsyncWorker ///////////////
 
   ParallelAsyncWorker::ParallelAsyncWorker(v8::Isolate * isolate) :
-    AsyncWorker(isolate), loopCount(0), concurrency(0), _tasks(nullptr), _pendingTasks(0), _currentIndex(0) {}
+    AsyncWorker(isolate),
+    loopCount(0),
+    concurrency(0),
+    chunkSize(0),
+    largestFirst(false),
+    _order(nullptr),
+    _autoChunkSize(false),
+    _pendingTasks(0),
+    _currentIndex(0) {}
 
-  ParallelAsyncWorker::~ParallelAsyncWorker() { delete[] _tasks; }
+  ParallelAsyncWorker::~ParallelAsyncWorker() { delete[] _order; }
+
+  uint64_t ParallelAsyncWorker::parallelWorkSize(uint32_t /*index*/) { return 0; }
+
+  bool ParallelAsyncWorker::nextParallelPhase() { return false; }
 
   void ParallelAsyncWorker::work() {
+    do {
+      const uint32_t c = loopCount;
+      const uint32_t * order = _order;
+      for (uint32_t i = 0; i != c && !hasError() && !_completed; ++i) {
+        parallelWork(order != nullptr ? order[i] : i);
+      }
+    } while (_nextPhase());
+  }
+
+  bool ParallelAsyncWorker::_nextPhase() {
+    delete[] _order;
+    _order = nullptr;
+    _currentIndex = 0;
+    return !hasError() && nextParallelPhase();
+  }
+
+  bool ParallelAsyncWorker::_sortLargestFirst() {
     const uint32_t c = loopCount;
-    for (uint32_t i = 0; i != c && !hasError() && !_completed; ++i) {
-      parallelWork(i);
+    auto * sizes = new uint64_t[c];
+    auto * order = new uint32_t[c];
+    if (sizes == nullptr || order == nullptr) {
+      delete[] sizes;
+      delete[] order;
+      setError("Failed to allocate memory");
+      return false;
+    }
+    for (uint32_t i = 0; i != c; ++i) {
+      sizes[i] = parallelWorkSize(i);
+      order[i] = i;
     }
+    std::stable_sort(order, order + c, [sizes](uint32_t a, uint32_t b) { return sizes[a] > sizes[b]; });
+    delete[] sizes;
+    _order = order;
+    return true;
   }
 
   bool ParallelAsyncWorker::_start() {
+    if (largestFirst && loopCount > 1 && !_sortLargestFirst()) {
+      return false;
+    }
+
     if (concurrency == 0) {
-      concurrency = getCpusCount();
+      concurrency = ThreadPool::getSize();
     }
 
     uint32_t tasksCount = concurrency < loopCount ? concurrency : loopCount;
@@ -270,68 +760,67 @@ namespace v8utils {
       return AsyncWorker::_start();
     }
 
-    auto * tasks = new uv_work_t[tasksCount]();
-    if (tasks == nullptr) {
-      this->setError("Failed to allocate memory");
+    if (!_initAsync()) {
       return false;
     }
 
-    _tasks = tasks;
+    _autoChunkSize = chunkSize == 0;
+    _postPhase();
+    return true;
+  }
 
-    for (uint32_t taskIndex = 0; taskIndex != tasksCount; ++taskIndex) {
-      tasks[taskIndex].data = this;
+  void ParallelAsyncWorker::_postPhase() {
+    uint32_t tasksCount = concurrency < loopCount ? concurrency : loopCount;
+    if (tasksCount < 1) {
+      tasksCount = 1;
+    }
+
+    if (_autoChunkSize) {
+      // Few items per chunk keep the threads balanced, bigger chunks reduce the contention on the shared index.
+      chunkSize = loopCount / (tasksCount * 16);
+      chunkSize = chunkSize < 1 ? 1 : chunkSize > 1024 ? 1024 : chunkSize;
     }
 
+    // The worker may be deleted as soon as the last task is posted, only locals are used in the loop.
+    AsyncEnvironment * environment = _environment;
+    const AsyncPriority taskPriority = priority;
+    _pendingTasks = (int32_t)tasksCount;
     for (uint32_t taskIndex = 0; taskIndex != tasksCount; ++taskIndex) {
-      if (
-        uv_queue_work(
-          uv_default_loop(), &tasks[taskIndex], ParallelAsyncWorker::_parallelWork, ParallelAsyncWorker::_parallelDone) !=
-        0) {
-        setError("Error starting async parallel task");
+      if (!environment->_post(ParallelAsyncWorker::_parallelWork, this, taskPriority)) {
         break;
       }
-      ++_pendingTasks;
     }
-
-    return _pendingTasks > 0;
   }
 
-  void ParallelAsyncWorker::_parallelWork(uv_work_t * request) {
-    auto * worker = static_cast<ParallelAsyncWorker *>(request->data);
+  void ParallelAsyncWorker::_parallelWork(void * data) {
+    auto * worker = static_cast<ParallelAsyncWorker *>(data);
+    AsyncEnvironment * environment = worker->_environment;
 
-    uint32_t loopCount = worker->loopCount;
+    const uint32_t loopCount = worker->loopCount;
+    const uint32_t chunkSize = worker->chunkSize;
+    const uint32_t * order = worker->_order;
     while (!worker->hasError() && !worker->_completed) {
-      const uint32_t prevIndex = worker->_currentIndex;
-      const uint32_t index = atomicIncrement32(&worker->_currentIndex) - 1;
-      if (index >= loopCount || index < prevIndex) {
+      const uint32_t begin = atomicFetchAdd32(&worker->_currentIndex, chunkSize);
+      if (begin >= loopCount) {
         break;
       }
-      worker->parallelWork(index);
-    }
-  }
-
-  void ParallelAsyncWorker::_parallelDone(uv_work_t * request, int /*status*/) {
-    auto * worker = static_cast<ParallelAsyncWorker *>(request->data);
-
-    if (worker->_completed) {
-#if NODE_MAJOR_VERSION > 13
-      worker->isolate->PerformMicrotaskCheckpoint();
-#else
-      worker->isolate->RunMicrotasks();
-#endif
-      return;
+      const uint32_t end = loopCount - begin < chunkSize ? loopCount : begin + chunkSize;
+      for (uint32_t i = begin; i != end && !worker->hasError(); ++i) {
+        worker->parallelWork(order != nullptr ? order[i] : i);
+      }
     }
 
-    if (--worker->_pendingTasks <= 0) {
-      _complete(worker);
-      return;
+    // The last task to complete starts the next phase or notifies the event loop.
+    // The other tasks must not touch the worker after the decrement, it may be already deleted.
+    uv_async_t * async = nullptr;
+    if (atomicDecrement32(&worker->_pendingTasks) == 0) {
+      if (worker->_nextPhase()) {
+        worker->_postPhase();
+      } else {
+        async = worker->_async;
+      }
     }
-
-#if NODE_MAJOR_VERSION > 13
-    worker->isolate->PerformMicrotaskCheckpoint();
-#else
-    worker->isolate->RunMicrotasks();
-#endif
+    environment->_release(async);
   }
 
 }  // namespace v8utils
@@ -5,24 +5,40 @@
 #include <node_buffer.h>
 #include <uv.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
 #if NODE_MAJOR_VERSION > 14
 #  define NEW_LITERAL_V8_STRING(isolate, str, type) v8::String::NewFromUtf8Literal(isolate, str, type)
 #else
 #  define NEW_LITERAL_V8_STRING(isolate, str, type) v8::String::NewFromUtf8(isolate, str, type).ToLocalChecked()
 #endif
 
-class JSTypes {
- public:
-  static v8::Eternal<v8::Object> Uint32Array;
-  static v8::Eternal<v8::Function> Uint32Array_from;
-
-  static void initJSTypes(v8::Isolate * isolate, const v8::Local<v8::Object> & global);
-};
-
 namespace v8utils {
 
   uint32_t getCpusCount();
 
+  /** Adds a read only accessor to the objects created from the given template. */
+  inline void setReadOnlyAccessor(
+    v8::Local<v8::ObjectTemplate> target, v8::Local<v8::String> name, v8::AccessorGetterCallback getter) {
+#if V8_MAJOR_VERSION >= 12
+    // AccessControl was removed in V8 12.
+    target->SetAccessor(name, getter, nullptr, v8::Local<v8::Value>(), v8::ReadOnly);
+#else
+    target->SetAccessor(
+      name,
+      getter,
+      nullptr,
+      v8::Local<v8::Value>(),
+      (v8::AccessControl)(v8::ALL_CAN_READ | v8::PROHIBITS_OVERWRITING),
+      (v8::PropertyAttribute)(v8::ReadOnly));
+#endif
+  }
+
   template <typename T>
   inline void ignoreMaybeResult(v8::Maybe<T>) {}
 
@@ -70,9 +86,13 @@ namespace v8utils {
 
   template <int N>
   void defineHiddenFunction(
-    v8::Isolate * isolate, v8::Local<v8::Object> target, const char (&literal)[N], v8::FunctionCallback callback) {
+    v8::Isolate * isolate,
+    v8::Local<v8::Object> target,
+    const char (&literal)[N],
+    v8::FunctionCallback callback,
+    v8::Local<v8::Value> data = v8::Local<v8::Value>()) {
     v8::HandleScope scope(isolate);
-    v8::Local<v8::FunctionTemplate> t = v8::FunctionTemplate::New(isolate, callback);
+    v8::Local<v8::FunctionTemplate> t = v8::FunctionTemplate::New(isolate, callback, data);
 
     auto name = NEW_LITERAL_V8_STRING(isolate, literal, v8::NewStringType::kInternalized);
     t->SetClassName(name);
@@ -147,6 +167,38 @@ namespace v8utils {
       this->data = nullptr;
       return false;
     }
+
+    // Like set, but accepts also an ArrayBuffer or a SharedArrayBuffer.
+    template <typename Q>
+    inline bool setBufferOrView(v8::Local<Q> from) {
+      if (!from.IsEmpty() && from->IsArrayBuffer()) {
+        auto buffer = v8::Local<v8::ArrayBuffer>::Cast(from);
+        this->length = buffer->ByteLength() / sizeof(T);
+        this->arrayBuffer = buffer;
+#if NODE_MAJOR_VERSION > 13
+        this->backingStore = buffer->GetBackingStore();
+        this->data = (T *)this->backingStore->Data();
+#else
+        this->data = (T *)buffer->GetContents().Data();
+#endif
+        return true;
+      }
+
+      if (!from.IsEmpty() && from->IsSharedArrayBuffer()) {
+        auto buffer = v8::Local<v8::SharedArrayBuffer>::Cast(from);
+        this->length = buffer->ByteLength() / sizeof(T);
+        this->arrayBuffer.Clear();
+#if NODE_MAJOR_VERSION > 13
+        this->backingStore = buffer->GetBackingStore();
+        this->data = (T *)this->backingStore->Data();
+#else
+        this->data = (T *)buffer->GetContents().Data();
+#endif
+        return true;
+      }
+
+      return this->set(from);
+    }
   };
 
   namespace ObjectWrap {
@@ -183,6 +235,12 @@ namespace v8utils {
       return ObjectWrap::TryUnwrap<T>(value, ctorTemplate.Get(isolate), isolate);
     }
 
+    template <class T>
+    static T * TryUnwrap(
+      const v8::Local<v8::Value> & value, const v8::Global<v8::FunctionTemplate> & ctorTemplate, v8::Isolate * isolate) {
+      return ObjectWrap::TryUnwrap<T>(value, ctorTemplate.Get(isolate), isolate);
+    }
+
     template <class T>
     static T * TryUnwrap(
       const v8::FunctionCallbackInfo<v8::Value> & info,
@@ -209,13 +267,115 @@ namespace v8utils {
       return info.Length() <= argumentIndex ? nullptr
                                             : ObjectWrap::TryUnwrap<T>(info[argumentIndex], ctorTemplate, info.GetIsolate());
     }
+
+    template <class T>
+    static T * TryUnwrap(
+      const v8::FunctionCallbackInfo<v8::Value> & info,
+      int argumentIndex,
+      const v8::Global<v8::FunctionTemplate> & ctorTemplate) {
+      return info.Length() <= argumentIndex ? nullptr
+                                            : ObjectWrap::TryUnwrap<T>(info[argumentIndex], ctorTemplate, info.GetIsolate());
+    }
   }  // namespace ObjectWrap
 
   typedef const char * const_char_ptr_t;
 
+  // Priority of a job in the thread pool. Jobs with an higher priority are started first.
+  enum class AsyncPriority : int32_t { Background = 0, Normal = 1, High = 2 };
+
+  // The thread pool used by AsyncWorker. It is separate from the libuv thread pool,
+  // so bitmap jobs do not compete with fs, dns and zlib for the libuv threads.
+  // Threads are started lazily and are shared between all the isolates of the process.
+  namespace ThreadPool {
+    typedef void (*Callback)(void * data);
+
+    // Gets the number of threads in the pool. Defaults to the number of CPUs.
+    uint32_t getSize();
+
+    // Sets the number of threads in the pool. Zero resets the size to the number of CPUs.
+    void setSize(uint32_t size);
+
+    // Enqueues a callback to be executed in one of the threads of the pool.
+    // The owner identifies the callbacks removed by cancel.
+    void post(Callback callback, void * data, AsyncPriority priority, const void * owner = nullptr);
+
+    // Removes the callbacks of the given owner that did not start yet. Returns the number of removed callbacks.
+    uint32_t cancel(const void * owner);
+
+    // Stops the threads and waits for them to exit. They are started again by the next post.
+    // Called when the last environment is cleaned up, node may unload the addon right after.
+    void stop();
+  }  // namespace ThreadPool
+
+  class AsyncWorker;
+
+#if NODE_MAJOR_VERSION > 14 || (NODE_MAJOR_VERSION == 14 && NODE_MINOR_VERSION >= 8) || \
+  (NODE_MAJOR_VERSION == 12 && NODE_MINOR_VERSION >= 19)
+#  define V8UTILS_ASYNC_CLEANUP_HOOK 1
+#endif
+
+  // The async jobs started by a node environment, the main thread or a worker thread.
+  // When the environment is cleaned up, the jobs are aborted, the callbacks not started yet are removed from the thread
+  // pool, the running ones are awaited, then the workers are deleted and their handles closed.
+  // It is refcounted and each callback posted to the thread pool holds a reference, so a thread never touches a freed
+  // worker, handle or event loop.
+  class AsyncEnvironment final {
+   public:
+    // Gets the environment of the given isolate, created on first use.
+    static AsyncEnvironment * get(v8::Isolate * isolate);
+
+   private:
+    v8::Isolate * const _isolate;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    uint32_t _refs;
+    bool _alive;
+
+    // Handles being closed. The cleanup completes when all of them are closed, node may unload the addon right after.
+    uint32_t _closingHandles;
+    bool _cleanedUp;
+
+#ifdef V8UTILS_ASYNC_CLEANUP_HOOK
+    node::AsyncCleanupHookHandle _cleanupHook;
+    void (*_cleanupDone)(void * arg);
+    void * _cleanupDoneArg;
+#endif
+
+    // The workers started in this environment and not deleted yet. Accessed only in the main thread of the environment.
+    AsyncWorker * _jobs;
+
+    AsyncEnvironment * _next;
+
+    explicit AsyncEnvironment(v8::Isolate * isolate);
+
+    // Posts a callback to the thread pool. Returns false if the environment was cleaned up.
+    bool _post(ThreadPool::Callback callback, void * data, AsyncPriority priority);
+
+    // Releases a reference, called by a thread of the pool when a posted callback returns.
+    // Notifies the event loop with the given handle if not null and the environment is still alive.
+    void _release(uv_async_t * async);
+
+    void _addJob(AsyncWorker * worker);
+    void _removeJob(AsyncWorker * worker);
+
+    void _closeHandle(uv_async_t * handle);
+    void _cleanupCompleted();
+    static void _handleClosed(uv_handle_t * handle);
+
+#ifdef V8UTILS_ASYNC_CLEANUP_HOOK
+    static void _cleanup(void * param, void (*done)(void * arg), void * doneArg);
+#else
+    static void _cleanup(void * param);
+#endif
+
+    friend class AsyncWorker;
+    friend class ParallelAsyncWorker;
+  };
+
   class AsyncWorker {
    public:
     v8::Isolate * const isolate;
+    AsyncPriority priority;
 
     explicit AsyncWorker(v8::Isolate * isolate);
 
@@ -233,6 +393,16 @@ namespace v8utils {
 
     inline void clearError() { this->_error = nullptr; }
 
+    inline bool isAborted() const { return this->_aborted; }
+
+    // Aborts the operation. The work stops as soon as it checks hasError(), and the operation fails with an AbortError.
+    void abort();
+
+    // Aborts the operation when the given AbortSignal is aborted.
+    // Any object with an "aborted" property and an "addEventListener" method is accepted.
+    // Returns false if the value is not an AbortSignal.
+    bool setAbortSignal(v8::Local<v8::Value> signal);
+
     static v8::Local<v8::Value> run(AsyncWorker * worker);
 
    protected:
@@ -243,27 +413,46 @@ namespace v8utils {
     virtual v8::Local<v8::Value> done();
 
    private:
-    uv_work_t _task{};
+    AsyncEnvironment * _environment;
+    AsyncWorker * _prevJob;
+    AsyncWorker * _nextJob;
+    uv_async_t * _async;
     volatile const_char_ptr_t _error;
     volatile bool _completed;
+    volatile bool _aborted;
     v8::Persistent<v8::Function> _callback;
     v8::Persistent<v8::Promise::Resolver> _resolver;
+    v8::Persistent<v8::Object> _abortSignal;
+    v8::Persistent<v8::Function> _abortListener;
 
     v8::Local<v8::Value> _invokeDone();
+    v8::Local<v8::Value> _createAbortError();
+    void _removeAbortListener();
+    static void _onAbort(const v8::FunctionCallbackInfo<v8::Value> & info);
+    bool _initAsync();
     virtual bool _start();
     static void _complete(AsyncWorker * worker);
     static void _resolveOrReject(AsyncWorker * worker);
-    static void _work(uv_work_t * request);
-    static void _done(uv_work_t * request, int status);
+    static void _work(void * data);
+    static void _asyncDone(uv_async_t * handle);
 
+    friend class AsyncEnvironment;
     friend class ParallelAsyncWorker;
   };
 
   class ParallelAsyncWorker : public AsyncWorker {
    public:
     uint32_t loopCount;
+
+    // Maximum number of threads used. Zero means the size of the thread pool.
     uint32_t concurrency;
 
+    // Number of consecutive indices taken by a thread at once. Zero means automatic.
+    uint32_t chunkSize;
+
+    // If true, indices are processed in descending order of parallelWorkSize.
+    bool largestFirst;
+
     explicit ParallelAsyncWorker(v8::Isolate * isolate);
     virtual ~ParallelAsyncWorker();
 
@@ -272,15 +461,26 @@ namespace v8utils {
 
     virtual void parallelWork(uint32_t index) = 0;
 
+    // The estimated cost of parallelWork(index), used when largestFirst is true. Called in the main thread.
+    virtual uint64_t parallelWorkSize(uint32_t index);
+
+    // Called in a thread after all the indices were processed without errors.
+    // To run another parallel phase, set loopCount and return true. largestFirst applies only to the first phase.
+    virtual bool nextParallelPhase();
+
    private:
-    uv_work_t * _tasks;
+    uint32_t * _order;
+    bool _autoChunkSize;
     volatile int32_t _pendingTasks;
     volatile uint32_t _currentIndex;
 
+    bool _sortLargestFirst();
+    bool _nextPhase();
+    void _postPhase();
+
     bool _start() override;
 
-    static void _parallelWork(uv_work_t * request);
-    static void _parallelDone(uv_work_t * request, int status);
+    static void _parallelWork(void * data);
   };
 
 }  // namespace v8utils
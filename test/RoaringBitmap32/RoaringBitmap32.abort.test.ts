@@ -0,0 +1,95 @@
+import RoaringBitmap32 from "../../RoaringBitmap32";
+import { expect } from "chai";
+
+async function expectAbortError(promise: Promise<unknown>) {
+  let error: any;
+  try {
+    await promise;
+  } catch (e) {
+    error = e;
+  }
+  expect(error).to.be.instanceOf(Error);
+  expect(error.name).eq("AbortError");
+  expect(error.code).eq("ABORT_ERR");
+  return error;
+}
+
+function abortedSignal() {
+  const controller = new AbortController();
+  controller.abort();
+  return controller.signal;
+}
+
+describe("RoaringBitmap32 abort", () => {
+  afterEach(() => {
+    RoaringBitmap32.setThreadPoolSize(0);
+  });
+
+  it("rejects all the async operations with an already aborted signal", async () => {
+    const bitmap = RoaringBitmap32.fromRange(0, 1000);
+    const serialized = bitmap.serialize(false);
+    const diff = RoaringBitmap32.serializeDiff(bitmap, new RoaringBitmap32([1, 2, 3]));
+    const bundle = RoaringBitmap32.serializeBundle([["a", bitmap]]);
+
+    await expectAbortError(RoaringBitmap32.fromArrayAsync([1, 2, 3], { signal: abortedSignal() }));
+    await expectAbortError(RoaringBitmap32.deserializeAsync(serialized, false, { signal: abortedSignal() }));
+    await expectAbortError(RoaringBitmap32.deserializeParallelAsync([serialized], false, { signal: abortedSignal() }));
+    await expectAbortError(bitmap.serializeAsync(false, { signal: abortedSignal() }));
+    await expectAbortError(bitmap.serializeAsync(false, { compressed: true, signal: abortedSignal() }));
+    await expectAbortError(RoaringBitmap32.serializeDiffAsync(bitmap, bitmap, { signal: abortedSignal() }));
+    await expectAbortError(RoaringBitmap32.applyDiffAsync(bitmap, diff, { signal: abortedSignal() }));
+    await expectAbortError(RoaringBitmap32.deserializeBundleParallelAsync(bundle, ["a"], { signal: abortedSignal() }));
+  });
+
+  it("stops a running parallel operation", async () => {
+    RoaringBitmap32.setThreadPoolSize(1);
+    const serialized = RoaringBitmap32.fromRange(0, 1000000, 3).serialize(false);
+    const buffers = [];
+    for (let i = 0; i < 2000; ++i) {
+      buffers.push(serialized);
+    }
+    const controller = new AbortController();
+    const promise = RoaringBitmap32.deserializeParallelAsync(buffers, false, { signal: controller.signal });
+    controller.abort();
+    await expectAbortError(promise);
+  });
+
+  it("uses the abort reason as cause", async () => {
+    const controller = new AbortController();
+    const reason = new Error("timeout");
+    controller.abort(reason);
+    const error = await expectAbortError(
+      RoaringBitmap32.deserializeAsync(new RoaringBitmap32([1]).serialize(true), true, { signal: controller.signal }),
+    );
+    expect(error.cause).eq(reason);
+  });
+
+  it("passes the AbortError to the callback", (done) => {
+    RoaringBitmap32.deserializeAsync(new RoaringBitmap32([1]).serialize(true), true, { signal: abortedSignal() }, ((
+      error: any,
+      bitmap: RoaringBitmap32 | undefined,
+    ) => {
+      try {
+        expect(error.name).eq("AbortError");
+        expect(bitmap).to.be.undefined;
+        done();
+      } catch (e) {
+        done(e);
+      }
+    }) as any);
+  });
+
+  it("completes normally when the signal is not aborted", async () => {
+    const controller = new AbortController();
+    const bitmap = await RoaringBitmap32.fromArrayAsync([1, 2, 3], { signal: controller.signal });
+    expect(bitmap.toArray()).deep.equal([1, 2, 3]);
+    controller.abort();
+    const result = await RoaringBitmap32.deserializeAsync(bitmap.serialize(false), false, {});
+    expect(result.toArray()).deep.equal([1, 2, 3]);
+  });
+
+  it("throws a TypeError for an invalid signal", () => {
+    expect(() => RoaringBitmap32.fromArrayAsync([1], { signal: {} as any })).to.throw(TypeError);
+    expect(() => RoaringBitmap32.deserializeAsync(new Uint8Array(0), false, 123 as any)).to.throw(TypeError);
+  });
+});
@@ -24,6 +24,57 @@ describe("RoaringBitmap32 basic", () => {
     });
   });
 
+  describe("cached size, minimum and maximum", () => {
+    it("stay valid after single value changes", () => {
+      const bitmap = new RoaringBitmap32();
+      const expected = new Set<number>();
+      for (let i = 0; i < 5000; ++i) {
+        const value = (i * 2654435761) % 100000;
+        switch (i % 4) {
+          case 0:
+            bitmap.add(value);
+            expected.add(value);
+            break;
+          case 1:
+            expect(bitmap.tryAdd(value)).eq(!expected.has(value));
+            expected.add(value);
+            break;
+          case 2:
+            bitmap.remove(bitmap.minimum());
+            expected.delete(Math.min(...expected));
+            break;
+          default:
+            expect(bitmap.delete(bitmap.maximum())).eq(expected.size !== 0);
+            expected.delete(Math.max(...expected));
+            break;
+        }
+        expect(bitmap.size).eq(expected.size);
+        if (i % 100 === 0) {
+          const copy = new RoaringBitmap32(bitmap);
+          expect(bitmap.minimum()).eq(copy.minimum());
+          expect(bitmap.maximum()).eq(copy.maximum());
+        }
+      }
+    });
+
+    it("are updated by bulk operations", () => {
+      const bitmap = new RoaringBitmap32([5, 10]);
+      expect([bitmap.size, bitmap.minimum(), bitmap.maximum()]).deep.equal([2, 5, 10]);
+      bitmap.addRange(100, 200);
+      expect([bitmap.size, bitmap.minimum(), bitmap.maximum()]).deep.equal([102, 5, 199]);
+      bitmap.removeMany([5, 199]);
+      expect([bitmap.size, bitmap.minimum(), bitmap.maximum()]).deep.equal([100, 10, 198]);
+      bitmap.andInPlace(RoaringBitmap32.fromRange(150, 160));
+      expect([bitmap.size, bitmap.minimum(), bitmap.maximum()]).deep.equal([10, 150, 159]);
+      bitmap.clear();
+      expect([bitmap.size, bitmap.minimum(), bitmap.maximum()]).deep.equal([0, 4294967295, 0]);
+      bitmap.add(7);
+      expect([bitmap.size, bitmap.minimum(), bitmap.maximum()]).deep.equal([1, 7, 7]);
+      bitmap.remove(7);
+      expect([bitmap.size, bitmap.minimum(), bitmap.maximum()]).deep.equal([0, 4294967295, 0]);
+    });
+  });
+
   describe("toString", () => {
     it('returns "RoaringBitmap32', () => {
       expect(new RoaringBitmap32().toString()).eq("RoaringBitmap32");
@@ -70,6 +121,47 @@ describe("RoaringBitmap32 basic", () => {
       expect(bitmap2.isEmpty).eq(false);
       expect(Array.from(bitmap2.toUint32Array())).deep.equal(values);
     });
+
+    it("copies only the containers modified after the clone", () => {
+      const bitmap1 = RoaringBitmap32.fromRange(0, 1000000, 3);
+      const values = bitmap1.toArray();
+      const bitmap2 = bitmap1.clone();
+      const bitmap3 = bitmap2.clone();
+      bitmap2.add(1);
+      bitmap2.removeRange(300000, 400000);
+      bitmap1.add(999998);
+      bitmap1.addRange(2000000, 2000010);
+      expect(bitmap3.toArray()).deep.equal(values);
+      expect(bitmap2.has(1)).eq(true);
+      expect(bitmap2.has(300000)).eq(false);
+      expect(bitmap2.has(999998)).eq(false);
+      expect(bitmap2.size).eq(values.length + 1 - 33334);
+      expect(bitmap1.has(1)).eq(false);
+      expect(bitmap1.has(300000)).eq(true);
+      expect(bitmap1.size).eq(values.length + 11);
+      bitmap3.clear();
+      expect(bitmap1.has(0)).eq(true);
+      expect(bitmap2.has(0)).eq(true);
+    });
+
+    it("keeps shared containers consistent through optimization and serialization", async () => {
+      const bitmap1 = RoaringBitmap32.fromRange(0, 500000);
+      bitmap1.addMany([600000, 700000, 800000]);
+      const bitmap2 = bitmap1.clone();
+      bitmap1.removeRunCompression();
+      bitmap1.shrinkToFit();
+      bitmap2.runOptimize();
+      expect(bitmap1.isEqual(bitmap2)).eq(true);
+      const serialized = bitmap1.serialize(true);
+      expect(bitmap2.serialize("croaring").length).gt(0);
+      expect(RoaringBitmap32.deserialize(serialized, true).isEqual(bitmap2)).eq(true);
+      expect((await bitmap2.serializeAsync(true)).equals(bitmap2.serialize(true))).eq(true);
+      expect(RoaringBitmap32.frozenView(bitmap2.serializeFrozen()).isEqual(bitmap1)).eq(true);
+      const bitmap3 = bitmap2.clone();
+      bitmap3.add(1000000);
+      const diff = await RoaringBitmap32.serializeDiffAsync(bitmap2, bitmap3);
+      expect((await RoaringBitmap32.applyDiffAsync(bitmap2, diff)).isEqual(bitmap3)).eq(true);
+    });
   });
 
   describe("select", () => {
@@ -156,6 +248,81 @@ describe("RoaringBitmap32 basic", () => {
       expect(x).to.have.lengthOf(6);
       expect(Array.from(x)).deep.equal([1, 2, 10, 30, 0x7fffffff, 0xffffffff]);
     });
+
+    it("returns a big array", () => {
+      const bitmap = RoaringBitmap32.fromRange(100, 300000, 3);
+      const x = bitmap.toUint32Array();
+      expect(x).to.be.instanceOf(Uint32Array);
+      expect(x.byteOffset).eq(0);
+      expect(x.buffer.byteLength).eq(bitmap.size * 4);
+      expect(x.length).eq(bitmap.size);
+      expect(x[0]).eq(100);
+      expect(x[x.length - 1]).eq(299998);
+      expect(new RoaringBitmap32(x).isEqual(bitmap)).eq(true);
+    });
+  });
+
+  describe("toUint32ArrayAsync", () => {
+    it("returns an empty Uint32Array for an empty bitmap", async () => {
+      const a = await new RoaringBitmap32().toUint32ArrayAsync();
+      expect(a).to.be.instanceOf(Uint32Array);
+      expect(a).to.have.lengthOf(0);
+    });
+
+    it("returns all the values", async () => {
+      const bitmap = RoaringBitmap32.fromRange(100, 300000, 3);
+      bitmap.add(0xffffffff);
+      const expected = bitmap.toUint32Array();
+      const promise = bitmap.toUint32ArrayAsync();
+      bitmap.clear();
+      const x = await promise;
+      expect(x).to.be.instanceOf(Uint32Array);
+      expect(x).deep.equal(expected);
+      expect(x[0]).eq(100);
+      expect(x[x.length - 1]).eq(0xffffffff);
+    });
+
+    it("reads a snapshot while the bitmap is changed", async () => {
+      const bitmap = RoaringBitmap32.fromRange(0, 2000000, 2);
+      const expected = bitmap.toUint32Array();
+      const clone = bitmap.clone();
+      const promises = [bitmap.toUint32ArrayAsync(), bitmap.serializeAsync(true), bitmap.toTextAsync("csv")];
+      for (let i = 0; i < 2000000; i += 1001) {
+        bitmap.add(i + 1);
+      }
+      bitmap.removeRange(500000, 1500000);
+      bitmap.runOptimize();
+      bitmap.shrinkToFit();
+      const [array, serialized, text] = await Promise.all(promises);
+      expect(array).deep.equal(expected);
+      expect(RoaringBitmap32.deserialize(serialized as Buffer, true).isEqual(clone)).eq(true);
+      expect(RoaringBitmap32.fromText(text as string, "csv").isEqual(clone)).eq(true);
+      expect(clone.toUint32Array()).deep.equal(expected);
+    });
+
+    it("works with a callback", (done) => {
+      new RoaringBitmap32([1, 2, 3]).toUint32ArrayAsync((error, result) => {
+        try {
+          expect(error).eq(null);
+          expect(Array.from(result!)).deep.equal([1, 2, 3]);
+          done();
+        } catch (e) {
+          done(e);
+        }
+      });
+    });
+
+    it("supports an abort signal", async () => {
+      const controller = new AbortController();
+      controller.abort();
+      let error: any;
+      try {
+        await new RoaringBitmap32([1, 2, 3]).toUint32ArrayAsync({ signal: controller.signal });
+      } catch (e) {
+        error = e;
+      }
+      expect(error.name).eq("AbortError");
+    });
   });
 
   describe("rangeUint32Array", () => {
@@ -226,6 +393,15 @@ describe("RoaringBitmap32 basic", () => {
       const bitmap = new RoaringBitmap32([1, 2, 10, 30, 0x7fffffff, 0xffffffff]);
       expect(bitmap.toArray()).deep.equal([1, 2, 10, 30, 0x7fffffff, 0xffffffff]);
     });
+
+    it("returns all the values of a big bitmap", () => {
+      const bitmap = RoaringBitmap32.fromRange(0x3fff0000, 0x40010000, 3);
+      bitmap.addRange(0, 10000);
+      const array = bitmap.toArray();
+      expect(array.length).eq(bitmap.size);
+      expect(array).deep.equal(Array.from(bitmap.toUint32Array()));
+      expect(array.every((x) => Number.isInteger(x) && x >= 0)).eq(true);
+    });
   });
 
   describe("toSet", () => {
@@ -247,6 +423,15 @@ describe("RoaringBitmap32 basic", () => {
       expect(set).to.be.instanceOf(Set);
       expect(Array.from(set)).deep.equal(values);
     });
+
+    it("returns all the values of a big bitmap", () => {
+      const bitmap = RoaringBitmap32.fromRange(0x3fff0000, 0x40010000, 3);
+      const set = bitmap.toSet();
+      expect(set.size).eq(bitmap.size);
+      expect(set.has(0x3fff0000)).eq(true);
+      expect(set.has(0x3fff0001)).eq(false);
+      expect(Array.from(set)).deep.equal(bitmap.toArray());
+    });
   });
 
   describe("toJSON", () => {
@@ -270,6 +455,20 @@ describe("RoaringBitmap32 basic", () => {
     });
   });
 
+  describe("toJSONString", () => {
+    it("returns an empty JSON array for an empty bitmap", () => {
+      expect(new RoaringBitmap32().toJSONString()).eq("[]");
+    });
+
+    it("returns the same string as JSON.stringify", () => {
+      const bitmap = new RoaringBitmap32([0, 1, 9, 10, 99, 100, 123456789, 0x7fffffff, 0xffffffff]);
+      expect(bitmap.toJSONString()).eq(JSON.stringify(bitmap.toArray()));
+      bitmap.addRange(1000, 100000);
+      expect(bitmap.toJSONString()).eq(JSON.stringify(bitmap));
+      expect(JSON.parse(bitmap.toJSONString())).deep.equal(bitmap.toArray());
+    });
+  });
+
   describe("statistics", () => {
     it("returns a statistics object for an empty bitmap", () => {
       const bitmap = new RoaringBitmap32();
@@ -289,6 +488,7 @@ describe("RoaringBitmap32 basic", () => {
         minValue: 4294967295,
         sumOfAllValues: 0,
         size: 0,
+        autoOptimizeSavedBytes: 0,
       });
     });
 
@@ -296,21 +496,23 @@ describe("RoaringBitmap32 basic", () => {
       const rb = new RoaringBitmap32();
       expect(rb.addMany([1, 2, 3, 4, 6, 7])).eq(rb);
       expect(rb.addMany([999991, 999992, 999993, 999994, 999996, 999997])).eq(rb);
+      // Sorted values added to an empty bitmap are built directly as run containers when smaller
       expect(rb.statistics()).deep.equal({
         containers: 2,
-        arrayContainers: 2,
-        runContainers: 0,
+        arrayContainers: 1,
+        runContainers: 1,
         bitsetContainers: 0,
-        valuesInArrayContainers: 12,
-        valuesInRunContainers: 0,
+        valuesInArrayContainers: 6,
+        valuesInRunContainers: 6,
         valuesInBitsetContainers: 0,
-        bytesInArrayContainers: 24,
-        bytesInRunContainers: 0,
+        bytesInArrayContainers: 12,
+        bytesInRunContainers: 10,
         bytesInBitsetContainers: 0,
         maxValue: 999997,
         minValue: 1,
         sumOfAllValues: 5999986,
         size: 12,
+        autoOptimizeSavedBytes: 0,
       });
       rb.runOptimize();
       rb.shrinkToFit();
@@ -329,10 +531,58 @@ describe("RoaringBitmap32 basic", () => {
         minValue: 1,
         sumOfAllValues: 5999986,
         size: 12,
+        autoOptimizeSavedBytes: 0,
       });
     });
   });
 
+  describe("containers", () => {
+    it("returns empty arrays for an empty bitmap", () => {
+      const containers = new RoaringBitmap32().containers();
+      expect(containers.keys).to.be.instanceOf(Uint16Array);
+      expect(containers.types).to.be.instanceOf(Uint8Array);
+      expect(containers.cardinalities).to.be.instanceOf(Uint32Array);
+      expect(containers.sizesInBytes).to.be.instanceOf(Uint32Array);
+      expect(containers.keys.length).eq(0);
+      expect(containers.sizesInBytes.length).eq(0);
+    });
+
+    it("returns the details of each container", () => {
+      const bitmap = new RoaringBitmap32([1, 5, 9]);
+      bitmap.addRange(0x10000, 0x10000 + 4097 * 2);
+      bitmap.removeRunCompression();
+      for (let i = 0; i < 4097; ++i) {
+        bitmap.remove(0x10000 + i * 2 + 1);
+      }
+      bitmap.addRange(0x50000, 0x58000);
+      bitmap.runOptimize();
+      const containers = bitmap.containers();
+      expect(Array.from(containers.keys)).deep.equal([0, 1, 5]);
+      expect(Array.from(containers.types)).deep.equal([2, 1, 3]);
+      expect(Array.from(containers.cardinalities)).deep.equal([3, 4097, 0x8000]);
+      expect(containers.sizesInBytes[1]).eq(8192);
+      expect(containers.sizesInBytes[0]).to.be.greaterThan(5);
+      expect(containers.sizesInBytes[2]).to.be.greaterThan(3);
+    });
+
+    it("filters by key range", () => {
+      const bitmap = new RoaringBitmap32([1, 0x10001, 0x20001, 0x30001, 0xffff0001]);
+      expect(Array.from(bitmap.containers(1, 2).keys)).deep.equal([1, 2]);
+      expect(Array.from(bitmap.containers(2).keys)).deep.equal([2, 3, 0xffff]);
+      expect(Array.from(bitmap.containers(undefined, 0).keys)).deep.equal([0]);
+      expect(Array.from(bitmap.containers(4, 0xfffe).keys)).deep.equal([]);
+      expect(Array.from(bitmap.containers(3, 1).keys)).deep.equal([]);
+    });
+
+    it("throws for invalid keys", () => {
+      const bitmap = new RoaringBitmap32([1]);
+      expect(() => bitmap.containers(-1)).to.throw(TypeError);
+      expect(() => bitmap.containers(0, 65536)).to.throw(TypeError);
+      expect(() => bitmap.containers(1.5)).to.throw(TypeError);
+      expect(() => bitmap.containers("1" as any)).to.throw(TypeError);
+    });
+  });
+
   describe("removeRunCompression", () => {
     it("does nothing with an empty bitmap", () => {
       const bitmap = new RoaringBitmap32();
@@ -367,6 +617,92 @@ describe("RoaringBitmap32 basic", () => {
     });
   });
 
+  describe("setAutoOptimize", () => {
+    function arrayBitmap() {
+      const bitmap = RoaringBitmap32.fromRange(0, 1000);
+      bitmap.removeRunCompression();
+      return bitmap;
+    }
+
+    it("optimizes after the given number of mutations", () => {
+      const bitmap = arrayBitmap();
+      expect(bitmap.setAutoOptimize({ everyNMutations: 3 })).eq(bitmap);
+      bitmap.add(2000);
+      bitmap.add(2001);
+      expect(Array.from(bitmap.containers().types)).deep.equal([2]);
+      bitmap.add(2002);
+      expect(Array.from(bitmap.containers().types)).deep.equal([3]);
+      expect(bitmap.statistics().autoOptimizeSavedBytes).to.be.gt(0);
+      expect(bitmap.size).eq(1003);
+    });
+
+    it("counts addMany and copyFrom as one mutation", () => {
+      const bitmap = arrayBitmap();
+      bitmap.setAutoOptimize({ everyNMutations: 2 });
+      bitmap.addMany([3000, 2000]);
+      expect(Array.from(bitmap.containers().types)).deep.equal([2]);
+      bitmap.addMany(new Uint32Array([4000, 5000]));
+      expect(Array.from(bitmap.containers().types)).deep.equal([3]);
+
+      const values = Array.from({ length: 1000 }, (_, i) => 999 - i);
+      bitmap.copyFrom(values);
+      expect(Array.from(bitmap.containers().types)).deep.equal([2]);
+      bitmap.copyFrom(new RoaringBitmap32(values));
+      expect(Array.from(bitmap.containers().types)).deep.equal([3]);
+      expect(bitmap.size).eq(1000);
+    });
+
+    it("keeps the content of the changed containers", () => {
+      const bitmap = new RoaringBitmap32();
+      bitmap.setAutoOptimize({ everyNMutations: 1 });
+      const expected = new Set<number>();
+      for (let i = 0; i < 20000; ++i) {
+        const value = (i * 7919) % 300000;
+        if (i % 3 === 0) {
+          bitmap.remove(value);
+          expected.delete(value);
+        } else {
+          bitmap.add(value);
+          expected.add(value);
+        }
+      }
+      for (let i = 0; i < 1000; ++i) {
+        bitmap.tryAdd(0x50000 + i);
+        expected.add(0x50000 + i);
+      }
+      expect(bitmap.toArray()).deep.equal(Array.from(expected).sort((a, b) => a - b));
+      expect(bitmap.containers().types[bitmap.containers().types.length - 1]).eq(3);
+    });
+
+    it("optimizes before serialization", () => {
+      const bitmap = arrayBitmap();
+      bitmap.setAutoOptimize({ onSerialize: true });
+      bitmap.add(5000);
+      expect(Array.from(bitmap.containers().types)).deep.equal([2]);
+      const size = bitmap.getSerializationSizeInBytes(false);
+      expect(Array.from(bitmap.containers().types)).deep.equal([3]);
+      const serialized = bitmap.serialize(false);
+      expect(serialized.length).eq(size);
+      expect(RoaringBitmap32.deserialize(serialized, false).isEqual(bitmap)).eq(true);
+    });
+
+    it("can be disabled", () => {
+      const bitmap = arrayBitmap();
+      bitmap.setAutoOptimize({ everyNMutations: 1 });
+      bitmap.setAutoOptimize(false);
+      bitmap.add(2000);
+      expect(Array.from(bitmap.containers().types)).deep.equal([2]);
+      expect(bitmap.statistics().autoOptimizeSavedBytes).eq(0);
+    });
+
+    it("throws for invalid options", () => {
+      const bitmap = new RoaringBitmap32();
+      expect(() => bitmap.setAutoOptimize(1 as any)).to.throw(TypeError);
+      expect(() => bitmap.setAutoOptimize({ everyNMutations: -1 })).to.throw(TypeError);
+      expect(() => bitmap.setAutoOptimize({ everyNMutations: 1.5 })).to.throw(TypeError);
+    });
+  });
+
   describe("general tests", () => {
     it("allows adding 900 values", () => {
       const bitmap = new RoaringBitmap32();
@@ -0,0 +1,185 @@
+import RoaringBitmap32 from "../../RoaringBitmap32";
+import RoaringBitmap32Bundle from "../../RoaringBitmap32Bundle";
+import { expect, use as chaiUse } from "chai";
+
+chaiUse(require("chai-as-promised"));
+
+function makeBitmaps() {
+  const result = new Map<string, RoaringBitmap32>();
+  result.set("empty", new RoaringBitmap32());
+  result.set("array", new RoaringBitmap32([1, 2, 3, 100000, 0xffffffff]));
+  result.set("range", RoaringBitmap32.fromRange(10, 300000));
+  const bitset = new RoaringBitmap32();
+  for (let i = 0; i < 100000; i += 3) {
+    bitset.add(i);
+  }
+  result.set("bitset", bitset);
+  result.set("unicode è中", new RoaringBitmap32([7]));
+  return result;
+}
+
+describe("RoaringBitmap32 bundle", () => {
+  describe("serializeBundle", () => {
+    it("serializes an empty bundle", () => {
+      const bundle = new RoaringBitmap32Bundle(RoaringBitmap32.serializeBundle([]));
+      expect(bundle.size).eq(0);
+      expect(bundle.keys()).deep.equal([]);
+      expect(bundle.get("x")).to.be.undefined;
+    });
+
+    it("accepts a Map, an array of pairs and an object", () => {
+      const a = new RoaringBitmap32([1, 2]);
+      const b = new RoaringBitmap32([3]);
+      const expected = RoaringBitmap32.serializeBundle(
+        new Map([
+          ["a", a],
+          ["b", b],
+        ]),
+      );
+      expect(
+        RoaringBitmap32.serializeBundle([
+          ["a", a],
+          ["b", b],
+        ]),
+      ).deep.equal(expected);
+      expect(RoaringBitmap32.serializeBundle({ a, b })).deep.equal(expected);
+    });
+
+    it("serializes frozen bitmaps that share containers with a clone", () => {
+      const range = RoaringBitmap32.fromRange(10, 300000);
+      const clone = range.clone();
+      const bundle = new RoaringBitmap32Bundle(RoaringBitmap32.serializeBundle({ range, clone }, { format: "frozen" }));
+      clone.add(1);
+      expect(bundle.get("range")!.isEqual(range)).eq(true);
+      expect(bundle.get("clone")!.isEqual(range)).eq(true);
+      expect(range.has(1)).eq(false);
+    });
+
+    it("throws on invalid arguments", () => {
+      const a = new RoaringBitmap32([1]);
+      expect(() => (RoaringBitmap32 as any).serializeBundle()).to.throw(TypeError);
+      expect(() => (RoaringBitmap32 as any).serializeBundle([["a", [1, 2]]])).to.throw(TypeError);
+      expect(() => (RoaringBitmap32 as any).serializeBundle([[1, a]])).to.throw(TypeError);
+      expect(() =>
+        RoaringBitmap32.serializeBundle([
+          ["a", a],
+          ["a", a],
+        ]),
+      ).to.throw(TypeError);
+      expect(() => RoaringBitmap32.serializeBundle({ a }, { format: "xxx" as any })).to.throw(TypeError);
+    });
+  });
+
+  for (const format of ["portable", "frozen"] as const) {
+    for (const checksum of [false, true]) {
+      describe(`format ${format}, checksum ${checksum}`, () => {
+        it("loads all the bitmaps", () => {
+          const bitmaps = makeBitmaps();
+          const bundle = new RoaringBitmap32Bundle(RoaringBitmap32.serializeBundle(bitmaps, { format, checksum }));
+          expect(bundle.size).eq(bitmaps.size);
+          expect(bundle.keys()).deep.equal(Array.from(bitmaps.keys()));
+          for (const [key, bitmap] of bitmaps) {
+            expect(bundle.has(key)).eq(true);
+            const loaded = bundle.get(key)!;
+            expect(loaded).to.be.instanceOf(RoaringBitmap32);
+            expect(loaded.isEqual(bitmap)).eq(true);
+          }
+          expect(bundle.has("missing")).eq(false);
+          expect(bundle.get("missing")).to.be.undefined;
+        });
+
+        it("loads bitmaps from a misaligned buffer", () => {
+          const bitmaps = makeBitmaps();
+          const serialized = RoaringBitmap32.serializeBundle(bitmaps, { format, checksum });
+          const misaligned = Buffer.concat([Buffer.alloc(5), serialized]).subarray(5);
+          const bundle = new RoaringBitmap32Bundle(misaligned);
+          for (const [key, bitmap] of bitmaps) {
+            expect(bundle.get(key)!.isEqual(bitmap)).eq(true);
+          }
+        });
+      });
+    }
+  }
+
+  describe("RoaringBitmap32Bundle", () => {
+    it("throws on invalid buffers", () => {
+      expect(() => new (RoaringBitmap32Bundle as any)()).to.throw(TypeError);
+      expect(() => new RoaringBitmap32Bundle(Buffer.from([]))).to.throw(Error);
+      expect(() => new RoaringBitmap32Bundle(Buffer.from("not a bundle of bitmaps"))).to.throw(Error);
+    });
+
+    it("throws on a truncated buffer", () => {
+      const serialized = RoaringBitmap32.serializeBundle(makeBitmaps());
+      expect(() => new RoaringBitmap32Bundle(serialized.subarray(0, 30))).to.throw(Error);
+      expect(() => new RoaringBitmap32Bundle(serialized.subarray(0, serialized.length - 1))).to.throw(Error);
+    });
+
+    it("detects corruption when checksums are enabled", () => {
+      const serialized = RoaringBitmap32.serializeBundle({ a: new RoaringBitmap32([1, 2, 3]) }, { checksum: true });
+      serialized[serialized.length - 1] ^= 1;
+      const bundle = new RoaringBitmap32Bundle(serialized);
+      expect(() => bundle.get("a")).to.throw(Error);
+
+      const directoryCorrupted = RoaringBitmap32.serializeBundle({ a: new RoaringBitmap32([1]) }, { checksum: true });
+      directoryCorrupted[44] ^= 1;
+      expect(() => new RoaringBitmap32Bundle(directoryCorrupted)).to.throw(Error);
+    });
+  });
+
+  describe("deserializeBundleParallelAsync", () => {
+    it("loads a subset of keys", async () => {
+      const bitmaps = makeBitmaps();
+      const serialized = RoaringBitmap32.serializeBundle(bitmaps, { checksum: true });
+      const result = await RoaringBitmap32.deserializeBundleParallelAsync(serialized, ["range", "missing", "array"]);
+      expect(result).to.have.lengthOf(3);
+      expect(result[0]!.isEqual(bitmaps.get("range")!)).eq(true);
+      expect(result[1]).to.be.undefined;
+      expect(result[2]!.isEqual(bitmaps.get("array")!)).eq(true);
+    });
+
+    it("accepts a RoaringBitmap32Bundle and an empty array of keys", async () => {
+      const bundle = new RoaringBitmap32Bundle(RoaringBitmap32.serializeBundle(makeBitmaps(), { format: "frozen" }));
+      expect(await RoaringBitmap32.deserializeBundleParallelAsync(bundle, [])).deep.equal([]);
+      const result = await RoaringBitmap32.deserializeBundleParallelAsync(bundle, bundle.keys());
+      expect(result.map((x) => x!.size)).deep.equal(bundle.keys().map((key) => bundle.get(key)!.size));
+    });
+
+    it("accepts scheduling options", async () => {
+      const bitmaps = makeBitmaps();
+      const serialized = RoaringBitmap32.serializeBundle(bitmaps);
+      const keys = ["missing", ...bitmaps.keys()];
+      const result = await RoaringBitmap32.deserializeBundleParallelAsync(serialized, keys, {
+        concurrency: 2,
+        chunkSize: 1,
+        largestFirst: true,
+      });
+      expect(result[0]).to.be.undefined;
+      for (let i = 1; i < keys.length; ++i) {
+        expect(result[i]!.isEqual(bitmaps.get(keys[i])!)).eq(true);
+      }
+    });
+
+    it("works with a callback", (done) => {
+      const serialized = RoaringBitmap32.serializeBundle({ a: new RoaringBitmap32([5]) });
+      RoaringBitmap32.deserializeBundleParallelAsync(serialized, ["a"], (error, result) => {
+        if (error) {
+          done(error);
+          return;
+        }
+        expect(result![0]!.toArray()).deep.equal([5]);
+        done();
+      });
+    });
+
+    it("fails if a bitmap is corrupted", async () => {
+      const serialized = RoaringBitmap32.serializeBundle({ a: new RoaringBitmap32([1, 2, 3]) }, { checksum: true });
+      serialized[serialized.length - 1] ^= 1;
+      await expect(RoaringBitmap32.deserializeBundleParallelAsync(serialized, ["a"])).to.be.rejectedWith(Error);
+    });
+
+    it("throws if keys are not strings", () => {
+      const serialized = RoaringBitmap32.serializeBundle({});
+      expect(() => RoaringBitmap32.deserializeBundleParallelAsync(serialized, [1 as any])).to.throw(TypeError);
+    });
+  });
+});
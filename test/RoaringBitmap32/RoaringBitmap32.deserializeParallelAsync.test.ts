@@ -87,4 +87,67 @@ describe("RoaringBitmap32 deserializeParallelAsync", () => {
       }
     });
   });
+
+  describe("scheduling options", () => {
+    function makeSources() {
+      const sources = [];
+      for (let i = 0; i < 300; ++i) {
+        sources.push(RoaringBitmap32.fromRange(i, i + (i % 7) * 1000 + 1, 1 + (i % 3)));
+      }
+      sources.push(RoaringBitmap32.fromRange(0, 1000000, 5));
+      return sources;
+    }
+
+    it("keeps the result order with concurrency, chunkSize and largestFirst", async () => {
+      const sources = makeSources();
+      const buffers = sources.map((x) => x.serialize(false));
+      const optionsList = [
+        { concurrency: 1 },
+        { concurrency: 3, chunkSize: 1 },
+        { chunkSize: 64 },
+        { chunkSize: 65536 },
+        { largestFirst: true },
+        { concurrency: 4, chunkSize: 7, largestFirst: true },
+      ];
+      for (const options of optionsList) {
+        const result = await RoaringBitmap32.deserializeParallelAsync(buffers, false, options);
+        expect(result).to.have.lengthOf(sources.length);
+        for (let i = 0; i < sources.length; ++i) {
+          expect(result[i].isEqual(sources[i])).eq(true);
+        }
+      }
+    });
+
+    it("works with a callback", (done) => {
+      const sources = makeSources();
+      RoaringBitmap32.deserializeParallelAsync(
+        sources.map((x) => x.serialize(true)),
+        true,
+        { chunkSize: 10, largestFirst: true },
+        ((error: Error | null, result: RoaringBitmap32[] | undefined) => {
+          try {
+            expect(error).to.be.null;
+            expect(result!.map((x) => x.size)).deep.equal(sources.map((x) => x.size));
+            done();
+          } catch (e) {
+            done(e);
+          }
+        }) as any,
+      );
+    });
+
+    it("propagates errors", async () => {
+      const buffers = makeSources().map((x) => x.serialize(false));
+      buffers[150] = Buffer.from([1, 2, 3, 4, 5]);
+      await expect(RoaringBitmap32.deserializeParallelAsync(buffers, false, { chunkSize: 8, largestFirst: true })).to.be
+        .rejected;
+    });
+
+    it("throws for invalid options", () => {
+      expect(() => RoaringBitmap32.deserializeParallelAsync([], false, { concurrency: -1 })).to.throw(TypeError);
+      expect(() => RoaringBitmap32.deserializeParallelAsync([], false, { concurrency: 1.5 })).to.throw(TypeError);
+      expect(() => RoaringBitmap32.deserializeParallelAsync([], false, { chunkSize: 100000 })).to.throw(TypeError);
+      expect(() => RoaringBitmap32.deserializeParallelAsync([], false, { chunkSize: "1" as any })).to.throw(TypeError);
+    });
+  });
 });
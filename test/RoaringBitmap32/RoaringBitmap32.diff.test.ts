@@ -0,0 +1,145 @@
+import RoaringBitmap32 from "../../RoaringBitmap32";
+import { expect, use as chaiUse } from "chai";
+
+chaiUse(require("chai-as-promised"));
+
+function makeBase() {
+  const base = RoaringBitmap32.fromRange(0, 500000);
+  for (let i = 1000000; i < 1200000; i += 7) {
+    base.add(i);
+  }
+  base.addMany([0x7fffffff, 0xfffffffe, 0xffffffff]);
+  base.runOptimize();
+  return base;
+}
+
+function makeCurrent(base: RoaringBitmap32) {
+  const current = base.clone();
+  current.remove(1234);
+  current.add(600000);
+  current.removeRange(1100000, 1100100);
+  current.remove(0xffffffff);
+  current.add(0x80000000);
+  return current;
+}
+
+describe("RoaringBitmap32 diff", () => {
+  describe("serializeDiff", () => {
+    it("is a small Buffer when few values changed", () => {
+      const base = makeBase();
+      const current = makeCurrent(base);
+      const diff = RoaringBitmap32.serializeDiff(base, current);
+      expect(diff).to.be.instanceOf(Buffer);
+      expect(diff.length).lessThan(200);
+      expect(diff.length).lessThan(current.serialize(false).length / 10);
+    });
+
+    it("round trips with applyDiff", () => {
+      const base = makeBase();
+      const current = makeCurrent(base);
+      const applied = RoaringBitmap32.applyDiff(base, RoaringBitmap32.serializeDiff(base, current));
+      expect(applied).to.be.instanceOf(RoaringBitmap32);
+      expect(applied.isEqual(current)).eq(true);
+      expect(base.isEqual(makeBase())).eq(true);
+    });
+
+    it("works with equal and empty bitmaps", () => {
+      const base = makeBase();
+      const empty = new RoaringBitmap32();
+      expect(RoaringBitmap32.applyDiff(base, RoaringBitmap32.serializeDiff(base, base)).isEqual(base)).eq(true);
+      expect(RoaringBitmap32.applyDiff(base, RoaringBitmap32.serializeDiff(base, empty)).isEmpty).eq(true);
+      expect(RoaringBitmap32.applyDiff(empty, RoaringBitmap32.serializeDiff(empty, base)).isEqual(base)).eq(true);
+      expect(RoaringBitmap32.applyDiff(empty, RoaringBitmap32.serializeDiff(empty, empty)).isEmpty).eq(true);
+    });
+
+    it("throws if arguments are not bitmaps", () => {
+      expect(() => (RoaringBitmap32 as any).serializeDiff(new RoaringBitmap32())).to.throw(TypeError);
+      expect(() => (RoaringBitmap32 as any).serializeDiff([1], new RoaringBitmap32())).to.throw(TypeError);
+    });
+  });
+
+  describe("applyDiff", () => {
+    it("throws if the diff was created from another base", () => {
+      const base = makeBase();
+      const diff = RoaringBitmap32.serializeDiff(base, makeCurrent(base));
+      expect(() => RoaringBitmap32.applyDiff(new RoaringBitmap32([1, 2, 3]), diff)).to.throw(/base bitmap/);
+    });
+
+    it("throws if the other base has the same size and keys", () => {
+      const diff = RoaringBitmap32.serializeDiff(new RoaringBitmap32([1, 2, 3]), new RoaringBitmap32([1, 2, 3, 4]));
+      expect(RoaringBitmap32.applyDiff(new RoaringBitmap32([1, 2, 3]), diff).toArray()).deep.equal([1, 2, 3, 4]);
+      expect(() => RoaringBitmap32.applyDiff(new RoaringBitmap32([10, 20, 30]), diff)).to.throw(/base bitmap/);
+
+      const base = makeBase();
+      const other = makeBase();
+      other.remove(100);
+      other.add(500000);
+      expect(() => RoaringBitmap32.applyDiff(other, RoaringBitmap32.serializeDiff(base, makeCurrent(base)))).to.throw(
+        /base bitmap/,
+      );
+    });
+
+    it("does not depend on the container types of base", () => {
+      const base = makeBase();
+      const diff = RoaringBitmap32.serializeDiff(base, makeCurrent(base));
+      const replica = makeBase();
+      replica.removeRunCompression();
+      expect(RoaringBitmap32.applyDiff(replica, diff).isEqual(makeCurrent(base))).eq(true);
+    });
+
+    it("throws if the diff is corrupted", () => {
+      const base = makeBase();
+      const diff = RoaringBitmap32.serializeDiff(base, makeCurrent(base));
+      const corrupted = Buffer.from(diff);
+      corrupted[corrupted.length - 1] ^= 0x10;
+      expect(() => RoaringBitmap32.applyDiff(base, corrupted)).to.throw(/checksum/);
+      expect(() => RoaringBitmap32.applyDiff(base, diff.subarray(0, 10))).to.throw(/invalid diff/);
+      expect(() => RoaringBitmap32.applyDiff(base, base.serialize(false))).to.throw(/invalid diff/);
+    });
+
+    it("throws if arguments are invalid", () => {
+      expect(() => (RoaringBitmap32 as any).applyDiff([], Buffer.alloc(0))).to.throw(TypeError);
+      expect(() => (RoaringBitmap32 as any).applyDiff(new RoaringBitmap32(), [1, 2])).to.throw(TypeError);
+    });
+  });
+
+  describe("async", () => {
+    it("serializeDiffAsync and applyDiffAsync return promises", async () => {
+      const base = makeBase();
+      const current = makeCurrent(base);
+      const diff = await RoaringBitmap32.serializeDiffAsync(base, current);
+      expect(diff).deep.equal(RoaringBitmap32.serializeDiff(base, current));
+      const applied = await RoaringBitmap32.applyDiffAsync(base, diff);
+      expect(applied.isEqual(current)).eq(true);
+    });
+
+    it("work on a snapshot of the bitmaps", async () => {
+      const base = makeBase();
+      const current = makeCurrent(base);
+      const expected = current.clone();
+      const promise = RoaringBitmap32.serializeDiffAsync(base, current);
+      current.add(999);
+      base.add(12345678);
+      const diff = await promise;
+      expect(RoaringBitmap32.applyDiff(makeBase(), diff).isEqual(expected)).eq(true);
+    });
+
+    it("support callbacks", async () => {
+      const base = makeBase();
+      const current = makeCurrent(base);
+      const diff = await new Promise<Buffer>((resolve, reject) => {
+        RoaringBitmap32.serializeDiffAsync(base, current, (error, result) => (error ? reject(error) : resolve(result!)));
+      });
+      const applied = await new Promise<RoaringBitmap32>((resolve, reject) => {
+        RoaringBitmap32.applyDiffAsync(base, diff, (error, result) => (error ? reject(error) : resolve(result!)));
+      });
+      expect(applied.isEqual(current)).eq(true);
+    });
+
+    it("applyDiffAsync rejects if the diff was created from another base", async () => {
+      const base = makeBase();
+      const diff = RoaringBitmap32.serializeDiff(base, makeCurrent(base));
+      await expect(RoaringBitmap32.applyDiffAsync(new RoaringBitmap32([1]), diff)).to.be.rejectedWith(/base bitmap/);
+    });
+  });
+});
@@ -59,5 +59,66 @@ describe("RoaringBitmap32 fromAsync", () => {
         expect(bitmap.toArray()).deep.equal(values);
       });
     });
+
+    describe("large arrays", () => {
+      function makeSorted() {
+        const values = new Uint32Array(1500000);
+        for (let i = 0; i < values.length; ++i) {
+          values[i] = i < 1000000 ? i * 7 : 0xffffffff - (values.length - i) * 3;
+        }
+        return values;
+      }
+
+      function shuffle(values: Uint32Array) {
+        let seed = 12345;
+        for (let i = values.length - 1; i > 0; --i) {
+          seed = (seed * 1103515245 + 12345) >>> 0;
+          const j = seed % (i + 1);
+          const t = values[i];
+          values[i] = values[j];
+          values[j] = t;
+        }
+        return values;
+      }
+
+      before(() => {
+        RoaringBitmap32.setThreadPoolSize(4);
+      });
+
+      after(() => {
+        RoaringBitmap32.setThreadPoolSize(0);
+      });
+
+      it("builds a sorted array in parallel", async () => {
+        const values = makeSorted();
+        const bitmap = await RoaringBitmap32.fromArrayAsync(values, { concurrency: 4 });
+        expect(bitmap.size).eq(values.length);
+        expect(bitmap.isEqual(new RoaringBitmap32(values))).eq(true);
+      });
+
+      it("builds an unsorted array with duplicates in parallel", async () => {
+        const values = shuffle(makeSorted());
+        values.fill(5, 0, 1000);
+        const expected = new RoaringBitmap32(values);
+        const bitmap = await RoaringBitmap32.fromArrayAsync(values, { concurrency: 3 });
+        expect(bitmap.size).eq(expected.size);
+        expect(bitmap.isEqual(expected)).eq(true);
+        expect(Array.from(values.subarray(0, 1000))).deep.equal(new Array(1000).fill(5));
+      });
+
+      it("gives the same result with a single thread", async () => {
+        const values = shuffle(makeSorted());
+        const a = await RoaringBitmap32.fromArrayAsync(values, { concurrency: 1 });
+        const b = await RoaringBitmap32.fromArrayAsync(values, { concurrency: 4, chunkSize: 1 });
+        expect(a.isEqual(b)).eq(true);
+      });
+
+      it("can be aborted", async () => {
+        const controller = new AbortController();
+        const promise = RoaringBitmap32.fromArrayAsync(shuffle(makeSorted()), { signal: controller.signal });
+        controller.abort();
+        await expect(promise).to.be.rejectedWith(Error, "The operation was aborted");
+      });
+    });
   });
 });
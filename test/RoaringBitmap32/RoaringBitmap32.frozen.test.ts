@@ -0,0 +1,189 @@
+import RoaringBitmap32 from "../../RoaringBitmap32";
+import { expect } from "chai";
+
+function makeBitmap() {
+  const bitmap = RoaringBitmap32.fromRange(100, 200000);
+  for (let i = 300000; i < 400000; i += 3) {
+    bitmap.add(i);
+  }
+  bitmap.addMany([1, 5, 0x7fffffff, 0xffffffff]);
+  bitmap.runOptimize();
+  return bitmap;
+}
+
+describe("RoaringBitmap32 frozen", () => {
+  describe("serializeFrozen", () => {
+    it("serializes into a new SharedArrayBuffer", () => {
+      const bitmap = makeBitmap();
+      const buffer = bitmap.serializeFrozen();
+      expect(buffer).to.be.instanceOf(SharedArrayBuffer);
+      expect(buffer.byteLength).eq(bitmap.getFrozenSizeInBytes());
+      const view = RoaringBitmap32.frozenView(buffer);
+      expect(view.isFrozen).eq(true);
+      expect(view.isEqual(bitmap)).eq(true);
+      expect(view.size).eq(bitmap.size);
+    });
+
+    it("serializes into a given buffer at an offset", () => {
+      const bitmap = makeBitmap();
+      const buffer = new SharedArrayBuffer(bitmap.getFrozenSizeInBytes() + 1000);
+      const written = bitmap.serializeFrozen(buffer, 13);
+      expect(written).lessThan(bitmap.getFrozenSizeInBytes() + 1);
+      expect(RoaringBitmap32.frozenView(buffer, 13).isEqual(bitmap)).eq(true);
+
+      const arrayBuffer = new ArrayBuffer(bitmap.getFrozenSizeInBytes() + 7);
+      bitmap.serializeFrozen(arrayBuffer, 7);
+      expect(RoaringBitmap32.frozenView(arrayBuffer, 7).isEqual(bitmap)).eq(true);
+
+      const array = new Uint8Array(bitmap.getFrozenSizeInBytes());
+      bitmap.serializeFrozen(array);
+      expect(RoaringBitmap32.frozenView(array).isEqual(bitmap)).eq(true);
+    });
+
+    it("serializes bitmaps that share containers with a clone", () => {
+      const bitmap = makeBitmap();
+      const clone = bitmap.clone();
+      expect(clone.getFrozenSizeInBytes()).eq(bitmap.getFrozenSizeInBytes());
+      const buffer = bitmap.serializeFrozen();
+      const cloneBuffer = clone.serializeFrozen();
+      clone.add(3);
+      clone.removeRange(300000, 310000);
+      expect(RoaringBitmap32.frozenView(buffer).isEqual(makeBitmap())).eq(true);
+      expect(RoaringBitmap32.frozenView(cloneBuffer).isEqual(makeBitmap())).eq(true);
+      expect(RoaringBitmap32.frozenView(bitmap.serializeFrozen()).isEqual(makeBitmap())).eq(true);
+      expect(RoaringBitmap32.frozenView(clone.serializeFrozen()).isEqual(clone)).eq(true);
+      expect(bitmap.has(3)).eq(false);
+      expect(bitmap.has(300000)).eq(true);
+    });
+
+    it("works with an empty bitmap", () => {
+      const view = RoaringBitmap32.frozenView(new RoaringBitmap32().serializeFrozen());
+      expect(view.isEmpty).eq(true);
+      expect(view.isFrozen).eq(true);
+    });
+
+    it("throws if the target is too small or invalid", () => {
+      const bitmap = makeBitmap();
+      expect(() => bitmap.serializeFrozen(new SharedArrayBuffer(10))).to.throw(/too small/);
+      expect(() => bitmap.serializeFrozen(new SharedArrayBuffer(100000), -1)).to.throw(TypeError);
+      expect(() => bitmap.serializeFrozen(new SharedArrayBuffer(100), 101)).to.throw(TypeError);
+      expect(() => (bitmap as any).serializeFrozen([1, 2, 3])).to.throw(TypeError);
+    });
+  });
+
+  describe("freeze", () => {
+    it("makes the bitmap immutable", () => {
+      const bitmap = makeBitmap();
+      expect(bitmap.isFrozen).eq(false);
+      expect(bitmap.freeze()).eq(bitmap);
+      expect(bitmap.isFrozen).eq(true);
+      expect(bitmap.freeze()).eq(bitmap);
+      expect(() => bitmap.add(3)).to.throw(/frozen/);
+      expect(() => bitmap.removeMany([100])).to.throw(/frozen/);
+      expect(() => bitmap.clear()).to.throw(/frozen/);
+      expect(() => bitmap.orInPlace(new RoaringBitmap32([2]))).to.throw(/frozen/);
+      expect(() => bitmap.setAutoOptimize({ everyNMutations: 1 })).to.throw(/frozen/);
+      expect(() => RoaringBitmap32.swap(bitmap, new RoaringBitmap32())).to.throw(/frozen/);
+      expect(bitmap.isEqual(makeBitmap())).eq(true);
+    });
+
+    it("can be read and serialized", async () => {
+      const bitmap = makeBitmap().freeze();
+      expect(bitmap.has(150)).eq(true);
+      expect(Array.from(bitmap)).deep.equal(makeBitmap().toArray());
+      expect(RoaringBitmap32.frozenView(bitmap.serializeFrozen()).isEqual(bitmap)).eq(true);
+      expect((await bitmap.serializeAsync(true)).equals(makeBitmap().serialize(true))).eq(true);
+    });
+
+    it("optimizes the containers pending for the auto optimize policy", () => {
+      const bitmap = new RoaringBitmap32().setAutoOptimize({ everyNMutations: 1000000 });
+      for (let i = 0; i < 10000; ++i) {
+        bitmap.add(i);
+      }
+      expect(bitmap.statistics().runContainers).eq(0);
+      bitmap.freeze();
+      expect(bitmap.statistics().runContainers).eq(1);
+    });
+
+    it("clones are not frozen and share the containers", () => {
+      const bitmap = makeBitmap().freeze();
+      const clone = bitmap.clone();
+      expect(clone.isFrozen).eq(false);
+      clone.add(3);
+      clone.remove(150);
+      expect(clone.has(3)).eq(true);
+      expect(bitmap.has(3)).eq(false);
+      expect(bitmap.has(150)).eq(true);
+      expect(bitmap.isEqual(makeBitmap())).eq(true);
+      expect(RoaringBitmap32.frozenView(clone.serializeFrozen()).isEqual(clone)).eq(true);
+    });
+  });
+
+  describe("frozenView", () => {
+    it("is a read only view of the buffer", () => {
+      const bitmap = makeBitmap();
+      const view = RoaringBitmap32.frozenView(bitmap.serializeFrozen());
+      expect(view.has(150)).eq(true);
+      expect(view.has(99)).eq(false);
+      expect(view.toUint32Array()).deep.equal(bitmap.toUint32Array());
+      expect(Array.from(view)).deep.equal(bitmap.toArray());
+      expect(view.serialize(true)).deep.equal(bitmap.serialize(true));
+      expect(RoaringBitmap32.or(view, new RoaringBitmap32([2])).size).eq(bitmap.size + 1);
+    });
+
+    it("throws when the bitmap is modified", () => {
+      const view = RoaringBitmap32.frozenView(makeBitmap().serializeFrozen());
+      const other = new RoaringBitmap32([1, 2]);
+      expect(() => view.add(3)).to.throw(/frozen/);
+      expect(() => view.tryAdd(3)).to.throw(/frozen/);
+      expect(() => view.addMany([3])).to.throw(/frozen/);
+      expect(() => view.remove(100)).to.throw(/frozen/);
+      expect(() => view.delete(100)).to.throw(/frozen/);
+      expect(() => view.removeMany([100])).to.throw(/frozen/);
+      expect(() => view.clear()).to.throw(/frozen/);
+      expect(() => view.addRange(0, 10)).to.throw(/frozen/);
+      expect(() => view.removeRange(0, 10)).to.throw(/frozen/);
+      expect(() => view.flipRange(0, 10)).to.throw(/frozen/);
+      expect(() => view.orInPlace(other)).to.throw(/frozen/);
+      expect(() => view.andInPlace(other)).to.throw(/frozen/);
+      expect(() => view.andNotInPlace(other)).to.throw(/frozen/);
+      expect(() => view.xorInPlace(other)).to.throw(/frozen/);
+      expect(() => view.copyFrom(other)).to.throw(/frozen/);
+      expect(() => view.runOptimize()).to.throw(/frozen/);
+      expect(() => view.shrinkToFit()).to.throw(/frozen/);
+      expect(() => view.removeRunCompression()).to.throw(/frozen/);
+      expect(() => view.deserialize(other.serialize(false), false)).to.throw(/frozen/);
+      expect(() => RoaringBitmap32.swap(view, other)).to.throw(/frozen/);
+      expect(view.isEqual(makeBitmap())).eq(true);
+    });
+
+    it("clones are not frozen", () => {
+      const view = RoaringBitmap32.frozenView(makeBitmap().serializeFrozen());
+      const clone = view.clone();
+      expect(clone.isFrozen).eq(false);
+      clone.add(3);
+      expect(clone.has(3)).eq(true);
+      expect(view.has(3)).eq(false);
+    });
+
+    it("copies the data when the buffer is not aligned anymore", () => {
+      const bitmap = makeBitmap();
+      const buffer = new Uint8Array(bitmap.serializeFrozen());
+      const copy = new Uint8Array(buffer.length + 1);
+      copy.set(buffer, 1);
+      const view = RoaringBitmap32.frozenView(copy, 1);
+      expect(view.isFrozen).eq(true);
+      expect(view.isEqual(bitmap)).eq(true);
+    });
+
+    it("throws with invalid data", () => {
+      expect(() => RoaringBitmap32.frozenView(new SharedArrayBuffer(4))).to.throw(/invalid frozen data/);
+      expect(() => RoaringBitmap32.frozenView(new SharedArrayBuffer(100))).to.throw(/invalid frozen data/);
+      const buffer = new Uint8Array(makeBitmap().serializeFrozen());
+      buffer[0] = 0xff;
+      buffer[1] = 0xff;
+      expect(() => RoaringBitmap32.frozenView(buffer)).to.throw(/invalid frozen data/);
+      expect(() => (RoaringBitmap32 as any).frozenView([1, 2])).to.throw(TypeError);
+    });
+  });
+});
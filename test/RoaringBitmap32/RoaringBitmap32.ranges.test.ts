@@ -381,4 +381,179 @@ describe("RoaringBitmap32 ranges", () => {
       expect(iterator.next()).deep.equal({ done: true, value: undefined });
     });
   });
+
+  describe("fromRanges", () => {
+    function fromRangesSlow(pairs: ArrayLike<number>) {
+      const result = new RoaringBitmap32();
+      for (let i = 0; i < pairs.length; i += 2) {
+        result.addRange(pairs[i], pairs[i + 1]);
+      }
+      return result;
+    }
+
+    it("builds sorted, touching and unsorted overlapping ranges", () => {
+      const sorted = new Uint32Array([0, 10, 10, 20, 65530, 65546, 100000, 300000, 0xfffffff0, 0xffffffff]);
+      expect(RoaringBitmap32.fromRanges(sorted).isEqual(fromRangesSlow(sorted))).eq(true);
+      expect(RoaringBitmap32.fromRanges(sorted).size).eq(20 + 16 + 200000 + 15);
+
+      const unsorted = new Uint32Array([500, 1000, 5, 7, 900, 70000, 0, 6, 65536, 65537]);
+      expect(RoaringBitmap32.fromRanges(unsorted).isEqual(fromRangesSlow(unsorted))).eq(true);
+
+      const overlapping = new Uint32Array([0, 200000, 100, 300, 150000, 140000, 199999, 200001]);
+      expect(RoaringBitmap32.fromRanges(overlapping).toArray()).deep.equal(fromRangesSlow(overlapping).toArray());
+    });
+
+    it("trims and skips ranges in a Float64Array like addRange", () => {
+      const pairs = new Float64Array([-10, 5, 20, 10, NaN, 100, 4294967290, 4294967300, 30, 30]);
+      const bitmap = RoaringBitmap32.fromRanges(pairs);
+      expect(bitmap.toArray()).deep.equal([0, 1, 2, 3, 4, 4294967290, 4294967291, 4294967292, 4294967293, 4294967294, 4294967295]);
+    });
+
+    it("creates many ranges", () => {
+      const pairs = new Uint32Array(200000);
+      for (let i = 0; i < pairs.length; i += 2) {
+        pairs[i] = i * 10;
+        pairs[i + 1] = i * 10 + 1 + (i % 7);
+      }
+      const bitmap = RoaringBitmap32.fromRanges(pairs);
+      expect(bitmap.isEqual(fromRangesSlow(pairs))).eq(true);
+    });
+
+    it("returns an empty bitmap for an empty array", () => {
+      expect(RoaringBitmap32.fromRanges(new Uint32Array(0)).isEmpty).eq(true);
+    });
+
+    it("throws for invalid arguments", () => {
+      expect(() => RoaringBitmap32.fromRanges([1, 2] as any)).to.throw(TypeError);
+      expect(() => RoaringBitmap32.fromRanges(new Uint32Array(3))).to.throw(TypeError);
+      expect(() => RoaringBitmap32.fromRanges(new Int32Array(2) as any)).to.throw(TypeError);
+    });
+
+    it("works asynchronously", async () => {
+      const pairs = new Uint32Array([10, 20, 1, 5, 1000, 100000]);
+      const bitmap = await RoaringBitmap32.fromRangesAsync(pairs);
+      expect(bitmap.isEqual(fromRangesSlow(pairs))).eq(true);
+      expect(() => RoaringBitmap32.fromRangesAsync(new Float64Array(1))).to.throw(TypeError);
+    });
+  });
+
+  describe("addRanges, removeRanges and flipRanges", () => {
+    it("adds and removes many ranges", () => {
+      const bitmap = new RoaringBitmap32([1, 50, 70000, 5000000]);
+      expect(bitmap.addRanges(new Uint32Array([10, 20, 60000, 80000, 2, 4]))).eq(bitmap);
+      const expected = new RoaringBitmap32([1, 50, 70000, 5000000]).addRange(10, 20).addRange(60000, 80000).addRange(2, 4);
+      expect(bitmap.isEqual(expected)).eq(true);
+
+      expect(bitmap.removeRanges(new Float64Array([0, 3, 65000, 4294967296]))).eq(bitmap);
+      expected.removeRange(0, 3).removeRange(65000, 4294967296);
+      expect(bitmap.toArray()).deep.equal(expected.toArray());
+    });
+
+    it("flips disjoint and overlapping ranges in order", () => {
+      const disjoint = new Uint32Array([0, 10, 20, 70000]);
+      const bitmap = new RoaringBitmap32([5, 15, 25]);
+      bitmap.flipRanges(disjoint);
+      expect(bitmap.isEqual(new RoaringBitmap32([5, 15, 25]).flipRange(0, 10).flipRange(20, 70000))).eq(true);
+
+      const overlapping = new Uint32Array([0, 10, 5, 15]);
+      const a = new RoaringBitmap32([3, 7, 12]).flipRanges(overlapping);
+      const b = new RoaringBitmap32([3, 7, 12]).flipRange(0, 10).flipRange(5, 15);
+      expect(a.toArray()).deep.equal(b.toArray());
+    });
+
+    it("throws on a frozen bitmap", () => {
+      const frozen = RoaringBitmap32.frozenView(new RoaringBitmap32([1]).serializeFrozen());
+      expect(() => frozen.addRanges(new Uint32Array([1, 2]))).to.throw();
+    });
+  });
+
+  describe("toRanges", () => {
+    it("returns an empty array for an empty bitmap", () => {
+      const ranges = new RoaringBitmap32().toRanges();
+      expect(ranges).to.be.instanceOf(Uint32Array);
+      expect(ranges.length).eq(0);
+    });
+
+    it("reads array, bitset and run containers", () => {
+      const bitmap = new RoaringBitmap32([1, 2, 3, 7, 9, 10]);
+      bitmap.addRange(0x10000 + 5, 0x10000 + 30000);
+      for (let i = 0x20000; i < 0x2fff0; i += 3) {
+        bitmap.add(i);
+        bitmap.add(i + 1);
+      }
+      bitmap.addRange(0x40000 + 63, 0x40000 + 200);
+      bitmap.addRange(0x50000 + 10, 0x50000 + 20);
+      bitmap.addRange(0x50000 + 100, 0x50000 + 120);
+      bitmap.runOptimize();
+
+      const expected: number[] = [1, 4, 7, 8, 9, 11, 0x10000 + 5, 0x10000 + 30000];
+      for (let i = 0x20000; i < 0x2fff0; i += 3) {
+        expected.push(i, i + 2);
+      }
+      expected.push(0x40000 + 63, 0x40000 + 200, 0x50000 + 10, 0x50000 + 20, 0x50000 + 100, 0x50000 + 120);
+      expect(Array.from(bitmap.toRanges())).deep.equal(expected);
+    });
+
+    it("reads bitset containers with long runs", () => {
+      const bitmap = RoaringBitmap32.fromRange(64, 4000);
+      for (let i = 5000; i < 30000; i += 2) {
+        bitmap.add(i);
+      }
+      bitmap.addRange(60000, 65536);
+      const expected: number[] = [64, 4000];
+      for (let i = 5000; i < 30000; i += 2) {
+        expected.push(i, i + 1);
+      }
+      expected.push(60000, 65536);
+      expect(Array.from(bitmap.toRanges())).deep.equal(expected);
+    });
+
+    it("merges the ranges across containers", () => {
+      const bitmap = RoaringBitmap32.fromRange(0xfff0, 0x30010);
+      bitmap.add(0x3ffff);
+      bitmap.add(0x40000);
+      expect(Array.from(bitmap.toRanges())).deep.equal([0xfff0, 0x30010, 0x3ffff, 0x40001]);
+      bitmap.runOptimize();
+      expect(Array.from(bitmap.toRanges())).deep.equal([0xfff0, 0x30010, 0x3ffff, 0x40001]);
+    });
+
+    it("handles the maximum value", () => {
+      const bitmap = new RoaringBitmap32([5, 0xfffffffe, 0xffffffff]);
+      expect(Array.from(bitmap.toRanges())).deep.equal([5, 6, 0xfffffffe, 0]);
+      expect(Array.from(bitmap.toRanges(new Float64Array(4)))).deep.equal([5, 6, 0xfffffffe, 4294967296]);
+      expect(RoaringBitmap32.fromRanges(bitmap.toRanges()).isEqual(bitmap)).eq(true);
+    });
+
+    it("writes to an output array", () => {
+      const bitmap = new RoaringBitmap32([1, 2, 10, 20, 21]);
+      const output = new Uint32Array(10).fill(99);
+      const result = bitmap.toRanges(output);
+      expect(result).to.be.instanceOf(Uint32Array);
+      expect(result.buffer).eq(output.buffer);
+      expect(Array.from(result)).deep.equal([1, 3, 10, 11, 20, 22]);
+      expect(Array.from(output)).deep.equal([1, 3, 10, 11, 20, 22, 99, 99, 99, 99]);
+
+      const small = bitmap.toRanges(new Float64Array(5));
+      expect(small).to.be.instanceOf(Float64Array);
+      expect(Array.from(small)).deep.equal([1, 3, 10, 11]);
+    });
+
+    it("stops at maxRanges", () => {
+      const bitmap = new RoaringBitmap32([1, 2, 10, 20, 21]);
+      expect(Array.from(bitmap.toRanges(2))).deep.equal([1, 3, 10, 11]);
+      expect(Array.from(bitmap.toRanges(0))).deep.equal([]);
+      expect(Array.from(bitmap.toRanges(new Uint32Array(100), 1))).deep.equal([1, 3]);
+      expect(() => bitmap.toRanges(-1)).to.throw(TypeError);
+      expect(() => bitmap.toRanges([] as any)).to.throw(TypeError);
+    });
+
+    it("round trips with fromRanges", () => {
+      const bitmap = new RoaringBitmap32();
+      for (let i = 0; i < 1000; ++i) {
+        const start = Math.floor(Math.random() * 0xfffff000);
+        bitmap.addRange(start, start + Math.floor(Math.random() * 3000));
+      }
+      expect(RoaringBitmap32.fromRanges(bitmap.toRanges()).isEqual(bitmap)).eq(true);
+    });
+  });
 });
@@ -151,4 +151,276 @@ describe("RoaringBitmap32 serialization", () => {
       expect(b.toArray()).deep.equal(values);
     });
   });
+
+  describe("checksum", () => {
+    const crc32c = (data: Uint8Array) => {
+      let crc = 0xffffffff;
+      for (const byte of data) {
+        crc ^= byte;
+        for (let k = 0; k < 8; ++k) {
+          crc = crc & 1 ? (crc >>> 1) ^ 0x82f63b78 : crc >>> 1;
+        }
+      }
+      return ~crc >>> 0;
+    };
+
+    const makeBitmaps = () => {
+      const bitset = new RoaringBitmap32();
+      for (let i = 0; i < 100000; i += 3) {
+        bitset.add(i);
+      }
+      return [
+        new RoaringBitmap32(),
+        new RoaringBitmap32([1, 2, 100, 0xffffffff]),
+        RoaringBitmap32.fromRange(0, 1000000),
+        bitset,
+      ];
+    };
+
+    it("wraps the non portable format in a CRC32C envelope", () => {
+      for (const bitmap of makeBitmaps()) {
+        const serialized = bitmap.serialize(false, { checksum: true });
+        expect(serialized.length).eq(bitmap.getSerializationSizeInBytes(false, { checksum: true }));
+        expect(serialized.length).eq(bitmap.getSerializationSizeInBytes(false) + 5);
+        expect(serialized[0]).eq(3);
+        expect(serialized.readUInt32LE(1)).eq(crc32c(serialized.subarray(5)));
+        expect(serialized.subarray(5).equals(bitmap.serialize(false))).eq(true);
+        expect(RoaringBitmap32.deserialize(serialized, false).isEqual(bitmap)).eq(true);
+      }
+    });
+
+    it("detects corrupted data", async () => {
+      for (const bitmap of makeBitmaps()) {
+        const serialized = bitmap.serialize(false, { checksum: true });
+        serialized[serialized.length - 1] ^= 0x10;
+        expect(() => RoaringBitmap32.deserialize(serialized, false)).to.throw(Error);
+        let error: any;
+        try {
+          await RoaringBitmap32.deserializeAsync(serialized, false);
+        } catch (e) {
+          error = e;
+        }
+        expect(error.message).eq("RoaringBitmap32::deserialize - corrupted data, checksum mismatch");
+      }
+    });
+
+    it("is not supported by the portable format", () => {
+      const bitmap = new RoaringBitmap32([1, 2, 3]);
+      expect(() => bitmap.serialize(true, { checksum: true })).to.throw(TypeError);
+      expect(bitmap.serialize(true, { checksum: false }).equals(bitmap.serialize(true))).eq(true);
+    });
+  });
+
+  describe("compressed", () => {
+    const makeBitmaps = () => {
+      const sparse = new RoaringBitmap32();
+      for (let i = 0; i < 1000; ++i) {
+        sparse.add((i * 2654435761) >>> 0);
+      }
+      const dense = new RoaringBitmap32();
+      for (let i = 0; i < 200000; i += 2) {
+        dense.add(i);
+      }
+      const mixed = RoaringBitmap32.fromRange(5, 70000);
+      mixed.remove(100);
+      mixed.add(0xffffffff);
+      const clustered = new RoaringBitmap32();
+      for (let i = 0; i < 50000; ++i) {
+        clustered.add(i * 5 + (i % 3));
+      }
+      return [new RoaringBitmap32(), new RoaringBitmap32([0]), sparse, dense, mixed, clustered];
+    };
+
+    it("is smaller than the non portable format", () => {
+      const dense = new RoaringBitmap32();
+      for (let i = 0; i < 100000; ++i) {
+        dense.add(i * 7);
+      }
+      const compressed = dense.serialize(false, { compressed: true });
+      expect(compressed[0]).eq(4);
+      expect(compressed.length < dense.serialize(false).length / 2).eq(true);
+    });
+
+    it("is never bigger than the non portable format", () => {
+      for (const bitmap of makeBitmaps()) {
+        expect(bitmap.serialize(false, { compressed: true }).length <= bitmap.serialize(false).length).eq(true);
+      }
+    });
+
+    it("can be serialized and deserialized", () => {
+      for (const bitmap of makeBitmaps()) {
+        const serialized = bitmap.serialize(false, { compressed: true });
+        expect(serialized.length).eq(bitmap.getSerializationSizeInBytes(false, { compressed: true }));
+        expect(RoaringBitmap32.deserialize(serialized, false).toArray()).deep.equal(bitmap.toArray());
+      }
+    });
+
+    it("can be combined with checksum", () => {
+      for (const bitmap of makeBitmaps()) {
+        const serialized = bitmap.serialize(false, { compressed: true, checksum: true });
+        expect(serialized[0]).eq(3);
+        expect(RoaringBitmap32.deserialize(serialized, false).isEqual(bitmap)).eq(true);
+      }
+    });
+
+    it("fails on truncated data", () => {
+      const bitmap = makeBitmaps()[5];
+      const serialized = bitmap.serialize(false, { compressed: true });
+      expect(() => RoaringBitmap32.deserialize(serialized.subarray(0, serialized.length - 1), false)).to.throw(Error);
+      expect(() => RoaringBitmap32.deserialize(Buffer.concat([serialized, Buffer.from([0])]), false)).to.throw(Error);
+    });
+
+    it("fails on overlong or non canonical varints", () => {
+      // One container with key 0 and the single value 5.
+      expect(RoaringBitmap32.deserialize(Buffer.from([4, 1, 0, 0, 0, 5]), false).toArray()).deep.equal([5]);
+      // 5 with a trailing zero byte.
+      expect(() => RoaringBitmap32.deserialize(Buffer.from([4, 1, 0, 0, 0, 0x85, 0]), false)).to.throw(Error);
+      // A container count with bits above 32 bits in the fifth byte.
+      const overlong = Buffer.from([4, 0x81, 0x80, 0x80, 0x80, 0x10, 0, 0, 0, 5]);
+      expect(() => RoaringBitmap32.deserialize(overlong, false)).to.throw(Error);
+    });
+
+    it("is not supported by the portable format", () => {
+      expect(() => new RoaringBitmap32([1]).serialize(true, { compressed: true })).to.throw(TypeError);
+    });
+
+    it("serializes incrementally the changed containers", () => {
+      for (const bitmap of makeBitmaps()) {
+        const options = { compressed: true, incremental: true };
+        expect(bitmap.serialize(false, options).equals(bitmap.serialize(false, { compressed: true }))).eq(true);
+        expect(bitmap.getSerializationSizeInBytes(false, options)).eq(bitmap.serialize(false, options).length);
+
+        bitmap.add(3);
+        bitmap.remove(5);
+        bitmap.tryAdd(0x30005);
+        expect(bitmap.serialize(false, options).equals(bitmap.serialize(false, { compressed: true }))).eq(true);
+
+        bitmap.removeRange(0x10000, 0x20000);
+        bitmap.addMany([0x7f000001, 0x7f000002]);
+        const serialized = bitmap.serialize(false, { ...options, checksum: true });
+        expect(serialized.equals(bitmap.serialize(false, { compressed: true, checksum: true }))).eq(true);
+        expect(RoaringBitmap32.deserialize(serialized, false).isEqual(bitmap)).eq(true);
+
+        bitmap.clear();
+        expect(bitmap.serialize(false, options).equals(bitmap.serialize(false, { compressed: true }))).eq(true);
+      }
+    });
+
+    it("releases the incremental serialization memory with shrinkToFit", () => {
+      const bitmap = RoaringBitmap32.fromRange(0, 100000, 3);
+      bitmap.shrinkToFit();
+      bitmap.serialize(false, { compressed: true, incremental: true });
+      expect(bitmap.shrinkToFit()).to.be.gt(0);
+      expect(bitmap.shrinkToFit()).eq(0);
+    });
+
+    it("supports incremental only with the compressed format", () => {
+      expect(() => new RoaringBitmap32([1]).serialize(false, { incremental: true })).to.throw(TypeError);
+      expect(() => new RoaringBitmap32([1]).getSerializationSizeInBytes(false, { incremental: true })).to.throw(
+        TypeError,
+      );
+    });
+  });
+
+  describe("serializeAsync", () => {
+    it("returns a promise that resolves to the serialized buffer", async () => {
+      const bitmap = RoaringBitmap32.fromRange(0, 100000, 3);
+      for (const portable of [false, true]) {
+        const serialized = await bitmap.serializeAsync(portable);
+        expect(serialized).to.be.instanceOf(Buffer);
+        expect(serialized.equals(bitmap.serialize(portable))).eq(true);
+      }
+      const compressed = await bitmap.serializeAsync(false, { compressed: true, checksum: true });
+      expect(compressed.equals(bitmap.serialize(false, { compressed: true, checksum: true }))).eq(true);
+    });
+
+    it("serializes a snapshot of the bitmap", async () => {
+      const bitmap = new RoaringBitmap32([1, 2, 3]);
+      const promise = bitmap.serializeAsync(false, { compressed: true });
+      bitmap.add(4);
+      expect(RoaringBitmap32.deserialize(await promise, false).toArray()).deep.equal([1, 2, 3]);
+    });
+
+    it("works with a callback", (done) => {
+      const bitmap = new RoaringBitmap32([1, 2, 3]);
+      bitmap.serializeAsync(true, (error, buffer) => {
+        if (error) {
+          done(error);
+          return;
+        }
+        expect(RoaringBitmap32.deserialize(buffer!, true).toArray()).deep.equal([1, 2, 3]);
+        done();
+      });
+    });
+  });
+
+  describe("serializeToChunks", () => {
+    const makeBitmaps = () => {
+      const withRuns = new RoaringBitmap32([1, 2, 3, 0x10000, 0x20001, 0xffffffff]);
+      withRuns.addRange(0x30000, 0x38000);
+      withRuns.runOptimize();
+      const manyContainers = new RoaringBitmap32();
+      for (let i = 0; i < 100; ++i) {
+        manyContainers.addRange(i * 0x10000 + i, i * 0x10000 + i * 2 + 1);
+      }
+      manyContainers.addRange(0x1000000, 0x1008000);
+      manyContainers.runOptimize();
+      const bitset = new RoaringBitmap32();
+      for (let i = 0; i < 20000; ++i) {
+        bitset.add(i * 3);
+      }
+      const fewRuns = RoaringBitmap32.fromRange(10, 1000);
+      fewRuns.runOptimize();
+      return [new RoaringBitmap32(), new RoaringBitmap32([5]), fewRuns, withRuns, manyContainers, bitset];
+    };
+
+    it("produces the same bytes of serialize(true)", () => {
+      for (const bitmap of makeBitmaps()) {
+        const expected = bitmap.serialize(true);
+        for (const chunkSize of [1, 3, 7, 64, 4096, 65536]) {
+          const chunks = Array.from(bitmap.serializeToChunks(chunkSize));
+          for (const chunk of chunks) {
+            expect(chunk).to.be.instanceOf(Buffer);
+            expect(chunk.length <= chunkSize).eq(true);
+          }
+          expect(Buffer.concat(chunks).equals(expected)).eq(true);
+        }
+      }
+    });
+
+    it("uses a default chunk size", () => {
+      const bitmap = RoaringBitmap32.fromRange(0, 1000000, 3);
+      const chunks = Array.from(bitmap.serializeToChunks());
+      expect(chunks.length > 1).eq(true);
+      expect(RoaringBitmap32.deserialize(Buffer.concat(chunks), true).isEqual(bitmap)).eq(true);
+    });
+
+    it("throws if the chunk size is invalid", () => {
+      const bitmap = new RoaringBitmap32([1, 2, 3]);
+      expect(() => bitmap.serializeToChunks(0).next()).to.throw(TypeError);
+      expect(() => bitmap.serializeToChunks(1.5).next()).to.throw(TypeError);
+    });
+
+    it("throws if the bitmap is changed while serializing", () => {
+      const bitmap = new RoaringBitmap32([1, 2, 3, 0x10000, 0x20000]);
+      const iterator = bitmap.serializeToChunks(4);
+      iterator.next();
+      bitmap.add(100);
+      expect(() => iterator.next()).to.throw(Error);
+    });
+
+    it("throws if the containers are converted while serializing", () => {
+      for (const convert of [(b: RoaringBitmap32) => b.runOptimize(), (b: RoaringBitmap32) => b.shrinkToFit()]) {
+        const bitmap = new RoaringBitmap32();
+        for (let i = 0; i < 300; ++i) {
+          bitmap.add(i * 2);
+          bitmap.addRange(0x10000 + i * 10, 0x10000 + i * 10 + 5);
+        }
+        const iterator = bitmap.serializeToChunks(16);
+        iterator.next();
+        convert(bitmap);
+        expect(() => iterator.next()).to.throw(Error);
+      }
+    });
+  });
 });
@@ -73,6 +73,50 @@ describe("RoaringBitmap32 static", () => {
       }
       expect(Array.from(bitmap)).deep.equal(values.slice().sort((a, b) => a - b));
     });
+
+    it("converts the numbers of an array like Uint32Array.from", () => {
+      const values = [-1, 1.5, 4294967296 + 7, -4294967296 - 9, NaN, Infinity, 2 ** 40 + 3, 0xffffffff];
+      const bitmap = new RoaringBitmap32(values);
+      expect(Array.from(bitmap)).deep.equal(Array.from(new Set(Uint32Array.from(values))).sort((a, b) => a - b));
+    });
+
+    it("works with arrays that do not contain only numbers", () => {
+      const sparse = [1, 2];
+      sparse[5] = 10;
+      expect(Array.from(new RoaringBitmap32(sparse))).deep.equal([0, 1, 2, 10]);
+      expect(Array.from(new RoaringBitmap32(["3", 1, "2"] as any))).deep.equal([1, 2, 3]);
+      expect(Array.from(new RoaringBitmap32().removeMany(["3"] as any))).deep.equal([]);
+      expect(Array.from(new RoaringBitmap32([1, 2, 3]).removeMany([1, 3]))).deep.equal([2]);
+    });
+
+    it("builds the smallest containers for sorted values", () => {
+      const values: number[] = [];
+      for (let i = 0; i < 1000; ++i) {
+        values.push(i);
+      }
+      for (let i = 0x10000; i < 0x20000; i += 2) {
+        values.push(i);
+      }
+      values.push(0x30000, 0x30002, 0x30004);
+      const bitmap = new RoaringBitmap32(values);
+      expect(bitmap.statistics()).to.deep.include({
+        containers: 3,
+        runContainers: 1,
+        bitsetContainers: 1,
+        arrayContainers: 1,
+        valuesInRunContainers: 1000,
+        valuesInArrayContainers: 3,
+      });
+      expect(bitmap.toArray()).deep.equal(values);
+      expect(new RoaringBitmap32(new Uint32Array(values)).isEqual(bitmap)).eq(true);
+      expect(new RoaringBitmap32(new Uint32Array(values)).statistics()).deep.equal(bitmap.statistics());
+    });
+
+    it("builds unsorted values and values with duplicates", () => {
+      const values = [5, 5, 3, 70000, 3, 1, 70000];
+      expect(Array.from(new RoaringBitmap32(values))).deep.equal([1, 3, 5, 70000]);
+      expect(Array.from(new RoaringBitmap32([1, 2, 3]).copyFrom([10, 11]))).deep.equal([10, 11]);
+    });
   });
 
   describe("static from", () => {
@@ -0,0 +1,134 @@
+import RoaringBitmap32 from "../../RoaringBitmap32";
+import { expect } from "chai";
+
+describe("RoaringBitmap32 text", () => {
+  describe("toText", () => {
+    it("writes an empty bitmap", () => {
+      const bitmap = new RoaringBitmap32();
+      expect(bitmap.toText()).eq("[]");
+      expect(bitmap.toText("json")).eq("[]");
+      expect(bitmap.toText("csv")).eq("");
+      expect(bitmap.toText("ndjson")).eq("");
+    });
+
+    it("writes all the formats", () => {
+      const bitmap = new RoaringBitmap32([0, 1, 10, 4294967295]);
+      expect(bitmap.toText()).eq("[0,1,10,4294967295]");
+      expect(bitmap.toText("csv")).eq("0,1,10,4294967295");
+      expect(bitmap.toText("ndjson")).eq("0\n1\n10\n4294967295\n");
+    });
+
+    it("writes the same json as JSON.stringify", () => {
+      const bitmap = RoaringBitmap32.fromRange(99990, 200000, 7);
+      bitmap.addRange(1000000, 1070000);
+      expect(bitmap.toText("json")).eq(JSON.stringify(bitmap));
+    });
+
+    it("throws for an invalid format", () => {
+      expect(() => new RoaringBitmap32([1]).toText("xml" as any)).to.throw(TypeError);
+      expect(() => new RoaringBitmap32([1]).toText(1 as any)).to.throw(TypeError);
+    });
+  });
+
+  describe("fromText", () => {
+    it("reads json", () => {
+      expect(RoaringBitmap32.fromText("[]").toArray()).deep.equal([]);
+      expect(RoaringBitmap32.fromText(" [ 3 , 1,\n2 ]\n").toArray()).deep.equal([1, 2, 3]);
+      expect(RoaringBitmap32.fromText("[4294967295,0]", "json").toArray()).deep.equal([0, 4294967295]);
+    });
+
+    it("reads csv with ranges", () => {
+      expect(RoaringBitmap32.fromText("", "csv").size).eq(0);
+      expect(RoaringBitmap32.fromText("1,2,,5 - 8\r\n100\n", "csv").toArray()).deep.equal([1, 2, 5, 6, 7, 8, 100]);
+      expect(RoaringBitmap32.fromText("4294967290-4294967295", "csv").size).eq(6);
+    });
+
+    it("reads ndjson with ranges", () => {
+      const bitmap = RoaringBitmap32.fromText("1\n\n3-4\n 123456789 \n", "ndjson");
+      expect(bitmap.toArray()).deep.equal([1, 3, 4, 123456789]);
+    });
+
+    it("reads a Buffer", () => {
+      expect(RoaringBitmap32.fromText(Buffer.from("[1,2,3]")).toArray()).deep.equal([1, 2, 3]);
+      expect(RoaringBitmap32.fromText(new Uint8Array(Buffer.from("7\n8")), "ndjson").toArray()).deep.equal([7, 8]);
+    });
+
+    it("reads back what toText writes", () => {
+      const bitmap = RoaringBitmap32.fromRange(0, 100000, 3);
+      bitmap.addRange(2000000, 2100000);
+      bitmap.add(4294967295);
+      for (const format of ["json", "csv", "ndjson"] as const) {
+        expect(RoaringBitmap32.fromText(bitmap.toText(format), format).isEqual(bitmap)).eq(true);
+      }
+    });
+
+    it("throws for invalid text", () => {
+      expect(() => RoaringBitmap32.fromText("")).to.throw(Error);
+      expect(() => RoaringBitmap32.fromText("[1,2")).to.throw(Error);
+      expect(() => RoaringBitmap32.fromText("[1,,2]")).to.throw(Error);
+      expect(() => RoaringBitmap32.fromText("[1-2]")).to.throw(Error);
+      expect(() => RoaringBitmap32.fromText("[-1]")).to.throw(Error);
+      expect(() => RoaringBitmap32.fromText("[1] x")).to.throw(Error);
+      expect(() => RoaringBitmap32.fromText("[1.5]")).to.throw(Error);
+      expect(() => RoaringBitmap32.fromText("[4294967296]")).to.throw(Error);
+      expect(() => RoaringBitmap32.fromText("[00000000004294967295]")).to.throw(Error);
+      expect(() => RoaringBitmap32.fromText("1,2;3", "csv")).to.throw(Error);
+      expect(() => RoaringBitmap32.fromText("5-3", "csv")).to.throw(Error);
+      expect(() => RoaringBitmap32.fromText("1,2", "ndjson")).to.throw(Error);
+    });
+
+    it("throws for invalid arguments", () => {
+      expect(() => RoaringBitmap32.fromText(123 as any)).to.throw(TypeError);
+      expect(() => RoaringBitmap32.fromText([1, 2] as any)).to.throw(TypeError);
+      expect(() => RoaringBitmap32.fromText("[1]", "xml" as any)).to.throw(TypeError);
+    });
+  });
+
+  describe("async", () => {
+    it("reads text with fromTextAsync", async () => {
+      const bitmap = RoaringBitmap32.fromRange(0, 300000, 2);
+      expect((await RoaringBitmap32.fromTextAsync(bitmap.toText())).isEqual(bitmap)).eq(true);
+      expect((await RoaringBitmap32.fromTextAsync(Buffer.from(bitmap.toText("csv")), "csv")).isEqual(bitmap)).eq(true);
+      expect((await RoaringBitmap32.fromTextAsync("1-3", "ndjson", {})).toArray()).deep.equal([1, 2, 3]);
+    });
+
+    it("rejects invalid text in fromTextAsync", async () => {
+      let error: any;
+      try {
+        await RoaringBitmap32.fromTextAsync("[1,x]");
+      } catch (e) {
+        error = e;
+      }
+      expect(error).to.be.instanceOf(Error);
+    });
+
+    it("supports callbacks", (done) => {
+      RoaringBitmap32.fromTextAsync("1,2", "csv", (error, bitmap) => {
+        try {
+          expect(error).to.be.null;
+          expect(bitmap!.toArray()).deep.equal([1, 2]);
+          bitmap!.toTextAsync("ndjson", (toTextError, text) => {
+            try {
+              expect(toTextError).to.be.null;
+              expect(text).eq("1\n2\n");
+              done();
+            } catch (e) {
+              done(e);
+            }
+          });
+        } catch (e) {
+          done(e);
+        }
+      });
+    });
+
+    it("writes text with toTextAsync", async () => {
+      const bitmap = RoaringBitmap32.fromRange(0, 100000, 5);
+      const promise = bitmap.toTextAsync("csv");
+      bitmap.clear();
+      expect(await promise).eq(RoaringBitmap32.fromRange(0, 100000, 5).toText("csv"));
+      expect(await bitmap.toTextAsync()).eq("[]");
+      expect(await bitmap.toTextAsync(undefined, {})).eq("[]");
+    });
+  });
+});
@@ -0,0 +1,96 @@
+import RoaringBitmap32 from "../../RoaringBitmap32";
+import { expect } from "chai";
+import * as crypto from "crypto";
+
+describe("RoaringBitmap32 thread pool", () => {
+  afterEach(() => {
+    RoaringBitmap32.setThreadPoolSize(0);
+  });
+
+  it("has a default size of at least one thread", () => {
+    expect(RoaringBitmap32.getThreadPoolSize()).to.be.a("number");
+    expect(RoaringBitmap32.getThreadPoolSize()).to.be.greaterThan(0);
+  });
+
+  it("can be resized and reset", () => {
+    const defaultSize = RoaringBitmap32.getThreadPoolSize();
+    RoaringBitmap32.setThreadPoolSize(3);
+    expect(RoaringBitmap32.getThreadPoolSize()).eq(3);
+    RoaringBitmap32.setThreadPoolSize(0);
+    expect(RoaringBitmap32.getThreadPoolSize()).eq(defaultSize);
+  });
+
+  it("throws for an invalid size", () => {
+    expect(() => RoaringBitmap32.setThreadPoolSize(-1)).to.throw();
+    expect(() => RoaringBitmap32.setThreadPoolSize(1.5)).to.throw();
+    expect(() => RoaringBitmap32.setThreadPoolSize(100000)).to.throw();
+    expect(() => RoaringBitmap32.setThreadPoolSize("2" as any)).to.throw();
+  });
+
+  it("runs parallel jobs after a resize", async () => {
+    const buffers = [];
+    for (let i = 0; i < 20; ++i) {
+      buffers.push(RoaringBitmap32.fromRange(i * 100, i * 100 + 1000).serialize(false));
+    }
+
+    RoaringBitmap32.setThreadPoolSize(1);
+    let result = await RoaringBitmap32.deserializeParallelAsync(buffers, false);
+    expect(result.map((x) => x.size)).deep.equal(buffers.map(() => 1000));
+
+    RoaringBitmap32.setThreadPoolSize(5);
+    result = await RoaringBitmap32.deserializeParallelAsync(buffers, false);
+    expect(result.map((x) => x.minimum())).deep.equal(buffers.map((_, i) => i * 100));
+  });
+
+  it("starts the jobs with an higher priority first", async () => {
+    const serialized = RoaringBitmap32.fromRange(0, 120000000, 3).serialize(false);
+    RoaringBitmap32.setThreadPoolSize(1);
+    const order: string[] = [];
+    const run = (name: string, priority?: "background" | "normal" | "high") =>
+      RoaringBitmap32.deserializeAsync(serialized, false, { priority }).then(() => {
+        order.push(name);
+      });
+
+    // The first job keeps the only thread busy while the others are queued.
+    await Promise.all([
+      run("first", "high"),
+      run("background", "background"),
+      run("default"),
+      run("normal", "normal"),
+      run("high", "high"),
+    ]);
+    expect(order).deep.equal(["first", "high", "default", "normal", "background"]);
+  });
+
+  it("throws for an invalid priority", () => {
+    const serialized = new RoaringBitmap32([1]).serialize(false);
+    expect(() => RoaringBitmap32.deserializeAsync(serialized, false, { priority: "low" as any })).to.throw(TypeError);
+    expect(() => new RoaringBitmap32([1]).serializeAsync(false, { priority: 2 as any })).to.throw(TypeError);
+  });
+
+  it("does not wait for the libuv thread pool", async () => {
+    const order: string[] = [];
+    const pending: Promise<void>[] = [];
+    for (let i = 0; i < 8; ++i) {
+      pending.push(
+        new Promise<void>((resolve, reject) => {
+          crypto.pbkdf2("password", "salt", 200000, 64, "sha512", (error) => {
+            if (error) {
+              reject(error);
+            } else {
+              order.push("pbkdf2");
+              resolve();
+            }
+          });
+        }),
+      );
+    }
+
+    const bitmap = await RoaringBitmap32.deserializeAsync(RoaringBitmap32.fromRange(0, 1000).serialize(true), true);
+    order.push("deserialize");
+    expect(bitmap.size).eq(1000);
+
+    await Promise.all(pending);
+    expect(order[0]).eq("deserialize");
+  });
+});
@@ -0,0 +1,124 @@
+import RoaringBitmap32 from "../../RoaringBitmap32";
+import { expect } from "chai";
+
+let workerThreads: typeof import("worker_threads") | undefined;
+try {
+  workerThreads = require("worker_threads");
+} catch {
+  workerThreads = undefined;
+}
+
+const workerSource = `
+const { parentPort, workerData } = require("worker_threads");
+const { RoaringBitmap32 } = require(workerData.roaringPath);
+const view = RoaringBitmap32.frozenView(workerData.buffer);
+const bitmap = new RoaringBitmap32([1, 2, 3]);
+bitmap.addRange(100, 200);
+parentPort.postMessage({
+  viewSize: view.size,
+  viewIsFrozen: view.isFrozen,
+  viewHas: view.has(workerData.value),
+  size: RoaringBitmap32.or(bitmap, view).size,
+  deserialized: RoaringBitmap32.deserialize(bitmap.serialize(true), true).size,
+});
+`;
+
+const asyncWorkerSource = `
+const { parentPort } = require("worker_threads");
+const { RoaringBitmap32 } = require(require("worker_threads").workerData.roaringPath);
+(async () => {
+  const values = [];
+  for (let i = 0; i < 300000; ++i) {
+    values.push(i * 3);
+  }
+  const bitmap = await RoaringBitmap32.fromArrayAsync(values);
+  const serialized = await bitmap.serializeAsync(true);
+  const deserialized = await RoaringBitmap32.deserializeAsync(serialized, true);
+  const parallel = await RoaringBitmap32.deserializeParallelAsync([serialized, serialized], true);
+  parentPort.postMessage({
+    size: bitmap.size,
+    deserialized: deserialized.size,
+    parallel: parallel.map((b) => b.size),
+    equal: deserialized.isEqual(bitmap),
+  });
+})().catch((error) => parentPort.postMessage({ error: String(error) }));
+`;
+
+const pendingAsyncWorkerSource = `
+const { parentPort, workerData } = require("worker_threads");
+const { RoaringBitmap32 } = require(workerData.roaringPath);
+const values = new Uint32Array(400000);
+for (let i = 0; i < values.length; ++i) {
+  values[i] = i * 7;
+}
+const bitmap = RoaringBitmap32.from(values);
+const serialized = bitmap.serialize(true);
+for (let i = 0; i < 8; ++i) {
+  bitmap.serializeAsync(true).catch(() => {});
+  RoaringBitmap32.fromArrayAsync(values).catch(() => {});
+  RoaringBitmap32.deserializeParallelAsync([serialized, serialized], true).catch(() => {});
+}
+parentPort.postMessage(1);
+`;
+
+function runWorker(buffer: SharedArrayBuffer | null, value: number, source = workerSource): Promise<any> {
+  return new Promise((resolve, reject) => {
+    const worker = new workerThreads!.Worker(source, {
+      eval: true,
+      workerData: { roaringPath: require.resolve("../../index"), buffer, value },
+    });
+    worker.once("message", resolve);
+    worker.once("error", reject);
+  });
+}
+
+(workerThreads ? describe : describe.skip)("RoaringBitmap32 worker threads", () => {
+  it("can be loaded and used in multiple worker threads sharing a frozen bitmap", async () => {
+    const shared = RoaringBitmap32.fromRange(1000, 2000);
+    const buffer = shared.serializeFrozen();
+    const results = await Promise.all([runWorker(buffer, 1500), runWorker(buffer, 5), runWorker(buffer, 1999)]);
+    for (const result of results) {
+      expect(result.viewSize).eq(1000);
+      expect(result.viewIsFrozen).eq(true);
+      expect(result.size).eq(1103);
+      expect(result.deserialized).eq(103);
+    }
+    expect(results.map((result) => result.viewHas)).deep.equal([true, false, true]);
+  });
+
+  it("keeps working in the main thread after the workers exit", async () => {
+    await runWorker(new RoaringBitmap32([5]).serializeFrozen(), 5);
+    const bitmap = new RoaringBitmap32([1, 2, 3]);
+    expect(RoaringBitmap32.deserialize(bitmap.serialize(false), false).toArray()).deep.equal([1, 2, 3]);
+    expect(await RoaringBitmap32.fromArrayAsync([4, 5])).to.be.instanceOf(RoaringBitmap32);
+  });
+
+  it("can terminate worker threads with pending async operations", async () => {
+    for (let round = 0; round < 2; ++round) {
+      const workers: import("worker_threads").Worker[] = [];
+      for (let i = 0; i < 20; ++i) {
+        workers.push(
+          new workerThreads!.Worker(pendingAsyncWorkerSource, {
+            eval: true,
+            workerData: { roaringPath: require.resolve("../../index") },
+          }),
+        );
+      }
+      await Promise.all(workers.map((worker) => new Promise((resolve) => worker.once("message", resolve))));
+      await Promise.all(workers.map((worker) => worker.terminate()));
+    }
+    expect((await RoaringBitmap32.fromArrayAsync([1, 2, 3])).toArray()).deep.equal([1, 2, 3]);
+  });
+
+  it("runs async operations inside worker threads", async () => {
+    const results = await Promise.all([
+      runWorker(null, 0, asyncWorkerSource),
+      runWorker(null, 0, asyncWorkerSource),
+      runWorker(null, 0, asyncWorkerSource),
+    ]);
+    for (const result of results) {
+      expect(result).deep.equal({ size: 300000, deserialized: 300000, parallel: [300000, 300000], equal: true });
+    }
+    expect((await RoaringBitmap32.fromArrayAsync([7, 8])).toArray()).deep.equal([7, 8]);
+  });
+});
@@ -270,5 +270,39 @@ describe("RoaringBitmap32Iterator", () => {
       }
       expect(error.message).eq("RoaringBitmap32 iterator - bitmap changed while iterating");
     });
+
+    it("iterates a snapshot while the bitmap is changed", () => {
+      const bitmap = new RoaringBitmap32();
+      bitmap.addRange(0, 1050);
+      bitmap.add(200000);
+      const expected = bitmap.toArray();
+
+      const iterator = new RoaringBitmap32Iterator(bitmap, 256, { snapshot: true });
+      bitmap.add(5000);
+      const values: number[] = [];
+      for (const v of iterator) {
+        values.push(v);
+        if (values.length === 1) {
+          bitmap.removeRange(0, 2000);
+          bitmap.add(999999);
+        }
+        if (values.length === 300) {
+          bitmap.clear();
+          bitmap.shrinkToFit();
+        }
+      }
+      expect(values).deep.equal(expected);
+      expect(bitmap.size).eq(0);
+    });
+
+    it("iterates a snapshot with bitmap.iterator", () => {
+      const bitmap = RoaringBitmap32.fromRange(0, 100000, 7);
+      const expected = bitmap.toArray();
+      const iterator = bitmap.iterator({ snapshot: true });
+      bitmap.flipRange(0, 100000);
+      expect(Array.from(iterator)).deep.equal(expected);
+      expect(Array.from(bitmap.iterator({ snapshot: true }))).deep.equal(bitmap.toArray());
+      expect(Array.from(new RoaringBitmap32().iterator({ snapshot: true }))).deep.equal([]);
+    });
   });
 });
@@ -3,6 +3,7 @@ import { expect } from "chai";
 
 import RoaringBitmap32 from "../RoaringBitmap32";
 import RoaringBitmap32Iterator from "../RoaringBitmap32Iterator";
+import RoaringBitmap32Bundle from "../RoaringBitmap32Bundle";
 
 describe("roaring", () => {
   it("is an object", () => {
@@ -26,6 +27,11 @@ describe("roaring", () => {
     expect(roaring.RoaringBitmap32Iterator === RoaringBitmap32Iterator).to.be.true;
   });
 
+  it("has RoaringBitmap32Bundle", () => {
+    expect(typeof roaring.RoaringBitmap32Bundle).eq("function");
+    expect(roaring.RoaringBitmap32Bundle === RoaringBitmap32Bundle).to.be.true;
+  });
+
   it("has CRoaringVersion", () => {
     expect(typeof roaring.CRoaringVersion).eq("string");
     const values = roaring.CRoaringVersion.split(".");